@@ -1,28 +1,9 @@
-QT       += core gui sql network
+# 主程序、各组件的功能测试和基准测试一起构建，make check 运行所有测试
+TEMPLATE = subdirs
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+SUBDIRS += \
+    app \
+    benchmarks \
+    tests
 
-CONFIG += c++17
-
-# You can make your code fail to compile if it uses deprecated APIs.
-# In order to do so, uncomment the following line.
-#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
-
-SOURCES += \
-    main.cpp \
-    mainwindow.cpp \
-    timepickerdialog.cpp \
-    userdefinedscenedialog.cpp
-
-HEADERS += \
-    mainwindow.h \
-    timepickerdialog.h \
-    userdefinedscenedialog.h
-
-FORMS += \
-    mainwindow.ui
-
-# Default rules for deployment.
-qnx: target.path = /tmp/$${TARGET}/bin
-else: unix:!android: target.path = /opt/$${TARGET}/bin
-!isEmpty(target.path): INSTALLS += target
+app.file = app.pro
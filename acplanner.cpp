@@ -0,0 +1,123 @@
+#include "acplanner.h"
+#include "ruleengine.h"
+#include <QDebug>
+
+AcPlanner::AcPlanner()
+    : ruleEngine(nullptr)
+{
+}
+
+void AcPlanner::setRuleEngine(const RuleEngine *engine)
+{
+    ruleEngine = engine;
+}
+
+void AcPlanner::recomputeAll()
+{
+    for (auto it = forecastByHour.constBegin(); it != forecastByHour.constEnd(); ++it) {
+        for (int room = 0; room < RoomCount; ++room) {
+            plan[room].insert(it.key(), computeEntry(Room(room), it.key(), it.value()));
+        }
+    }
+    qDebug() << "规则变化，重新计算空调计划" << forecastByHour.size() << "个小时";
+}
+
+int AcPlanner::updateForecast(const QVector<HourlyForecast> &forecast, const QDateTime &now)
+{
+    // 丢弃已经过去的小时
+    QDateTime currentHour = truncateToHour(now);
+    while (!forecastByHour.isEmpty() && forecastByHour.firstKey() < currentHour) {
+        QDateTime expired = forecastByHour.firstKey();
+        forecastByHour.remove(expired);
+        for (int room = 0; room < RoomCount; ++room) {
+            plan[room].remove(expired);
+        }
+    }
+
+    int recomputed = 0;
+    for (const HourlyForecast &item : forecast) {
+        QDateTime hour = truncateToHour(item.hour);
+        if (!hour.isValid() || hour < currentHour) {
+            continue;
+        }
+
+        // 温度没有变化的小时保留原计划
+        auto it = forecastByHour.constFind(hour);
+        if (it != forecastByHour.constEnd() && it.value() == item.temp) {
+            continue;
+        }
+
+        forecastByHour.insert(hour, item.temp);
+        for (int room = 0; room < RoomCount; ++room) {
+            plan[room].insert(hour, computeEntry(Room(room), hour, item.temp));
+        }
+        recomputed++;
+    }
+
+    qDebug() << "空调计划更新完成，重新计算" << recomputed << "个小时，共" << forecastByHour.size() << "个小时";
+    return recomputed;
+}
+
+bool AcPlanner::lookup(Room room, const QDateTime &when, AcPlanEntry *entry) const
+{
+    auto it = plan[room].constFind(truncateToHour(when));
+    if (it == plan[room].constEnd()) {
+        return false;
+    }
+    if (entry) {
+        *entry = it.value();
+    }
+    return true;
+}
+
+AcPlanEntry AcPlanner::computeEntry(Room room, const QDateTime &hour, int outsideTemp) const
+{
+    AcPlanEntry entry;
+    entry.hour = hour;
+    entry.outsideTemp = outsideTemp;
+    if (!ruleEngine) {
+        return entry;
+    }
+
+    QHash<QString, double> overrides;
+    overrides.insert("sensor.outside", outsideTemp);
+    overrides.insert("time.hour", hour.time().hour());
+
+    // 没有规则命中时保持关闭
+    const QString deviceId = acDeviceId(room);
+    const QVector<RuleAction> actions = ruleEngine->dryRun("plan." + roomName(room), overrides);
+    for (const RuleAction &action : actions) {
+        if (action.deviceId != deviceId) {
+            continue;
+        }
+        if (action.command == "power") {
+            entry.turnOn = (action.value == "on");
+        } else if (action.command == "mode") {
+            entry.mode = action.value;
+        } else if (action.command == "temperature") {
+            entry.targetTemp = action.value.toInt();
+        }
+    }
+    return entry;
+}
+
+QDateTime AcPlanner::truncateToHour(const QDateTime &time)
+{
+    QDateTime local = time.toLocalTime();
+    return QDateTime(local.date(), QTime(local.time().hour(), 0));
+}
+
+QString AcPlanner::roomName(Room room)
+{
+    return room == Bedroom ? QString("Bedroom") : QString("Livingroom");
+}
+
+QString AcPlanner::acDeviceId(Room room)
+{
+    return roomName(room) + "Ac";
+}
+
+int AcPlanner::plannedHours() const
+{
+    return forecastByHour.size();
+}
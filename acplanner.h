@@ -0,0 +1,67 @@
+#ifndef ACPLANNER_H
+#define ACPLANNER_H
+
+#include <QDateTime>
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+class RuleEngine;
+
+// 某个房间某个小时的空调计划
+struct AcPlanEntry
+{
+    QDateTime hour;        // 整点时间
+    int outsideTemp = 0;   // 该小时的预报室外温度
+    bool turnOn = false;   // 是否需要开空调
+    QString mode;          // 空调模式（制冷/制热/睡眠）
+    int targetTemp = 0;    // 设定温度
+};
+
+// 单小时的预报数据
+struct HourlyForecast
+{
+    QDateTime hour;
+    int temp = 0;
+};
+
+// 空调计划：根据逐小时预报提前算好未来24小时每个房间的空调模式和温度，
+// 场景执行时直接查表，不再在点击时临时判断。
+// 开关、模式和温度由规则引擎中 plan.<房间> 事件的规则试算得出，阈值只在规则中定义
+class AcPlanner
+{
+public:
+    enum Room {
+        Livingroom,
+        Bedroom,
+        RoomCount
+    };
+
+    AcPlanner();
+
+    // 规则变化后需要调用 recomputeAll 重新计算已有的小时
+    void setRuleEngine(const RuleEngine *engine);
+    void recomputeAll();
+
+    // 合并新的预报，只重新计算温度有变化或新出现的小时，返回重新计算的小时数
+    int updateForecast(const QVector<HourlyForecast> &forecast, const QDateTime &now = QDateTime::currentDateTime());
+
+    // 查询某个时间点所在小时的计划，没有计划时返回false
+    bool lookup(Room room, const QDateTime &when, AcPlanEntry *entry) const;
+
+    // 根据室外温度试算规则，得到单个房间的空调计划
+    AcPlanEntry computeEntry(Room room, const QDateTime &hour, int outsideTemp) const;
+
+    static QDateTime truncateToHour(const QDateTime &time);
+    static QString roomName(Room room);
+    static QString acDeviceId(Room room);
+
+    int plannedHours() const;
+
+private:
+    const RuleEngine *ruleEngine;
+    QMap<QDateTime, int> forecastByHour;  // 整点 -> 预报温度
+    QMap<QDateTime, AcPlanEntry> plan[RoomCount];
+};
+
+#endif // ACPLANNER_H
@@ -0,0 +1,193 @@
+#include "allocationcounter.h"
+#include <cstdlib>
+#include <new>
+#if defined(SMARTHOME_COUNT_ALLOCATIONS) && defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+// 线程局部的普通整数：分配函数中不能再分配内存，也不需要原子操作
+static thread_local quint64 threadAllocations = 0;
+static thread_local quint64 threadBytes = 0;
+static thread_local qint64 threadLiveBytes = 0;
+static thread_local qint64 threadPeakBytes = 0;
+
+bool AllocationCounter::isEnabled()
+{
+#ifdef SMARTHOME_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+quint64 AllocationCounter::allocations()
+{
+    return threadAllocations;
+}
+
+quint64 AllocationCounter::bytes()
+{
+    return threadBytes;
+}
+
+void AllocationCounter::record(std::size_t size)
+{
+    ++threadAllocations;
+    threadBytes += size;
+}
+
+bool AllocationCounter::tracksLiveBytes()
+{
+#if defined(SMARTHOME_COUNT_ALLOCATIONS) && defined(__GLIBC__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+qint64 AllocationCounter::liveBytes()
+{
+    return threadLiveBytes;
+}
+
+void AllocationCounter::recordLive(qint64 delta)
+{
+    threadLiveBytes += delta;
+    if (threadLiveBytes > threadPeakBytes) {
+        threadPeakBytes = threadLiveBytes;
+    }
+}
+
+AllocationScope::AllocationScope()
+    : startAllocations(AllocationCounter::allocations())
+    , startBytes(AllocationCounter::bytes())
+    , startLiveBytes(threadLiveBytes)
+    , outerPeakBytes(threadPeakBytes)
+{
+    // 峰值从作用域开始时重新统计
+    threadPeakBytes = threadLiveBytes;
+}
+
+AllocationScope::~AllocationScope()
+{
+    threadPeakBytes = qMax(threadPeakBytes, outerPeakBytes);
+}
+
+quint64 AllocationScope::allocations() const
+{
+    return AllocationCounter::allocations() - startAllocations;
+}
+
+quint64 AllocationScope::bytes() const
+{
+    return AllocationCounter::bytes() - startBytes;
+}
+
+qint64 AllocationScope::peakBytes() const
+{
+    return threadPeakBytes - startLiveBytes;
+}
+
+#ifdef SMARTHOME_COUNT_ALLOCATIONS
+#if defined(__GLIBC__)
+
+// 可执行文件中定义的 malloc 会覆盖 libc 的符号，再转调 glibc 的内部实现；
+// 默认的 operator new 也调用 malloc，所以不需要再替换。
+// 已分配未释放的字节数按块的实际大小（malloc_usable_size）增减，释放时才能减去同样的值
+extern "C" {
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t count, std::size_t size);
+void *__libc_realloc(void *ptr, std::size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(std::size_t size)
+{
+    AllocationCounter::record(size);
+    void *result = __libc_malloc(size);
+    if (result) {
+        AllocationCounter::recordLive(qint64(malloc_usable_size(result)));
+    }
+    return result;
+}
+
+void *calloc(std::size_t count, std::size_t size)
+{
+    AllocationCounter::record(count * size);
+    void *result = __libc_calloc(count, size);
+    if (result) {
+        AllocationCounter::recordLive(qint64(malloc_usable_size(result)));
+    }
+    return result;
+}
+
+void *realloc(void *ptr, std::size_t size)
+{
+    AllocationCounter::record(size);
+    const std::size_t oldSize = ptr ? malloc_usable_size(ptr) : 0;
+    void *result = __libc_realloc(ptr, size);
+    // 失败时原来的块保持不变；size 为0时原来的块已释放
+    if (result || size == 0) {
+        AllocationCounter::recordLive(qint64(result ? malloc_usable_size(result) : 0) - qint64(oldSize));
+    }
+    return result;
+}
+
+void free(void *ptr)
+{
+    if (ptr) {
+        AllocationCounter::recordLive(-qint64(malloc_usable_size(ptr)));
+    }
+    __libc_free(ptr);
+}
+}
+
+#else
+
+void *operator new(std::size_t size)
+{
+    AllocationCounter::record(size);
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    AllocationCounter::record(size);
+    return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    AllocationCounter::record(size);
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+#endif // __GLIBC__
+#endif // SMARTHOME_COUNT_ALLOCATIONS
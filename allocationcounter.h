@@ -0,0 +1,49 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <QtGlobal>
+#include <cstddef>
+
+// 堆分配计数（可选）：以 CONFIG+=count_allocations 构建（定义 SMARTHOME_COUNT_ALLOCATIONS）时替换全局分配函数，
+// 按线程统计分配次数和字节数；未打开时所有计数都是0，不影响正式构建
+//
+// glibc 上拦截 malloc/calloc/realloc，Qt 容器和 operator new 的分配都会被统计；
+// 其他平台只替换 operator new，Qt 容器直接调用 malloc 的分配统计不到
+class AllocationCounter
+{
+public:
+    static bool isEnabled();
+
+    // 当前线程累计的分配次数和字节数
+    static quint64 allocations();
+    static quint64 bytes();
+
+    static void record(std::size_t size);
+
+    // 当前线程已分配未释放的字节数（按 malloc_usable_size 计），只在 glibc 上统计；
+    // 在一个线程分配、另一个线程释放的内存会让两边的值都有偏差；memalign 等对齐分配不计入
+    static bool tracksLiveBytes();
+    static qint64 liveBytes();
+    static void recordLive(qint64 delta);
+};
+
+// 统计一段代码中当前线程的分配
+class AllocationScope
+{
+public:
+    AllocationScope();
+    ~AllocationScope();
+
+    quint64 allocations() const;
+    quint64 bytes() const;
+    // 作用域内已分配未释放内存的峰值，相对于开始时
+    qint64 peakBytes() const;
+
+private:
+    quint64 startAllocations;
+    quint64 startBytes;
+    qint64 startLiveBytes;
+    qint64 outerPeakBytes;  // 外层作用域的峰值，结束时合并回去
+};
+
+#endif // ALLOCATIONCOUNTER_H
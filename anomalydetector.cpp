@@ -0,0 +1,479 @@
+#include "anomalydetector.h"
+#include "metricsregistry.h"
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QStandardPaths>
+#include <QTime>
+#include <limits>
+
+AnomalyDetector::AnomalyDetector(QObject *parent)
+    : QObject(parent)
+    , ruleEngine(nullptr)
+    , latencyBudget(DefaultLatencyBudgetMs)
+    , rateHistory(0)
+    , wakeTimer(this)
+    , detectionSeconds(&MetricsRegistry::instance().histogram("smarthome_anomaly_detection_seconds",
+                                                              "Delay from triggering event to anomaly alert"))
+    , overBudget(&MetricsRegistry::instance().counter("smarthome_anomaly_latency_over_budget_total",
+                                                      "Anomaly alerts raised later than the latency budget"))
+{
+    qRegisterMetaType<AnomalyAlert>("AnomalyAlert");
+    clock.start();
+    // 时段边界可能在几个小时之后，粗精度定时器最多会提前5%
+    wakeTimer.setTimerType(Qt::PreciseTimer);
+    wakeTimer.setSingleShot(true);
+    connect(&wakeTimer, &QTimer::timeout, this, &AnomalyDetector::onWakeUp);
+}
+
+void AnomalyDetector::setRuleEngine(RuleEngine *engine)
+{
+    ruleEngine = engine;
+}
+
+bool AnomalyDetector::loadDetectors(const QByteArray &json, QString *errorMessage)
+{
+    QJsonParseError jsonError;
+    QJsonDocument doc = QJsonDocument::fromJson(json, &jsonError);
+    if (jsonError.error != QJsonParseError::NoError || !doc.isObject()) {
+        if (errorMessage) {
+            *errorMessage = "异常检测JSON解析失败: " + jsonError.errorString();
+        }
+        return false;
+    }
+
+    auto fail = [errorMessage](const QString &message) {
+        if (errorMessage) {
+            *errorMessage = message;
+        }
+        return false;
+    };
+
+    QJsonObject root = doc.object();
+    QVector<AnomalyRule> loaded;
+    const QJsonArray detectorArray = root["detectors"].toArray();
+    for (const QJsonValue &detectorValue : detectorArray) {
+        QJsonObject obj = detectorValue.toObject();
+        AnomalyRule rule;
+        rule.id = obj["id"].toString();
+        rule.description = obj["description"].toString(rule.id);
+        rule.deviceId = obj["device"].toString();
+        rule.deviceType = obj["deviceType"].toString();
+        if (rule.id.isEmpty()) {
+            return fail("异常检测器缺少 id");
+        }
+
+        if (obj.contains("rate")) {
+            QJsonObject rateObj = obj["rate"].toObject();
+            rule.kind = AnomalyRule::Rate;
+            rule.rateCount = rateObj["count"].toInt();
+            rule.windowMs = qRound64(rateObj["seconds"].toDouble() * 1000);
+            if (rule.rateCount < 2 || rule.windowMs <= 0) {
+                return fail(QString("检测器 %1 的 rate 需要 count>=2 和 seconds>0").arg(rule.id));
+            }
+            loaded.append(rule);
+            continue;
+        }
+
+        rule.on = obj["on"].toBool(true);
+        rule.mode = obj["mode"].toString();
+        rule.afterScene = obj["afterScene"].toString();
+        rule.sceneWindowMs = qRound64(obj["sceneMinutes"].toDouble(DefaultSceneWindowMinutes) * 60 * 1000);
+        rule.holdMs = qRound64(obj["minutes"].toDouble() * 60 * 1000);
+        if (obj.contains("if")) {
+            QJsonObject conditionObj = obj["if"].toObject();
+            QString op = conditionObj["op"].toString();
+            if (!ruleEngine || !RuleEngine::parseOp(op, &rule.condition.op)) {
+                return fail(QString("检测器 %1 的条件无效: %2").arg(rule.id, op));
+            }
+            rule.condition.input = ruleEngine->inputIndex(conditionObj["input"].toString());
+            rule.condition.value = conditionObj["value"].toDouble();
+        }
+        if (obj.contains("hours")) {
+            QJsonObject hoursObj = obj["hours"].toObject();
+            rule.fromHour = hoursObj["from"].toInt(-1);
+            rule.toHour = hoursObj["to"].toInt(-1);
+            if (rule.fromHour < 0 || rule.fromHour > 23 || rule.toHour < 0 || rule.toHour > 23
+                || rule.fromHour == rule.toHour) {
+                return fail(QString("检测器 %1 的时段无效").arg(rule.id));
+            }
+        }
+        loaded.append(rule);
+    }
+
+    rules = loaded;
+    latencyBudget = root["latencyBudgetMs"].toInt(DefaultLatencyBudgetMs);
+    alertCounters.clear();
+    for (const AnomalyRule &rule : rules) {
+        alertCounters.append(&MetricsRegistry::instance().counter("smarthome_anomalies_total", "Anomalies detected",
+                                                                  MetricsRegistry::label("detector", rule.id)));
+    }
+    rebuild();
+    qDebug() << "异常检测器加载完成，共" << rules.size() << "个检测器，延迟预算" << latencyBudget << "ms";
+    return true;
+}
+
+bool AnomalyDetector::loadDefaultDetectors()
+{
+    QString userDetectors = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/detectors.json";
+    QString path = QFile::exists(userDetectors) ? userDetectors : QString(":/rules/default_detectors.json");
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCritical() << "无法读取异常检测文件:" << path;
+        return false;
+    }
+
+    QString errorMessage;
+    if (!loadDetectors(file.readAll(), &errorMessage)) {
+        qCritical() << "加载异常检测器失败:" << path << errorMessage;
+        return false;
+    }
+    qDebug() << "已加载异常检测文件:" << path;
+    return true;
+}
+
+int AnomalyDetector::detectorCount() const
+{
+    return rules.size();
+}
+
+int AnomalyDetector::latencyBudgetMs() const
+{
+    return latencyBudget;
+}
+
+void AnomalyDetector::setDevices(const QVector<DeviceState> &list)
+{
+    devices.clear();
+    for (const DeviceState &state : list) {
+        DeviceEntry entry;
+        entry.type = state.type;
+        entry.on = state.on;
+        entry.mode = state.mode;
+        devices.insert(state.deviceId, entry);
+    }
+    rebuild();
+}
+
+void AnomalyDetector::onDeviceEvent(const QString &deviceId, bool on, const QDateTime &at)
+{
+    auto it = devices.find(deviceId);
+    if (it == devices.end()) {
+        return;
+    }
+    DeviceEntry &device = it.value();
+    device.on = on;
+    countEvent(device, deviceId, at);
+    updateAll(device.watches, at, latencySince(at));
+}
+
+void AnomalyDetector::onAcSetting(const QString &deviceId, const QString &mode, const QDateTime &at)
+{
+    auto it = devices.find(deviceId);
+    if (it == devices.end() || it->mode == mode) {
+        return;
+    }
+    it->mode = mode;
+    updateAll(it->watches, at, latencySince(at));
+}
+
+void AnomalyDetector::onSceneEvent(const QString &sceneId, const QDateTime &at)
+{
+    // 新场景取代之前的场景，要求之前场景的状态机随之复位
+    lastScene = sceneId;
+    lastSceneAt = at;
+    updateAll(sceneWatches, at, latencySince(at));
+}
+
+void AnomalyDetector::onInputChanged(int input, const QDateTime &at)
+{
+    auto it = inputWatches.constFind(input);
+    if (it != inputWatches.constEnd()) {
+        updateAll(it.value(), at, latencySince(at));
+    }
+}
+
+bool AnomalyDetector::matches(const AnomalyRule &rule, const QString &deviceId, const DeviceEntry &device)
+{
+    if (!rule.deviceId.isEmpty()) {
+        return deviceId == rule.deviceId;
+    }
+    return rule.deviceType.isEmpty() || device.type == rule.deviceType;
+}
+
+bool AnomalyDetector::inHours(const AnomalyRule &rule, const QDateTime &at)
+{
+    if (rule.fromHour < 0) {
+        return true;
+    }
+    int hour = at.toLocalTime().time().hour();
+    if (rule.fromHour < rule.toHour) {
+        return hour >= rule.fromHour && hour < rule.toHour;
+    }
+    return hour >= rule.fromHour || hour < rule.toHour;  // 跨午夜，例如 23 点到 6 点
+}
+
+// 检测器或设备列表变化后重建所有状态机和索引；已经成立的条件（例如启动时夜间门锁没有上锁）从现在开始计时
+void AnomalyDetector::rebuild()
+{
+    watches.clear();
+    ruleWatches = QVector<QVector<int>>(rules.size());
+    inputWatches.clear();
+    sceneWatches.clear();
+    boundaryDue.fill(-1, rules.size());
+    wakeQueue = decltype(wakeQueue)();
+
+    rateHistory = 0;
+    for (const AnomalyRule &rule : rules) {
+        if (rule.kind == AnomalyRule::Rate) {
+            rateHistory = qMax(rateHistory, rule.rateCount);
+        }
+    }
+
+    for (auto it = devices.begin(); it != devices.end(); ++it) {
+        DeviceEntry &device = it.value();
+        device.watches.clear();
+        device.rateRules.clear();
+        device.quietUntil.clear();
+        device.recent.fill(0, rateHistory);
+        device.next = 0;
+        device.filled = 0;
+        for (int r = 0; r < rules.size(); ++r) {
+            const AnomalyRule &rule = rules.at(r);
+            if (!matches(rule, it.key(), device)) {
+                continue;
+            }
+            if (rule.kind == AnomalyRule::Rate) {
+                device.rateRules.append(r);
+                device.quietUntil.append(std::numeric_limits<qint64>::min());
+                continue;
+            }
+            Watch watch;
+            watch.rule = r;
+            watch.deviceId = it.key();
+            int index = watches.size();
+            watches.append(watch);
+            device.watches.append(index);
+            ruleWatches[r].append(index);
+            if (rule.condition.input >= 0) {
+                inputWatches[rule.condition.input].append(index);
+            }
+            if (!rule.afterScene.isEmpty()) {
+                sceneWatches.append(index);
+            }
+        }
+    }
+
+    for (int r = 0; r < rules.size(); ++r) {
+        if (rules.at(r).fromHour >= 0 && !ruleWatches.at(r).isEmpty()) {
+            scheduleBoundary(r);
+        }
+    }
+    QDateTime now = QDateTime::currentDateTime();
+    for (int i = 0; i < watches.size(); ++i) {
+        update(i, now, 0);
+    }
+    armTimer();
+}
+
+bool AnomalyDetector::conditionHolds(const Watch &watch, const QDateTime &at) const
+{
+    const AnomalyRule &rule = rules.at(watch.rule);
+    auto it = devices.constFind(watch.deviceId);
+    if (it == devices.constEnd() || it->on != rule.on) {
+        return false;
+    }
+    if (!rule.mode.isEmpty() && it->mode != rule.mode) {
+        return false;
+    }
+    // 场景之后很久才开的灯是有人在家手动开的，不再算作场景遗留的状态；
+    // 窗口内已开始计时的状态机照常到期告警
+    if (!rule.afterScene.isEmpty()
+        && (lastScene != rule.afterScene || !lastSceneAt.isValid() || lastSceneAt.msecsTo(at) > rule.sceneWindowMs)) {
+        return false;
+    }
+    if (!inHours(rule, at)) {
+        return false;
+    }
+    if (rule.condition.input >= 0) {
+        return ruleEngine && RuleEngine::evaluateCondition(rule.condition, ruleEngine->inputValue(rule.condition.input));
+    }
+    return true;
+}
+
+// 条件不成立时复位，等待中的到期项留在堆中，出堆时按 dueMs 跳过；
+// 条件开始成立时开始计时，不需要持续的立即告警
+void AnomalyDetector::update(int index, const QDateTime &at, qint64 latencyMs)
+{
+    Watch &watch = watches[index];
+    if (!conditionHolds(watch, at)) {
+        watch.holding = false;
+        watch.dueMs = -1;
+        return;
+    }
+    if (watch.holding) {
+        return;
+    }
+    watch.holding = true;
+
+    const AnomalyRule &rule = rules.at(watch.rule);
+    if (rule.holdMs > 0) {
+        watch.dueMs = clock.elapsed() + rule.holdMs;
+        schedule(watch.dueMs, index);
+        return;
+    }
+    raise(rule, watch.rule, watch.deviceId, latencyMs);
+}
+
+// 按值传入：索引与成员共享数据，不复制
+void AnomalyDetector::updateAll(QVector<int> indexes, const QDateTime &at, qint64 latencyMs)
+{
+    for (int index : qAsConst(indexes)) {
+        update(index, at, latencyMs);
+    }
+}
+
+// 第 N 次之前的那次操作仍在窗口内时告警，之后一个窗口内同一检测器不再告警
+void AnomalyDetector::countEvent(DeviceEntry &device, const QString &deviceId, const QDateTime &at)
+{
+    if (device.rateRules.isEmpty() || rateHistory == 0) {
+        return;
+    }
+    qint64 ms = at.toMSecsSinceEpoch();
+    device.recent[device.next] = ms;
+    device.next = (device.next + 1) % rateHistory;
+    device.filled = qMin(device.filled + 1, rateHistory);
+
+    const qint64 latencyMs = latencySince(at);
+    for (int i = 0; i < device.rateRules.size(); ++i) {
+        int ruleIndex = device.rateRules.at(i);
+        const AnomalyRule &rule = rules.at(ruleIndex);
+        if (device.filled < rule.rateCount || ms < device.quietUntil.at(i)) {
+            continue;
+        }
+        qint64 oldest = device.recent.at((device.next - rule.rateCount + rateHistory) % rateHistory);
+        if (ms - oldest > rule.windowMs) {
+            continue;
+        }
+        device.quietUntil[i] = ms + rule.windowMs;
+        raise(rule, ruleIndex, deviceId, latencyMs);
+    }
+}
+
+void AnomalyDetector::raise(const AnomalyRule &rule, int ruleIndex, const QString &deviceId, qint64 latencyMs)
+{
+    alertCounters.at(ruleIndex)->inc();
+    detectionSeconds->observe(latencyMs / 1000.0);
+    if (latencyMs > latencyBudget) {
+        overBudget->inc();
+        qWarning() << "异常告警延迟超出预算:" << rule.id << latencyMs << "ms，预算" << latencyBudget << "ms";
+    }
+    qWarning() << "检测到异常:" << rule.id << deviceId << rule.description;
+
+    AnomalyAlert alert;
+    alert.detectorId = rule.id;
+    alert.description = rule.description;
+    alert.deviceId = deviceId;
+    alert.at = QDateTime::currentDateTime();
+    alert.latencyMs = latencyMs;
+    emit anomalyDetected(alert);
+}
+
+// 下一个整点的开始或结束边界，按本地时间计算；夏令时跳过的整点按一小时后再检查
+void AnomalyDetector::scheduleBoundary(int ruleIndex)
+{
+    const AnomalyRule &rule = rules.at(ruleIndex);
+    QDateTime now = QDateTime::currentDateTime();
+    qint64 delay = -1;
+    for (int hour : { rule.fromHour, rule.toHour }) {
+        QDateTime next(now.date(), QTime(hour, 0));
+        if (next <= now) {
+            next = next.addDays(1);
+        }
+        if (!next.isValid()) {
+            continue;
+        }
+        qint64 ms = now.msecsTo(next);
+        delay = (delay < 0) ? ms : qMin(delay, ms);
+    }
+    if (delay < 0) {
+        delay = 60 * 60 * 1000;
+    }
+    boundaryDue[ruleIndex] = clock.elapsed() + delay;
+    schedule(boundaryDue.at(ruleIndex), -1 - ruleIndex);
+}
+
+void AnomalyDetector::schedule(qint64 dueMs, int entry)
+{
+    bool earliest = wakeQueue.empty() || dueMs < wakeQueue.top().first;
+    wakeQueue.emplace(dueMs, entry);
+    if (earliest) {
+        armTimer();
+    }
+}
+
+void AnomalyDetector::armTimer()
+{
+    // 条件反复成立又复位后堆中主要是失效的条目，按仍在等待的状态机和边界重建
+    if (wakeQueue.size() > size_t(2 * (watches.size() + rules.size()) + 64)) {
+        std::vector<WakeEntry> live;
+        for (int i = 0; i < watches.size(); ++i) {
+            if (watches.at(i).dueMs >= 0) {
+                live.emplace_back(watches.at(i).dueMs, i);
+            }
+        }
+        for (int r = 0; r < boundaryDue.size(); ++r) {
+            if (boundaryDue.at(r) >= 0) {
+                live.emplace_back(boundaryDue.at(r), -1 - r);
+            }
+        }
+        wakeQueue = decltype(wakeQueue)(std::greater<WakeEntry>(), std::move(live));
+    }
+
+    if (wakeQueue.empty()) {
+        wakeTimer.stop();
+        return;
+    }
+    qint64 delay = wakeQueue.top().first - clock.elapsed();
+    wakeTimer.start(int(qBound<qint64>(0, delay, std::numeric_limits<int>::max())));
+}
+
+void AnomalyDetector::onWakeUp()
+{
+    const qint64 now = clock.elapsed();
+    const QDateTime wallNow = QDateTime::currentDateTime();
+    while (!wakeQueue.empty() && wakeQueue.top().first <= now) {
+        WakeEntry entry = wakeQueue.top();
+        wakeQueue.pop();
+
+        if (entry.second < 0) {
+            // 时段边界：重新检查该检测器的所有状态机，再安排下一个边界
+            int ruleIndex = -1 - entry.second;
+            if (ruleIndex >= boundaryDue.size() || boundaryDue.at(ruleIndex) != entry.first) {
+                continue;
+            }
+            boundaryDue[ruleIndex] = -1;
+            updateAll(ruleWatches.at(ruleIndex), wallNow, now - entry.first);
+            scheduleBoundary(ruleIndex);
+            continue;
+        }
+
+        // 已复位，或重新成立后安排了别的到期时间
+        if (entry.second >= watches.size() || watches.at(entry.second).dueMs != entry.first) {
+            continue;
+        }
+        Watch &watch = watches[entry.second];
+        watch.dueMs = -1;
+        raise(rules.at(watch.rule), watch.rule, watch.deviceId, now - entry.first);
+    }
+    armTimer();
+}
+
+qint64 AnomalyDetector::latencySince(const QDateTime &at)
+{
+    return at.isValid() ? qMax<qint64>(0, at.msecsTo(QDateTime::currentDateTime())) : 0;
+}
@@ -0,0 +1,167 @@
+#ifndef ANOMALYDETECTOR_H
+#define ANOMALYDETECTOR_H
+
+#include "homecontroller.h"
+#include "ruleengine.h"
+#include <QByteArray>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+class MetricCounter;
+class MetricHistogram;
+
+// 一个异常检测器的定义
+struct AnomalyRule
+{
+    enum Kind {
+        State,  // 设备处于某个状态（可再要求传感器条件、时段和最近执行的场景）并持续一段时间
+        Rate    // 同一设备在时间窗口内的开关操作次数
+    };
+
+    QString id;
+    QString description;
+    Kind kind = State;
+    QString deviceId;         // 指定设备；为空时按 deviceType 匹配，两者都为空时匹配所有设备
+    QString deviceType;
+    bool on = true;           // 要求的开关状态（门锁为上锁）
+    QString mode;             // 非空时还要求空调模式
+    RuleCondition condition;  // input < 0 表示没有传感器条件
+    int fromHour = -1;        // 时段 [fromHour, toHour)，可以跨午夜；-1 表示不限时段
+    int toHour = -1;
+    QString afterScene;       // 非空时只在该场景是最近执行的场景、且在场景后 sceneWindowMs 内时成立
+    qint64 sceneWindowMs = 0;
+    qint64 holdMs = 0;        // 条件需持续的时间，0 表示成立时立即告警
+    int rateCount = 0;        // 频率检测：windowMs 内达到 rateCount 次操作
+    qint64 windowMs = 0;
+};
+
+struct AnomalyAlert
+{
+    QString detectorId;
+    QString description;
+    QString deviceId;
+    QDateTime at;
+    qint64 latencyMs = 0;     // 从触发事件发生（或持续时间到期）到发出告警
+};
+Q_DECLARE_METATYPE(AnomalyAlert)
+
+// 流式异常检测：由控制核心把设备、空调设定、场景和传感器事件逐条交给检测器，例如
+// 离家模式后灯仍开着超过30分钟、室外30°C时空调在制热、夜间门锁没有上锁、一分钟内开关50次
+//
+// 每个（检测器, 设备）是一个边沿触发的小状态机：条件开始成立时开始计时，持续到期后告警一次，
+// 条件不再成立时复位。加载时为每个设备、输入和场景预先算出相关的状态机，
+// 一个事件只检查与它有关的几个，耗时不随设备和检测器总数增长；
+// 频率检测每个设备只保留最近 N 次操作时间的环形缓冲
+//
+// 持续时间和时段边界的到期时间放在最小堆中，整个检测器只用一个单次 QTimer（与 SceneSequencer 相同）；
+// 告警延迟超过预算时输出警告并计数
+//
+// 传感器条件读取规则引擎的输入，需与规则引擎和控制核心在同一线程中使用
+class AnomalyDetector : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultLatencyBudgetMs = 1000;
+    static constexpr int DefaultSceneWindowMinutes = 10;
+
+    explicit AnomalyDetector(QObject *parent = nullptr);
+
+    // 条件中的输入键在加载时转为规则引擎的输入编号，需在加载检测器之前设置
+    void setRuleEngine(RuleEngine *engine);
+
+    // 从JSON加载检测器，替换现有定义，所有状态机重新开始
+    bool loadDetectors(const QByteArray &json, QString *errorMessage = nullptr);
+    // 加载内置检测器，配置目录中存在 detectors.json 时优先使用
+    bool loadDefaultDetectors();
+
+    int detectorCount() const;
+    int latencyBudgetMs() const;
+
+    // 设备列表和当前状态，来自控制核心
+    void setDevices(const QVector<DeviceState> &list);
+
+    // 事件入口，由控制核心在控制线程中调用；at 为事件发生的时间
+    void onDeviceEvent(const QString &deviceId, bool on, const QDateTime &at);
+    void onAcSetting(const QString &deviceId, const QString &mode, const QDateTime &at);
+    void onSceneEvent(const QString &sceneId, const QDateTime &at);
+    // 传感器的新值已写入规则引擎之后调用
+    void onInputChanged(int input, const QDateTime &at);
+
+signals:
+    // 界面程序中是跨线程的队列连接；直接连接时槽函数中不要重新加载检测器或设备列表
+    void anomalyDetected(const AnomalyAlert &alert);
+
+private slots:
+    void onWakeUp();
+
+private:
+    struct Watch {
+        int rule = 0;
+        QString deviceId;
+        bool holding = false;  // 条件成立中，每次成立最多告警一次
+        qint64 dueMs = -1;     // 持续到期时间（单调时钟），-1 表示没有等待
+    };
+
+    struct DeviceEntry {
+        QString type;
+        bool on = false;
+        QString mode;
+        QVector<int> watches;       // 与该设备有关的状态机
+        QVector<int> rateRules;     // 与该设备有关的频率检测器
+        QVector<qint64> quietUntil; // 与 rateRules 对应：告警后一个窗口内不再告警
+        QVector<qint64> recent;     // 最近的操作时间（毫秒），环形缓冲
+        int next = 0;
+        int filled = 0;
+    };
+
+    // 到期时间, 状态机编号；负数为时段边界，-1 - 检测器编号
+    using WakeEntry = std::pair<qint64, int>;
+
+    static bool matches(const AnomalyRule &rule, const QString &deviceId, const DeviceEntry &device);
+    static bool inHours(const AnomalyRule &rule, const QDateTime &at);
+    void rebuild();
+    bool conditionHolds(const Watch &watch, const QDateTime &at) const;
+    void update(int index, const QDateTime &at, qint64 latencyMs);
+    void updateAll(QVector<int> indexes, const QDateTime &at, qint64 latencyMs);
+    void countEvent(DeviceEntry &device, const QString &deviceId, const QDateTime &at);
+    void raise(const AnomalyRule &rule, int ruleIndex, const QString &deviceId, qint64 latencyMs);
+    void scheduleBoundary(int ruleIndex);
+    void schedule(qint64 dueMs, int entry);
+    void armTimer();
+    static qint64 latencySince(const QDateTime &at);
+
+    RuleEngine *ruleEngine;
+    QVector<AnomalyRule> rules;
+    int latencyBudget;
+    QHash<QString, DeviceEntry> devices;
+    QVector<Watch> watches;
+    QVector<QVector<int>> ruleWatches;      // 检测器 -> 状态机，时段边界时重新检查
+    QHash<int, QVector<int>> inputWatches;  // 输入编号 -> 状态机
+    QVector<int> sceneWatches;              // 要求最近场景的状态机
+    QVector<qint64> boundaryDue;            // 检测器下一个时段边界的时间，-1 表示没有
+    QString lastScene;
+    QDateTime lastSceneAt;
+    int rateHistory;                        // 环形缓冲的长度：频率检测器中最大的次数
+
+    // 失效的条目不从堆中删除，出堆时到期时间与状态机或边界记录的不符就跳过
+    std::priority_queue<WakeEntry, std::vector<WakeEntry>, std::greater<WakeEntry>> wakeQueue;
+    QElapsedTimer clock;  // 单调时钟，不受系统时间修改的影响
+    QTimer wakeTimer;     // 子对象，随检测器一起移到控制线程
+
+    QVector<MetricCounter*> alertCounters;  // 与 rules 对应
+    MetricHistogram *detectionSeconds;
+    MetricCounter *overBudget;
+};
+
+#endif // ANOMALYDETECTOR_H
@@ -0,0 +1,7 @@
+# 异常检测每个事件的耗时
+TARGET = anomalydetectorbenchmark
+
+include(../benchmark.pri)
+
+SOURCES += \
+    anomalydetectorbenchmark.cpp
@@ -0,0 +1,43 @@
+#include "benchmarksupport.h"
+#include "anomalydetector.h"
+#include <QSignalSpy>
+
+// 异常检测：每个事件的耗时；告警条件见 tests/anomalydetector
+class AnomalyDetectorBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void deviceEvent();
+};
+
+// 操作频率检测器：每2秒一次操作，不会达到告警的频率
+void AnomalyDetectorBenchmark::deviceEvent()
+{
+    RuleEngine engine;
+    AnomalyDetector detector;
+    detector.setRuleEngine(&engine);
+    QString error;
+    QVERIFY2(detector.loadDetectors(R"({
+        "detectors": [
+            {"id": "storm", "deviceType": "curtain", "rate": {"count": 50, "seconds": 60}}
+        ]
+    })", &error), qPrintable(error));
+    DeviceState curtain;
+    curtain.deviceId = "LivingroomCurtain";
+    curtain.type = "curtain";
+    detector.setDevices({ curtain });
+    QSignalSpy spy(&detector, &AnomalyDetector::anomalyDetected);
+
+    bool open = false;
+    QDateTime at = QDateTime::currentDateTime();
+    QBENCHMARK {
+        detector.onDeviceEvent("LivingroomCurtain", open = !open, at);
+        at = at.addSecs(2);
+    }
+    QCOMPARE(spy.count(), 0);
+}
+
+SMARTHOME_BENCHMARK_MAIN(AnomalyDetectorBenchmark)
+
+#include "anomalydetectorbenchmark.moc"
@@ -0,0 +1,27 @@
+# 各组件基准测试的公共配置：与主程序编译同一份源文件，另加测试入口、与功能测试共用的夹具（tests/testsupport）
+# 和计时、分配统计的部分（benchmarksupport）
+QT       += core gui widgets sql network testlib
+
+CONFIG += c++17 console testcase
+# 统计控制核心的堆分配，见 steadyStateAllocations
+CONFIG += count_allocations
+CONFIG -= app_bundle
+
+# 解析天气数据使用模拟服务器的夹具
+DEFINES += FIXTURE_DIR=\\\"$$PWD/../tools/mockweatherserver/fixtures\\\"
+
+include($$PWD/../smarthome.pri)
+
+INCLUDEPATH += \
+    $$PWD \
+    $$PWD/../tests
+
+SOURCES += \
+    $$PWD/../tests/mainwindowtestaccess.cpp \
+    $$PWD/../tests/testsupport.cpp \
+    $$PWD/benchmarksupport.cpp
+
+HEADERS += \
+    $$PWD/../tests/mainwindowtestaccess.h \
+    $$PWD/../tests/testsupport.h \
+    $$PWD/benchmarksupport.h
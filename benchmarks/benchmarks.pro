@@ -0,0 +1,18 @@
+# 每个组件一个 QtTest 程序，测量耗时和分配；功能测试见 tests/，公共配置见 benchmark.pri
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    anomalydetector \
+    controlserver \
+    devicecatalog \
+    historyexporter \
+    homecontroller \
+    mainwindow \
+    ruleengine \
+    sceneanalytics \
+    scenescheduler \
+    scenesequencer \
+    schedulestore \
+    sensorstore \
+    storageworker \
+    weatherpollpolicy
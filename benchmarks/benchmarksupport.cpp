@@ -0,0 +1,12 @@
+#include "benchmarksupport.h"
+
+QStringList prepareBenchmark(const QStringList &arguments, const char *benchmarkName)
+{
+    prepareTestEnvironment(benchmarkName);
+
+    QStringList args = arguments;
+    if (!args.contains("-o")) {
+        args << "-o" << QString::fromLatin1(benchmarkName).toLower() + "_results.xml,xml" << "-o" << "-,txt";
+    }
+    return args;
+}
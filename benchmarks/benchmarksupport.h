@@ -0,0 +1,34 @@
+#ifndef BENCHMARKSUPPORT_H
+#define BENCHMARKSUPPORT_H
+
+#include "allocationcounter.h"
+#include "testsupport.h"
+#include <QStringList>
+
+// 基准测试另外需要的部分：分配统计和结果输出；夹具和测试入口的公共部分见 tests/testsupport.h
+
+// 统计一段操作平均每次的分配次数和字节数，输出到测试日志
+template <typename Operation>
+void reportAllocations(const char *name, int iterations, Operation operation)
+{
+    AllocationScope scope;
+    for (int i = 0; i < iterations; ++i) {
+        operation(i);
+    }
+    qInfo("%s: %.1f allocations, %.0f bytes per call", name,
+          double(scope.allocations()) / iterations, double(scope.bytes()) / iterations);
+}
+
+// 测试环境同 prepareTestEnvironment；返回 qExec 的参数，不带 -o 时结果同时输出到终端和 <测试名>_results.xml
+QStringList prepareBenchmark(const QStringList &arguments, const char *benchmarkName);
+
+#define SMARTHOME_BENCHMARK_MAIN(BenchmarkClass) \
+int main(int argc, char *argv[]) \
+{ \
+    QApplication app(argc, argv); \
+    const QStringList args = prepareBenchmark(app.arguments(), #BenchmarkClass); \
+    BenchmarkClass benchmark; \
+    return QTest::qExec(&benchmark, args); \
+}
+
+#endif // BENCHMARKSUPPORT_H
@@ -0,0 +1,7 @@
+# 本机控制接口的吞吐量和状态推送
+TARGET = controlserverbenchmark
+
+include(../benchmark.pri)
+
+SOURCES += \
+    controlserverbenchmark.cpp
@@ -0,0 +1,248 @@
+#include "benchmarksupport.h"
+#include "controlserver.h"
+#include "mainwindowtestaccess.h"
+#include <QCborArray>
+#include <QCborMap>
+#include <QElapsedTimer>
+#include <QThread>
+
+// 本机控制接口：流水线和批量请求的吞吐量、订阅者很多时的状态推送；请求和回复的内容见 tests/controlserver
+class ControlServerBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void controlApiThroughput_data();
+    void controlApiThroughput();
+    void stateStream();
+
+private:
+    MainWindow *window = nullptr;
+    CoreFixture core;
+    QString controlName;
+};
+
+// 按快照和增量重建各设备的开关状态；seq 必须递增，序号必须在快照范围内
+static bool replayStream(const QVector<QCborValue> &frames, QHash<QString, bool> *on, int *deltas)
+{
+    QStringList ids;
+    qint64 last = -1;
+    for (const QCborValue &frame : frames) {
+        if (ControlClient::field(frame, "event").toString() == "snapshot") {
+            ids.clear();
+            on->clear();
+            last = ControlClient::field(frame, "seq").toInteger();
+            for (const QCborValue &device : ControlClient::field(frame, "devices").toArray()) {
+                ids.append(ControlClient::field(device, "device").toString());
+                on->insert(ids.last(), ControlClient::field(device, "on").toBool());
+            }
+            continue;
+        }
+        for (const QCborValue &delta : ControlClient::field(frame, "deltas").toArray()) {
+            const QCborArray entry = delta.toArray();
+            const qint64 seq = entry.at(0).toInteger();
+            const int index = int(entry.at(1).toInteger());
+            if (seq <= last || index < 0 || index >= ids.size()) {
+                return false;
+            }
+            last = seq;
+            (*on)[ids.at(index)] = entry.at(2).toBool();
+            ++*deltas;
+        }
+    }
+    return !ids.isEmpty();
+}
+
+void ControlServerBenchmark::initTestCase()
+{
+    // 控制接口使用测试专用的名称，与正在运行的主程序互不影响
+    controlName = QString("QtSmartHome-benchmark-%1").arg(QCoreApplication::applicationPid());
+    prepareWindowEnvironment(core.filePath("benchmark.db"), controlName);
+    window = new MainWindow;
+    QTRY_VERIFY(MainWindowTestAccess::isDatabaseReady(*window));
+    QVERIFY(core.open());
+}
+
+void ControlServerBenchmark::cleanupTestCase()
+{
+    delete window;
+    window = nullptr;
+}
+
+void ControlServerBenchmark::controlApiThroughput_data()
+{
+    QTest::addColumn<int>("frames");
+    QTest::addColumn<int>("commandsPerFrame");
+    QTest::newRow("pipelined") << 5000 << 1;
+    QTest::newRow("batched") << 100 << 50;
+}
+
+// 从发出第一帧到收到最后一个回复，命令经过界面线程、控制线程，回复再回到网络线程
+void ControlServerBenchmark::controlApiThroughput()
+{
+    QFETCH(int, frames);
+    QFETCH(int, commandsPerFrame);
+    ControlClient client(controlName);
+    QVERIFY(client.waitForConnected());
+
+    const QStringList lights = { "LivingroomLight", "KitchenLight", "BedroomLight", "BathroomLight",
+                                 "StudyroomLight", "BalconyLight", "DiningroomLight" };
+    QElapsedTimer elapsed;
+    elapsed.start();
+    int sent = 0;
+    for (int i = 0; i < frames; ++i) {
+        QCborArray commands;
+        for (int j = 0; j < commandsPerFrame; ++j, ++sent) {
+            commands.append(ControlClient::command(lights.at(sent % lights.size()), "power",
+                                           (sent / lights.size()) % 2 ? "off" : "on"));
+        }
+        QCborMap set = ControlClient::request(i, "set");
+        set.insert(QStringLiteral("commands"), commands);
+        client.send(set);
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(client.frames.size(), frames, 60000);
+    const qint64 ms = qMax<qint64>(1, elapsed.elapsed());
+
+    for (const QCborValue &frame : qAsConst(client.frames)) {
+        QVERIFY(ControlClient::field(frame, "ok").toBool());
+    }
+    QCOMPARE(ControlClient::field(client.frames.last(), "id").toInteger(), qint64(frames - 1));
+    qInfo("%d commands in %d frames: %lld ms, %.0f commands per second", sent, frames, ms, sent * 1000.0 / ms);
+}
+
+// 状态推送：几百个订阅者时控制核心每次操作的耗时，订阅者按快照和增量重建的状态与控制核心一致；
+// 不读取的订阅者积压后只收到合并的增量，恢复读取后同样收敛
+void ControlServerBenchmark::stateStream()
+{
+    const QString name = QString("QtSmartHome-stream-%1").arg(QCoreApplication::applicationPid());
+    QThread thread;
+    ControlServer *server = new ControlServer;
+    server->moveToThread(&thread);
+    connect(&thread, &QThread::finished, server, &QObject::deleteLater);
+    thread.start();
+    bool listening = false;
+    QMetaObject::invokeMethod(server, [server, name]() { return server->listen(name); },
+                              Qt::BlockingQueuedConnection, &listening);
+    QVERIFY(listening);
+
+    const QStringList ids = core.controller->deviceIds();
+    QVector<DeviceState> devices;
+    for (const QString &deviceId : ids) {
+        devices.append(core.controller->device(deviceId));
+    }
+    QMetaObject::invokeMethod(server, [server, devices]() { server->setDevices(devices); });
+
+    const QStringList lights = { "LivingroomLight", "KitchenLight", "BedroomLight" };
+    const int actions = 2000;
+    auto toggle = [this, &lights](int count) {
+        QElapsedTimer elapsed;
+        elapsed.start();
+        for (int i = 0; i < count; ++i) {
+            core.controller->recordDeviceAction(lights.at(i % lights.size()), "toggle",
+                                           (i / lights.size()) % 2 ? "off" : "on");
+        }
+        return elapsed.nsecsElapsed() / 1000.0 / count;
+    };
+    const double baselineUs = toggle(actions);
+
+    // 200个订阅者，另有一个收到快照后暂停读取
+    const int subscribers = 200;
+    QVector<ControlClient*> clients;
+    for (int i = 0; i <= subscribers; ++i) {
+        clients.append(new ControlClient(name));
+        QVERIFY(clients.last()->waitForConnected());
+        clients.last()->send(ControlClient::request(1, "subscribe"));
+    }
+    ControlClient *slow = clients.last();
+    auto subscribed = [&clients]() {
+        for (ControlClient *client : qAsConst(clients)) {
+            if (client->frames.size() < 2) {
+                return false;
+            }
+        }
+        return true;
+    };
+    QTRY_VERIFY_WITH_TIMEOUT(subscribed(), 10000);
+    slow->setPaused(true);
+
+    QMetaObject::Connection changes = connect(core.controller, &HomeController::deviceStateChanged,
+                                              server, &ControlServer::publishDeviceState);
+    const double streamUs = toggle(actions);
+    qInfo("controller: %.2f us per action without subscribers, %.2f us with %d subscribers",
+          baselineUs, streamUs, subscribers);
+
+    auto converged = [this, &ids](ControlClient *client) {
+        QHash<QString, bool> on;
+        int deltas = 0;
+        if (!replayStream(client->frames, &on, &deltas)) {
+            return false;
+        }
+        for (const QString &deviceId : ids) {
+            if (on.value(deviceId) != core.controller->device(deviceId).on) {
+                return false;
+            }
+        }
+        return true;
+    };
+    auto allConverged = [&]() {
+        for (int i = 0; i < subscribers; ++i) {
+            if (!converged(clients.at(i))) {
+                return false;
+            }
+        }
+        return true;
+    };
+    QTRY_VERIFY_WITH_TIMEOUT(allConverged(), 30000);
+    disconnect(changes);
+
+    // 暂停的订阅者：其余订阅者断开后，直接在网络线程中产生大量变化，远超套接字缓冲
+    qDeleteAll(clients.begin(), clients.end() - 1);
+    clients.erase(clients.begin(), clients.end() - 1);
+    const int changesPerBurst = 1000;
+    const int bursts = 100;
+    QHash<QString, bool> expected;
+    for (int burst = 0; burst < bursts; ++burst) {
+        QMetaObject::invokeMethod(server, [server, &lights, &expected, changesPerBurst, burst]() {
+            for (int i = 0; i < changesPerBurst; ++i) {
+                DeviceState state;
+                state.deviceId = lights.at(i % lights.size());
+                state.on = (burst * changesPerBurst + i) / lights.size() % 2 == 0;
+                server->publishDeviceState(state.deviceId, state);
+                expected.insert(state.deviceId, state.on);
+            }
+        }, Qt::BlockingQueuedConnection);
+        QTest::qWait(1);
+    }
+    slow->setPaused(false);
+    auto slowConverged = [slow, &lights, &expected]() {
+        QHash<QString, bool> on;
+        int deltas = 0;
+        if (!replayStream(slow->frames, &on, &deltas)) {
+            return false;
+        }
+        for (const QString &light : lights) {
+            if (on.value(light) != expected.value(light)) {
+                return false;
+            }
+        }
+        return true;
+    };
+    QTRY_VERIFY_WITH_TIMEOUT(slowConverged(), 30000);
+    QHash<QString, bool> on;
+    int slowDeltas = 0;
+    QVERIFY(replayStream(slow->frames, &on, &slowDeltas));
+    const int total = actions + bursts * changesPerBurst;
+    qInfo("slow subscriber: %d deltas for %d changes", slowDeltas, total);
+    QVERIFY(slowDeltas < total / 2);
+
+    qDeleteAll(clients);
+    thread.quit();
+    thread.wait();
+}
+
+SMARTHOME_BENCHMARK_MAIN(ControlServerBenchmark)
+
+#include "controlserverbenchmark.moc"
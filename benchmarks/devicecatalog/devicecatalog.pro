@@ -0,0 +1,7 @@
+# 设备目录的加载
+TARGET = devicecatalogbenchmark
+
+include(../benchmark.pri)
+
+SOURCES += \
+    devicecatalogbenchmark.cpp
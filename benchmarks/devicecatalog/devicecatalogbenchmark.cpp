@@ -0,0 +1,56 @@
+#include "benchmarksupport.h"
+#include "devicecatalog.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+// 设备目录的加载
+class DeviceCatalogBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void loadDeviceCatalog_data();
+    void loadDeviceCatalog();
+};
+
+void DeviceCatalogBenchmark::loadDeviceCatalog_data()
+{
+    QTest::addColumn<int>("deviceCount");
+    QTest::newRow("12 devices") << 12;
+    QTest::newRow("10000 devices") << 10000;
+}
+
+// 大型安装的设备目录也应在几毫秒内加载完成
+void DeviceCatalogBenchmark::loadDeviceCatalog()
+{
+    QFETCH(int, deviceCount);
+
+    const QStringList rooms = { "Livingroom", "Bedroom", "Kitchen", "Studyroom" };
+    QJsonArray devices;
+    for (int i = 0; i < deviceCount; ++i) {
+        QJsonObject device;
+        device["id"] = QString("Device%1").arg(i);
+        device["name"] = QString("设备%1").arg(i);
+        device["type"] = (i % 3 == 0) ? "curtain" : "light";
+        device["room"] = rooms.at(i % rooms.size());
+        devices.append(device);
+    }
+    QJsonObject root;
+    root["types"] = QJsonArray({
+        QJsonObject({{"id", "light"}, {"label", "灯光设备"}}),
+        QJsonObject({{"id", "curtain"}, {"label", "窗帘设备"}})
+    });
+    root["devices"] = devices;
+    const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Compact);
+
+    QBENCHMARK {
+        DeviceCatalog catalog;
+        QVERIFY(catalog.load(json));
+        QCOMPARE(catalog.devices().size(), deviceCount);
+    }
+}
+
+SMARTHOME_BENCHMARK_MAIN(DeviceCatalogBenchmark)
+
+#include "devicecatalogbenchmark.moc"
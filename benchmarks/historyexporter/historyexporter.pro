@@ -0,0 +1,7 @@
+# 历史记录的分页导出
+TARGET = historyexporterbenchmark
+
+include(../benchmark.pri)
+
+SOURCES += \
+    historyexporterbenchmark.cpp
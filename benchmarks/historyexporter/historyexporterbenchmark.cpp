@@ -0,0 +1,220 @@
+#include "benchmarksupport.h"
+#include "historyexporter.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+
+// 历史导出：分页导出的行数、列式文件的内容和过滤条件
+class HistoryExporterBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void exportHistory_data();
+    void exportHistory();
+    void exportMemory_data();
+    void exportMemory();
+
+private:
+    static void runExport(const HistoryExportOptions &options, qint64 *rows, QVector<int> *percents);
+    static qint64 exportPeakBytes(const HistoryExportOptions &options, qint64 *rows);
+
+    CoreFixture core;
+};
+
+void HistoryExporterBenchmark::initTestCase()
+{
+    QVERIFY(core.open());
+
+    // 10秒一条的连续历史
+    const int records = 300000;
+    const QStringList devices = { "LivingroomLight", "BedroomLight", "LivingroomCurtain", "StudyroomLight" };
+    QSqlDatabase db = core.storage->database();
+    QSqlQuery query(db);
+    QVERIFY(db.transaction());
+    // 与控制核心相同的语句，记录带回放序号
+    QVERIFY(query.prepare(HomeController::InsertHistorySql));
+    QDateTime start(QDate(2024, 1, 1), QTime(0, 0), Qt::UTC);
+    for (int i = 0; i < records; ++i) {
+        query.bindValue(0, devices.at(i % devices.size()));
+        query.bindValue(1, QStringLiteral("toggle"));
+        query.bindValue(2, (i / devices.size()) % 2 ? QStringLiteral("off") : QStringLiteral("on"));
+        query.bindValue(3, start.addSecs(i * 10).toString("yyyy-MM-dd hh:mm:ss"));
+        QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+    }
+    QVERIFY(db.commit());
+}
+
+void HistoryExporterBenchmark::exportHistory_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::newRow("csv") << int(HistoryExportOptions::Csv);
+    QTest::newRow("columnar") << int(HistoryExportOptions::Columnar);
+}
+
+// 在工作线程中导出，等待结束并记录进度
+void HistoryExporterBenchmark::runExport(const HistoryExportOptions &options, qint64 *rows, QVector<int> *percents)
+{
+    QThread thread;
+    HistoryExporter exporter(options);
+    exporter.moveToThread(&thread);
+    connect(&thread, &QThread::started, &exporter, &HistoryExporter::run);
+    std::atomic<bool> done(false);
+    bool ok = false;
+    QString errorMessage;
+    connect(&exporter, &HistoryExporter::progress, &thread, [percents](qint64, int percent) {
+        percents->append(percent);
+    }, Qt::DirectConnection);
+    connect(&exporter, &HistoryExporter::finished, &thread,
+            [&](bool success, qint64 exported, const QString &message) {
+        ok = success;
+        *rows = exported;
+        errorMessage = message;
+        done = true;
+    }, Qt::DirectConnection);
+
+    thread.start();
+    QTRY_VERIFY_WITH_TIMEOUT(done, 120000);
+    thread.quit();
+    thread.wait();
+    QVERIFY2(ok, qPrintable(errorMessage));
+}
+
+// 分页导出：行数与直接查询一致，列式文件能还原出相同的行，过滤条件与 SQL 的结果一致
+void HistoryExporterBenchmark::exportHistory()
+{
+    QFETCH(int, format);
+
+    QSqlQuery query(core.storage->database());
+    QVERIFY(query.exec("SELECT COUNT(*) FROM device_history") && query.next());
+    const qint64 expectedRows = query.value(0).toLongLong();
+
+    HistoryExportOptions options;
+    options.dbPath = core.databasePath();
+    options.format = HistoryExportOptions::Format(format);
+    options.outputPath = core.filePath(format == HistoryExportOptions::Csv ? "history.csv" : "history.shc");
+
+    qint64 rows = 0;
+    QVector<int> percents;
+    QElapsedTimer elapsed;
+    elapsed.start();
+    runExport(options, &rows, &percents);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+    qInfo("exported %lld rows in %lld ms, %lld bytes", rows, elapsed.elapsed(),
+          QFileInfo(options.outputPath).size());
+    QCOMPARE(rows, expectedRows);
+    QVERIFY(!percents.isEmpty());
+    QCOMPARE(percents.last(), 100);
+    QVERIFY(std::is_sorted(percents.begin(), percents.end()));
+
+    if (options.format == HistoryExportOptions::Csv) {
+        QFile file(options.outputPath);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        qint64 lines = 0;
+        while (!file.atEnd()) {
+            file.readLine();
+            ++lines;
+        }
+        QCOMPARE(lines, expectedRows + 1);  // 含表头
+    } else {
+        QVERIFY(query.exec("SELECT id, device_id, action_value, timestamp FROM device_history ORDER BY id LIMIT 1")
+                && query.next());
+        HistoryRow first;
+        qint64 decoded = 0;
+        QString errorMessage;
+        QVERIFY2(HistoryExporter::readColumnar(options.outputPath, [&](const HistoryRow &row) {
+            if (decoded++ == 0) {
+                first = row;
+            }
+            return true;
+        }, &errorMessage), qPrintable(errorMessage));
+        QCOMPARE(decoded, expectedRows);
+        QCOMPARE(first.id, query.value(0).toLongLong());
+        QCOMPARE(first.key, query.value(1).toString());
+        QCOMPARE(first.actionValue, query.value(2).toString());
+        QDateTime firstTime = QDateTime::fromString(query.value(3).toString(), "yyyy-MM-dd hh:mm:ss");
+        firstTime.setTimeSpec(Qt::UTC);
+        QCOMPARE(first.timestamp, firstTime.toSecsSinceEpoch());
+    }
+
+    // 设备和时间范围过滤
+    options.ids = QStringList{ "LivingroomLight", "StudyroomLight" };
+    options.from = QDateTime(QDate(2024, 1, 3), QTime(0, 0), Qt::UTC);
+    options.to = QDateTime(QDate(2024, 1, 10), QTime(0, 0), Qt::UTC);
+    QVERIFY(query.prepare("SELECT COUNT(*) FROM device_history WHERE device_id IN (?, ?) "
+                          "AND timestamp >= ? AND timestamp < ?"));
+    query.addBindValue(options.ids.at(0));
+    query.addBindValue(options.ids.at(1));
+    query.addBindValue(options.from.toString("yyyy-MM-dd hh:mm:ss"));
+    query.addBindValue(options.to.toString("yyyy-MM-dd hh:mm:ss"));
+    QVERIFY(query.exec() && query.next());
+    const qint64 expectedFiltered = query.value(0).toLongLong();
+    QVERIFY(expectedFiltered > 0);
+
+    percents.clear();
+    runExport(options, &rows, &percents);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+    QCOMPARE(rows, expectedFiltered);
+}
+
+// 在当前线程直接导出（分配按线程统计），返回导出期间已分配未释放内存的峰值，失败时返回 -1
+qint64 HistoryExporterBenchmark::exportPeakBytes(const HistoryExportOptions &options, qint64 *rows)
+{
+    HistoryExporter exporter(options);
+    bool ok = false;
+    connect(&exporter, &HistoryExporter::finished, &exporter, [&](bool success, qint64 exported, const QString &) {
+        ok = success;
+        *rows = exported;
+    });
+    AllocationScope scope;
+    exporter.run();
+    return ok ? scope.peakBytes() : -1;
+}
+
+void HistoryExporterBenchmark::exportMemory_data()
+{
+    exportHistory_data();
+}
+
+// 导出的内存与行数无关：导出约三分之一的行和全部行时，已分配未释放内存的峰值基本相同
+void HistoryExporterBenchmark::exportMemory()
+{
+    if (!AllocationCounter::tracksLiveBytes()) {
+        QSKIP("未以 CONFIG+=count_allocations 在 glibc 上构建，不统计已分配未释放的内存");
+    }
+    QFETCH(int, format);
+
+    HistoryExportOptions options;
+    options.dbPath = core.databasePath();
+    options.format = HistoryExportOptions::Format(format);
+    options.outputPath = core.filePath(format == HistoryExportOptions::Csv ? "memory.csv" : "memory.shc");
+    // 前11天约95000行，超过一个列式块
+    options.to = QDateTime(QDate(2024, 1, 12), QTime(0, 0), Qt::UTC);
+    qint64 smallRows = 0;
+    const qint64 smallPeak = exportPeakBytes(options, &smallRows);
+    options.to = QDateTime();
+    qint64 largeRows = 0;
+    const qint64 largePeak = exportPeakBytes(options, &largeRows);
+
+    qInfo("peak %lld bytes for %lld rows, %lld bytes for %lld rows", smallPeak, smallRows, largePeak, largeRows);
+    QVERIFY(smallPeak >= 0 && largePeak >= 0);
+    QVERIFY(largeRows > 3 * smallRows - 10000);
+    // 允许 SQLite 页缓存和输出缓冲的波动，但不能随行数增长
+    QVERIFY2(largePeak <= smallPeak + smallPeak / 4 + 1024 * 1024,
+             qPrintable(QString("%1 -> %2 bytes").arg(smallPeak).arg(largePeak)));
+}
+
+SMARTHOME_BENCHMARK_MAIN(HistoryExporterBenchmark)
+
+#include "historyexporterbenchmark.moc"
@@ -0,0 +1,7 @@
+# 控制核心的设备操作、场景执行和堆分配
+TARGET = homecontrollerbenchmark
+
+include(../benchmark.pri)
+
+SOURCES += \
+    homecontrollerbenchmark.cpp
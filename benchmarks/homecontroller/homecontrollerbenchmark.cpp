@@ -0,0 +1,127 @@
+#include "benchmarksupport.h"
+#include <QSqlQuery>
+
+// 控制核心：设备操作的耗时，稳定状态下的堆分配不超过直接写入同样记录
+class HomeControllerBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void writeDeviceHistory();
+    void updateDeviceStatus();
+    void steadyStateAllocations();
+
+private:
+    CoreFixture core;
+};
+
+void HomeControllerBenchmark::initTestCase()
+{
+    QVERIFY(core.open());
+}
+
+void HomeControllerBenchmark::writeDeviceHistory()
+{
+    QBENCHMARK {
+        core.controller->recordDeviceAction("LivingroomLight", "toggle", "on");
+    }
+}
+
+void HomeControllerBenchmark::updateDeviceStatus()
+{
+    QBENCHMARK {
+        core.controller->updateStatus("LivingroomLight", "on");
+    }
+}
+
+// 控制核心的稳定状态：一次设备操作或场景执行的分配不超过直接写入同样记录的分配
+// （时间戳字符串和 QtSql 绑定参数）
+void HomeControllerBenchmark::steadyStateAllocations()
+{
+    if (!AllocationCounter::isEnabled()) {
+        QSKIP("未以 CONFIG+=count_allocations 构建，不统计堆分配");
+    }
+
+    const QString deviceId = QStringLiteral("StudyroomLight");
+    const QString actionType = QStringLiteral("toggle");
+    const QString values[2] = { QStringLiteral("on"), QStringLiteral("off") };
+    const QString sceneId = QStringLiteral("UserDefinedMode1");
+    const QString timestampFormat = QStringLiteral("yyyy-MM-dd hh:mm:ss");
+    QVERIFY(core.controller->contains(deviceId));
+
+    // 基线：复用预编译语句直接写入与控制核心相同的记录
+    QSqlQuery insertHistory(core.storage->database());
+    QSqlQuery updateStatus(core.storage->database());
+    QSqlQuery insertScene(core.storage->database());
+    QVERIFY(insertHistory.prepare(HomeController::InsertHistorySql));
+    QVERIFY(updateStatus.prepare(HomeController::UpdateStatusSql));
+    QVERIFY(insertScene.prepare(HomeController::InsertSceneSql));
+
+    auto baselineDevice = [&](int i) {
+        const QDateTime now = QDateTime::currentDateTime();
+        insertHistory.bindValue(0, deviceId);
+        insertHistory.bindValue(1, actionType);
+        insertHistory.bindValue(2, values[i & 1]);
+        insertHistory.bindValue(3, now.toUTC().toString(timestampFormat));
+        insertHistory.exec();
+        updateStatus.bindValue(0, values[i & 1]);
+        updateStatus.bindValue(1, deviceId);
+        updateStatus.exec();
+    };
+    auto coreDevice = [&](int i) {
+        const QDateTime now = QDateTime::currentDateTime();
+        core.controller->recordDeviceAction(deviceId, actionType, values[i & 1], now);
+        core.controller->updateStatus(deviceId, values[i & 1]);
+    };
+    auto baselineScene = [&](int) {
+        insertScene.bindValue(0, sceneId);
+        insertScene.bindValue(1, QDateTime::currentDateTime().toString(timestampFormat));
+        insertScene.exec();
+    };
+    auto coreScene = [&](int) {
+        core.controller->recordSceneRun(sceneId, QDateTime::currentDateTime());
+    };
+
+    // 预热：准备语句、注册指标、能耗统计的小时桶等只在第一次发生
+    const int warmUp = 20;
+    for (int i = 0; i < warmUp; ++i) {
+        baselineDevice(i);
+        coreDevice(i);
+        baselineScene(i);
+        coreScene(i);
+    }
+
+    // 两者交替执行，SQLite 页缓存等的偶发分配平均落到双方
+    const int iterations = 1000;
+    quint64 baselineAllocations = 0;
+    quint64 coreAllocations = 0;
+    for (int i = 0; i < iterations; ++i) {
+        {
+            AllocationScope scope;
+            baselineDevice(i);
+            baselineScene(i);
+            baselineAllocations += scope.allocations();
+        }
+        {
+            AllocationScope scope;
+            coreDevice(i);
+            coreScene(i);
+            coreAllocations += scope.allocations();
+        }
+    }
+
+    const double baselinePerCall = double(baselineAllocations) / iterations;
+    const double corePerCall = double(coreAllocations) / iterations;
+    qInfo("persisted write baseline: %.2f allocations per iteration", baselinePerCall);
+    qInfo("control core: %.2f allocations per iteration", corePerCall);
+    // 允许每次迭代平均0.5次的偶发分配（例如能耗统计跨小时换桶）
+    QVERIFY2(corePerCall <= baselinePerCall + 0.5,
+             qPrintable(QString("控制核心每次迭代分配 %1 次，直接写入记录只需 %2 次")
+                            .arg(corePerCall).arg(baselinePerCall)));
+}
+
+SMARTHOME_BENCHMARK_MAIN(HomeControllerBenchmark)
+
+#include "homecontrollerbenchmark.moc"
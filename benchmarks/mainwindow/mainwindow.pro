@@ -0,0 +1,7 @@
+# 界面线程的按钮操作、场景和状态快照
+TARGET = mainwindowbenchmark
+
+include(../benchmark.pri)
+
+SOURCES += \
+    mainwindowbenchmark.cpp
@@ -0,0 +1,297 @@
+#include "benchmarksupport.h"
+#include "devicecatalog.h"
+#include "mainwindowtestaccess.h"
+#include <QComboBox>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSemaphore>
+#include <QStandardPaths>
+
+// 界面线程：按钮操作、自定义场景、天气解析和状态快照的耗时；结果是否正确见 tests/mainwindow
+class MainWindowBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void toggleLight();
+    void toggleCurtain();
+    void executeCustomScene_data();
+    void executeCustomScene();
+    void parseWeatherData();
+    void guiAllocations();
+    void forwardingAllocations();
+    void readSnapshot();
+
+private:
+    static constexpr int LargeSceneDevices = 1000;
+
+    static bool writeLargeCatalog(const QString &path);
+
+    QTemporaryDir tempDir;
+    QString catalogPath;
+    MainWindow *window = nullptr;
+    QPushButton *livingroomLight = nullptr;
+    QPushButton *livingroomCurtain = nullptr;
+};
+
+// 大型安装：内置目录之外再加入灯、窗帘和空调，门锁以外共 LargeSceneDevices 个设备，都是真实的设备类型
+bool MainWindowBenchmark::writeLargeCatalog(const QString &path)
+{
+    QFile builtin(":/devices/default_catalog.json");
+    if (!builtin.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QJsonObject catalog = QJsonDocument::fromJson(builtin.readAll()).object();
+    QJsonArray devices = catalog.value("devices").toArray();
+    int sceneDevices = 0;
+    for (const QJsonValue &device : qAsConst(devices)) {
+        if (device.toObject().value("type").toString() != QLatin1String("lock")) {
+            ++sceneDevices;
+        }
+    }
+    // 空调使用已有房间的温度下拉框
+    const QString rooms[] = { QStringLiteral("Livingroom"), QStringLiteral("Bedroom") };
+    for (int i = 0; sceneDevices < LargeSceneDevices; ++i, ++sceneDevices) {
+        QJsonObject device;
+        switch (i % 3) {
+        case 0:
+            device["id"] = QString("Bench%1Light").arg(i);
+            device["name"] = QString("测试灯%1").arg(i);
+            device["type"] = "light";
+            device["room"] = QString("Bench%1").arg(i);
+            break;
+        case 1:
+            device["id"] = QString("Bench%1Curtain").arg(i);
+            device["name"] = QString("测试窗帘%1").arg(i);
+            device["type"] = "curtain";
+            device["room"] = QString("Bench%1").arg(i);
+            break;
+        default:
+            device["id"] = QString("Bench%1Ac").arg(i);
+            device["name"] = QString("测试空调%1").arg(i);
+            device["type"] = "air_conditioner";
+            device["room"] = rooms[i % 2];
+            break;
+        }
+        devices.append(device);
+    }
+    catalog["devices"] = devices;
+
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        && file.write(QJsonDocument(catalog).toJson(QJsonDocument::Compact)) > 0;
+}
+
+void MainWindowBenchmark::initTestCase()
+{
+    QVERIFY(tempDir.isValid());
+    // 设备目录在第一次使用时加载，必须在创建界面之前写入配置目录
+    const QString configDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    QVERIFY(QDir().mkpath(configDir));
+    catalogPath = configDir + "/devices.json";
+    QVERIFY(writeLargeCatalog(catalogPath));
+
+    prepareWindowEnvironment(tempDir.filePath("benchmark.db"));
+    window = new MainWindow;
+    // 存储线程打开数据库后才恢复定时任务和空调设置
+    QTRY_VERIFY(MainWindowTestAccess::isDatabaseReady(*window));
+    livingroomLight = window->findChild<QPushButton*>("LivingroomLightButton");
+    livingroomCurtain = window->findChild<QPushButton*>("LivingroomCurtainButton");
+    QVERIFY(livingroomLight && livingroomCurtain);
+
+    // 新增的设备在界面上没有控件：按界面的命名规则补上（不放进布局），再重新生成执行表
+    const QComboBox *modes = window->findChild<QComboBox*>("LivingroomAcModecomboBox");
+    QVERIFY(modes);
+    for (const DeviceInfo &device : DeviceCatalog::instance().devices()) {
+        if (window->findChild<QPushButton*>(device.id + "Button")) {
+            continue;
+        }
+        QPushButton *button = new QPushButton(window);
+        button->setObjectName(device.id + "Button");
+        if (device.type == QLatin1String("air_conditioner")) {
+            QComboBox *modeBox = new QComboBox(window);
+            modeBox->setObjectName(device.id + "ModecomboBox");
+            for (int i = 0; i < modes->count(); ++i) {
+                modeBox->addItem(modes->itemText(i));
+            }
+        }
+    }
+    QCOMPARE(MainWindowTestAccess::rebuildDeviceTargets(*window), DeviceCatalog::instance().devices().size());
+}
+
+void MainWindowBenchmark::cleanupTestCase()
+{
+    delete window;
+    window = nullptr;
+    QFile::remove(catalogPath);
+}
+
+// 与用户点击按钮相同的路径
+void MainWindowBenchmark::toggleLight()
+{
+    QBENCHMARK {
+        livingroomLight->click();
+    }
+}
+
+void MainWindowBenchmark::toggleCurtain()
+{
+    QBENCHMARK {
+        livingroomCurtain->click();
+    }
+}
+
+void MainWindowBenchmark::executeCustomScene_data()
+{
+    QTest::addColumn<int>("deviceCount");
+    QTest::newRow("11 devices") << 11;
+    QTest::newRow("1000 devices") << LargeSceneDevices;
+}
+
+void MainWindowBenchmark::executeCustomScene()
+{
+    QFETCH(int, deviceCount);
+
+    // 目录中的前 deviceCount 个设备（门锁除外）：每个都有控件，经过按类型分发、控制核心和存储的完整路径
+    QMap<QString, int> sceneOn;
+    QMap<QString, int> sceneOff;
+    for (const DeviceInfo &device : DeviceCatalog::instance().devices()) {
+        if (sceneOn.size() == deviceCount) {
+            break;
+        }
+        if (device.type == QLatin1String("lock")) {
+            continue;
+        }
+        sceneOn.insert(device.name, 1);
+        sceneOff.insert(device.name, 2);
+    }
+    QCOMPARE(sceneOn.size(), deviceCount);
+
+    // 开、关两个场景交替执行，每次都有真实的状态变化
+    bool turnOn = true;
+    QBENCHMARK {
+        MainWindowTestAccess::executeCustomScene(*window, turnOn ? sceneOn : sceneOff);
+        turnOn = !turnOn;
+    }
+}
+
+void MainWindowBenchmark::parseWeatherData()
+{
+    QFile fixture(QString(FIXTURE_DIR) + "/weather_now.json");
+    QVERIFY(fixture.open(QIODevice::ReadOnly));
+    QJsonObject jsonObj = QJsonDocument::fromJson(fixture.readAll()).object();
+    QVERIFY(!jsonObj.isEmpty());
+
+    QBENCHMARK {
+        MainWindowTestAccess::parseWeatherData(*window, jsonObj);
+    }
+}
+
+// 界面函数的分配（setText/setStyleSheet 等）只作参考，不检查
+void MainWindowBenchmark::guiAllocations()
+{
+    if (!AllocationCounter::isEnabled()) {
+        QSKIP("未以 CONFIG+=count_allocations 构建，不统计堆分配");
+    }
+
+    reportAllocations("toggleLight", 200, [this](int) {
+        livingroomLight->click();
+    });
+    reportAllocations("toggleCurtain", 200, [this](int) {
+        livingroomCurtain->click();
+    });
+    QMap<QString, int> sceneOn;
+    QMap<QString, int> sceneOff;
+    for (const QString &name : {QStringLiteral("客厅灯"), QStringLiteral("卧室灯"), QStringLiteral("客厅窗帘")}) {
+        sceneOn.insert(name, 1);
+        sceneOff.insert(name, 2);
+    }
+    reportAllocations("executeCustomScene", 200, [&](int i) {
+        MainWindowTestAccess::executeCustomScene(*window, (i & 1) ? sceneOff : sceneOn);
+    });
+}
+
+// 开关操作转发给控制线程、再交给存储线程的路径：界面线程每批只唤醒一次控制线程，
+// 控制线程每条操作的分配平均不超过0.5次；存储线程的写入（QtSql 绑定参数）只输出参考值
+void MainWindowBenchmark::forwardingAllocations()
+{
+    if (!AllocationCounter::isEnabled()) {
+        QSKIP("未以 CONFIG+=count_allocations 构建，不统计堆分配");
+    }
+
+    constexpr int Commands = 50;  // 小于控制核心预留的队列容量
+    HomeController *controller = MainWindowTestAccess::controller(*window);
+    StorageWorker *storage = MainWindowTestAccess::storage(*window);
+    auto threadAllocations = [](QObject *context) {
+        quint64 count = 0;
+        QMetaObject::invokeMethod(context, [&count]() {
+            count = AllocationCounter::allocations();
+        }, Qt::BlockingQueuedConnection);
+        return count;
+    };
+
+    // 灯已经打开：重复的 turn_on 不改变界面，界面线程上只剩转发本身
+    QVERIFY(MainWindowTestAccess::setPowerByButton(*window, livingroomLight, true));
+    quint64 guiAllocations = 0;
+    quint64 controllerAllocations = 0;
+    quint64 storageAllocations = 0;
+    // 前两轮让两边队列的容量增长到位，只检查最后一轮
+    for (int round = 0; round < 3; ++round) {
+        // 控制线程停在一个事件中，这一轮的操作都在队列里等待同一次唤醒
+        QSemaphore parked;
+        QSemaphore resume;
+        quint64 controllerBefore = 0;
+        QMetaObject::invokeMethod(controller, [&]() {
+            controllerBefore = AllocationCounter::allocations();
+            parked.release();
+            resume.acquire();
+        }, Qt::QueuedConnection);
+        parked.acquire();
+        const quint64 storageBefore = threadAllocations(storage);
+
+        {
+            AllocationScope scope;
+            for (int i = 0; i < Commands; ++i) {
+                MainWindowTestAccess::setPowerByButton(*window, livingroomLight, true);
+            }
+            guiAllocations = scope.allocations();
+        }
+        resume.release();
+
+        // 读取计数的事件排在唤醒之后，控制线程已处理完这一批；存储线程同理
+        controllerAllocations = threadAllocations(controller) - controllerBefore;
+        storageAllocations = threadAllocations(storage) - storageBefore;
+    }
+
+    qInfo("forwarding %d commands: gui %llu, controller %llu, storage %llu allocations", Commands,
+          guiAllocations, controllerAllocations, storageAllocations);
+    // 一次唤醒：函数对象和队列事件，与操作条数无关（逐条转发时每条至少4次）
+    QVERIFY2(guiAllocations <= 8, qPrintable(QString("界面线程分配 %1 次").arg(guiAllocations)));
+    QVERIFY2(controllerAllocations <= Commands / 2,
+             qPrintable(QString("控制线程分配 %1 次").arg(controllerAllocations)));
+}
+
+// 启动时恢复状态只需要一次文件读取和反序列化
+void MainWindowBenchmark::readSnapshot()
+{
+    const HomeSnapshot saved = MainWindowTestAccess::captureSnapshot(*window);
+    const QString path = tempDir.filePath("read.snapshot");
+    QString errorMessage;
+    QVERIFY2(HomeSnapshot::writeFile(path, saved.serialize(), &errorMessage), qPrintable(errorMessage));
+
+    HomeSnapshot restored;
+    QBENCHMARK {
+        QVERIFY2(HomeSnapshot::readFile(path, &restored, &errorMessage), qPrintable(errorMessage));
+    }
+    QCOMPARE(restored.devices.size(), saved.devices.size());
+}
+
+SMARTHOME_BENCHMARK_MAIN(MainWindowBenchmark)
+
+#include "mainwindowbenchmark.moc"
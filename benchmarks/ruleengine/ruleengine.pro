@@ -0,0 +1,7 @@
+# 规则引擎的增量计算
+TARGET = ruleenginebenchmark
+
+include(../benchmark.pri)
+
+SOURCES += \
+    ruleenginebenchmark.cpp
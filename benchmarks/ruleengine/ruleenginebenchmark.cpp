@@ -0,0 +1,37 @@
+#include "benchmarksupport.h"
+
+// 规则引擎：输入变化时的增量计算；条件和动作见 tests/ruleengine
+class RuleEngineBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void evaluateRules();
+};
+
+// 内置规则：室外温度变化只重新计算依赖它的规则
+void RuleEngineBenchmark::evaluateRules()
+{
+    RuleEngine engine;
+    QVERIFY(engine.loadDefaultRules());
+    QVERIFY(engine.ruleCount() > 0);
+    const int outside = engine.inputIndex("sensor.outside");
+    engine.setInput("plan.Livingroom", 1);
+    engine.setInput("plan.Bedroom", 1);
+
+    int fired = 0;
+    connect(&engine, &RuleEngine::actionTriggered, [&fired]() {
+        ++fired;
+    });
+    // 在制冷和制热阈值两侧交替，每次都有规则从不满足变为满足
+    const double temperatures[] = { 30, 20, 10, 20 };
+    int i = 0;
+    QBENCHMARK {
+        engine.setInput(outside, temperatures[i++ & 3]);
+    }
+    QVERIFY(fired > 0);
+}
+
+SMARTHOME_BENCHMARK_MAIN(RuleEngineBenchmark)
+
+#include "ruleenginebenchmark.moc"
@@ -0,0 +1,7 @@
+# 场景使用统计的查询
+TARGET = sceneanalyticsbenchmark
+
+include(../benchmark.pri)
+
+SOURCES += \
+    sceneanalyticsbenchmark.cpp
@@ -0,0 +1,49 @@
+#include "benchmarksupport.h"
+#include "sceneanalytics.h"
+
+// 场景使用统计：打开统计对话框时的查询只读内存；统计是否正确见 tests/sceneanalytics
+class SceneAnalyticsBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void usage();
+
+private:
+    CoreFixture core;
+};
+
+void SceneAnalyticsBenchmark::initTestCase()
+{
+    QVERIFY(core.open());
+}
+
+// 默认场景各运行一周，每小时一次
+void SceneAnalyticsBenchmark::usage()
+{
+    SceneAnalytics *analytics = core.storage->sceneAnalytics();
+    QVERIFY(analytics);
+    const QStringList scenes = { "comingHomeMode", "leavingHomeMode", "SleepMode", "WakeUpMode" };
+    const QDateTime start(QDate(2024, 1, 1), QTime(0, 0));
+    StorageRecord record;
+    record.kind = StorageRecord::SceneRun;
+    record.value = QStringLiteral("on");
+    for (int hour = 0; hour < 7 * 24; ++hour) {
+        record.id = scenes.at(hour % scenes.size());
+        record.at = start.addSecs(hour * 3600);
+        core.storage->enqueue(record);
+    }
+    core.storage->drain();
+
+    QVector<SceneUsage> usage;
+    QBENCHMARK {
+        usage = analytics->usage();
+    }
+    QVERIFY(usage.size() >= scenes.size());
+}
+
+SMARTHOME_BENCHMARK_MAIN(SceneAnalyticsBenchmark)
+
+#include "sceneanalyticsbenchmark.moc"
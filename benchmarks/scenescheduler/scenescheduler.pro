@@ -0,0 +1,7 @@
+# 分层时间轮的插入和取消
+TARGET = sceneschedulerbenchmark
+
+include(../benchmark.pri)
+
+SOURCES += \
+    sceneschedulerbenchmark.cpp
@@ -0,0 +1,33 @@
+#include "benchmarksupport.h"
+#include "scenescheduler.h"
+
+// 场景调度器：时间轮的插入和取消；触发时刻是否准确见 tests/scenescheduler
+class SceneSchedulerBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void scheduleAndCancel();
+};
+
+// 插入和取消都是 O(1)：1000个分布在各层的任务
+void SceneSchedulerBenchmark::scheduleAndCancel()
+{
+    const QDateTime start(QDate(2024, 1, 1), QTime(0, 0, 30));
+    SceneScheduler scheduler;
+    scheduler.setSimulatedTime(start);
+    QVector<quint64> ids(1000);
+    QBENCHMARK {
+        for (int i = 0; i < ids.size(); ++i) {
+            ids[i] = scheduler.scheduleOnce("bench", start.addSecs(1 + qint64(i) * 997));
+        }
+        for (quint64 id : qAsConst(ids)) {
+            scheduler.cancel(id);
+        }
+    }
+    QCOMPARE(scheduler.jobCount(), 0);
+}
+
+SMARTHOME_BENCHMARK_MAIN(SceneSchedulerBenchmark)
+
+#include "sceneschedulerbenchmark.moc"
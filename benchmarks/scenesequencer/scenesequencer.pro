@@ -0,0 +1,7 @@
+# 场景序列的等待、渐变和取消
+TARGET = scenesequencerbenchmark
+
+include(../benchmark.pri)
+
+SOURCES += \
+    scenesequencerbenchmark.cpp
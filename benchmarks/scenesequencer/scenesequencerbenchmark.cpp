@@ -0,0 +1,62 @@
+#include "benchmarksupport.h"
+#include "scenesequencer.h"
+#include <QElapsedTimer>
+
+// 场景序列：大量同时等待的序列
+class SceneSequencerBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void concurrentSceneSequences();
+};
+
+// 上万个同时等待的场景序列只占用内存：启动、唤醒和渐变都在一个线程的事件循环中完成
+void SceneSequencerBenchmark::concurrentSceneSequences()
+{
+    RuleEngine ruleEngine;
+    ruleEngine.loadDefaultRules();
+    SceneSequencer sequencer;
+    sequencer.setRuleEngine(&ruleEngine);
+    QString errorMessage;
+    QVERIFY2(sequencer.loadSequences(R"([{
+        "id": "fade",
+        "steps": [
+            {"wait": 0.05},
+            {"device": "StudyroomLight", "command": "power", "value": "on"},
+            {"device": "BedroomAc", "command": "temperature",
+             "ramp": {"from": 20, "to": 26, "seconds": 0.3, "steps": 6}}
+        ]
+    }])", &errorMessage), qPrintable(errorMessage));
+
+    int actions = 0;
+    connect(&sequencer, &SceneSequencer::actionTriggered, [&actions]() {
+        ++actions;
+    });
+
+    const int runs = 10000;
+    QElapsedTimer elapsed;
+    elapsed.start();
+    for (int i = 0; i < runs; ++i) {
+        QVERIFY(sequencer.start("fade") != 0);
+    }
+    const qint64 startMs = elapsed.elapsed();
+    QCOMPARE(sequencer.runningCount(), runs);
+
+    QTRY_COMPARE_WITH_TIMEOUT(sequencer.runningCount(), 0, 30000);
+    // 开灯1次，渐变 20..26 共7个值
+    QCOMPARE(actions, runs * 8);
+    qInfo("started %d sequences in %lld ms, all finished after %lld ms", runs, startMs, elapsed.elapsed());
+
+    // 同组的新序列取消旧序列
+    quint64 first = sequencer.start("fade", SceneSequencer::SceneGroup);
+    quint64 second = sequencer.start("fade", SceneSequencer::SceneGroup);
+    QVERIFY(!sequencer.isRunning(first));
+    QVERIFY(sequencer.isRunning(second));
+    sequencer.startScene("leavingHomeMode");
+    QCOMPARE(sequencer.runningCount(), 0);
+}
+
+SMARTHOME_BENCHMARK_MAIN(SceneSequencerBenchmark)
+
+#include "scenesequencerbenchmark.moc"
@@ -0,0 +1,7 @@
+# 定时任务的读入
+TARGET = schedulestorebenchmark
+
+include(../benchmark.pri)
+
+SOURCES += \
+    schedulestorebenchmark.cpp
@@ -0,0 +1,68 @@
+#include "benchmarksupport.h"
+#include "schedulestore.h"
+
+// 定时任务持久化：启动时的一次读入；字段是否保持不变见 tests/schedulestore
+class ScheduleStoreBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void loadAll();
+
+private:
+    QTemporaryDir tempDir;
+    QSqlDatabase db;
+    ScheduleStore *store = nullptr;
+};
+
+void ScheduleStoreBenchmark::initTestCase()
+{
+    QVERIFY(tempDir.isValid());
+    db = QSqlDatabase::addDatabase("QSQLITE", "schedulestore");
+    db.setDatabaseName(tempDir.filePath("schedules.db"));
+    QVERIFY(db.open());
+    store = new ScheduleStore(db);
+    QVERIFY(store->ensureSchema());
+}
+
+void ScheduleStoreBenchmark::cleanupTestCase()
+{
+    delete store;
+    store = nullptr;
+    db.close();
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase("schedulestore");
+}
+
+// 1000个循环任务
+void ScheduleStoreBenchmark::loadAll()
+{
+    ScheduleJob job;
+    job.sceneId = "WakeUpMode";
+    job.kind = ScheduleJob::Recurring;
+    job.weekdays = 0x1F;
+    job.timeOfDay = QTime(6, 45);
+    job.catchUpPolicy = ScheduleJob::RunIfWithin;
+    job.catchUpMinutes = 30;
+    const QDateTime fireAt(QDate(2030, 5, 7), job.timeOfDay);
+    QVERIFY(db.transaction());
+    for (int i = 0; i < 1000; ++i) {
+        job.id = 1000 + quint64(i);
+        job.fireAt = fireAt.addSecs(i * 60);
+        QVERIFY(store->save(job));
+    }
+    QVERIFY(db.commit());
+
+    QVector<ScheduleJob> jobs;
+    QBENCHMARK {
+        jobs = store->loadAll();
+    }
+    QCOMPARE(jobs.size(), 1000);
+}
+
+SMARTHOME_BENCHMARK_MAIN(ScheduleStoreBenchmark)
+
+#include "schedulestorebenchmark.moc"
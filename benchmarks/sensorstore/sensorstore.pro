@@ -0,0 +1,7 @@
+# 温度时间序列的写入和范围查询
+TARGET = sensorstorebenchmark
+
+include(../benchmark.pri)
+
+SOURCES += \
+    sensorstorebenchmark.cpp
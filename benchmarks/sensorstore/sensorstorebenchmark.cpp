@@ -0,0 +1,71 @@
+#include "benchmarksupport.h"
+#include "sensorstore.h"
+
+// 温度时间序列：缓冲写入和范围查询的耗时；写入、查询和降采样的结果见 tests/sensorstore
+class SensorStoreBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void append();
+    void querySeries();
+
+private:
+    QTemporaryDir tempDir;
+    QSqlDatabase db;
+    SensorStore *store = nullptr;
+};
+
+void SensorStoreBenchmark::initTestCase()
+{
+    QVERIFY(tempDir.isValid());
+    db = QSqlDatabase::addDatabase("QSQLITE", "sensorstore");
+    db.setDatabaseName(tempDir.filePath("sensor.db"));
+    QVERIFY(db.open());
+    store = new SensorStore(db);
+    QVERIFY(store->ensureSchema());
+}
+
+void SensorStoreBenchmark::cleanupTestCase()
+{
+    delete store;
+    store = nullptr;
+    db.close();
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase("sensorstore");
+}
+
+// 每条读数的写入开销（含每64条一次的批量提交）
+void SensorStoreBenchmark::append()
+{
+    const QDateTime start = QDateTime::currentDateTime().addSecs(-3600);
+    int i = 0;
+    QBENCHMARK {
+        store->append("Append", "sensor", 20.0, start.addSecs(i++ % 3600));
+    }
+    store->flush();
+}
+
+// 两小时、每10分钟一条的读数
+void SensorStoreBenchmark::querySeries()
+{
+    const QString room = QStringLiteral("Query");
+    const QDateTime start = QDateTime::currentDateTime().addSecs(-2 * 3600);
+    for (int i = 0; i < 12; ++i) {
+        store->append(room, "sensor", 20.0 + i, start.addSecs(i * 600));
+    }
+    store->flush();
+
+    QVector<SensorReading> series;
+    QBENCHMARK {
+        series = store->querySeries(room, start, start.addSecs(7200));
+    }
+    QCOMPARE(series.size(), 12);
+}
+
+SMARTHOME_BENCHMARK_MAIN(SensorStoreBenchmark)
+
+#include "sensorstorebenchmark.moc"
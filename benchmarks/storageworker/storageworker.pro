@@ -0,0 +1,7 @@
+# 存储线程的写入和设备状态恢复
+TARGET = storageworkerbenchmark
+
+include(../benchmark.pri)
+
+SOURCES += \
+    storageworkerbenchmark.cpp
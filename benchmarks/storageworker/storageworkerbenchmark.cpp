@@ -0,0 +1,142 @@
+#include "benchmarksupport.h"
+#include "homesnapshot.h"
+#include <QElapsedTimer>
+#include <QSqlQuery>
+#include <QThread>
+#include <QTimer>
+#include <atomic>
+
+// 存储线程：默认数据的写入、积压记录的批量写入和设备状态恢复的耗时；恢复结果见 tests/storageworker
+class StorageWorkerBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void populateDefaultDevicesCold();
+    void populateDefaultDevicesWarm();
+    void storageBacklogEventLoopLatency();
+    void recoverDevices();
+
+private:
+    CoreFixture core;
+};
+
+void StorageWorkerBenchmark::initTestCase()
+{
+    QVERIFY(core.open());
+}
+
+void StorageWorkerBenchmark::populateDefaultDevicesCold()
+{
+    // 清空设备表，只测第一次插入
+    QSqlQuery query(core.storage->database());
+    QVERIFY(query.exec("DELETE FROM devices"));
+    QBENCHMARK_ONCE {
+        core.storage->populateDefaultDevices();
+    }
+}
+
+void StorageWorkerBenchmark::populateDefaultDevicesWarm()
+{
+    // 设备已存在，INSERT OR IGNORE 全部跳过
+    QBENCHMARK {
+        core.storage->populateDefaultDevices();
+    }
+}
+
+// 存储线程写入大量积压记录时，界面线程的事件循环不应被阻塞：
+// 4ms 的定时器统计相邻两次触发的最大间隔，要求低于一帧（16ms）
+void StorageWorkerBenchmark::storageBacklogEventLoopLatency()
+{
+    const int records = 200000;
+    const QStringList devices = { "LivingroomLight", "BedroomLight", "LivingroomCurtain", "StudyroomLight" };
+
+    qint64 worstGapNs = 0;
+    QElapsedTimer sinceTick;
+    QTimer ticker;
+    ticker.setTimerType(Qt::PreciseTimer);
+    ticker.setInterval(4);
+    connect(&ticker, &QTimer::timeout, [&]() {
+        worstGapNs = qMax(worstGapNs, sinceTick.nsecsElapsed());
+        sinceTick.start();
+    });
+
+    // 与界面程序相同：存储对象运行在单独的线程，测试线程是生产者
+    QThread thread;
+    StorageWorker *worker = new StorageWorker(core.filePath("backlog.db"), "backlog");
+    worker->moveToThread(&thread);
+    connect(&thread, &QThread::finished, worker, &QObject::deleteLater);
+    thread.start();
+    bool opened = false;
+    QMetaObject::invokeMethod(worker, [worker]() {
+        if (!worker->open()) {
+            return false;
+        }
+        worker->populateDefaultDevices();
+        return true;
+    }, Qt::BlockingQueuedConnection, &opened);
+    if (!opened) {
+        thread.quit();
+        thread.wait();
+        QFAIL("存储线程打开数据库失败");
+    }
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    sinceTick.start();
+    ticker.start();
+
+    QDateTime at = QDateTime::currentDateTime();
+    StorageRecord record;
+    record.kind = StorageRecord::DeviceAction;
+    record.type = "toggle";
+    for (int i = 0; i < records; ++i) {
+        record.id = devices.at(i % devices.size());
+        record.value = (i / devices.size()) % 2 ? "off" : "on";
+        record.at = at.addMSecs(i);
+        worker->enqueue(record);
+        // 生产者每批之间让出事件循环，与实际的界面操作一样
+        if (i % 1000 == 999) {
+            QCoreApplication::processEvents();
+        }
+    }
+
+    // 屏障：排在所有写入之后执行
+    std::atomic<bool> done(false);
+    QMetaObject::invokeMethod(worker, [&done]() {
+        done = true;
+    });
+    QTRY_VERIFY_WITH_TIMEOUT(done, 120000);
+    ticker.stop();
+    thread.quit();
+    thread.wait();
+
+    qInfo("drained %d records in %lld ms, worst event loop gap %.1f ms",
+          records, elapsed.elapsed(), worstGapNs / 1e6);
+    QVERIFY2(worstGapNs < 16 * 1000 * 1000,
+             qPrintable(QString("事件循环最长间隔 %1 ms").arg(worstGapNs / 1e6)));
+}
+
+// 启动时的快照加历史回放：快照之后有1000条记录
+void StorageWorkerBenchmark::recoverDevices()
+{
+    HomeSnapshot snapshot;
+    snapshot.devices = core.storage->loadDevices();
+    snapshot.historySequence = core.storage->lastHistorySequence();
+    const int tailRows = 1000;
+    for (int i = 0; i < tailRows; ++i) {
+        QVERIFY(core.controller->recordDeviceAction("LivingroomLight", "toggle", i % 2 ? "off" : "on"));
+    }
+
+    DeviceRecovery recovery;
+    QBENCHMARK {
+        recovery = core.storage->recoverDevices(&snapshot);
+    }
+    QCOMPARE(recovery.replayedRows, tailRows);
+}
+
+SMARTHOME_BENCHMARK_MAIN(StorageWorkerBenchmark)
+
+#include "storageworkerbenchmark.moc"
@@ -0,0 +1,7 @@
+# 自适应天气轮询间隔的计算
+TARGET = weatherpollpolicybenchmark
+
+include(../benchmark.pri)
+
+SOURCES += \
+    weatherpollpolicybenchmark.cpp
@@ -0,0 +1,31 @@
+#include "benchmarksupport.h"
+#include "weatherpollpolicy.h"
+
+// 天气轮询策略：计算下一次轮询间隔的耗时；各种情况下的间隔见 tests/weatherpollpolicy
+class WeatherPollPolicyBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void nextInterval();
+};
+
+void WeatherPollPolicyBenchmark::nextInterval()
+{
+    WeatherPollPolicy policy;
+    policy.setThresholds({26, 28, 30, 32});
+    const QDateTime start = QDateTime::currentDateTime().addSecs(-4 * 3600);
+    for (int i = 0; i < 4; ++i) {
+        policy.recordObservation(20 + (i % 2), start.addSecs(3600 * i));
+    }
+
+    int interval = 0;
+    QBENCHMARK {
+        interval = policy.nextIntervalMs();
+    }
+    QCOMPARE(interval, int(WeatherPollPolicy::NormalIntervalMs));
+}
+
+SMARTHOME_BENCHMARK_MAIN(WeatherPollPolicyBenchmark)
+
+#include "weatherpollpolicybenchmark.moc"
@@ -0,0 +1,516 @@
+#include "controlserver.h"
+#include "metricsregistry.h"
+#include <QCborArray>
+#include <QDebug>
+#include <QLocalSocket>
+#include <QtEndian>
+#include <algorithm>
+
+const char ControlServer::DefaultName[] = "QtSmartHome-control";
+
+static const QString KeyId = QStringLiteral("id");
+static const QString KeyOp = QStringLiteral("op");
+static const QString KeyOk = QStringLiteral("ok");
+static const QString KeyError = QStringLiteral("error");
+static const QString KeyDevice = QStringLiteral("device");
+static const QString KeyDevices = QStringLiteral("devices");
+static const QString KeyCommand = QStringLiteral("command");
+static const QString KeyCommands = QStringLiteral("commands");
+static const QString KeyValue = QStringLiteral("value");
+static const QString KeyScene = QStringLiteral("scene");
+static const QString KeyEnable = QStringLiteral("enable");
+static const QString KeyEvent = QStringLiteral("event");
+static const QString KeyOn = QStringLiteral("on");
+static const QString KeyMode = QStringLiteral("mode");
+static const QString KeyTemperature = QStringLiteral("temperature");
+static const QString KeySeq = QStringLiteral("seq");
+static const QString KeySnapshot = QStringLiteral("snapshot");
+static const QString KeyDeltas = QStringLiteral("deltas");
+// 控制接口发出的命令在日志中的来源
+static const QString ApiRuleId = QStringLiteral("api");
+
+static const char *const OpNames[] = { "invalid", "get", "set", "scene", "subscribe" };
+
+ControlServer::ControlServer(QObject *parent)
+    : QObject(parent)
+    , server(this)
+    , nextConnectionId(1)
+    , subscriberCount(0)
+    , sequence(0)
+    , connectionGauge(&MetricsRegistry::instance().gauge("smarthome_control_connections",
+                                                         "Open control API connections"))
+    , deltasSent(&MetricsRegistry::instance().counter("smarthome_control_stream_deltas_total",
+                                                      "Device state deltas written to subscribers"))
+    , deltasCoalesced(&MetricsRegistry::instance().counter(
+          "smarthome_control_stream_coalesced_total",
+          "Device state changes replaced by a later change before reaching a backlogged subscriber"))
+{
+    qRegisterMetaType<ControlBatch>("ControlBatch");
+    qRegisterMetaType<DeviceState>("DeviceState");
+    qRegisterMetaType<QVector<DeviceState>>("QVector<DeviceState>");
+    for (int op = 0; op <= ControlRequest::Subscribe; ++op) {
+        requestCounters[op] = &MetricsRegistry::instance().counter(
+            "smarthome_control_requests_total", "Control API requests",
+            MetricsRegistry::label("op", QString::fromLatin1(OpNames[op])));
+    }
+    // 只允许当前用户连接
+    server.setSocketOptions(QLocalServer::UserAccessOption);
+    connect(&server, &QLocalServer::newConnection, this, &ControlServer::onNewConnection);
+}
+
+// 能连上说明另一个实例正在监听
+static bool isServerRunning(const QString &name)
+{
+    QLocalSocket probe;
+    probe.connectToServer(name);
+    return probe.waitForConnected(200);
+}
+
+bool ControlServer::listen(const QString &name)
+{
+    bool listening = server.listen(name);
+    // 上次异常退出会留下套接字文件；已有实例在监听时不抢占
+    if (!listening && server.serverError() == QAbstractSocket::AddressInUseError && !isServerRunning(name)) {
+        QLocalServer::removeServer(name);
+        listening = server.listen(name);
+    }
+    if (!listening) {
+        qWarning() << "控制接口监听失败:" << name << server.errorString();
+        return false;
+    }
+    qDebug() << "控制接口已启动:" << server.fullServerName();
+    return true;
+}
+
+QString ControlServer::fullServerName() const
+{
+    return server.fullServerName();
+}
+
+int ControlServer::connectionCount() const
+{
+    return connections.size();
+}
+
+QString ControlServer::nameFromEnvironment()
+{
+    if (!qEnvironmentVariableIsSet("SMARTHOME_CONTROL_SOCKET")) {
+        return QString::fromLatin1(DefaultName);
+    }
+    return qEnvironmentVariable("SMARTHOME_CONTROL_SOCKET");
+}
+
+QByteArray ControlServer::frame(const QCborValue &payload)
+{
+    const QByteArray body = payload.toCbor();
+    QByteArray data(4, Qt::Uninitialized);
+    qToBigEndian<quint32>(quint32(body.size()), data.data());
+    data.append(body);
+    return data;
+}
+
+bool ControlServer::takeFrame(const QByteArray &buffer, int *offset, QByteArray *payload, bool *tooLarge)
+{
+    if (buffer.size() - *offset < 4) {
+        return false;
+    }
+    quint32 length = qFromBigEndian<quint32>(buffer.constData() + *offset);
+    if (length > quint32(MaxFrameBytes)) {
+        if (tooLarge) {
+            *tooLarge = true;
+        }
+        return false;
+    }
+    if (buffer.size() - *offset - 4 < int(length)) {
+        return false;
+    }
+    *payload = QByteArray::fromRawData(buffer.constData() + *offset + 4, int(length));
+    *offset += 4 + int(length);
+    return true;
+}
+
+// 值可以是字符串或数字（温度）
+static bool decodeCommand(const QCborMap &map, RuleAction *action)
+{
+    action->ruleId = ApiRuleId;
+    action->deviceId = map.value(KeyDevice).toString();
+    action->command = map.value(KeyCommand).toString();
+    QCborValue value = map.value(KeyValue);
+    action->value = value.isString() ? value.toString() : value.toVariant().toString();
+    return !action->deviceId.isEmpty() && !action->command.isEmpty();
+}
+
+ControlRequest ControlServer::decodeRequest(const QCborValue &value)
+{
+    ControlRequest request;
+    if (!value.isMap()) {
+        request.error = "请求必须是 map";
+        return request;
+    }
+    const QCborMap map = value.toMap();
+    request.id = map.value(KeyId).toInteger();
+    const QString op = map.value(KeyOp).toString();
+
+    if (op == QLatin1String("get")) {
+        request.op = ControlRequest::Get;
+        const QCborArray ids = map.value(KeyDevices).toArray();
+        for (const QCborValue &id : ids) {
+            request.deviceIds.append(id.toString());
+        }
+    } else if (op == QLatin1String("set")) {
+        request.op = ControlRequest::Set;
+        RuleAction action;
+        if (map.contains(KeyCommands)) {
+            const QCborArray commands = map.value(KeyCommands).toArray();
+            request.commands.reserve(commands.size());
+            for (const QCborValue &command : commands) {
+                if (!decodeCommand(command.toMap(), &action)) {
+                    request.error = "set 的命令缺少 device 或 command";
+                    break;
+                }
+                request.commands.append(action);
+            }
+            if (request.commands.isEmpty() && request.error.isEmpty()) {
+                request.error = "set 没有命令";
+            }
+        } else if (decodeCommand(map, &action)) {
+            request.commands.append(action);
+        } else {
+            request.error = "set 缺少 device 或 command";
+        }
+    } else if (op == QLatin1String("scene")) {
+        request.op = ControlRequest::Scene;
+        request.sceneId = map.value(KeyScene).toString();
+        if (request.sceneId.isEmpty()) {
+            request.error = "scene 缺少场景ID";
+        }
+    } else if (op == QLatin1String("subscribe")) {
+        request.op = ControlRequest::Subscribe;
+        request.subscribe = map.value(KeyEnable).toBool(true);
+    } else {
+        request.error = "未知的操作: " + op;
+    }
+    return request;
+}
+
+QCborMap ControlServer::encodeResponse(const ControlRequest &request)
+{
+    QCborMap map;
+    map.insert(KeyId, request.id);
+    map.insert(KeyOk, request.error.isEmpty());
+    if (!request.error.isEmpty()) {
+        map.insert(KeyError, request.error);
+    } else if (request.op == ControlRequest::Get) {
+        QCborArray devices;
+        for (const DeviceState &state : request.states) {
+            devices.append(encodeDevice(state));
+        }
+        map.insert(KeyDevices, devices);
+    }
+    return map;
+}
+
+QCborMap ControlServer::encodeDevice(const DeviceState &state)
+{
+    QCborMap map;
+    map.insert(KeyDevice, state.deviceId);
+    map.insert(KeyOn, state.on);
+    if (!state.mode.isEmpty()) {
+        map.insert(KeyMode, state.mode);
+        map.insert(KeyTemperature, state.temperature);
+    }
+    return map;
+}
+
+// [seq, 序号, on] 或 [seq, 序号, on, mode, temperature]
+QCborArray ControlServer::encodeDelta(qint64 sequence, int index, const DeviceState &state)
+{
+    QCborArray delta;
+    delta.append(sequence);
+    delta.append(index);
+    delta.append(state.on);
+    if (!state.mode.isEmpty()) {
+        delta.append(state.mode);
+        delta.append(state.temperature);
+    }
+    return delta;
+}
+
+void ControlServer::onNewConnection()
+{
+    while (QLocalSocket *socket = server.nextPendingConnection()) {
+        quint64 connectionId = nextConnectionId++;
+        Connection &connection = connections[connectionId];
+        connection.socket = socket;
+        connect(socket, &QLocalSocket::readyRead, this, [this, connectionId]() {
+            readRequests(connectionId);
+        });
+        connect(socket, &QLocalSocket::disconnected, this, [this, connectionId]() {
+            closeConnection(connectionId);
+        });
+        // 发送缓冲排空后补发积压期间合并的增量
+        connect(socket, &QLocalSocket::bytesWritten, this, [this, connectionId]() {
+            flushDeltas(connectionId);
+        });
+    }
+    connectionGauge->set(connections.size());
+}
+
+// 一次读出所有完整的帧，解码后整批转发；格式错误的帧作为失败的请求留在原位置，回复顺序不变
+void ControlServer::readRequests(quint64 connectionId)
+{
+    auto it = connections.find(connectionId);
+    if (it == connections.end()) {
+        return;
+    }
+    Connection &connection = it.value();
+    connection.buffer.append(connection.socket->readAll());
+
+    ControlBatch batch;
+    batch.connectionId = connectionId;
+    int offset = 0;
+    bool tooLarge = false;
+    QByteArray payload;
+    while (takeFrame(connection.buffer, &offset, &payload, &tooLarge)) {
+        QCborParserError parseError;
+        QCborValue value = QCborValue::fromCbor(payload, &parseError);
+        if (parseError.error != QCborError::NoError) {
+            ControlRequest request;
+            request.error = "CBOR解析失败: " + parseError.errorString();
+            batch.requests.append(request);
+            batch.frameSizes.append(-1);
+        } else if (value.isArray()) {
+            const QCborArray array = value.toArray();
+            for (const QCborValue &item : array) {
+                batch.requests.append(decodeRequest(item));
+            }
+            batch.frameSizes.append(array.size());
+        } else {
+            batch.requests.append(decodeRequest(value));
+            batch.frameSizes.append(-1);
+        }
+    }
+    payload.clear();
+    connection.buffer.remove(0, offset);
+
+    if (tooLarge) {
+        qWarning() << "控制接口收到过长的帧，断开连接";
+        closeConnection(connectionId);
+        return;
+    }
+    if (batch.frameSizes.isEmpty()) {
+        return;
+    }
+    for (const ControlRequest &request : qAsConst(batch.requests)) {
+        requestCounters[request.op]->inc();
+    }
+    emit requestsReceived(batch);
+}
+
+void ControlServer::sendResponses(const ControlBatch &batch)
+{
+    auto it = connections.find(batch.connectionId);
+    if (it == connections.end()) {
+        return;
+    }
+    Connection &connection = it.value();
+
+    bool subscribed = false;
+    auto respond = [this, &connection, &subscribed](const ControlRequest &request) {
+        if (request.op == ControlRequest::Subscribe && request.error.isEmpty()
+            && connection.subscribed != request.subscribe) {
+            connection.subscribed = request.subscribe;
+            subscriberCount += request.subscribe ? 1 : -1;
+            subscribed = request.subscribe;
+        }
+        return encodeResponse(request);
+    };
+
+    QByteArray data;
+    int index = 0;
+    for (int size : batch.frameSizes) {
+        if (size < 0) {
+            data.append(frame(respond(batch.requests.at(index++))));
+            continue;
+        }
+        QCborArray responses;
+        for (int i = 0; i < size; ++i) {
+            responses.append(respond(batch.requests.at(index++)));
+        }
+        data.append(frame(responses));
+    }
+    connection.socket->write(data);
+
+    // 新的订阅者在订阅回复之后收到快照；取消订阅时丢弃还没发送的增量
+    if (connection.subscribed && subscribed) {
+        sendSnapshot(connection, snapshotFrame());
+    } else if (!connection.subscribed) {
+        connection.dirty.clear();
+        connection.dirtyIndexes.clear();
+    }
+}
+
+void ControlServer::setDevices(const QVector<DeviceState> &devices)
+{
+    states = devices;
+    stateSequences.fill(++sequence, devices.size());
+    deviceIndexes.clear();
+    deviceIndexes.reserve(devices.size());
+    for (int i = 0; i < states.size(); ++i) {
+        deviceIndexes.insert(states.at(i).deviceId, i);
+    }
+    // 设备序号变了，已有的订阅者重新从快照开始
+    if (subscriberCount > 0) {
+        const QByteArray snapshot = snapshotFrame();
+        for (Connection &connection : connections) {
+            if (connection.subscribed) {
+                sendSnapshot(connection, snapshot);
+            }
+        }
+    }
+}
+
+// 状态变化只编码一次，发送缓冲没有积压的订阅者写同一份数据；
+// 积压的订阅者只标记设备，之后再有变化时覆盖，缓冲排空时由 flushDeltas 发送最新状态
+void ControlServer::publishDeviceState(const QString &deviceId, const DeviceState &state)
+{
+    auto found = deviceIndexes.constFind(deviceId);
+    if (found == deviceIndexes.constEnd()) {
+        // 设备列表之外的设备（例如只在界面中存在）：追加到表尾，订阅者重新取快照
+        DeviceState added = state;
+        added.deviceId = deviceId;
+        QVector<DeviceState> devices = states;
+        devices.append(added);
+        setDevices(devices);
+        return;
+    }
+    const int index = found.value();
+    DeviceState &current = states[index];
+    current.on = state.on;
+    current.mode = state.mode;
+    current.temperature = state.temperature;
+    stateSequences[index] = ++sequence;
+    if (subscriberCount == 0) {
+        return;
+    }
+
+    QByteArray data;
+    for (Connection &connection : connections) {
+        if (!connection.subscribed) {
+            continue;
+        }
+        if (!connection.dirtyIndexes.isEmpty() || connection.socket->bytesToWrite() > StreamBacklogBytes) {
+            if (connection.dirty.testBit(index)) {
+                deltasCoalesced->inc();
+            } else {
+                connection.dirty.setBit(index);
+                connection.dirtyIndexes.append(index);
+            }
+            continue;
+        }
+        if (data.isEmpty()) {
+            QCborMap deltas;
+            deltas.insert(KeyDeltas, QCborArray({ encodeDelta(sequence, index, current) }));
+            data = frame(deltas);
+        }
+        connection.socket->write(data);
+        deltasSent->inc();
+    }
+}
+
+void ControlServer::publishScene(const QString &sceneId)
+{
+    if (subscriberCount == 0) {
+        return;
+    }
+    QCborMap event;
+    event.insert(KeyEvent, KeyScene);
+    event.insert(KeyScene, sceneId);
+    publish(frame(event));
+}
+
+// 事件只编码一次；不读取的订阅者积压过多时断开，不让发送缓冲无限增长
+void ControlServer::publish(const QByteArray &data)
+{
+    QVector<quint64> stalled;
+    for (auto it = connections.begin(); it != connections.end(); ++it) {
+        if (!it->subscribed) {
+            continue;
+        }
+        if (it->socket->bytesToWrite() > MaxPendingEventBytes) {
+            stalled.append(it.key());
+            continue;
+        }
+        it->socket->write(data);
+    }
+    for (quint64 connectionId : qAsConst(stalled)) {
+        qWarning() << "控制接口的订阅者积压过多，断开连接:" << connectionId;
+        closeConnection(connectionId);
+    }
+}
+
+QByteArray ControlServer::snapshotFrame() const
+{
+    QCborArray devices;
+    for (const DeviceState &state : states) {
+        devices.append(encodeDevice(state));
+    }
+    QCborMap snapshot;
+    snapshot.insert(KeyEvent, KeySnapshot);
+    snapshot.insert(KeySeq, sequence);
+    snapshot.insert(KeyDevices, devices);
+    return frame(snapshot);
+}
+
+// 快照包含所有设备的最新状态，之前标记的增量不再需要
+void ControlServer::sendSnapshot(Connection &connection, const QByteArray &snapshot)
+{
+    connection.dirty.fill(false, states.size());
+    connection.dirtyIndexes.clear();
+    connection.socket->write(snapshot);
+}
+
+// 积压期间变化过的设备合成一帧，每个设备一条，按 seq 排序
+void ControlServer::flushDeltas(quint64 connectionId)
+{
+    auto it = connections.find(connectionId);
+    if (it == connections.end()) {
+        return;
+    }
+    Connection &connection = it.value();
+    if (connection.dirtyIndexes.isEmpty() || connection.socket->bytesToWrite() > StreamBacklogBytes) {
+        return;
+    }
+    std::sort(connection.dirtyIndexes.begin(), connection.dirtyIndexes.end(), [this](int a, int b) {
+        return stateSequences.at(a) < stateSequences.at(b);
+    });
+    QCborArray deltas;
+    for (int index : qAsConst(connection.dirtyIndexes)) {
+        deltas.append(encodeDelta(stateSequences.at(index), index, states.at(index)));
+        connection.dirty.clearBit(index);
+    }
+    deltasSent->inc(quint64(connection.dirtyIndexes.size()));
+    connection.dirtyIndexes.clear();
+
+    QCborMap map;
+    map.insert(KeyDeltas, deltas);
+    connection.socket->write(frame(map));
+}
+
+void ControlServer::closeConnection(quint64 connectionId)
+{
+    auto it = connections.find(connectionId);
+    if (it == connections.end()) {
+        return;
+    }
+    QLocalSocket *socket = it->socket;
+    if (it->subscribed) {
+        --subscriberCount;
+    }
+    connections.erase(it);
+    connectionGauge->set(connections.size());
+
+    socket->disconnect(this);
+    socket->abort();
+    socket->deleteLater();
+}
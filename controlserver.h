@@ -0,0 +1,153 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include "homecontroller.h"
+#include "ruleengine.h"
+#include <QBitArray>
+#include <QByteArray>
+#include <QCborArray>
+#include <QCborMap>
+#include <QCborValue>
+#include <QHash>
+#include <QLocalServer>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class MetricCounter;
+class MetricGauge;
+class QLocalSocket;
+
+// 控制接口的一条请求；执行结果在转发途中填入
+struct ControlRequest
+{
+    enum Op {
+        Invalid,
+        Get,        // 读取设备状态
+        Set,        // 一条或多条设备命令，命令与规则动作相同（power/lock、mode、temperature）
+        Scene,      // 执行场景
+        Subscribe   // 订阅（或取消订阅）设备状态和场景事件
+    };
+
+    qint64 id = 0;                 // 客户端给出的编号，原样放入回复
+    Op op = Invalid;
+    QVector<RuleAction> commands;  // Set
+    QStringList deviceIds;         // Get，为空时返回所有设备
+    QString sceneId;               // Scene
+    bool subscribe = true;         // Subscribe
+    QString error;                 // 非空表示失败，不再执行
+    QVector<DeviceState> states;   // Get 的结果
+};
+
+// 一个连接一次读到的所有完整帧，整批转发，每个线程只排队一次
+struct ControlBatch
+{
+    quint64 connectionId = 0;
+    QVector<ControlRequest> requests;
+    QVector<int> frameSizes;       // 每帧的请求数，-1 表示单个请求的帧；回复保持与请求帧相同的形状
+};
+Q_DECLARE_METATYPE(ControlBatch)
+
+// 本机控制接口：QLocalServer 上的分帧协议，只允许当前用户连接
+//
+// 帧：4字节大端长度 + CBOR 内容。内容是一个请求（map），或多个请求组成的数组（一帧发送一批）：
+//   {"id": 1, "op": "get", "devices": ["LivingroomLight"]}           devices 省略时返回所有设备
+//   {"id": 2, "op": "set", "device": "KitchenLight", "command": "power", "value": "on"}
+//   {"id": 3, "op": "set", "commands": [{"device": ..., "command": ..., "value": ...}, ...]}
+//   {"id": 4, "op": "scene", "scene": "leavingHomeMode"}
+//   {"id": 5, "op": "subscribe", "enable": true}
+// 回复与请求帧形状相同：{"id": n, "ok": true} 或 {"id": n, "ok": false, "error": ...}，
+// get 另有 "devices": [{"device", "on", "mode", "temperature"}, ...]
+//
+// 订阅后的状态推送：先收到一帧完整快照，之后只有变化的设备（增量），按设备序号而不是设备ID：
+//   {"event": "snapshot", "seq": n, "devices": [{"device", "on", "mode", "temperature"}, ...]}   数组下标即设备序号
+//   {"deltas": [[seq, 序号, on], [seq, 序号, on, mode, temperature], ...]}                       空调带模式和设定温度
+// seq 是控制核心状态变化的序号，快照之后的增量 seq 都更大；设备列表重新加载时重发快照。
+// 场景事件：{"event": "scene", "scene": ...}
+//
+// 慢的订阅者：发送缓冲积压超过 StreamBacklogBytes 后只记下哪些设备变了，缓冲排空时每个设备只发最新状态，
+// 中间的变化丢弃（seq 会跳过），积压不随变化次数增长。增量每次变化只编码一次，所有订阅者写同一份数据；
+// 控制核心只发出一个跨线程信号，扇出在网络线程中进行，订阅者数量不影响控制线程
+//
+// 客户端可以不等回复连续发送请求，同一连接的回复按请求顺序返回。
+// 请求在网络线程中解码后整批交给界面线程，与按钮走同一条路径执行（界面、控制核心、历史记录），
+// 查询排在同批命令之后在控制线程中读取，最后回到网络线程写回复
+class ControlServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const char DefaultName[];
+    static const int MaxFrameBytes = 1024 * 1024;
+    static const qint64 MaxPendingEventBytes = 4 * 1024 * 1024;  // 订阅者积压超过此值时断开（场景事件）
+    static const qint64 StreamBacklogBytes = 64 * 1024;            // 超过此值后状态增量只合并不发送
+
+    explicit ControlServer(QObject *parent = nullptr);
+
+    bool listen(const QString &name);
+    QString fullServerName() const;
+    int connectionCount() const;
+
+    // 环境变量 SMARTHOME_CONTROL_SOCKET 指定名称，设为空时不启动
+    static QString nameFromEnvironment();
+
+    // 分帧和编解码，客户端（例如基准测试）使用同样的函数
+    static QByteArray frame(const QCborValue &payload);
+    // 从 *offset 处取出一个完整帧并前移 *offset，payload 引用 buffer 中的数据，不复制；
+    // 数据不完整时返回 false，帧过长时 *tooLarge 为 true。调用方读完后一次移除已处理的部分
+    static bool takeFrame(const QByteArray &buffer, int *offset, QByteArray *payload, bool *tooLarge = nullptr);
+    static ControlRequest decodeRequest(const QCborValue &value);
+    static QCborMap encodeResponse(const ControlRequest &request);
+    static QCborMap encodeDevice(const DeviceState &state);
+    static QCborArray encodeDelta(qint64 sequence, int index, const DeviceState &state);
+
+public slots:
+    // 执行完的批次，按请求顺序写回复；连接已断开时丢弃
+    void sendResponses(const ControlBatch &batch);
+    // 控制核心的设备列表和事件：维护按序号排列的状态表，推送给订阅的连接
+    void setDevices(const QVector<DeviceState> &devices);
+    void publishDeviceState(const QString &deviceId, const DeviceState &state);
+    void publishScene(const QString &sceneId);
+
+signals:
+    void requestsReceived(const ControlBatch &batch);
+
+private slots:
+    void onNewConnection();
+
+private:
+    struct Connection {
+        QLocalSocket *socket = nullptr;
+        QByteArray buffer;
+        bool subscribed = false;
+        QBitArray dirty;             // 按设备序号：积压期间变化过、还没有发送的设备
+        QVector<int> dirtyIndexes;
+    };
+
+    void readRequests(quint64 connectionId);
+    void publish(const QByteArray &data);
+    QByteArray snapshotFrame() const;
+    void sendSnapshot(Connection &connection, const QByteArray &snapshot);
+    void flushDeltas(quint64 connectionId);
+    void closeConnection(quint64 connectionId);
+
+    QLocalServer server;
+    QHash<quint64, Connection> connections;
+    quint64 nextConnectionId;
+    int subscriberCount;
+
+    // 状态表：订阅者的快照和增量都取自这里，与控制核心的信号顺序一致
+    QVector<DeviceState> states;     // 设备序号 -> 最新状态
+    QVector<qint64> stateSequences;  // 设备序号 -> 最近一次变化的 seq
+    QHash<QString, int> deviceIndexes;
+    qint64 sequence;
+
+    MetricCounter *requestCounters[ControlRequest::Subscribe + 1];  // 按操作计数
+    MetricGauge *connectionGauge;
+    MetricCounter *deltasSent;
+    MetricCounter *deltasCoalesced;
+};
+
+#endif // CONTROLSERVER_H
@@ -0,0 +1,162 @@
+#include "devicecatalog.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QStandardPaths>
+
+const DeviceCatalog &DeviceCatalog::instance()
+{
+    // 函数内静态对象的初始化是线程安全的，第一次使用时加载
+    static const DeviceCatalog catalog = []() {
+        DeviceCatalog loaded;
+        loaded.loadDefault();
+        return loaded;
+    }();
+    return catalog;
+}
+
+bool DeviceCatalog::load(const QByteArray &json, QString *errorMessage)
+{
+    QJsonParseError jsonError;
+    QJsonDocument doc = QJsonDocument::fromJson(json, &jsonError);
+    if (jsonError.error != QJsonParseError::NoError || !doc.isObject()) {
+        if (errorMessage) {
+            *errorMessage = "设备目录JSON解析失败: " + jsonError.errorString();
+        }
+        return false;
+    }
+
+    auto fail = [errorMessage](const QString &message) {
+        if (errorMessage) {
+            *errorMessage = message;
+        }
+        return false;
+    };
+
+    QJsonObject root = doc.object();
+    QVector<DeviceTypeInfo> types;
+    QHash<QString, int> typeIndex;
+    const QJsonArray typeArray = root["types"].toArray();
+    for (const QJsonValue &typeValue : typeArray) {
+        QJsonObject typeObj = typeValue.toObject();
+        DeviceTypeInfo type;
+        type.id = typeObj["id"].toString();
+        type.label = typeObj["label"].toString(type.id);
+        type.defaultStatus = typeObj["defaultStatus"].toString("off");
+        if (type.id.isEmpty() || typeIndex.contains(type.id)) {
+            return fail(QString("设备类型缺少 id 或重复: %1").arg(type.id));
+        }
+        typeIndex.insert(type.id, types.size());
+        types.append(type);
+    }
+
+    const QJsonArray deviceArray = root["devices"].toArray();
+    QVector<DeviceInfo> devices;
+    QHash<QString, int> byId;
+    QHash<QString, int> byName;
+    devices.reserve(deviceArray.size());
+    byId.reserve(deviceArray.size());
+    byName.reserve(deviceArray.size());
+    for (const QJsonValue &deviceValue : deviceArray) {
+        QJsonObject deviceObj = deviceValue.toObject();
+        DeviceInfo device;
+        device.id = deviceObj["id"].toString();
+        device.name = deviceObj["name"].toString(device.id);
+        device.type = deviceObj["type"].toString();
+        device.room = deviceObj["room"].toString();
+
+        auto type = typeIndex.constFind(device.type);
+        if (device.id.isEmpty() || type == typeIndex.constEnd()) {
+            return fail(QString("设备缺少 id 或类型未定义: %1 %2").arg(device.id, device.type));
+        }
+        if (byId.contains(device.id) || byName.contains(device.name)) {
+            return fail(QString("设备ID或名称重复: %1 %2").arg(device.id, device.name));
+        }
+        // 设备可以覆盖类型的初始状态
+        device.defaultStatus = deviceObj["defaultStatus"].toString(types.at(type.value()).defaultStatus);
+
+        byId.insert(device.id, devices.size());
+        byName.insert(device.name, devices.size());
+        devices.append(device);
+    }
+
+    typeList = types;
+    deviceList = devices;
+    indexById = byId;
+    indexByName = byName;
+    return true;
+}
+
+// 用户目录无法读取或内容无效时不让界面没有设备：警告后改用内置目录
+bool DeviceCatalog::loadDefault()
+{
+    static const QString builtinCatalog = QStringLiteral(":/devices/default_catalog.json");
+    QString userCatalog = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/devices.json";
+
+    QString errorMessage;
+    if (QFile::exists(userCatalog)) {
+        if (loadFile(userCatalog, &errorMessage)) {
+            return true;
+        }
+        qWarning() << "用户设备目录无效，改用内置目录:" << userCatalog << errorMessage;
+    }
+    if (!loadFile(builtinCatalog, &errorMessage)) {
+        qCritical() << "加载设备目录失败:" << builtinCatalog << errorMessage;
+        return false;
+    }
+    return true;
+}
+
+bool DeviceCatalog::loadFile(const QString &path, QString *errorMessage)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *errorMessage = "无法读取文件: " + file.errorString();
+        return false;
+    }
+    if (!load(file.readAll(), errorMessage)) {
+        return false;
+    }
+    qDebug() << "已加载设备目录:" << path << "设备数量:" << deviceList.size()
+             << "耗时(毫秒):" << timer.nsecsElapsed() / 1e6;
+    return true;
+}
+
+const QVector<DeviceTypeInfo> &DeviceCatalog::types() const
+{
+    return typeList;
+}
+
+const QVector<DeviceInfo> &DeviceCatalog::devices() const
+{
+    return deviceList;
+}
+
+QVector<DeviceInfo> DeviceCatalog::devicesOfType(const QString &type) const
+{
+    QVector<DeviceInfo> result;
+    for (const DeviceInfo &device : deviceList) {
+        if (device.type == type) {
+            result.append(device);
+        }
+    }
+    return result;
+}
+
+const DeviceInfo *DeviceCatalog::find(const QString &deviceId) const
+{
+    auto it = indexById.constFind(deviceId);
+    return it != indexById.constEnd() ? &deviceList.at(it.value()) : nullptr;
+}
+
+const DeviceInfo *DeviceCatalog::findByName(const QString &name) const
+{
+    auto it = indexByName.constFind(name);
+    return it != indexByName.constEnd() ? &deviceList.at(it.value()) : nullptr;
+}
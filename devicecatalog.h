@@ -0,0 +1,57 @@
+#ifndef DEVICECATALOG_H
+#define DEVICECATALOG_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// 设备类型：自定义场景对话框按类型分组，新设备的初始状态默认取自类型；
+// 类型接受的命令、状态值和设定温度范围见 devicetraits.h
+struct DeviceTypeInfo
+{
+    QString id;              // light / curtain / air_conditioner / lock
+    QString label;           // 分组标题，例如 "灯光设备"
+    QString defaultStatus;
+};
+
+struct DeviceInfo
+{
+    QString id;              // 设备ID，界面按钮为 <ID>Button
+    QString name;            // 显示名称，自定义场景按名称保存
+    QString type;
+    QString room;
+    QString defaultStatus;   // 写入数据库时的初始状态
+};
+
+// 设备目录：设备ID、名称、类型和房间的唯一来源（能力按类型取自 devicetraits.h）
+// 数据库的默认设备、自定义场景对话框、界面的设备状态表和自定义场景的执行表都由它生成
+//
+// 程序启动时加载一次，之后只读，可以在任意线程中使用；
+// 配置目录中存在 devices.json 时优先使用，否则（或它无法读取、解析失败时）使用内置目录
+class DeviceCatalog
+{
+public:
+    static const DeviceCatalog &instance();
+
+    bool load(const QByteArray &json, QString *errorMessage = nullptr);
+    bool loadDefault();
+
+    const QVector<DeviceTypeInfo> &types() const;
+    const QVector<DeviceInfo> &devices() const;
+    // 按目录中的顺序返回某类型的设备
+    QVector<DeviceInfo> devicesOfType(const QString &type) const;
+    // 找不到时返回 nullptr
+    const DeviceInfo *find(const QString &deviceId) const;
+    const DeviceInfo *findByName(const QString &name) const;
+
+private:
+    bool loadFile(const QString &path, QString *errorMessage);
+
+    QVector<DeviceTypeInfo> typeList;
+    QVector<DeviceInfo> deviceList;
+    QHash<QString, int> indexById;
+    QHash<QString, int> indexByName;
+};
+
+#endif // DEVICECATALOG_H
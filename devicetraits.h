@@ -0,0 +1,129 @@
+#ifndef DEVICETRAITS_H
+#define DEVICETRAITS_H
+
+#include <QString>
+
+// 设备类型；顺序即 DeviceTraitsTable 的下标
+enum class DeviceKind {
+    Light,
+    Curtain,
+    AirConditioner,
+    Lock
+};
+constexpr int DeviceKindCount = 4;
+
+// 设备类型的静态参数，编译期确定
+struct DeviceTypeTraits
+{
+    const char *type;        // 与设备目录和 devices.type 一致
+    const char *name;        // 日志中的名称
+    const char *onValue;     // 开启状态写入 device_history 和 devices.status 的值
+    const char *offValue;
+    const char *powerCommand;  // 开关设备的规则命令
+    bool hasMode;            // 接受 mode 命令
+    bool hasSetpoint;        // 接受 temperature 命令
+    int minSetpoint;         // 设定温度范围（与界面下拉框一致）
+    int maxSetpoint;
+    double onWatts;          // 默认功率，写入 power_profiles 后可由用户修改
+    double standbyWatts;
+};
+
+template <DeviceKind Kind>
+struct DeviceTraits;
+
+template <>
+struct DeviceTraits<DeviceKind::Light>
+{
+    static constexpr DeviceTypeTraits value = {
+        "light", "灯", "on", "off", "power", false, false, 0, 0, 10.0, 0.3
+    };
+};
+
+template <>
+struct DeviceTraits<DeviceKind::Curtain>
+{
+    static constexpr DeviceTypeTraits value = {
+        "curtain", "窗帘", "open", "close", "power", false, false, 0, 0, 0.5, 0.5
+    };
+};
+
+template <>
+struct DeviceTraits<DeviceKind::AirConditioner>
+{
+    static constexpr DeviceTypeTraits value = {
+        "air_conditioner", "空调", "on", "off", "power", true, true, 16, 29, 1200.0, 2.0
+    };
+};
+
+template <>
+struct DeviceTraits<DeviceKind::Lock>
+{
+    static constexpr DeviceTypeTraits value = {
+        "lock", "门锁", "locked", "unlocked", "lock", false, false, 0, 0, 1.5, 1.5
+    };
+};
+
+// 运行时按类型查表，下标为 DeviceKind
+constexpr DeviceTypeTraits DeviceTraitsTable[DeviceKindCount] = {
+    DeviceTraits<DeviceKind::Light>::value,
+    DeviceTraits<DeviceKind::Curtain>::value,
+    DeviceTraits<DeviceKind::AirConditioner>::value,
+    DeviceTraits<DeviceKind::Lock>::value
+};
+
+constexpr const DeviceTypeTraits &deviceTraits(DeviceKind kind)
+{
+    return DeviceTraitsTable[int(kind)];
+}
+
+constexpr bool sameText(const char *a, const char *b)
+{
+    while (*a && *a == *b) {
+        ++a;
+        ++b;
+    }
+    return *a == *b;
+}
+
+constexpr bool traitsTableMatchesKinds()
+{
+    return sameText(deviceTraits(DeviceKind::Light).type, DeviceTraits<DeviceKind::Light>::value.type)
+           && sameText(deviceTraits(DeviceKind::Curtain).type, DeviceTraits<DeviceKind::Curtain>::value.type)
+           && sameText(deviceTraits(DeviceKind::AirConditioner).type, DeviceTraits<DeviceKind::AirConditioner>::value.type)
+           && sameText(deviceTraits(DeviceKind::Lock).type, DeviceTraits<DeviceKind::Lock>::value.type);
+}
+
+static_assert(traitsTableMatchesKinds(), "DeviceTraitsTable 的顺序必须与 DeviceKind 一致");
+static_assert(deviceTraits(DeviceKind::AirConditioner).minSetpoint < deviceTraits(DeviceKind::AirConditioner).maxSetpoint,
+              "空调设定温度范围无效");
+
+// 类型名 -> DeviceKind，找不到时返回 false
+inline bool deviceKindFromType(const QString &type, DeviceKind *kind)
+{
+    for (int i = 0; i < DeviceKindCount; ++i) {
+        if (type == QLatin1String(DeviceTraitsTable[i].type)) {
+            *kind = DeviceKind(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// 规则、场景序列和控制接口中开关命令的值：类型自己的状态值（例如 locked / unlocked），
+// 或通用的 on/off、true/false、1/0（JSON 中的布尔值和数字转成的字符串）；其他值返回 false
+inline bool parsePowerValue(const DeviceTypeTraits &traits, const QString &value, bool *on)
+{
+    if (value == QLatin1String(traits.onValue) || value == QLatin1String("on")
+        || value == QLatin1String("true") || value == QLatin1String("1")) {
+        *on = true;
+        return true;
+    }
+    if (value == QLatin1String(traits.offValue) || value == QLatin1String("off")
+        || value == QLatin1String("false") || value == QLatin1String("0")) {
+        *on = false;
+        return true;
+    }
+    return false;
+}
+
+#endif // DEVICETRAITS_H
@@ -0,0 +1,366 @@
+#include "energymeter.h"
+#include "acplanner.h"
+#include "devicetraits.h"
+#include "homecontroller.h"
+#include "metricsregistry.h"
+#include <QDebug>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QVariantList>
+
+static const int FlushIntervalMs = 60 * 1000;  // 每分钟结算一次
+static const char *TimestampFormat = "yyyy-MM-dd hh:mm:ss";
+
+EnergyMeter::EnergyMeter(const QSqlDatabase &database, QObject *parent)
+    : QObject(parent)
+    , db(database)
+    , flushSeconds(&MetricsRegistry::instance().histogram("smarthome_sql_duration_seconds", "SQL statement latency",
+                                                          MetricsRegistry::label("statement", "energy_hourly_upsert")))
+    , pendingBuckets(&MetricsRegistry::instance().gauge("smarthome_energy_pending_buckets",
+                                                        "Hourly energy buckets waiting to be written"))
+{
+    connect(&flushTimer, &QTimer::timeout, this, &EnergyMeter::flush);
+    flushTimer.start(FlushIntervalMs);
+}
+
+EnergyMeter::~EnergyMeter()
+{
+    flush();
+}
+
+bool EnergyMeter::ensureSchema()
+{
+    if (!db.isOpen()) {
+        qWarning() << "数据库未打开，无法初始化能耗表。";
+        return false;
+    }
+
+    QSqlQuery query(db);
+    if (!query.exec(R"(
+        CREATE TABLE IF NOT EXISTS power_profiles (
+            type TEXT NOT NULL PRIMARY KEY,
+            on_watts REAL NOT NULL,
+            standby_watts REAL NOT NULL DEFAULT 0
+        )
+    )")) {
+        qCritical() << "创建power_profiles表失败:" << query.lastError().text();
+        return false;
+    }
+
+    if (!query.exec(R"(
+        CREATE TABLE IF NOT EXISTS energy_hourly (
+            hour TEXT NOT NULL,
+            device_id TEXT NOT NULL,
+            room TEXT NOT NULL,
+            kwh REAL NOT NULL DEFAULT 0,
+            PRIMARY KEY (hour, device_id)
+        )
+    )")) {
+        qCritical() << "创建energy_hourly表失败:" << query.lastError().text();
+        return false;
+    }
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_energy_room_hour ON energy_hourly (room, hour)")) {
+        qCritical() << "创建energy_hourly索引失败:" << query.lastError().text();
+        return false;
+    }
+
+    // 默认功率参数取自设备类型表，已存在的类型保留用户修改过的值
+    QVariantList types;
+    QVariantList onWatts;
+    QVariantList standbyWatts;
+    for (const DeviceTypeTraits &traits : DeviceTraitsTable) {
+        types.append(QString::fromLatin1(traits.type));
+        onWatts.append(traits.onWatts);
+        standbyWatts.append(traits.standbyWatts);
+    }
+    query.prepare("INSERT OR IGNORE INTO power_profiles (type, on_watts, standby_watts) VALUES (?, ?, ?)");
+    query.addBindValue(types);
+    query.addBindValue(onWatts);
+    query.addBindValue(standbyWatts);
+    if (!query.execBatch()) {
+        qCritical() << "写入默认功率参数失败:" << query.lastError().text();
+        return false;
+    }
+
+    profiles.clear();
+    if (!query.exec("SELECT type, on_watts, standby_watts FROM power_profiles")) {
+        qCritical() << "读取功率参数失败:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        PowerProfile profile;
+        profile.onWatts = query.value(1).toDouble();
+        profile.standbyWatts = query.value(2).toDouble();
+        profiles.insert(query.value(0).toString(), profile);
+    }
+
+    // 所有设备从现在开始按 devices.status 中的开关状态计量
+    QDateTime now = currentTime();
+    if (!query.exec("SELECT device_id, type, status FROM devices")) {
+        qCritical() << "读取设备类型失败:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        QString deviceId = query.value(0).toString();
+        DeviceMeter meter;
+        meter.type = query.value(1).toString();
+        meter.room = roomForDevice(deviceId);
+        meter.on = HomeController::isOnValue(query.value(2).toString());
+        meter.since = now;
+        meter.watts = wattsFor(meter);
+        meters.insert(deviceId, meter);
+    }
+
+    qDebug() << "能耗统计初始化完成:" << profiles.size() << "种设备类型，" << meters.size() << "个设备";
+    return true;
+}
+
+void EnergyMeter::setDevices(const QVector<DeviceState> &devices, const QDateTime &at)
+{
+    for (auto it = meters.begin(); it != meters.end(); ++it) {
+        accrue(it.key(), it.value(), at);
+    }
+    QHash<QString, DeviceMeter> updated;
+    updated.reserve(devices.size());
+    for (const DeviceState &device : devices) {
+        DeviceMeter meter = meters.value(device.deviceId);
+        meter.type = device.type;
+        meter.room = roomForDevice(device.deviceId);
+        meter.on = device.on;
+        meter.since = at;
+        if (!device.mode.isEmpty()) {
+            meter.acMode = device.mode;
+            meter.acSetpoint = device.temperature;
+        }
+        meter.watts = wattsFor(meter);
+        updated.insert(device.deviceId, meter);
+    }
+    meters.swap(updated);
+}
+
+void EnergyMeter::recordPower(const QString &deviceId, bool on, const QDateTime &at)
+{
+    auto it = meters.find(deviceId);
+    if (it == meters.end()) {
+        return;
+    }
+    DeviceMeter &meter = it.value();
+    accrue(deviceId, meter, at);
+    meter.on = on;
+    meter.watts = wattsFor(meter);
+}
+
+void EnergyMeter::setAcSetting(const QString &deviceId, const QString &mode, int setpoint, const QDateTime &at)
+{
+    auto it = meters.find(deviceId);
+    if (it == meters.end()) {
+        return;
+    }
+    DeviceMeter &meter = it.value();
+    if (meter.acMode == mode && meter.acSetpoint == setpoint) {
+        return;
+    }
+    accrue(deviceId, meter, at);
+    meter.acMode = mode;
+    meter.acSetpoint = setpoint;
+    meter.watts = wattsFor(meter);
+}
+
+double EnergyMeter::currentWatts(const QString &deviceId) const
+{
+    return meters.value(deviceId).watts;
+}
+
+void EnergyMeter::setSimulatedTime(const QDateTime &now)
+{
+    simulatedTime = now;
+}
+
+QDateTime EnergyMeter::currentTime() const
+{
+    return simulatedTime.isValid() ? simulatedTime : QDateTime::currentDateTime();
+}
+
+double EnergyMeter::wattsFor(const DeviceMeter &meter) const
+{
+    PowerProfile profile = profiles.value(meter.type);
+    if (!meter.on) {
+        return profile.standbyWatts;
+    }
+    if (meter.type == "air_conditioner") {
+        return profile.onWatts * acWeight(meter.acMode, meter.acSetpoint);
+    }
+    return profile.onWatts;
+}
+
+// 按当前功率把 since 到 until 的电量累计到各个整点桶，跨小时的区间拆开计算
+void EnergyMeter::accrue(const QString &deviceId, DeviceMeter &meter, const QDateTime &until)
+{
+    QDateTime from = meter.since;
+    // 时间戳早于上次结算（例如系统时间被调回）时不累计
+    if (from.isValid() && until <= from) {
+        return;
+    }
+    meter.since = until;
+    if (!from.isValid() || meter.watts <= 0.0) {
+        return;
+    }
+
+    while (from < until) {
+        QDateTime hour = AcPlanner::truncateToHour(from);
+        QDateTime segmentEnd = qMin(hour.addSecs(3600), until);
+        pendingWh[qMakePair(hour, deviceId)] += meter.watts * from.msecsTo(segmentEnd) / 3600000.0;
+        from = segmentEnd;
+    }
+}
+
+void EnergyMeter::flush()
+{
+    QDateTime now = currentTime();
+    for (auto it = meters.begin(); it != meters.end(); ++it) {
+        accrue(it.key(), it.value(), now);
+    }
+
+    pendingBuckets->set(pendingWh.size());
+    if (pendingWh.isEmpty()) {
+        return;
+    }
+    if (!db.isOpen()) {
+        qWarning() << "数据库未打开，丢弃" << pendingWh.size() << "条能耗记录。";
+        pendingWh.clear();
+        pendingBuckets->set(0);
+        return;
+    }
+
+    QVariantList hours, deviceIds, rooms, kwhs;
+    for (auto it = pendingWh.constBegin(); it != pendingWh.constEnd(); ++it) {
+        hours << it.key().first.toString(TimestampFormat);
+        deviceIds << it.key().second;
+        rooms << meters.value(it.key().second).room;
+        kwhs << it.value() / 1000.0;
+    }
+
+    // 同一小时同一设备的记录累加到已有的行上
+    db.transaction();
+    QSqlQuery query(db);
+    query.prepare(R"(
+        INSERT INTO energy_hourly (hour, device_id, room, kwh) VALUES (?, ?, ?, ?)
+        ON CONFLICT (hour, device_id) DO UPDATE SET kwh = kwh + excluded.kwh
+    )");
+    query.addBindValue(hours);
+    query.addBindValue(deviceIds);
+    query.addBindValue(rooms);
+    query.addBindValue(kwhs);
+
+    bool ok;
+    {
+        MetricTimer timer(*flushSeconds);
+        ok = query.execBatch() && db.commit();
+    }
+    if (!ok) {
+        qCritical() << "写入能耗记录失败:" << query.lastError().text();
+        db.rollback();
+        return;
+    }
+    pendingWh.clear();
+    pendingBuckets->set(0);
+}
+
+QVector<EnergyUsage> EnergyMeter::queryHourly(const QDateTime &from, const QDateTime &to)
+{
+    QVector<EnergyUsage> usage;
+    if (!db.isOpen()) {
+        return usage;
+    }
+    flush();
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(R"(
+        SELECT hour, device_id, room, kwh
+        FROM energy_hourly
+        WHERE hour >= ? AND hour < ?
+        ORDER BY hour, device_id
+    )");
+    query.addBindValue(from.toString(TimestampFormat));
+    query.addBindValue(to.toString(TimestampFormat));
+    if (!query.exec()) {
+        qCritical() << "查询能耗记录失败:" << query.lastError().text();
+        return usage;
+    }
+
+    while (query.next()) {
+        EnergyUsage item;
+        item.hour = QDateTime::fromString(query.value(0).toString(), TimestampFormat);
+        item.deviceId = query.value(1).toString();
+        item.room = query.value(2).toString();
+        item.kwh = query.value(3).toDouble();
+        usage.append(item);
+    }
+    return usage;
+}
+
+QHash<QString, double> EnergyMeter::totalsByRoom(const QDateTime &from, const QDateTime &to)
+{
+    return queryTotals("room", from, to);
+}
+
+QHash<QString, double> EnergyMeter::totalsByDevice(const QDateTime &from, const QDateTime &to)
+{
+    return queryTotals("device_id", from, to);
+}
+
+QHash<QString, double> EnergyMeter::queryTotals(const QString &column, const QDateTime &from, const QDateTime &to)
+{
+    QHash<QString, double> totals;
+    if (!db.isOpen()) {
+        return totals;
+    }
+    flush();
+
+    // column 只会是内部传入的 room 或 device_id
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(QString("SELECT %1, SUM(kwh) FROM energy_hourly WHERE hour >= ? AND hour < ? GROUP BY %1").arg(column));
+    query.addBindValue(from.toString(TimestampFormat));
+    query.addBindValue(to.toString(TimestampFormat));
+    if (!query.exec()) {
+        qCritical() << "汇总能耗失败:" << query.lastError().text();
+        return totals;
+    }
+    while (query.next()) {
+        totals.insert(query.value(0).toString(), query.value(1).toDouble());
+    }
+    return totals;
+}
+
+QString EnergyMeter::roomForDevice(const QString &deviceId)
+{
+    static const QStringList suffixes = {"Light", "Curtain", "Ac"};
+    for (const QString &suffix : suffixes) {
+        if (deviceId.endsWith(suffix) && deviceId.size() > suffix.size()) {
+            return deviceId.left(deviceId.size() - suffix.size());
+        }
+    }
+    // 门锁等没有房间前缀的设备归到入户
+    return "Entrance";
+}
+
+double EnergyMeter::acWeight(const QString &mode, int setpoint)
+{
+    // 模式系数：相对制冷满负荷
+    static const QHash<QString, double> modeFactors = {
+        {"制冷", 1.0}, {"制热", 1.15}, {"除湿", 0.6},
+        {"通风", 0.1}, {"自动", 0.9}, {"睡眠", 0.7}
+    };
+    double modeFactor = modeFactors.value(mode, 1.0);
+    if (mode == "通风" || setpoint <= 0) {
+        return modeFactor;
+    }
+
+    // 设定温度系数：每偏离基准1度能耗约变化6%，制热以20度为基准，其余以26度为基准
+    double setpointFactor = (mode == "制热") ? 1.0 + 0.06 * (setpoint - 20)
+                                             : 1.0 + 0.06 * (26 - setpoint);
+    return modeFactor * qBound(0.5, setpointFactor, 1.6);
+}
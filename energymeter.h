@@ -0,0 +1,99 @@
+#ifndef ENERGYMETER_H
+#define ENERGYMETER_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QSqlDatabase>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+class MetricGauge;
+class MetricHistogram;
+struct DeviceState;
+
+// 设备类型的功率参数，对应 power_profiles 表
+struct PowerProfile
+{
+    double onWatts = 0.0;       // 开启时的功率
+    double standbyWatts = 0.0;  // 关闭（待机）时的功率
+};
+
+// energy_hourly 表中的一行：某个设备某个小时的耗电量
+struct EnergyUsage
+{
+    QDateTime hour;
+    QString deviceId;
+    QString room;
+    double kwh = 0.0;
+};
+
+// 能耗统计：设备开关事件到来时按当前功率累计电量，按小时和设备汇总到 energy_hourly 表
+// 空调功率按模式和设定温度加权；跨小时的区间按小时拆分
+class EnergyMeter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EnergyMeter(const QSqlDatabase &database, QObject *parent = nullptr);
+    ~EnergyMeter();
+
+    // 创建 power_profiles / energy_hourly 表，写入默认功率参数并读入设备类型
+    bool ensureSchema();
+
+    // 程序启动时恢复出的设备状态：已计量的设备先按旧功率结算到 at，之后所有设备按新的开关状态计量
+    void setDevices(const QVector<DeviceState> &devices, const QDateTime &at = QDateTime::currentDateTime());
+    // 设备开关事件，先按旧功率结算到 at，再切换到新功率
+    void recordPower(const QString &deviceId, bool on, const QDateTime &at = QDateTime::currentDateTime());
+    // 空调模式或设定温度变化
+    void setAcSetting(const QString &deviceId, const QString &mode, int setpoint,
+                      const QDateTime &at = QDateTime::currentDateTime());
+
+    double currentWatts(const QString &deviceId) const;
+
+    // 回放历史时以事件时间作为时钟，之后的结算和查询都以它为当前时间
+    void setSimulatedTime(const QDateTime &now);
+
+    // 以下查询都是对 energy_hourly 的一次 SELECT，查询前先结算到当前时间
+    QVector<EnergyUsage> queryHourly(const QDateTime &from, const QDateTime &to);
+    QHash<QString, double> totalsByRoom(const QDateTime &from, const QDateTime &to);
+    QHash<QString, double> totalsByDevice(const QDateTime &from, const QDateTime &to);
+
+    // 设备ID前缀即房间，例如 LivingroomAc -> Livingroom
+    static QString roomForDevice(const QString &deviceId);
+    // 空调功率系数：模式系数 × 设定温度系数
+    static double acWeight(const QString &mode, int setpoint);
+
+public slots:
+    // 把正在计量的设备结算到当前时间，并写入数据库
+    void flush();
+
+private:
+    struct DeviceMeter {
+        QString type;
+        QString room;
+        bool on = false;
+        double watts = 0.0;  // 当前功率
+        QDateTime since;     // 上次结算的时间
+        QString acMode;
+        int acSetpoint = 0;
+    };
+
+    QDateTime currentTime() const;
+    double wattsFor(const DeviceMeter &meter) const;
+    void accrue(const QString &deviceId, DeviceMeter &meter, const QDateTime &until);
+    QHash<QString, double> queryTotals(const QString &column, const QDateTime &from, const QDateTime &to);
+
+    QSqlDatabase db;
+    QHash<QString, PowerProfile> profiles;                 // 设备类型 -> 功率参数
+    QHash<QString, DeviceMeter> meters;                    // 设备ID -> 计量状态
+    QHash<QPair<QDateTime, QString>, double> pendingWh;    // (整点, 设备ID) -> 尚未写入的电量（Wh）
+    QTimer flushTimer;
+    QDateTime simulatedTime;  // 无效时使用系统时间
+    MetricHistogram *flushSeconds;
+    MetricGauge *pendingBuckets;
+};
+
+#endif // ENERGYMETER_H
@@ -0,0 +1,586 @@
+#include "historyexporter.h"
+#include <QDate>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QSaveFile>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTime>
+#include <QVector>
+#include <limits>
+#include <memory>
+
+static const char *TimestampFormat = "yyyy-MM-dd hh:mm:ss";
+static const char ColumnarMagic[4] = { 'S', 'H', 'H', 'C' };
+static const char ColumnarVersion = 1;
+static const int ColumnarBlockRows = 65536;
+static const int ColumnCount = 5;  // id, timestamp, key, actionType, actionValue
+
+static void appendVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(char(value | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+static bool readVarint(const char *&p, const char *end, quint64 *value)
+{
+    quint64 result = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        quint8 byte = quint8(*p++);
+        result |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool readVarint(QIODevice &device, quint64 *value)
+{
+    quint64 result = 0;
+    char byte;
+    for (int shift = 0; shift < 64 && device.getChar(&byte); shift += 7) {
+        result |= quint64(quint8(byte) & 0x7f) << shift;
+        if (!(quint8(byte) & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// 有符号差值映射为无符号数，绝对值小的差值编码后也短
+static quint64 zigzag(qint64 value)
+{
+    return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+static qint64 unzigzag(quint64 value)
+{
+    return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+// "yyyy-MM-dd hh:mm:ss" 按 UTC 换算成秒；不用 QDateTime::fromString，每行省去一次格式解析
+static bool parseUtcSeconds(const QString &text, qint64 *seconds)
+{
+    if (text.size() < 19) {
+        return false;
+    }
+    auto number = [&text](int pos, int len, int *value) {
+        int result = 0;
+        for (int i = pos; i < pos + len; ++i) {
+            int digit = text.at(i).unicode() - '0';
+            if (digit < 0 || digit > 9) {
+                return false;
+            }
+            result = result * 10 + digit;
+        }
+        *value = result;
+        return true;
+    };
+    int year, month, day, hour, minute, second;
+    if (!number(0, 4, &year) || !number(5, 2, &month) || !number(8, 2, &day)
+        || !number(11, 2, &hour) || !number(14, 2, &minute) || !number(17, 2, &second)) {
+        return false;
+    }
+    qint64 days = QDate(year, month, day).toJulianDay() - QDate(1970, 1, 1).toJulianDay();
+    *seconds = days * 86400 + hour * 3600 + minute * 60 + second;
+    return true;
+}
+
+namespace {
+
+// 导出的目标格式
+class HistorySink
+{
+public:
+    virtual ~HistorySink() = default;
+    virtual bool begin(QIODevice *device) = 0;
+    // rawTimestamp 为数据库中的原始字符串
+    virtual bool write(const HistoryRow &row, const QString &rawTimestamp) = 0;
+    virtual bool end() = 0;
+};
+
+class CsvSink : public HistorySink
+{
+public:
+    explicit CsvSink(HistoryExportOptions::Table table)
+        : table(table)
+        , device(nullptr)
+    {
+        line.reserve(256);
+    }
+
+    bool begin(QIODevice *output) override
+    {
+        device = output;
+        // device_history 的时间是 UTC，scene_history 的时间是本地时间
+        const char *header = (table == HistoryExportOptions::DeviceHistory)
+                ? "id,device_id,action_type,action_value,timestamp_utc\n"
+                : "id,scene_id,timestamp_local\n";
+        return device->write(header) >= 0;
+    }
+
+    bool write(const HistoryRow &row, const QString &rawTimestamp) override
+    {
+        // 预留了容量，resize(0) 不释放内存
+        line.resize(0);
+        line.append(QByteArray::number(row.id));
+        appendField(row.key);
+        if (table == HistoryExportOptions::DeviceHistory) {
+            appendField(row.actionType);
+            appendField(row.actionValue);
+        }
+        appendField(rawTimestamp);
+        line.append('\n');
+        return device->write(line) == line.size();
+    }
+
+    bool end() override
+    {
+        return true;
+    }
+
+private:
+    void appendField(const QString &field)
+    {
+        line.append(',');
+        bool quote = false;
+        for (QChar c : field) {
+            if (c == ',' || c == '"' || c == '\n' || c == '\r') {
+                quote = true;
+                break;
+            }
+        }
+        if (!quote) {
+            line.append(field.toUtf8());
+            return;
+        }
+        line.append('"');
+        line.append(field.toUtf8().replace("\"", "\"\""));
+        line.append('"');
+    }
+
+    HistoryExportOptions::Table table;
+    QIODevice *device;
+    QByteArray line;
+};
+
+class ColumnarSink : public HistorySink
+{
+public:
+    explicit ColumnarSink(HistoryExportOptions::Table table)
+        : table(table)
+        , device(nullptr)
+        , newEntryCount(0)
+        , blockRows(0)
+        , lastId(0)
+        , lastTimestamp(0)
+    {
+        for (QByteArray &column : columns) {
+            column.reserve(ColumnarBlockRows * 3);
+        }
+        newEntries.reserve(4096);
+        payload.reserve(ColumnarBlockRows * 12);
+    }
+
+    bool begin(QIODevice *output) override
+    {
+        device = output;
+        QByteArray header(ColumnarMagic, sizeof(ColumnarMagic));
+        header.append(ColumnarVersion);
+        header.append(char(table));
+        return device->write(header) == header.size();
+    }
+
+    bool write(const HistoryRow &row, const QString &) override
+    {
+        appendVarint(columns[0], zigzag(row.id - lastId));
+        appendVarint(columns[1], zigzag(row.timestamp - lastTimestamp));
+        appendVarint(columns[2], dictionaryIndex(row.key));
+        if (table == HistoryExportOptions::DeviceHistory) {
+            appendVarint(columns[3], dictionaryIndex(row.actionType));
+            appendVarint(columns[4], dictionaryIndex(row.actionValue));
+        }
+        lastId = row.id;
+        lastTimestamp = row.timestamp;
+        if (++blockRows == ColumnarBlockRows) {
+            return flush();
+        }
+        return true;
+    }
+
+    bool end() override
+    {
+        if (blockRows > 0 && !flush()) {
+            return false;
+        }
+        // 行数为0的块表示文件结束
+        QByteArray terminator;
+        appendVarint(terminator, 0);
+        return device->write(terminator) == terminator.size();
+    }
+
+private:
+    quint32 dictionaryIndex(const QString &value)
+    {
+        auto it = dictionary.constFind(value);
+        if (it != dictionary.constEnd()) {
+            return it.value();
+        }
+        quint32 index = quint32(dictionary.size());
+        dictionary.insert(value, index);
+        ++newEntryCount;
+        QByteArray utf8 = value.toUtf8();
+        appendVarint(newEntries, quint64(utf8.size()));
+        newEntries.append(utf8);
+        return index;
+    }
+
+    bool flush()
+    {
+        payload.resize(0);
+        appendVarint(payload, quint64(newEntryCount));
+        payload.append(newEntries);
+        for (const QByteArray &column : columns) {
+            appendVarint(payload, quint64(column.size()));
+            payload.append(column);
+        }
+        QByteArray compressed = qCompress(payload);
+
+        QByteArray blockHeader;
+        appendVarint(blockHeader, quint64(blockRows));
+        appendVarint(blockHeader, quint64(compressed.size()));
+        bool ok = device->write(blockHeader) == blockHeader.size()
+                  && device->write(compressed) == compressed.size();
+
+        blockRows = 0;
+        newEntryCount = 0;
+        newEntries.resize(0);
+        for (QByteArray &column : columns) {
+            column.resize(0);
+        }
+        return ok;
+    }
+
+    HistoryExportOptions::Table table;
+    QIODevice *device;
+    // 字典只随不同的设备ID、场景ID和操作值增长，与行数无关
+    QHash<QString, quint32> dictionary;
+    QByteArray newEntries;
+    int newEntryCount;
+    QByteArray columns[ColumnCount];
+    QByteArray payload;
+    int blockRows;
+    qint64 lastId;
+    qint64 lastTimestamp;
+};
+
+} // namespace
+
+HistoryExporter::HistoryExporter(const HistoryExportOptions &options, QObject *parent)
+    : QObject(parent)
+    , options(options)
+    , cancelled(false)
+{
+}
+
+void HistoryExporter::cancel()
+{
+    cancelled = true;
+}
+
+bool HistoryExporter::parseTable(const QString &text, HistoryExportOptions::Table *table)
+{
+    if (text == QLatin1String("device_history")) {
+        *table = HistoryExportOptions::DeviceHistory;
+    } else if (text == QLatin1String("scene_history")) {
+        *table = HistoryExportOptions::SceneHistory;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool HistoryExporter::parseFormat(const QString &text, HistoryExportOptions::Format *format)
+{
+    if (text == QLatin1String("csv")) {
+        *format = HistoryExportOptions::Csv;
+    } else if (text == QLatin1String("columnar")) {
+        *format = HistoryExportOptions::Columnar;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void HistoryExporter::run()
+{
+    // 连接在工作线程中创建和使用，名称按对象区分，可以同时运行多个导出
+    const QString connectionName = QString("history_export_%1").arg(quintptr(this), 0, 16);
+    qint64 rows = 0;
+    QString errorMessage;
+    bool ok = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(options.dbPath);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY");
+        if (!db.open()) {
+            errorMessage = "数据库打开失败: " + db.lastError().text();
+        } else {
+            ok = exportRows(db, &rows, &errorMessage);
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    if (!ok) {
+        qCritical() << "导出历史失败:" << errorMessage;
+    }
+    emit finished(ok, rows, errorMessage);
+}
+
+bool HistoryExporter::exportRows(const QSqlDatabase &db, qint64 *rows, QString *errorMessage)
+{
+    const bool deviceTable = (options.table == HistoryExportOptions::DeviceHistory);
+    const QString tableName = deviceTable ? "device_history" : "scene_history";
+    const QString keyColumn = deviceTable ? "device_id" : "scene_id";
+
+    // 主键范围只用于估算进度
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec(QString("SELECT MIN(id), MAX(id) FROM %1").arg(tableName)) || !query.next()) {
+        *errorMessage = "读取主键范围失败: " + query.lastError().text();
+        return false;
+    }
+    const qint64 minId = query.value(0).toLongLong();
+    const qint64 maxId = query.value(1).toLongLong();
+    query.finish();
+
+    // 时间过滤按表中的格式比较字符串：device_history 是 UTC，scene_history 是本地时间
+    auto storedTime = [deviceTable](const QDateTime &time) {
+        return (deviceTable ? time.toUTC() : time.toLocalTime()).toString(TimestampFormat);
+    };
+    QString sql = deviceTable
+            ? "SELECT id, device_id, action_type, action_value, timestamp FROM device_history WHERE id > ?"
+            : "SELECT id, scene_id, timestamp FROM scene_history WHERE id > ?";
+    if (options.from.isValid()) {
+        sql += " AND timestamp >= ?";
+    }
+    if (options.to.isValid()) {
+        sql += " AND timestamp < ?";
+    }
+    if (!options.ids.isEmpty()) {
+        QStringList placeholders;
+        for (int i = 0; i < options.ids.size(); ++i) {
+            placeholders.append("?");
+        }
+        sql += QString(" AND %1 IN (%2)").arg(keyColumn, placeholders.join(','));
+    }
+    sql += " ORDER BY id LIMIT ?";
+    if (!query.prepare(sql)) {
+        *errorMessage = "准备导出查询失败: " + query.lastError().text();
+        return false;
+    }
+
+    std::unique_ptr<HistorySink> sink;
+    if (options.format == HistoryExportOptions::Csv) {
+        sink.reset(new CsvSink(options.table));
+    } else {
+        sink.reset(new ColumnarSink(options.table));
+    }
+    // 写入临时文件，成功后才替换目标文件
+    QSaveFile file(options.outputPath);
+    if (!file.open(QIODevice::WriteOnly) || !sink->begin(&file)) {
+        *errorMessage = "无法写入导出文件: " + file.errorString();
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const int timestampColumn = deviceTable ? 4 : 2;
+    const int pageRows = qMax(1, options.pageRows);
+    HistoryRow row;
+    QString rawTimestamp;
+    // scene_history 是本地时间，本地时间与 UTC 的差按小时缓存
+    qint64 offsetHour = std::numeric_limits<qint64>::min();
+    qint64 offsetSeconds = 0;
+    qint64 lastId = minId - 1;
+    int lastPercent = -1;
+
+    forever {
+        if (cancelled) {
+            file.cancelWriting();
+            *errorMessage = "导出已取消";
+            return false;
+        }
+
+        int bind = 0;
+        query.bindValue(bind++, lastId);
+        if (options.from.isValid()) {
+            query.bindValue(bind++, storedTime(options.from));
+        }
+        if (options.to.isValid()) {
+            query.bindValue(bind++, storedTime(options.to));
+        }
+        for (const QString &id : options.ids) {
+            query.bindValue(bind++, id);
+        }
+        query.bindValue(bind++, pageRows);
+        if (!query.exec()) {
+            file.cancelWriting();
+            *errorMessage = "读取历史失败: " + query.lastError().text();
+            return false;
+        }
+
+        int pageCount = 0;
+        while (query.next()) {
+            row.id = query.value(0).toLongLong();
+            row.key = query.value(1).toString();
+            if (deviceTable) {
+                row.actionType = query.value(2).toString();
+                row.actionValue = query.value(3).toString();
+            }
+            rawTimestamp = query.value(timestampColumn).toString();
+
+            qint64 seconds = 0;
+            if (parseUtcSeconds(rawTimestamp, &seconds) && !deviceTable) {
+                if (seconds / 3600 != offsetHour) {
+                    offsetHour = seconds / 3600;
+                    QDateTime local = QDateTime::fromSecsSinceEpoch(seconds, Qt::UTC);
+                    local.setTimeSpec(Qt::LocalTime);
+                    offsetSeconds = local.offsetFromUtc();
+                }
+                seconds -= offsetSeconds;
+            }
+            row.timestamp = seconds;
+
+            if (!sink->write(row, rawTimestamp)) {
+                file.cancelWriting();
+                *errorMessage = "写入导出文件失败: " + file.errorString();
+                return false;
+            }
+            lastId = row.id;
+            ++pageCount;
+            ++*rows;
+        }
+        // 结束本页的读事务
+        query.finish();
+
+        int percent = (maxId > minId) ? int((lastId - minId) * 100 / (maxId - minId)) : 100;
+        if (pageCount < pageRows) {
+            percent = 100;
+        }
+        if (percent != lastPercent) {
+            lastPercent = percent;
+            emit progress(*rows, percent);
+        }
+        if (pageCount < pageRows) {
+            break;
+        }
+    }
+
+    if (!sink->end() || !file.commit()) {
+        *errorMessage = "保存导出文件失败: " + file.errorString();
+        return false;
+    }
+    qDebug() << "已导出" << tableName << *rows << "行到" << options.outputPath
+             << "耗时(毫秒):" << timer.elapsed();
+    return true;
+}
+
+bool HistoryExporter::readColumnar(const QString &path, const std::function<bool(const HistoryRow &)> &visitor,
+                                   QString *errorMessage)
+{
+    auto fail = [errorMessage](const QString &message) {
+        if (errorMessage) {
+            *errorMessage = message;
+        }
+        return false;
+    };
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail("无法打开列式文件: " + file.errorString());
+    }
+    QByteArray header = file.read(sizeof(ColumnarMagic) + 2);
+    if (header.size() != int(sizeof(ColumnarMagic)) + 2 || !header.startsWith(QByteArray(ColumnarMagic, sizeof(ColumnarMagic)))
+        || header.at(sizeof(ColumnarMagic)) != ColumnarVersion) {
+        return fail("不是列式历史文件或版本不支持: " + path);
+    }
+    const bool deviceTable = (header.at(sizeof(ColumnarMagic) + 1) == char(HistoryExportOptions::DeviceHistory));
+
+    QVector<QString> dictionary;
+    HistoryRow row;
+    forever {
+        quint64 blockRows = 0;
+        quint64 compressedSize = 0;
+        if (!readVarint(file, &blockRows)) {
+            return fail("列式文件不完整");
+        }
+        if (blockRows == 0) {
+            return true;
+        }
+        if (!readVarint(file, &compressedSize) || compressedSize > quint64(std::numeric_limits<int>::max())) {
+            return fail("列式文件块头损坏");
+        }
+        QByteArray payload = qUncompress(file.read(qint64(compressedSize)));
+        const char *p = payload.constData();
+        const char *end = p + payload.size();
+
+        quint64 newEntries = 0;
+        if (!readVarint(p, end, &newEntries)) {
+            return fail("列式文件字典损坏");
+        }
+        for (quint64 i = 0; i < newEntries; ++i) {
+            quint64 length = 0;
+            if (!readVarint(p, end, &length) || length > quint64(end - p)) {
+                return fail("列式文件字典损坏");
+            }
+            dictionary.append(QString::fromUtf8(p, int(length)));
+            p += length;
+        }
+
+        const char *columnBegin[ColumnCount];
+        const char *columnEnd[ColumnCount];
+        for (int c = 0; c < ColumnCount; ++c) {
+            quint64 length = 0;
+            if (!readVarint(p, end, &length) || length > quint64(end - p)) {
+                return fail("列式文件列数据损坏");
+            }
+            columnBegin[c] = p;
+            columnEnd[c] = p + length;
+            p += length;
+        }
+
+        auto readString = [&](int column, QString *value) {
+            quint64 index = 0;
+            if (!readVarint(columnBegin[column], columnEnd[column], &index) || index >= quint64(dictionary.size())) {
+                return false;
+            }
+            *value = dictionary.at(int(index));
+            return true;
+        };
+        for (quint64 i = 0; i < blockRows; ++i) {
+            quint64 idDelta = 0;
+            quint64 timeDelta = 0;
+            if (!readVarint(columnBegin[0], columnEnd[0], &idDelta)
+                || !readVarint(columnBegin[1], columnEnd[1], &timeDelta)
+                || !readString(2, &row.key)
+                || (deviceTable && (!readString(3, &row.actionType) || !readString(4, &row.actionValue)))) {
+                return fail("列式文件列数据损坏");
+            }
+            row.id += unzigzag(idDelta);
+            row.timestamp += unzigzag(timeDelta);
+            if (!visitor(row)) {
+                return true;
+            }
+        }
+    }
+}
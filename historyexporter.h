@@ -0,0 +1,84 @@
+#ifndef HISTORYEXPORTER_H
+#define HISTORYEXPORTER_H
+
+#include <QDateTime>
+#include <QObject>
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <functional>
+
+struct HistoryExportOptions
+{
+    enum Table { DeviceHistory, SceneHistory };
+    enum Format {
+        Csv,        // 逐行文本，时间戳保持数据库中的格式
+        Columnar    // 按块压缩的列式文件，见 HistoryExporter 的说明
+    };
+
+    QString dbPath;
+    QString outputPath;
+    Table table = DeviceHistory;
+    Format format = Csv;
+    QDateTime from;            // 无效时不限制起点
+    QDateTime to;              // 不含；无效时不限制终点
+    QStringList ids;           // 只导出这些设备ID（device_history）或场景ID（scene_history），为空时全部导出
+    int pageRows = 20000;      // 每次查询读取的行数
+};
+
+// 导出的一行；读取列式文件时作为回调的参数
+struct HistoryRow
+{
+    qint64 id = 0;
+    qint64 timestamp = 0;      // UTC 秒，原记录没有时间时为0
+    QString key;               // device_id 或 scene_id
+    QString actionType;        // 仅 device_history
+    QString actionValue;       // 仅 device_history
+};
+
+// 历史导出：把 device_history 或 scene_history 写成 CSV 或列式文件，用于离线分析
+//
+// 使用独立的只读连接，按主键分页读取（WHERE id > 上一页最后的ID ... LIMIT），每页的游标只向前移动，
+// 读完一页即结束读事务，主程序的存储线程不会被长时间阻塞；内存只占一页的游标和一个输出块，
+// 与表的行数无关
+//
+// 列式文件以 "SHHC" 开头，之后是版本号和表类型各一个字节，再是若干个块，行数为0的块表示结束。
+// 每块最多 65536 行：varint 行数、varint 压缩后长度、qCompress 压缩的内容。内容依次为
+// 本块新增的字典项，以及 id、时间戳、key、actionType、actionValue 各列（varint 长度 + 数据）；
+// id 和时间戳为与上一行之差的 zigzag varint，字符串列为字典下标，字典在整个文件中累积
+//
+// moveToThread 到工作线程后调用 run()，进度和结果通过信号投递回调用方的线程
+class HistoryExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HistoryExporter(const HistoryExportOptions &options, QObject *parent = nullptr);
+
+    // 可以在任意线程调用，导出在当前页结束后停止，不留下不完整的文件
+    void cancel();
+
+    static bool parseTable(const QString &text, HistoryExportOptions::Table *table);
+    static bool parseFormat(const QString &text, HistoryExportOptions::Format *format);
+
+    // 按顺序读出列式文件中的行，visitor 返回 false 时停止
+    static bool readColumnar(const QString &path, const std::function<bool(const HistoryRow &)> &visitor,
+                             QString *errorMessage = nullptr);
+
+public slots:
+    void run();
+
+signals:
+    // percent 按已读到的主键估算
+    void progress(qint64 rows, int percent);
+    void finished(bool ok, qint64 rows, const QString &errorMessage);
+
+private:
+    bool exportRows(const QSqlDatabase &db, qint64 *rows, QString *errorMessage);
+
+    HistoryExportOptions options;
+    std::atomic<bool> cancelled;
+};
+
+#endif // HISTORYEXPORTER_H
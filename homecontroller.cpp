@@ -0,0 +1,631 @@
+#include "homecontroller.h"
+#include "anomalydetector.h"
+#include "devicecatalog.h"
+#include "devicetraits.h"
+#include "energymeter.h"
+#include "metricsregistry.h"
+#include "ruleengine.h"
+#include "storageworker.h"
+#include <QDebug>
+#include <QSqlError>
+#include <QSqlRecord>
+
+Q_LOGGING_CATEGORY(lcControl, "smarthome.control")
+
+// 格式串只构造一次，热路径上不再从字面量转换
+static const QString TimestampFormat = QStringLiteral("yyyy-MM-dd hh:mm:ss");
+// device_history 的操作类型，下标为 PowerCommand::Action：场景和规则使用 turn_on/turn_off，
+// 与手动操作的 toggle 和门锁按钮的 lock 区分
+static const QString PowerActionTypes[] = {
+    QStringLiteral("toggle"),
+    QStringLiteral("turn_on"),
+    QStringLiteral("turn_off"),
+    QStringLiteral("lock")
+};
+
+// seq 取当前最大值加1（唯一索引上的一次查找），与写入在同一条语句中，不会出现空洞或重复
+const char HomeController::InsertHistorySql[] =
+    "INSERT INTO device_history (device_id, action_type, action_value, timestamp, seq) "
+    "VALUES (?, ?, ?, ?, IFNULL((SELECT MAX(seq) FROM device_history), 0) + 1)";
+const char HomeController::UpdateStatusSql[] = "UPDATE devices SET status = ? WHERE device_id = ?";
+const char HomeController::InsertSceneSql[] = "INSERT INTO scene_history (scene_id, timestamp) VALUES (?, ?)";
+
+static MetricHistogram *sqlHistogram(const QString &statement)
+{
+    return &MetricsRegistry::instance().histogram("smarthome_sql_duration_seconds", "SQL statement latency",
+                                                  MetricsRegistry::label("statement", statement));
+}
+
+HomeController::HomeController(QObject *parent)
+    : QObject(parent)
+    , ruleEngine(nullptr)
+    , energyMeter(nullptr)
+    , storage(nullptr)
+    , anomalyDetector(nullptr)
+    , hourInput(-1)
+    , weekdayInput(-1)
+    , submitBatch(0)
+    , wokenBatch(0)
+    , statementsPrepared(false)
+    , unknownCommands(&commandCounter("unknown"))
+    , historyInsertSeconds(sqlHistogram("device_history_insert"))
+    , statusUpdateSeconds(sqlHistogram("device_status_update"))
+    , sceneInsertSeconds(sqlHistogram("scene_history_insert"))
+    , historyQueueDepth(&MetricsRegistry::instance().gauge("smarthome_history_queue_depth",
+                                                           "History rows waiting to be written"))
+{
+    qRegisterMetaType<DeviceState>("DeviceState");
+    qRegisterMetaType<QVector<DeviceState>>("QVector<DeviceState>");
+    pendingCommands.reserve(PowerCommandCapacity);
+    runningCommands.reserve(PowerCommandCapacity);
+}
+
+void HomeController::setDatabase(const QSqlDatabase &database)
+{
+    db = database;
+    statementsPrepared = false;
+}
+
+void HomeController::setRuleEngine(RuleEngine *engine)
+{
+    ruleEngine = engine;
+    hourInput = ruleEngine ? ruleEngine->inputIndex("time.hour") : -1;
+    weekdayInput = ruleEngine ? ruleEngine->inputIndex("time.weekday") : -1;
+    sceneInputs.clear();
+    bindRuleInputs();
+}
+
+void HomeController::setEnergyMeter(EnergyMeter *meter)
+{
+    energyMeter = meter;
+}
+
+void HomeController::setStorage(StorageWorker *worker)
+{
+    storage = worker;
+}
+
+void HomeController::setAnomalyDetector(AnomalyDetector *detector)
+{
+    anomalyDetector = detector;
+    if (anomalyDetector) {
+        QVector<DeviceState> list;
+        list.reserve(devices.size());
+        for (const DeviceEntry &entry : qAsConst(devices)) {
+            list.append(entry.state);
+        }
+        anomalyDetector->setDevices(list);
+    }
+}
+
+bool HomeController::ensureSchema()
+{
+    return createSchema(db);
+}
+
+bool HomeController::createSchema(const QSqlDatabase &database)
+{
+    if (!database.isOpen()) {
+        qWarning() << "数据库未打开，无法创建基础表。";
+        return false;
+    }
+
+    const QStringList statements = {
+        R"(CREATE TABLE IF NOT EXISTS devices (
+            device_id TEXT NOT NULL PRIMARY KEY,
+            name TEXT NOT NULL,
+            type TEXT NOT NULL,
+            status TEXT NOT NULL,
+            created_at DATE NOT NULL
+        ))",
+        R"(CREATE TABLE IF NOT EXISTS scenes (
+            scene_id TEXT NOT NULL PRIMARY KEY,
+            name TEXT NOT NULL,
+            created_at DATE NOT NULL
+        ))",
+        R"(CREATE TABLE IF NOT EXISTS device_history (
+            id INTEGER NOT NULL PRIMARY KEY,
+            action_type TEXT NOT NULL,
+            action_value TEXT,
+            timestamp DATE,
+            device_id TEXT NOT NULL REFERENCES devices (device_id),
+            seq INTEGER
+        ))",
+        R"(CREATE TABLE IF NOT EXISTS scene_history (
+            id INTEGER NOT NULL PRIMARY KEY,
+            scene_id TEXT NOT NULL REFERENCES scenes (scene_id),
+            timestamp DATE
+        ))"
+    };
+
+    QSqlQuery query(database);
+    for (const QString &statement : statements) {
+        if (!query.exec(statement)) {
+            qCritical() << "创建基础表失败:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    // 旧表没有 seq 列：补上并按原有的ID顺序编号，之后的记录从最大值继续
+    if (!database.record("device_history").contains("seq")) {
+        if (!query.exec("ALTER TABLE device_history ADD COLUMN seq INTEGER")
+            || !query.exec("UPDATE device_history SET seq = id")) {
+            qCritical() << "为device_history添加序号列失败:" << query.lastError().text();
+            return false;
+        }
+        qDebug() << "device_history已添加序号列";
+    }
+    if (!query.exec("CREATE UNIQUE INDEX IF NOT EXISTS idx_device_history_seq ON device_history (seq)")) {
+        qCritical() << "创建device_history序号索引失败:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool HomeController::loadDevices()
+{
+    bool ok = false;
+    QVector<DeviceState> list = readDevices(db, &ok);
+    if (ok) {
+        setDevices(list);
+    }
+    return ok;
+}
+
+QVector<DeviceState> HomeController::readDevices(const QSqlDatabase &database, bool *ok)
+{
+    QVector<DeviceState> list;
+    if (ok) {
+        *ok = false;
+    }
+    if (!database.isOpen()) {
+        return list;
+    }
+
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT device_id, name, type, status FROM devices")) {
+        qCritical() << "读取设备列表失败:" << query.lastError().text();
+        return list;
+    }
+
+    while (query.next()) {
+        DeviceState state;
+        state.deviceId = query.value(0).toString();
+        state.name = query.value(1).toString();
+        state.type = query.value(2).toString();
+        // devices.status 随每次操作更新，重启后从这里恢复开关状态
+        state.on = isOnValue(query.value(3).toString());
+        list.append(state);
+    }
+    if (ok) {
+        *ok = true;
+    }
+    return list;
+}
+
+void HomeController::setDevices(const QVector<DeviceState> &list)
+{
+    devices.clear();
+    for (const DeviceState &state : list) {
+        DeviceEntry entry;
+        entry.state = state;
+        // 在加载时注册每种设备类型的计数器，热路径上直接使用
+        entry.commands = &commandCounter(state.type);
+        devices.insert(state.deviceId, entry);
+    }
+    bindRuleInputs();
+    if (anomalyDetector) {
+        anomalyDetector->setDevices(list);
+    }
+    qDebug() << "控制核心已加载" << devices.size() << "个设备";
+    emit devicesLoaded(list);
+}
+
+bool HomeController::recordDeviceAction(const QString &deviceId, const QString &actionType,
+                                        const QString &actionValue, const QDateTime &at)
+{
+    // 只有开关类的值会改变设备状态，其余（例如温度）只记录日志
+    bool isOn = isOnValue(actionValue);
+    bool isStateValue = isOn || isOffValue(actionValue);
+
+    auto it = devices.find(deviceId);
+    DeviceEntry *entry = (it != devices.end()) ? &it.value() : nullptr;
+    (entry ? entry->commands : unknownCommands)->inc();
+
+    bool changed = false;
+    if (entry && isStateValue) {
+        changed = (entry->state.on != isOn);
+        entry->state.on = isOn;
+    }
+
+    if (isStateValue) {
+        if (ruleEngine) {
+            // 已加载的设备使用缓存的输入编号，不再拼接键
+            if (entry && entry->ruleInput >= 0) {
+                ruleEngine->setInput(entry->ruleInput, isOn ? 1.0 : 0.0);
+            } else {
+                ruleEngine->setInput("device." + deviceId, isOn ? 1.0 : 0.0);
+            }
+        }
+        if (energyMeter) {
+            energyMeter->recordPower(deviceId, isOn, at);
+        }
+    }
+    // 重复的同一状态命令（例如连续的 turn_on）不是设备事件，不计入异常检测的操作频率
+    if (changed && anomalyDetector) {
+        anomalyDetector->onDeviceEvent(deviceId, isOn, at);
+    }
+
+    bool written = false;
+    if (storage) {
+        StorageRecord record;
+        record.kind = StorageRecord::DeviceAction;
+        record.id = deviceId;
+        record.type = actionType;
+        record.value = actionValue;
+        record.at = at;
+        storage->enqueue(record);
+        written = true;
+    } else if (!db.isOpen()) {
+        qWarning() << "数据库未打开，无法记录设备历史。";
+    } else if (prepareStatements()) {
+        // 使用 ? 占位符防止SQL注入；时间戳与 CURRENT_TIMESTAMP 一样使用 UTC
+        insertHistoryQuery.bindValue(0, deviceId);
+        insertHistoryQuery.bindValue(1, actionType);
+        insertHistoryQuery.bindValue(2, actionValue);
+        insertHistoryQuery.bindValue(3, at.toUTC().toString(TimestampFormat));
+
+        historyQueueDepth->add(1);
+        {
+            MetricTimer timer(*historyInsertSeconds);
+            written = insertHistoryQuery.exec();
+        }
+        historyQueueDepth->add(-1);
+        if (!written) {
+            // 记录失败时打印详细错误，方便调试
+            qCritical() << "记录设备历史失败 for device" << deviceId
+                        << "Action:" << actionType
+                        << "Error:" << insertHistoryQuery.lastError().text();
+        } else {
+            qCDebug(lcControl) << "成功记录设备历史:" << deviceId << "-" << actionType << ":" << actionValue;
+        }
+    }
+
+    if (changed) {
+        // 复制一份再发信号，槽函数中重新加载设备也不会影响参数
+        DeviceState state = entry->state;
+        emit deviceStateChanged(deviceId, state);
+    }
+    return written;
+}
+
+bool HomeController::updateStatus(const QString &deviceId, const QString &status)
+{
+    if (storage) {
+        StorageRecord record;
+        record.kind = StorageRecord::StatusUpdate;
+        record.id = deviceId;
+        record.value = status;
+        storage->enqueue(record);
+        return true;
+    }
+    if (!db.isOpen()) {
+        qWarning() << "数据库未打开，无法更新设备状态。";
+        return false;
+    }
+    if (!prepareStatements()) {
+        return false;
+    }
+
+    updateStatusQuery.bindValue(0, status);
+    updateStatusQuery.bindValue(1, deviceId);
+    bool ok;
+    {
+        MetricTimer timer(*statusUpdateSeconds);
+        ok = updateStatusQuery.exec();
+    }
+    if (!ok) {
+        qCritical() << "更新设备状态失败 for device" << deviceId
+                    << "Error:" << updateStatusQuery.lastError().text();
+        return false;
+    }
+    if (updateStatusQuery.numRowsAffected() > 0) {
+        qCDebug(lcControl) << "成功更新设备状态:" << deviceId << "→ 状态：" << status;
+    } else {
+        qCDebug(lcControl) << "设备状态未变化（或设备不存在）:" << deviceId;
+    }
+    return true;
+}
+
+void HomeController::setAcSetting(const QString &deviceId, const QString &mode, int temperature, const QDateTime &at)
+{
+    auto it = devices.find(deviceId);
+    if (it == devices.end()) {
+        return;
+    }
+    DeviceState &state = it->state;
+    if (state.mode == mode && state.temperature == temperature) {
+        return;
+    }
+    state.mode = mode;
+    state.temperature = temperature;
+    DeviceState changed = state;
+    if (ruleEngine) {
+        ruleEngine->setInput(it->setpointInput, temperature);
+    }
+    if (anomalyDetector) {
+        anomalyDetector->onAcSetting(deviceId, mode, at);
+    }
+
+    if (energyMeter) {
+        energyMeter->setAcSetting(deviceId, mode, temperature, at);
+    } else if (storage) {
+        StorageRecord record;
+        record.kind = StorageRecord::AcSetting;
+        record.id = deviceId;
+        record.type = mode;
+        record.number = temperature;
+        record.at = at;
+        storage->enqueue(record);
+    }
+    emit deviceStateChanged(deviceId, changed);
+}
+
+// 可以在任意线程调用：队列原本为空或开始了新的一批时唤醒控制线程，
+// 同一批中随后的操作由已经排队的那次唤醒一起处理
+void HomeController::submitPowerCommand(PowerCommand command)
+{
+    bool wake;
+    {
+        QMutexLocker locker(&commandMutex);
+        command.batch = submitBatch;
+        wake = pendingCommands.isEmpty() || wokenBatch != submitBatch;
+        wokenBatch = submitBatch;
+        pendingCommands.append(command);
+    }
+    if (wake) {
+        quint64 batch = command.batch;
+        QMetaObject::invokeMethod(this, [this, batch]() {
+            drainPowerCommands(batch);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void HomeController::closeCommandBatch()
+{
+    QMutexLocker locker(&commandMutex);
+    ++submitBatch;
+}
+
+// 只取出 batch 及更早批次的操作：之后的批次排在提交方随后转发的操作之后，由各自的唤醒处理
+void HomeController::drainPowerCommands(quint64 batch)
+{
+    {
+        QMutexLocker locker(&commandMutex);
+        int count = 0;
+        while (count < pendingCommands.size() && pendingCommands.at(count).batch <= batch) {
+            ++count;
+        }
+        if (count == pendingCommands.size()) {
+            runningCommands.swap(pendingCommands);
+        } else {
+            for (int i = 0; i < count; ++i) {
+                runningCommands.append(pendingCommands.at(i));
+            }
+            pendingCommands.remove(0, count);
+        }
+    }
+
+    if (powerTargets.isEmpty()) {
+        buildPowerTargets();
+    }
+    for (const PowerCommand &command : qAsConst(runningCommands)) {
+        if (command.device < 0 || command.device >= powerTargets.size()
+            || powerTargets.at(command.device).deviceId.isEmpty()) {
+            qWarning() << "开关操作的设备下标无效:" << command.device;
+            continue;
+        }
+        const PowerTarget &target = powerTargets.at(command.device);
+        const QString &value = command.on ? target.onValue : target.offValue;
+        recordDeviceAction(target.deviceId, PowerActionTypes[command.action], value,
+                           QDateTime::fromMSecsSinceEpoch(command.atMSecs));
+        updateStatus(target.deviceId, value);
+    }
+    // 保留容量，下一批交换回来时不再分配
+    runningCommands.resize(0);
+}
+
+// 状态值取自设备类型表，每种类型只构造一次，各设备共享；类型未知的设备留空，不接受开关操作
+void HomeController::buildPowerTargets()
+{
+    const QVector<DeviceInfo> &catalog = DeviceCatalog::instance().devices();
+    QString values[DeviceKindCount][2];
+    for (int kind = 0; kind < DeviceKindCount; ++kind) {
+        values[kind][0] = QString::fromLatin1(DeviceTraitsTable[kind].onValue);
+        values[kind][1] = QString::fromLatin1(DeviceTraitsTable[kind].offValue);
+    }
+
+    powerTargets.resize(catalog.size());
+    for (int i = 0; i < catalog.size(); ++i) {
+        DeviceKind kind;
+        if (!deviceKindFromType(catalog.at(i).type, &kind)) {
+            continue;
+        }
+        powerTargets[i].deviceId = catalog.at(i).id;
+        powerTargets[i].onValue = values[int(kind)][0];
+        powerTargets[i].offValue = values[int(kind)][1];
+    }
+}
+
+bool HomeController::recordSceneRun(const QString &sceneId, const QDateTime &at)
+{
+    QString sceneIdClean = sceneId.trimmed(); // 去除首尾空格
+    if (sceneIdClean.isEmpty()) {
+        qCritical() << "场景ID为空，无法记录日志";
+        return false;
+    }
+
+    // 场景的其余操作（例如早于7点打开卧室灯）由规则引擎根据场景事件执行
+    if (ruleEngine) {
+        updateTimeInputs(at);
+        ruleEngine->fireEvent(sceneInput(sceneIdClean));
+    }
+    if (anomalyDetector) {
+        anomalyDetector->onSceneEvent(sceneIdClean, at);
+    }
+    emit sceneExecuted(sceneIdClean);
+
+    if (storage) {
+        StorageRecord record;
+        record.kind = StorageRecord::SceneRun;
+        record.id = sceneIdClean;
+        record.at = at;
+        storage->enqueue(record);
+        return true;
+    }
+    if (!db.isOpen()) {
+        qWarning() << "数据库未打开，无法记录场景历史。";
+        return false;
+    }
+    if (!prepareStatements()) {
+        return false;
+    }
+
+    insertSceneQuery.bindValue(0, sceneIdClean);
+    insertSceneQuery.bindValue(1, at.toString(TimestampFormat));
+    bool ok;
+    {
+        MetricTimer timer(*sceneInsertSeconds);
+        ok = insertSceneQuery.exec();
+    }
+    if (!ok) {
+        qCritical() << "记录场景历史失败 for scene" << sceneId
+                    << "Error:" << insertSceneQuery.lastError().text();
+        return false;
+    }
+    qCDebug(lcControl) << "成功记录场景历史:" << sceneId;
+    return true;
+}
+
+void HomeController::updateTimeInputs(const QDateTime &at)
+{
+    if (!ruleEngine) {
+        return;
+    }
+    ruleEngine->setInput(hourInput, at.time().hour());
+    ruleEngine->setInput(weekdayInput, at.date().dayOfWeek());
+}
+
+void HomeController::setSensorInput(const QString &key, double value, const QDateTime &at)
+{
+    if (!ruleEngine) {
+        return;
+    }
+    int input = ruleEngine->inputIndex(key);
+    ruleEngine->setInput(input, value);
+    if (anomalyDetector) {
+        anomalyDetector->onInputChanged(input, at);
+    }
+}
+
+bool HomeController::contains(const QString &deviceId) const
+{
+    return devices.contains(deviceId);
+}
+
+DeviceState HomeController::device(const QString &deviceId) const
+{
+    return devices.value(deviceId).state;
+}
+
+QStringList HomeController::deviceIds() const
+{
+    return devices.keys();
+}
+
+// 第一次使用时准备语句，之后每次只重新绑定参数
+bool HomeController::prepareStatements()
+{
+    if (statementsPrepared) {
+        return true;
+    }
+
+    insertHistoryQuery = QSqlQuery(db);
+    updateStatusQuery = QSqlQuery(db);
+    insertSceneQuery = QSqlQuery(db);
+    if (!insertHistoryQuery.prepare(InsertHistorySql)
+        || !updateStatusQuery.prepare(UpdateStatusSql)
+        || !insertSceneQuery.prepare(InsertSceneSql)) {
+        qCritical() << "准备控制核心SQL失败:" << insertHistoryQuery.lastError().text()
+                    << updateStatusQuery.lastError().text() << insertSceneQuery.lastError().text();
+        return false;
+    }
+    statementsPrepared = true;
+    return true;
+}
+
+// 输入编号在规则重新加载后保持不变，设备列表或规则引擎变化时重新登记即可
+// 设定温度（setpoint.<ID>）在收到空调设定之前没有值，场景序列据此渐变时跳过
+void HomeController::bindRuleInputs()
+{
+    for (auto it = devices.begin(); it != devices.end(); ++it) {
+        it->ruleInput = ruleEngine ? ruleEngine->inputIndex("device." + it.key()) : -1;
+        // 恢复的开启状态同步给规则条件
+        if (it->ruleInput >= 0 && it->state.on) {
+            ruleEngine->setInput(it->ruleInput, 1.0);
+        }
+
+        DeviceKind kind;
+        bool hasSetpoint = deviceKindFromType(it->state.type, &kind) && deviceTraits(kind).hasSetpoint;
+        it->setpointInput = (ruleEngine && hasSetpoint) ? ruleEngine->inputIndex("setpoint." + it.key()) : -1;
+        if (it->setpointInput >= 0 && it->state.temperature > 0) {
+            ruleEngine->setInput(it->setpointInput, it->state.temperature);
+        }
+    }
+}
+
+int HomeController::sceneInput(const QString &sceneId)
+{
+    auto it = sceneInputs.constFind(sceneId);
+    if (it != sceneInputs.constEnd()) {
+        return it.value();
+    }
+    int input = ruleEngine->inputIndex("scene." + sceneId);
+    sceneInputs.insert(sceneId, input);
+    return input;
+}
+
+MetricCounter &HomeController::commandCounter(const QString &type)
+{
+    auto it = commandCounters.constFind(type);
+    if (it != commandCounters.constEnd()) {
+        return *it.value();
+    }
+    MetricCounter *counter = &MetricsRegistry::instance().counter("smarthome_device_commands_total",
+                                                                  "Device commands by device type",
+                                                                  MetricsRegistry::label("type", type));
+    commandCounters.insert(type, counter);
+    return *counter;
+}
+
+// 状态值取自设备类型表
+bool HomeController::isOnValue(const QString &actionValue)
+{
+    for (const DeviceTypeTraits &traits : DeviceTraitsTable) {
+        if (actionValue == QLatin1String(traits.onValue)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HomeController::isOffValue(const QString &actionValue)
+{
+    for (const DeviceTypeTraits &traits : DeviceTraitsTable) {
+        if (actionValue == QLatin1String(traits.offValue)) {
+            return true;
+        }
+    }
+    return false;
+}
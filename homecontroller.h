@@ -0,0 +1,178 @@
+#ifndef HOMECONTROLLER_H
+#define HOMECONTROLLER_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QLoggingCategory>
+#include <QMetaType>
+#include <QMutex>
+#include <QObject>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class AnomalyDetector;
+class EnergyMeter;
+class MetricCounter;
+class MetricGauge;
+class MetricHistogram;
+class RuleEngine;
+class StorageWorker;
+
+// 设备操作和场景执行热路径上的调试输出；关闭时（例如 smarthome.control.debug=false）不构造 QDebug
+Q_DECLARE_LOGGING_CATEGORY(lcControl)
+
+// 设备的当前状态
+struct DeviceState
+{
+    QString deviceId;
+    QString name;
+    QString type;
+    bool on = false;       // 灯/空调开、窗帘打开、门锁上锁
+    QString mode;          // 空调模式
+    int temperature = 0;   // 空调设定温度
+};
+Q_DECLARE_METATYPE(DeviceState)
+
+// 其他线程提交的开关操作：设备按目录下标记录，不携带字符串，
+// 控制线程处理时再取出设备ID、操作类型和状态值
+struct PowerCommand
+{
+    // device_history.action_type 为 toggle/turn_on/turn_off/lock
+    enum Action : quint8 { Toggle, TurnOn, TurnOff, Lock };
+    int device = -1;      // DeviceCatalog::devices() 中的下标
+    Action action = Toggle;
+    bool on = false;
+    qint64 atMSecs = 0;   // 操作发生的时刻，不受线程排队的影响
+    quint64 batch = 0;    // 由 submitPowerCommand 填写
+};
+Q_DECLARE_TYPEINFO(PowerCommand, Q_MOVABLE_TYPE);
+
+// 控制核心（不依赖界面）：维护设备状态，写 device_history / scene_history，
+// 并把设备和场景事件交给规则引擎、能耗统计和异常检测。界面和命令行工具（tools/loadgen）共用
+//
+// 两种写入方式：setDatabase 后在当前线程直接执行SQL（工具和基准测试）；
+// setStorage 后记录交给存储线程批量写入（界面程序中控制核心运行在单独的控制线程）
+//
+// 稳定状态下一次设备操作或场景执行除了写入的记录本身（时间戳和 QtSql 绑定参数）外不分配堆内存：
+// SQL 语句只准备一次，规则输入编号和指标序列在加载设备时缓存
+class HomeController : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HomeController(QObject *parent = nullptr);
+
+    void setDatabase(const QSqlDatabase &database);
+    void setRuleEngine(RuleEngine *engine);
+    void setEnergyMeter(EnergyMeter *meter);
+    // 写后模式：记录进入存储线程的队列，能耗统计也在存储线程中按记录累计，不再调用 setEnergyMeter
+    void setStorage(StorageWorker *worker);
+    // 异常检测：设备、空调设定、场景和传感器事件逐条交给检测器，需与控制核心在同一线程
+    void setAnomalyDetector(AnomalyDetector *detector);
+
+    // 新建的数据库文件中创建基础表；已有的表只补上缺少的列（device_history.seq）和索引
+    bool ensureSchema();
+    static bool createSchema(const QSqlDatabase &database);
+    // 从 devices 表读入设备列表，开关状态取自 devices.status
+    bool loadDevices();
+    static QVector<DeviceState> readDevices(const QSqlDatabase &database, bool *ok = nullptr);
+    void setDevices(const QVector<DeviceState> &list);
+
+    // 写入语句，存储线程使用同样的语句
+    static const char InsertHistorySql[];
+    static const char UpdateStatusSql[];
+    static const char InsertSceneSql[];
+
+    // 设备操作：更新状态、通知规则引擎和能耗统计并写入 device_history
+    bool recordDeviceAction(const QString &deviceId, const QString &actionType, const QString &actionValue,
+                            const QDateTime &at = QDateTime::currentDateTime());
+    bool updateStatus(const QString &deviceId, const QString &status);
+    void setAcSetting(const QString &deviceId, const QString &mode, int temperature,
+                      const QDateTime &at = QDateTime::currentDateTime());
+
+    // 可以在任意线程调用：开关操作追加到预分配的队列，同一批的操作只唤醒一次控制线程，
+    // 在控制线程中依次执行 recordDeviceAction 和 updateStatus。
+    // 提交线程向控制线程转发其它操作之前调用 closeCommandBatch：之前提交的开关操作先于该操作处理，之后的排在它后面
+    void submitPowerCommand(PowerCommand command);
+    void closeCommandBatch();
+
+    // 场景执行：触发规则事件并写入 scene_history
+    bool recordSceneRun(const QString &sceneId, const QDateTime &at = QDateTime::currentDateTime());
+    void updateTimeInputs(const QDateTime &at);
+    // 传感器读数（例如 sensor.outside）：写入规则引擎的输入并通知异常检测
+    void setSensorInput(const QString &key, double value, const QDateTime &at = QDateTime::currentDateTime());
+
+    bool contains(const QString &deviceId) const;
+    DeviceState device(const QString &deviceId) const;
+    QStringList deviceIds() const;
+
+    // on/open/locked 视为开启状态，off/close/unlocked 视为关闭状态
+    static bool isOnValue(const QString &actionValue);
+    static bool isOffValue(const QString &actionValue);
+
+signals:
+    // 设备列表重新加载；之后的变化由 deviceStateChanged 逐条发出
+    void devicesLoaded(const QVector<DeviceState> &devices);
+    void deviceStateChanged(const QString &deviceId, const DeviceState &state);
+    void sceneExecuted(const QString &sceneId);
+
+private:
+    struct DeviceEntry {
+        DeviceState state;
+        int ruleInput = -1;                 // device.<ID> 在规则引擎中的编号
+        int setpointInput = -1;             // setpoint.<ID>：有设定温度的设备（空调）的当前设定值
+        MetricCounter *commands = nullptr;  // 该设备类型的命令计数
+    };
+
+    // 设备目录下标 -> 设备ID和状态值，第一次处理开关操作时生成
+    struct PowerTarget {
+        QString deviceId;
+        QString onValue;
+        QString offValue;
+    };
+
+    void drainPowerCommands(quint64 batch);
+    void buildPowerTargets();
+    bool prepareStatements();
+    void bindRuleInputs();
+    int sceneInput(const QString &sceneId);
+    MetricCounter &commandCounter(const QString &type);
+
+    QSqlDatabase db;
+    RuleEngine *ruleEngine;
+    EnergyMeter *energyMeter;
+    StorageWorker *storage;
+    AnomalyDetector *anomalyDetector;
+    QHash<QString, DeviceEntry> devices;
+    QHash<QString, int> sceneInputs;  // 场景ID -> scene.<ID> 的输入编号
+    int hourInput;
+    int weekdayInput;
+
+    // 开关操作队列：提交方只在互斥锁内追加，控制线程把已结束的批次取出再处理；两个数组都保留容量
+    static constexpr int PowerCommandCapacity = 64;
+    QMutex commandMutex;
+    QVector<PowerCommand> pendingCommands;
+    QVector<PowerCommand> runningCommands;
+    quint64 submitBatch;  // 提交方当前的批次
+    quint64 wokenBatch;   // 最近一次唤醒控制线程时的批次
+    QVector<PowerTarget> powerTargets;
+
+    // 热路径上复用的预编译语句
+    bool statementsPrepared;
+    QSqlQuery insertHistoryQuery;
+    QSqlQuery updateStatusQuery;
+    QSqlQuery insertSceneQuery;
+
+    // 指标：注册表中的序列在程序运行期间一直有效，这里缓存指针，更新时不加锁
+    QHash<QString, MetricCounter*> commandCounters;  // 设备类型 -> 命令数
+    MetricCounter *unknownCommands;
+    MetricHistogram *historyInsertSeconds;
+    MetricHistogram *statusUpdateSeconds;
+    MetricHistogram *sceneInsertSeconds;
+    MetricGauge *historyQueueDepth;
+};
+
+#endif // HOMECONTROLLER_H
@@ -0,0 +1,141 @@
+#include "homesnapshot.h"
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+const quint32 HomeSnapshot::Magic = 0x53485353;  // "SHSS"
+const quint16 HomeSnapshot::Version = 2;
+
+QByteArray HomeSnapshot::serialize() const
+{
+    QByteArray payload;
+    {
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_15);
+        out << savedAt << historySequence;
+
+        out << quint32(devices.size());
+        for (const DeviceState &device : devices) {
+            out << device.deviceId << device.on << device.mode << qint32(device.temperature);
+        }
+
+        out << quint32(customScenes.size());
+        for (const CustomSceneSnapshot &scene : customScenes) {
+            out << scene.name << scene.devices;
+        }
+
+        out << quint32(schedules.size());
+        for (const ScheduleJob &job : schedules) {
+            out << job.id << job.sceneId << qint32(job.kind) << job.fireAt << job.weekdays << job.timeOfDay
+                << qint32(job.catchUpPolicy) << qint32(job.catchUpMinutes) << job.lastRun;
+        }
+    }
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << Magic << Version << quint16(qChecksum(payload.constData(), uint(payload.size()))) << payload;
+    return data;
+}
+
+bool HomeSnapshot::deserialize(const QByteArray &data, QString *errorMessage)
+{
+    auto fail = [errorMessage](const QString &message) {
+        if (errorMessage) {
+            *errorMessage = message;
+        }
+        return false;
+    };
+
+    QDataStream header(data);
+    header.setVersion(QDataStream::Qt_5_15);
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint16 checksum = 0;
+    QByteArray payload;
+    header >> magic >> version >> checksum >> payload;
+    if (header.status() != QDataStream::Ok || magic != Magic) {
+        return fail("不是状态快照文件");
+    }
+    if (version == 0 || version > Version) {
+        return fail(QString("快照版本 %1 不受支持").arg(version));
+    }
+    if (checksum != qChecksum(payload.constData(), uint(payload.size()))) {
+        return fail("快照校验和不符");
+    }
+
+    // 版本2在保存时间之后增加了 historySequence
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_5_15);
+    HomeSnapshot snapshot;
+    in >> snapshot.savedAt;
+    if (version >= 2) {
+        in >> snapshot.historySequence;
+    }
+
+    quint32 count = 0;
+    in >> count;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        DeviceState device;
+        qint32 temperature = 0;
+        in >> device.deviceId >> device.on >> device.mode >> temperature;
+        device.temperature = temperature;
+        snapshot.devices.append(device);
+    }
+
+    in >> count;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        CustomSceneSnapshot scene;
+        in >> scene.name >> scene.devices;
+        snapshot.customScenes.append(scene);
+    }
+
+    in >> count;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        ScheduleJob job;
+        qint32 kind = 0;
+        qint32 policy = 0;
+        qint32 catchUpMinutes = 0;
+        in >> job.id >> job.sceneId >> kind >> job.fireAt >> job.weekdays >> job.timeOfDay
+           >> policy >> catchUpMinutes >> job.lastRun;
+        job.kind = ScheduleJob::Kind(kind);
+        job.catchUpPolicy = ScheduleJob::CatchUpPolicy(policy);
+        job.catchUpMinutes = catchUpMinutes;
+        snapshot.schedules.append(job);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        return fail("快照内容不完整");
+    }
+    *this = snapshot;
+    return true;
+}
+
+bool HomeSnapshot::writeFile(const QString &path, const QByteArray &data, QString *errorMessage)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
+bool HomeSnapshot::readFile(const QString &path, HomeSnapshot *snapshot, QString *errorMessage)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        return false;
+    }
+    return snapshot->deserialize(file.readAll(), errorMessage);
+}
+
+QString HomeSnapshot::pathForDatabase(const QString &databasePath)
+{
+    return databasePath + ".snapshot";
+}
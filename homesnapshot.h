@@ -0,0 +1,47 @@
+#ifndef HOMESNAPSHOT_H
+#define HOMESNAPSHOT_H
+
+#include "homecontroller.h"
+#include "scenescheduler.h"
+#include <QByteArray>
+#include <QDateTime>
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+// 自定义场景：设备名 -> 0 保持不变, 1 开, 2 关
+struct CustomSceneSnapshot
+{
+    QString name;                // 为空表示这个位置没有场景
+    QMap<QString, int> devices;
+};
+
+// 整个家庭的状态快照：设备开关、空调模式和设定温度、自定义场景和定时任务。
+// 界面启动时在第一次绘制之前一次读入；数据库打开后再回放 historySequence 之后的 device_history，
+// 得到崩溃前最后的开关状态（见 StorageWorker::recoverDevices）
+//
+// 文件格式：magic、版本号、内容的 CRC-16 和 QDataStream 写出的内容；
+// 格式变化时增加版本号，并保留旧版本的读取分支
+struct HomeSnapshot
+{
+    static const quint32 Magic;
+    static const quint16 Version;
+
+    QDateTime savedAt;
+    // 快照已包含的 device_history 最大序号，恢复时只回放这之后的记录；-1 表示未知（版本1的快照），不回放
+    qint64 historySequence = -1;
+    QVector<DeviceState> devices;  // 只保存设备ID、开关状态，以及空调的模式和设定温度
+    QVector<CustomSceneSnapshot> customScenes;
+    QVector<ScheduleJob> schedules;
+
+    QByteArray serialize() const;
+    bool deserialize(const QByteArray &data, QString *errorMessage = nullptr);
+
+    // 先写临时文件再替换，写到一半断电不会破坏上一份快照
+    static bool writeFile(const QString &path, const QByteArray &data, QString *errorMessage = nullptr);
+    static bool readFile(const QString &path, HomeSnapshot *snapshot, QString *errorMessage = nullptr);
+    // 快照放在数据库文件旁边，基准测试和工具使用独立的数据库时快照也互不影响
+    static QString pathForDatabase(const QString &databasePath);
+};
+
+#endif // HOMESNAPSHOT_H
@@ -5,6 +5,9 @@
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    // 应用名称决定缓存等数据文件的存放目录
+    QApplication::setOrganizationName("QtLab");
+    QApplication::setApplicationName("QtSmartHome");
     MainWindow w;
     w.show();
     return a.exec();
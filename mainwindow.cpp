@@ -1,38 +1,92 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "userdefinedscenedialog.h"
+#include "sceneusagedialog.h"
+#include "devicecatalog.h"
+#include "metricsregistry.h"
+#include "metricsserver.h"
 #include <QDebug>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonArray>
 #include <QJsonParseError>
 #include <QPushButton>
-#include <QNetworkAccessManager>
-#include <QNetworkRequest>
 #include <QUrl>
 #include <QByteArray>
 #include <QTimer>
 #include <QString>
-#include <QSqlDatabase>
-#include <QSqlQuery>
-#include<QSqlError>
-#include<QDateTime>
+#include <QStandardPaths>
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+// 开关按钮的文字和高亮样式，热路径上不再每次从字面量构造
+static const QString OnText = QStringLiteral("开");
+static const QString OffText = QStringLiteral("关");
+static const QString ActiveButtonStyle = QStringLiteral("background-color: #FFD700; color: black; font-weight: bold;");
+
+// 指标序列在各函数中用局部静态变量缓存，只在第一次调用时访问注册表
+static MetricHistogram &sceneDurationHistogram(const QString &sceneId)
+{
+    return MetricsRegistry::instance().histogram("smarthome_scene_duration_seconds", "Scene execution time",
+                                                 MetricsRegistry::label("scene", sceneId));
+}
+
+static MetricHistogram &uiRefreshHistogram(const QString &view)
+{
+    return MetricsRegistry::instance().histogram("smarthome_ui_refresh_seconds", "UI refresh time",
+                                                 MetricsRegistry::label("view", view));
+}
+
+static MetricHistogram &weatherFetchHistogram(const QString &kind)
+{
+    return MetricsRegistry::instance().histogram("smarthome_weather_fetch_seconds", "Weather request latency",
+                                                 MetricsRegistry::label("kind", kind));
+}
+
+static MetricCounter &weatherFailureCounter(const QString &kind)
+{
+    return MetricsRegistry::instance().counter("smarthome_weather_failures_total", "Failed weather requests",
+                                               MetricsRegistry::label("kind", kind));
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
+    , storageThread(nullptr)
+    , networkThread(nullptr)
+    , controllerThread(nullptr)
+    , storage(nullptr)
+    , networkWorker(nullptr)
+    , homeController(nullptr)
+    , sceneSequencer(nullptr)
+    , anomalyDetector(nullptr)
+    , controlServer(nullptr)
+    , databaseReady(false)
     , ui(new Ui::MainWindow)
-    , networkManager(nullptr)
-    , weatherReply(nullptr)
+    , weatherRequestPending(false)
+    , forecastRequestPending(false)
     , timeUpdateTimer(nullptr)
     , weatherUpdateTimer(nullptr)
+    , weatherRetryTimer(nullptr)
+    , forecastUpdateTimer(nullptr)
+    , ruleEngine(nullptr)
+    , planningRules(nullptr)
     , lightsOnCount(0)
     , curtainsOpenCount(0)
     , outsideTemperature(25)  // 默认室外温度为25度
-    , wakeUpTimer(nullptr)
+    , sceneScheduler(nullptr)
+    , wakeUpJobId(0)
     , wakeUpStatusLabel(nullptr)
     , isWakeUpModeActive(false)
+    , snapshotTimer(nullptr)
+    , historySequence(-1)
+    , schedulesFromSnapshot(false)
 {
     ui->setupUi(this);
+    buildCustomSceneTargets();
 
     // 初始化状态栏标签
     statusTimeLabel.setMidLineWidth(200);
@@ -49,99 +103,278 @@ MainWindow::MainWindow(QWidget *parent)
     ui->statusbar->addPermanentWidget(&statusTemperatureLabel);
     ui->statusbar->setMinimumHeight(50);
 
-    // 初始化网络管理器
-    networkManager = new QNetworkAccessManager(this);
-    
+    // 场景使用统计页
+    QPushButton *sceneUsageButton = new QPushButton("场景统计", this);
+    ui->statusbar->addWidget(sceneUsageButton);
+    connect(sceneUsageButton, &QPushButton::clicked, this, &MainWindow::showSceneUsage);
+
     // 初始化定时器
     timeUpdateTimer = new QTimer(this);
     weatherUpdateTimer = new QTimer(this);
+    weatherRetryTimer = new QTimer(this);
+    weatherRetryTimer->setSingleShot(true);
+    forecastUpdateTimer = new QTimer(this);
+    snapshotPath = HomeSnapshot::pathForDatabase(StorageWorker::defaultDatabasePath());
+    snapshotTimer = new QTimer(this);
+    snapshotTimer->setSingleShot(true);
+    snapshotTimer->setInterval(SnapshotDelayMs);
+    for (int room = 0; room < AcPlanner::RoomCount; ++room) {
+        indoorTemperatures[room] = qQNaN();
+        preconditionTimers[room] = new QTimer(this);
+        preconditionTimers[room]->setSingleShot(true);
+        connect(preconditionTimers[room], &QTimer::timeout, this, [this, room]() {
+            startPreconditioning(AcPlanner::Room(room));
+        });
+    }
     
     // 连接定时器信号
     connect(timeUpdateTimer, &QTimer::timeout, this, &MainWindow::updateCurrentTime);
     connect(weatherUpdateTimer, &QTimer::timeout, this, &MainWindow::updateWeatherFromNetwork);
+    connect(weatherRetryTimer, &QTimer::timeout, this, &MainWindow::updateWeatherFromNetwork);
+    connect(forecastUpdateTimer, &QTimer::timeout, this, &MainWindow::updateForecastFromNetwork);
+    connect(snapshotTimer, &QTimer::timeout, this, &MainWindow::saveSnapshot);
+
+    // 场景调度器：起床闹钟等定时场景都由它触发
+    sceneScheduler = new SceneScheduler(this);
+    connect(sceneScheduler, &SceneScheduler::jobTriggered, this, &MainWindow::onScheduledJobTriggered);
+    connect(sceneScheduler, &SceneScheduler::jobSkipped, this, &MainWindow::persistScheduleJob);
+
+    // 规则引擎：空调计划和起床开灯等规则都从规则文件加载，需在天气数据之前就绪
+    // 接收设备和场景事件的引擎运行在控制线程，触发的动作通过队列连接回到界面线程执行
+    ruleEngine = new RuleEngine;
+    connect(ruleEngine, &RuleEngine::actionTriggered, this, &MainWindow::applyRuleAction);
+    ruleEngine->loadDefaultRules();
+    // 空调计划在界面线程中试算，使用一份只读的规则副本，不与控制线程共享状态
+    planningRules = new RuleEngine(this);
+    acPlanner.setRuleEngine(planningRules);
+    connect(planningRules, &RuleEngine::rulesReloaded, this, &MainWindow::onRulesReloaded);
+    planningRules->loadDefaultRules();
+
+    // 控制核心：设备状态，以及规则引擎的事件入口；历史记录和能耗统计交给存储线程
+    homeController = new HomeController;
+    homeController->setRuleEngine(ruleEngine);
+
+    // 场景序列：场景的延时和渐变步骤，动作与规则动作一样回到界面线程执行
+    sceneSequencer = new SceneSequencer;
+    sceneSequencer->setRuleEngine(ruleEngine);
+    connect(sceneSequencer, &SceneSequencer::actionTriggered, this, &MainWindow::applyRuleAction);
+    sceneSequencer->loadDefaultSequences();
+
+    // 异常检测：控制核心把设备和场景事件逐条交给检测器，告警回到界面线程显示
+    anomalyDetector = new AnomalyDetector;
+    anomalyDetector->setRuleEngine(ruleEngine);
+    connect(anomalyDetector, &AnomalyDetector::anomalyDetected, this, &MainWindow::onAnomalyDetected);
+    anomalyDetector->loadDefaultDetectors();
+    homeController->setAnomalyDetector(anomalyDetector);
+
+    // 上次的状态快照先读入：存储线程从快照开始回放之后的设备历史，界面在第一次绘制之前按快照显示
+    HomeSnapshot snapshot;
+    bool hasSnapshot = readSnapshot(&snapshot);
+    startWorkerThreads(hasSnapshot ? &snapshot : nullptr);
+
+    // 先用磁盘缓存绘制天气，网络请求返回后再刷新
+    loadWeatherCache();
     
     // 先启动定时器，再启动网络更新
     startNetworkUpdate();
 
     setupConnections();
     
-    // 初始化灯光状态，所有灯默认关闭
-    lightStates[ui->LivingroomLightButton] = false;
-    lightStates[ui->KitchenLightButton] = false;
-    lightStates[ui->BedroomLightButton] = false;
-    lightStates[ui->BathroomLightButton] = false;
-    lightStates[ui->StudyroomLightButton] = false;
-    lightStates[ui->BalconyLightButton] = false;
-    lightStates[ui->DiningroomLightButton] = false;
-    
-    // 确保所有灯光按钮初始状态一致
-    QList<QPushButton*> allLightButtons = {
-        ui->LivingroomLightButton,
-        ui->KitchenLightButton,
-        ui->BedroomLightButton,
-        ui->BathroomLightButton,
-        ui->StudyroomLightButton,
-        ui->BalconyLightButton,
-        ui->DiningroomLightButton
-    };
-    
-    for (QPushButton* button : allLightButtons) {
-        if (button) {
-            button->setText("关");
-            button->setStyleSheet("");
-            qDebug() << "初始化灯光按钮:" << button->objectName() << "状态:关";
-        } else {
-            qDebug() << "警告：发现空灯光按钮";
+    // 按设备目录初始化界面上的设备状态，灯、窗帘和空调默认关闭
+    for (const CustomSceneTarget &target : qAsConst(deviceTargets)) {
+        switch (target.kind) {
+        case DeviceKind::Light:
+            lightStates[target.button] = false;
+            break;
+        case DeviceKind::Curtain:
+            curtainStates[target.button] = false;
+            break;
+        case DeviceKind::AirConditioner:
+            target.modeBox->setEnabled(false);
+            target.temperatureBox->setEnabled(false);
+            break;
+        case DeviceKind::Lock:
+            // 门锁按钮的文字由门锁状态决定
+            continue;
         }
+        target.button->setText(OffText);
+        target.button->setStyleSheet(QString());
     }
-    
-    // 重置灯光计数并更新主页面显示
+
+    // 重置灯光和窗帘计数并更新主页面显示
     lightsOnCount = 0;
     updateMainPageLightStatus();
-    qDebug() << "灯光系统初始化完成，开启灯数量:" << lightsOnCount;
-
-    //空调界面初始化
-    ui->LivingroomAcButton->setText("关");
-    ui->BedroomAcButton->setText("关");
-    ui->LivingroomAcModecomboBox->setEnabled(false);
-    ui->LivingroomTemperaturecomboBox->setEnabled(false);
-    ui->BedroomAcModecomboBox->setEnabled(false);
-    ui->BedroomTemperaturecomboBox->setEnabled(false);
-
-    //窗帘初始化
-    ui->LivingroomCurtainButton->setText("关");
-    ui->BedroomCurtainButton->setText("关");
-    
-    // 初始化窗帘状态，所有窗帘默认关闭
-    curtainStates[ui->LivingroomCurtainButton] = false;
-    curtainStates[ui->BedroomCurtainButton] = false;
-    
-    // 重置窗帘计数并更新主页面显示
+    qDebug() << "灯光系统初始化完成，灯的数量:" << lightStates.size();
     curtainsOpenCount = 0;
     updateMainPageCurtainStatus();
-    qDebug() << "窗帘系统初始化完成，开启窗帘数量:" << curtainsOpenCount;
+    qDebug() << "窗帘系统初始化完成，窗帘数量:" << curtainStates.size();
 
-    if (initDatabase()) {
-        populateDefaultDevices();  // 插入默认设备
-        populateDefaultScenes();
-    } else {
-        qCritical() << "数据库初始化失败，日志功能将无法使用！";
+    // 上次的设备状态、空调设置、自定义场景和定时任务
+    if (hasSnapshot) {
+        restoreSnapshot(snapshot);
     }
+
     ui->stackedWidget->setCurrentIndex(0);
 
 }
 
 MainWindow::~MainWindow()
 {
-    // 清理网络请求
-    if (weatherReply) {
-        weatherReply->abort();
-        weatherReply->deleteLater();
+    // 后台线程可能还在投递结果，先停止线程再析构界面
+    stopWorkerThreads();
+    // 存储线程已停止，退出前在界面线程中写入最新状态
+    snapshotTimer->stop();
+    QString errorMessage;
+    if (!HomeSnapshot::writeFile(snapshotPath, captureSnapshot().serialize(), &errorMessage)) {
+        qWarning() << "写入状态快照失败:" << snapshotPath << errorMessage;
     }
-    
     delete ui;
 }
 
+// 创建存储、网络和控制线程；工作对象没有父对象，线程结束时在各自的线程中删除
+void MainWindow::startWorkerThreads(const HomeSnapshot *snapshot)
+{
+    storageThread = new QThread(this);
+    storageThread->setObjectName("storage");
+    storage = new StorageWorker(StorageWorker::defaultDatabasePath());
+    storage->moveToThread(storageThread);
+    connect(storageThread, &QThread::finished, storage, &QObject::deleteLater);
+    connect(storage, &StorageWorker::historyCommitted, this, &MainWindow::onHistoryCommitted);
+
+    controllerThread = new QThread(this);
+    controllerThread->setObjectName("controller");
+    homeController->setStorage(storage);
+    homeController->moveToThread(controllerThread);
+    ruleEngine->moveToThread(controllerThread);
+    sceneSequencer->moveToThread(controllerThread);
+    anomalyDetector->moveToThread(controllerThread);
+    connect(controllerThread, &QThread::finished, homeController, &QObject::deleteLater);
+    connect(controllerThread, &QThread::finished, ruleEngine, &QObject::deleteLater);
+    connect(controllerThread, &QThread::finished, sceneSequencer, &QObject::deleteLater);
+    connect(controllerThread, &QThread::finished, anomalyDetector, &QObject::deleteLater);
+
+    networkThread = new QThread(this);
+    networkThread->setObjectName("network");
+    networkWorker = new NetworkWorker(QWeatherProvider::fromSettings());
+    networkWorker->moveToThread(networkThread);
+    connect(networkThread, &QThread::finished, networkWorker, &QObject::deleteLater);
+    connect(networkWorker, &NetworkWorker::weatherFetched, this, &MainWindow::onWeatherFetched);
+    connect(networkWorker, &NetworkWorker::forecastFetched, this, &MainWindow::onForecastFetched);
+
+    // 本机控制接口也在网络线程中收发，请求回到界面线程与按钮走同一条路径；SMARTHOME_CONTROL_SOCKET 为空时不启动。
+    // 在线程启动前连接，控制核心加载设备列表时状态推送已能收到
+    QString controlName = ControlServer::nameFromEnvironment();
+    if (!controlName.isEmpty()) {
+        controlServer = new ControlServer;
+        controlServer->moveToThread(networkThread);
+        connect(networkThread, &QThread::finished, controlServer, &QObject::deleteLater);
+        connect(controlServer, &ControlServer::requestsReceived, this, &MainWindow::onControlRequests);
+        connect(homeController, &HomeController::devicesLoaded, controlServer, &ControlServer::setDevices);
+        connect(homeController, &HomeController::deviceStateChanged, controlServer, &ControlServer::publishDeviceState);
+        connect(homeController, &HomeController::sceneExecuted, controlServer, &ControlServer::publishScene);
+        QMetaObject::invokeMethod(controlServer, [server = controlServer, controlName]() {
+            server->listen(controlName);
+        });
+    }
+
+    storageThread->start();
+    controllerThread->start();
+    networkThread->start();
+
+    // 打开数据库并写入默认设备和场景，从快照和之后的设备历史恢复设备状态；
+    // 同一份恢复结果交给能耗统计（存储线程）、控制线程和界面线程，定时任务交给界面线程。
+    // 这是存储线程的第一个任务，之后控制线程提交的记录都排在它后面，回放读到的历史不会缺少或多出
+    StorageWorker *worker = storage;
+    HomeController *controller = homeController;
+    bool hasSnapshot = snapshot != nullptr;
+    HomeSnapshot base = hasSnapshot ? *snapshot : HomeSnapshot();
+    QMetaObject::invokeMethod(storage, [this, worker, controller, hasSnapshot, base]() {
+        if (!worker->open()) {
+            qCritical() << "数据库初始化失败，日志功能将无法使用！";
+            return;
+        }
+        worker->populateDefaultDevices();
+        worker->populateDefaultScenes();
+        DeviceRecovery recovery = worker->recoverDevices(hasSnapshot ? &base : nullptr);
+        QVector<ScheduleJob> jobs = worker->loadSchedules();
+        QMetaObject::invokeMethod(controller, [controller, devices = recovery.devices]() {
+            controller->setDevices(devices);
+        });
+        QMetaObject::invokeMethod(this, [this, recovery, jobs]() {
+            onStorageReady(recovery, jobs);
+        });
+    });
+
+    // 本机指标导出在网络线程中监听，SMARTHOME_METRICS_PORT=0 时不启动
+    quint16 metricsPort = MetricsServer::portFromEnvironment();
+    QMetaObject::invokeMethod(networkWorker, [network = networkWorker, metricsPort]() {
+        network->startMetricsServer(metricsPort);
+    });
+}
+
+// 按依赖顺序停止：控制线程先处理完已转发的操作（会继续提交到存储队列），存储线程最后写完剩余记录
+void MainWindow::stopWorkerThreads()
+{
+    const QPair<QThread*, QObject*> threads[] = {
+        qMakePair(networkThread, static_cast<QObject*>(networkWorker)),
+        qMakePair(controllerThread, static_cast<QObject*>(homeController)),
+        qMakePair(storageThread, static_cast<QObject*>(storage))
+    };
+    for (const auto &entry : threads) {
+        QThread *thread = entry.first;
+        if (!thread || !thread->isRunning()) {
+            continue;
+        }
+        // 退出请求排在已投递的任务之后
+        QMetaObject::invokeMethod(entry.second, [thread]() {
+            thread->quit();
+        });
+        thread->wait();
+    }
+    // 网络线程结束时已删除，控制线程交回的回复不再转发
+    controlServer = nullptr;
+}
+
+// 存储线程打开数据库后：显示恢复出的开关状态（快照加之后的历史回放，没有快照时为每个设备最近的开关记录），能耗统计取得空调的当前设置，恢复或同步定时任务
+void MainWindow::onStorageReady(const DeviceRecovery &recovery, const QVector<ScheduleJob> &jobs)
+{
+    databaseReady = true;
+    // 只更新需要重绘的设备（没有快照时为全部设备），其余设备保持界面上的状态（数据库打开之前用户可能已经操作过）
+    for (const DeviceState &device : recovery.devices) {
+        if (!recovery.replayedIds.contains(device.deviceId)) {
+            continue;
+        }
+        const CustomSceneTarget *target = deviceTarget(device.deviceId);
+        if (target && isTargetOn(*target) != device.on) {
+            showTargetPower(*target, device.on);
+        }
+    }
+    historySequence = recovery.sequence;
+    if (!recovery.replayedIds.isEmpty() || recovery.replayedRows > 0) {
+        scheduleSnapshot();
+    }
+
+    updateAcSetting(AcPlanner::Livingroom);
+    updateAcSetting(AcPlanner::Bedroom);
+    if (!schedulesFromSnapshot) {
+        restoreSchedules(jobs);
+        return;
+    }
+
+    // 快照中的任务已在调度器中：补充快照中没有的任务，
+    // 再把快照任务的当前状态写回数据库（恢复时补执行或跳过的任务在数据库中更新或删除）
+    QVector<ScheduleJob> missing;
+    for (const ScheduleJob &job : jobs) {
+        if (!snapshotJobIds.contains(job.id)) {
+            missing.append(job);
+        }
+    }
+    restoreSchedules(missing);
+    for (quint64 jobId : qAsConst(snapshotJobIds)) {
+        persistScheduleJob(jobId);
+    }
+}
+
 void MainWindow::setupConnections()
 {
     // 设置自定义场景按钮的上下文菜单策略
@@ -206,8 +439,21 @@ void MainWindow::setupConnections()
     });
     
 
+    // 空调模式和温度变化时同步到控制核心
+    connect(ui->LivingroomAcModecomboBox, &QComboBox::currentTextChanged, this, [this]() {
+        updateAcSetting(AcPlanner::Livingroom);
+    });
+    connect(ui->LivingroomTemperaturecomboBox, &QComboBox::currentTextChanged, this, [this]() {
+        updateAcSetting(AcPlanner::Livingroom);
+    });
+    connect(ui->BedroomAcModecomboBox, &QComboBox::currentTextChanged, this, [this]() {
+        updateAcSetting(AcPlanner::Bedroom);
+    });
+    connect(ui->BedroomTemperaturecomboBox, &QComboBox::currentTextChanged, this, [this]() {
+        updateAcSetting(AcPlanner::Bedroom);
+    });
+
     // 网络请求完成信号连接
-    connect(networkManager, &QNetworkAccessManager::finished, this, &MainWindow::onNetworkReplyFinished);
 }
 
 void MainWindow::startNetworkUpdate()
@@ -220,126 +466,212 @@ void MainWindow::startNetworkUpdate()
     
     qDebug() << "调用updateWeatherFromNetwork()...";
     updateWeatherFromNetwork();
+    updateForecastFromNetwork();
     
-    // 设置定时器，时间每分钟更新一次，天气每30分钟更新一次
+    // 设置定时器，时间每分钟更新一次，天气默认每30分钟更新一次，逐小时预报每小时更新一次
     qDebug() << "启动定时器...";
     timeUpdateTimer->start(60000);  // 1分钟
-    weatherUpdateTimer->start(1800000);  // 30分钟
+    weatherUpdateTimer->start(WeatherPollPolicy::NormalIntervalMs);  // 30分钟，之后按天气变化自适应调整
+    forecastUpdateTimer->start(3600000);  // 1小时
     qDebug() << "定时器启动完成";
 }
 
 void MainWindow::updateCurrentTime()
 {
+    static MetricHistogram &refreshSeconds = uiRefreshHistogram("clock");
+    MetricTimer refreshTimer(refreshSeconds);
+
     // 获取当前时间并格式化
     QDateTime currentDateTime = QDateTime::currentDateTime();
     QString timeString = currentDateTime.toString("yyyy-MM-dd hh:mm");
     statusTimeLabel.setText(timeString);
+    postToController([controller = homeController, currentDateTime]() {
+        controller->updateTimeInputs(currentDateTime);
+    });
 }
 
-void MainWindow::onNetworkReplyFinished(QNetworkReply *reply)
+void MainWindow::updateWeatherFromNetwork()
 {
-    qDebug() << "网络请求完成，reply对象:" << reply;
-    
-    if (reply == weatherReply) {
-        qDebug() << "天气请求完成，调用onWeatherReplyFinished()";
-        onWeatherReplyFinished();
-    } else {
-        qDebug() << "未识别的请求类型";
-        reply->deleteLater();
+    // 上一次请求尚未完成，不重复发起
+    if (weatherRequestPending) {
+        qDebug() << "天气请求进行中，跳过本次更新";
+        return;
     }
+
+    // 熔断器断开期间不再请求，冷却结束后由重试定时器发起试探请求
+    if (!weatherBreaker.allowRequest()) {
+        qDebug() << "天气服务熔断中，剩余冷却时间(秒):" << weatherBreaker.remainingCooldownMs() / 1000;
+        return;
+    }
+
+    // 条件请求：数据未变化时服务器返回304，不必重新传输和解析
+    QByteArray etag;
+    QByteArray lastModified;
+    if (weatherCache.hasObservation()) {
+        etag = weatherCache.etag();
+        lastModified = weatherCache.lastModified();
+    }
+
+    weatherRequestPending = true;
+    QMetaObject::invokeMethod(networkWorker, [network = networkWorker, etag, lastModified]() {
+        network->fetchWeather(etag, lastModified);
+    });
 }
 
-void MainWindow::updateWeatherFromNetwork()
+// 网络线程已完成读取和 JSON 解析，这里只更新界面、缓存和重试状态
+void MainWindow::onWeatherFetched(const WeatherFetchResult &result)
 {
-    // 使用和风天气API获取天气信息
-    QUrl weatherUrl("https://n66apx77xf.re.qweatherapi.com/v7/weather/now?location=101281601");
-    
-    if (weatherReply) {
-        weatherReply->abort();
-        weatherReply->deleteLater();
+    weatherRequestPending = false;
+
+    static MetricHistogram &fetchSeconds = weatherFetchHistogram("now");
+    fetchSeconds.observe(result.seconds);
+
+    switch (result.status) {
+    case WeatherFetchResult::NotModified:
+        // 304：缓存内容仍然有效，只刷新获取时间；不是新的观测，不计入轮询策略的温度变化
+        if (weatherCache.hasObservation()) {
+            qDebug() << "天气数据未变化(304)，使用缓存";
+            weatherCache.markRevalidated();
+            weatherCache.save();
+            parseWeatherData(weatherCache.observation());
+            recordWeatherSuccess();
+            rescheduleWeatherPolling(false);
+        } else {
+            qDebug() << "服务器返回304，但本地没有天气缓存";
+            handleWeatherFailure();
+        }
+        return;
+
+    case WeatherFetchResult::NetworkError:
+        qDebug() << "天气请求错误:" << result.error;
+        if (weatherCache.hasObservation()) {
+            // 有缓存时继续显示缓存数据，并标注获取时间
+            showCachedWeather();
+        } else {
+            statusWeatherLabel.setText("天气获取失败");
+            statusTemperatureLabel.setText("温度获取失败");
+        }
+        handleWeatherFailure();
+        return;
+
+    case WeatherFetchResult::InvalidResponse:
+        // 不更新天气信息，保持原来的数据
+        qDebug() << "天气响应无效:" << result.error;
+        handleWeatherFailure();
+        return;
+
+    case WeatherFetchResult::Updated:
+        break;
     }
-    
-    // 创建请求并添加API密钥到请求头
-    QNetworkRequest request(weatherUrl);
-    request.setHeader(QNetworkRequest::UserAgentHeader, "QtSmartHomeApp/1.0");
-    request.setRawHeader("X-QW-Api-Key", "228b0b2673454eacb238fdefe86d9409");
-    
-    weatherReply = networkManager->get(request);
+
+    // 尝试解析天气数据
+    if (!parseWeatherData(result.observation)) {
+        // 如果无法解析数据，不更新天气信息，保持原来的数据
+        qDebug() << "无法解析天气数据，保持原来的信息";
+    } else if (result.observation.contains("now")) {
+        // 保存到磁盘缓存，下次启动时立即显示
+        weatherCache.store(result.observation, result.etag, result.lastModified);
+        weatherCache.save();
+        recordTemperatureReadings(result.observation);
+    }
+    recordWeatherSuccess();
+    rescheduleWeatherPolling(true);
 }
 
-void MainWindow::onWeatherReplyFinished()
+// 一次请求获取未来24小时的逐小时预报，用于预先计算空调计划
+void MainWindow::updateForecastFromNetwork()
 {
-    qDebug() << "天气请求完成处理开始";
-    
-    if (!weatherReply) {
-        qDebug() << "天气请求对象为空";
+    if (forecastRequestPending) {
+        qDebug() << "预报请求进行中，跳过本次更新";
         return;
     }
-    
-    // 检查响应状态码
-    if (weatherReply->error() != QNetworkReply::NoError) {
-        qDebug() << "天气请求错误:" << weatherReply->errorString();
-        
-        statusWeatherLabel.setText("天气获取失败");
-        statusTemperatureLabel.setText("温度获取失败");
 
-        weatherReply->deleteLater();
-        weatherReply = nullptr;
+    // 实况天气请求已熔断，说明服务不可用，预报也不再请求
+    if (weatherBreaker.state() == CircuitBreaker::Open) {
+        qDebug() << "天气服务熔断中，跳过预报更新";
         return;
     }
-    
-    qDebug() << "天气请求成功，响应代码:" << weatherReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-    
-    // 读取响应数据
-    QByteArray responseData = weatherReply->readAll();
-    qDebug() << "响应数据长度:" << responseData.size();
-    qDebug() << "响应数据内容:" << responseData.left(200); // 只显示前200个字符
-    qDebug() << "检查JSON解析...";
-    
-    // 解析JSON响应
-    QJsonParseError jsonError;
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(responseData, &jsonError);
-    
-    if (jsonError.error != QJsonParseError::NoError) {
-        qDebug() << "JSON解析错误:" << jsonError.errorString();
-        
-        // 不更新天气信息，保持原来的数据
-        weatherReply->deleteLater();
-        weatherReply = nullptr;
+
+    forecastRequestPending = true;
+    QMetaObject::invokeMethod(networkWorker, [network = networkWorker]() {
+        network->fetchForecast();
+    });
+}
+
+void MainWindow::onForecastFetched(const ForecastFetchResult &result)
+{
+    forecastRequestPending = false;
+
+    static MetricHistogram &fetchSeconds = weatherFetchHistogram("forecast");
+    static MetricCounter &failures = weatherFailureCounter("forecast");
+    fetchSeconds.observe(result.seconds);
+
+    if (!result.ok) {
+        qDebug() << "预报获取失败:" << result.error << "，继续使用已有的空调计划";
+        failures.inc();
         return;
     }
-    
-    qDebug() << "JSON解析成功";
-    
-    // 提取天气信息
-    QJsonObject jsonObj = jsonDoc.object();
-    
-    // 检查API返回的状态码
-    if (jsonObj.contains("code")) {
-        QString code = jsonObj["code"].toString();
-        if (code != "200") {
-            qDebug() << "和风天气API返回错误:" << code;
-            
-            // API返回错误时，不更新天气信息，保持原来的数据
-            weatherReply->deleteLater();
-            weatherReply = nullptr;
-            return;
-        }
+    applyForecast(result.forecast);
+}
+
+// 增量更新空调计划
+void MainWindow::applyForecast(const QVector<HourlyForecast> &forecast)
+{
+    if (forecast.isEmpty()) {
+        qDebug() << "预报中没有有效的逐小时数据";
+        return;
     }
-    
-    // 尝试解析天气数据
-    if (!parseWeatherData(jsonObj)) {
-        // 如果无法解析数据，不更新天气信息，保持原来的数据
-        qDebug() << "无法解析天气数据，保持原来的信息";
+
+    acPlanner.updateForecast(forecast);
+    // 计划变化后重新计算预调温的开机时间
+    updatePreconditioning();
+}
+
+void MainWindow::recordWeatherSuccess()
+{
+    weatherBreaker.recordSuccess();
+    weatherBackoff.reset();
+    weatherRetryTimer->stop();
+}
+
+// 根据最近的温度变化和在家状态调整天气轮询间隔
+void MainWindow::rescheduleWeatherPolling(bool newObservation)
+{
+    if (newObservation && isOutsideTemperatureUsable()) {
+        weatherPollPolicy.recordObservation(outsideTemperature);
     }
-    
-    weatherReply->deleteLater();
-    weatherReply = nullptr;
+
+    int intervalMs = weatherPollPolicy.nextIntervalMs();
+    if (weatherUpdateTimer->interval() != intervalMs || !weatherUpdateTimer->isActive()) {
+        qDebug() << "天气轮询间隔调整为" << intervalMs / 60000 << "分钟";
+    }
+    weatherUpdateTimer->start(intervalMs);
+}
+
+// 天气请求失败：按指数退避安排重试，连续失败过多时由熔断器暂停请求
+void MainWindow::handleWeatherFailure()
+{
+    static MetricCounter &failures = weatherFailureCounter("now");
+    failures.inc();
+    weatherBreaker.recordFailure();
+
+    int retryDelayMs = 0;
+    if (weatherBreaker.state() == CircuitBreaker::Open) {
+        retryDelayMs = int(weatherBreaker.remainingCooldownMs());
+        qDebug() << "天气请求连续失败，熔断" << retryDelayMs / 1000 << "秒";
+    } else {
+        retryDelayMs = weatherBackoff.nextDelayMs();
+        qDebug() << "天气请求失败，第" << weatherBackoff.attempts() << "次重试将在" << retryDelayMs / 1000 << "秒后进行";
+    }
+    weatherRetryTimer->start(retryDelayMs);
 }
 
 // 解析天气数据的函数
 bool MainWindow::parseWeatherData(const QJsonObject& jsonObj)
 {
+    static MetricHistogram &refreshSeconds = uiRefreshHistogram("weather");
+    MetricTimer refreshTimer(refreshSeconds);
+
     qDebug() << "开始解析天气数据";
     
     if (jsonObj.contains("now")) {
@@ -354,6 +686,9 @@ bool MainWindow::parseWeatherData(const QJsonObject& jsonObj)
                 QString temp = nowObj["temp"].toString();
                 qDebug()<<temp;
                 outsideTemperature = temp.toInt();  // 更新室外温度
+                postToController([controller = homeController, value = outsideTemperature]() {
+                    controller->setSensorInput("sensor.outside", value);
+                });
                 QString tempString = temp + "°C";
                 QString insideTemp = QString::number(temp.toInt()+3);//模拟室内温度比室外高3度
                 qDebug() << "更新温度:" << tempString << "室外温度已更新为:" << outsideTemperature << "°C";
@@ -380,370 +715,398 @@ bool MainWindow::parseWeatherData(const QJsonObject& jsonObj)
     return true;
 }
 
-bool MainWindow::initDatabase()
+// 把每次获取到的室外温度和模拟的室内温度写入温度时间序列；模拟的室温只用于估计当前室温，不参与热模型拟合
+void MainWindow::recordTemperatureReadings(const QJsonObject &jsonObj)
 {
-    // 检查是否已经存在默认连接
-    if (db.isOpen()) {
-        qDebug() << "数据库已经打开";
-        return true;
+    if (!databaseReady) {
+        return;
     }
-    
-    // 如果已经存在名为"qt_sql_default_connection"的连接，直接使用它
-    if (QSqlDatabase::contains("qt_sql_default_connection")) {
-        db = QSqlDatabase::database("qt_sql_default_connection");
-    } else {
-        // 创建新的数据库连接
-        db = QSqlDatabase::addDatabase("QSQLITE");
-        db.setDatabaseName("C:/Users/Daisy/Desktop/QtCode/QtLab-FinalProject/finalprojectDB.db");
+
+    bool ok = false;
+    int temp = jsonObj["now"].toObject()["temp"].toString().toInt(&ok);
+    if (!ok) {
+        return;
     }
 
-    if (!db.isOpen()) {
-        if (!db.open()) {
-            qDebug() << "数据库打开失败:" << db.lastError().text();
-            return false;
-        }
+    QDateTime now = QDateTime::currentDateTime();
+    QMetaObject::invokeMethod(storage, [worker = storage, temp, now]() {
+        worker->appendReading(SensorStore::OutsideRoom, "weather", temp, now);
+        // 没有室内传感器，模拟室内温度比室外高3度
+        worker->appendReading("Livingroom", SensorStore::SimulatedSource, temp + 3, now);
+        worker->appendReading("Bedroom", SensorStore::SimulatedSource, temp + 3, now);
+    });
+}
+
+void MainWindow::loadWeatherCache()
+{
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    weatherCache.setFilePath(cacheDir + "/weather_cache.json");
+
+    if (weatherCache.load()) {
+        showCachedWeather();
     }
-    qDebug() << "数据库打开成功";
-    return true;
 }
-/**
- * @brief 记录设备操作到数据库的 device_history 表
- * @param deviceId 设备的唯一ID (例如: "light_livingroom")
- * @param actionType 操作类型 (例如: "toggle", "turn_on", "turn_off", "set_temperature")
- * @param actionValue 操作的值 (例如: "on", "off", "24")
- */
-void MainWindow::writeDeviceHistory(const QString &deviceId, const QString &actionType, const QString &actionValue)
+
+void MainWindow::showCachedWeather()
 {
-    if (!db.isOpen()) {
-        qWarning() << "数据库未打开，无法记录设备历史。";
+    if (!weatherCache.hasObservation()) {
         return;
     }
 
-    QSqlQuery query;
-    // 使用 ? 占位符防止SQL注入
-    QString insertSql = R"(
-        INSERT INTO device_history (device_id, action_type, action_value, timestamp)
-        VALUES (?, ?, ?, CURRENT_TIMESTAMP)
-    )";
-    query.prepare(insertSql);
-
-    query.addBindValue(deviceId);
-    query.addBindValue(actionType);
-    query.addBindValue(actionValue);
+    parseWeatherData(weatherCache.observation());
 
-    if (!query.exec()) {
-        // 记录失败时打印详细错误，方便调试
-        qCritical() << "记录设备历史失败 for device" << deviceId
-                    << "Action:" << actionType
-                    << "Error:" << query.lastError().text();
-    } else {
-        qDebug() << "成功记录设备历史:" << deviceId << "-" << actionType << ":" << actionValue;
+    // 非新鲜数据在状态栏上标注获取时间，提示用户这是旧数据
+    if (weatherCache.freshness() != WeatherCache::Fresh) {
+        QString fetchedTime = weatherCache.fetchedAt().toString("hh:mm");
+        statusWeatherLabel.setText(statusWeatherLabel.text() + QString("(缓存 %1)").arg(fetchedTime));
     }
 }
 
-void MainWindow::updateDeviceStatus(const QString &deviceId, const QString &name, const QString &type, const QString &status)
+// 室外温度是否可以用于智能空调判断：从未获取过或缓存已过期时不可用
+bool MainWindow::isOutsideTemperatureUsable() const
 {
-    if (!db.isOpen()) {
-        qWarning() << "数据库未打开，无法更新设备状态。";
-        return;
-    }
-    QSqlQuery query;
+    return weatherCache.isUsableForSmartControl();
+}
 
-       // 构建需要更新的字段列表（只处理非空值）
-       QStringList updateFields;
-       if (!name.isEmpty()) {
-           updateFields << "name = ?";
-       }
-       if (!type.isEmpty()) {
-           updateFields << "type = ?";
-       }
-       if (!status.isEmpty()) {
-           updateFields << "status = ?";
-       }
+// 转发给控制线程的其它操作先结束当前一批开关操作：之前提交的开关操作先于它处理，之后的排在它后面
+template <typename Function>
+void MainWindow::postToController(Function function)
+{
+    homeController->closeCommandBatch();
+    QMetaObject::invokeMethod(homeController, std::move(function));
+}
 
-       // 无更新字段则直接返回
-       if (updateFields.isEmpty()) {
-           qDebug() << "无需要更新的设备字段，跳过更新";
-           return;
-       }
+void MainWindow::writeSceneHistory(const QString &sceneId)
+{
+    // 控制线程触发场景的规则事件，scene_history 由存储线程写入；
+    // 新场景取消上一个场景还在等待的序列，再开始本场景的延时步骤
+    QDateTime at = QDateTime::currentDateTime();
+    postToController([controller = homeController, sequencer = sceneSequencer, sceneId, at]() {
+        controller->recordSceneRun(sceneId, at);
+        sequencer->startScene(sceneId);
+    });
+}
 
-       // 拼接更新SQL
-       QString updateSql = QString("UPDATE devices SET %1 WHERE device_id = ?").arg(updateFields.join(", "));
-       query.prepare(updateSql);
 
-       // 按顺序绑定更新字段的值
-       int bindIndex = 0;
-       if (!name.isEmpty()) {
-           query.addBindValue(name);
-           bindIndex++;
-       }
-       if (!type.isEmpty()) {
-           query.addBindValue(type);
-           bindIndex++;
-       }
-       if (!status.isEmpty()) {
-           query.addBindValue(status);
-           bindIndex++;
-       }
 
-       // 绑定设备ID（WHERE条件）
-       query.addBindValue(deviceId);
-
-       // 执行更新并处理结果
-       if (!query.exec()) {
-           qCritical() << "更新设备状态失败 for device" << deviceId
-                       << "Error:" << query.lastError().text();
-       } else {
-           if (query.numRowsAffected() > 0) {
-               qDebug() << "成功更新设备状态:" << deviceId << "→ 状态：" << status;
-           } else {
-               qDebug() << "设备状态未变化（或设备不存在）:" << deviceId;
-           }
-       }
+// 设备开关的界面部分：灯、窗帘和空调的开关状态显示在按钮上；门锁的状态显示在主页面的标签上
+
+static void showPowerButton(QPushButton *button, bool on)
+{
+    button->setText(on ? OnText : OffText);
+    button->setStyleSheet(on ? ActiveButtonStyle : QString());
 }
 
-void MainWindow::populateDefaultDevices()
+template <>
+bool MainWindow::isDeviceOn<DeviceKind::Light>(const CustomSceneTarget &target) const
 {
-    if (!db.isOpen()) {
-        qCritical() << "数据库未打开，无法插入默认设备。";
-        return;
+    return lightStates.value(target.button);
+}
+
+template <>
+void MainWindow::showDevicePower<DeviceKind::Light>(const CustomSceneTarget &target, bool on)
+{
+    lightStates[target.button] = on;
+    showPowerButton(target.button, on);
+    lightsOnCount += on ? 1 : -1;
+    updateMainPageLightStatus();
+}
+
+template <>
+bool MainWindow::isDeviceOn<DeviceKind::Curtain>(const CustomSceneTarget &target) const
+{
+    return curtainStates.value(target.button);
+}
+
+template <>
+void MainWindow::showDevicePower<DeviceKind::Curtain>(const CustomSceneTarget &target, bool on)
+{
+    curtainStates[target.button] = on;
+    showPowerButton(target.button, on);
+    curtainsOpenCount += on ? 1 : -1;
+    updateMainPageCurtainStatus();
+}
+
+template <>
+bool MainWindow::isDeviceOn<DeviceKind::AirConditioner>(const CustomSceneTarget &target) const
+{
+    return target.button->text() == OnText;
+}
+
+template <>
+void MainWindow::showDevicePower<DeviceKind::AirConditioner>(const CustomSceneTarget &target, bool on)
+{
+    showPowerButton(target.button, on);
+    target.modeBox->setEnabled(on);
+    target.temperatureBox->setEnabled(on);
+}
+
+template <>
+bool MainWindow::isDeviceOn<DeviceKind::Lock>(const CustomSceneTarget &) const
+{
+    return ui->Locklabel->text() == QStringLiteral("已锁门");
+}
+
+template <>
+void MainWindow::showDevicePower<DeviceKind::Lock>(const CustomSceneTarget &, bool on)
+{
+    ui->Locklabel->setText(on ? QStringLiteral("已锁门") : QStringLiteral("未锁门"));
+}
+
+// 所有类型的开关都经过这里：状态变化时更新界面，每次操作都提交给控制线程记录历史并更新设备状态。
+// 提交的记录只有设备目录下标和操作类型，不复制字符串；同一批操作只唤醒一次控制线程
+template <DeviceKind Kind>
+void MainWindow::setDevicePower(const CustomSceneTarget &target, bool on, PowerCommand::Action action)
+{
+    constexpr const DeviceTypeTraits &traits = DeviceTraits<Kind>::value;
+    if (isDeviceOn<Kind>(target) != on) {
+        showDevicePower<Kind>(target, on);
+        scheduleSnapshot();
+        qCDebug(lcControl) << traits.name << target.deviceId << "新状态:" << (on ? traits.onValue : traits.offValue);
+    } else {
+        qCDebug(lcControl) << traits.name << target.deviceId << "已经是该状态:" << (on ? traits.onValue : traits.offValue);
     }
 
-    QString currentTime = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-    const QList<QVariantMap> defaultDevices = {
-        // 灯光设备
-        {
-            {"device_id", "LivingroomLight"},
-            {"name", "客厅灯"},
-            {"type", "light"},
-            {"status", "off"},
-            {"created_at", currentTime}
-        },
-        {
-            {"device_id", "KitchenLight"},
-            {"name", "厨房灯"},
-            {"type", "light"},
-            {"status", "off"},
-            {"created_at", currentTime}
-        },
-        {
-            {"device_id", "BedroomLight"},
-            {"name", "卧室灯"},
-            {"type", "light"},
-            {"status", "off"},
-            {"created_at", currentTime}
-        },
-        {
-            {"device_id", "BathroomLight"},
-            {"name", "浴室灯"},
-            {"type", "light"},
-            {"status", "off"},
-            {"created_at", currentTime}
-        },
-        {
-            {"device_id", "StudyroomLight"},
-            {"name", "书房灯"},
-            {"type", "light"},
-            {"status", "off"},
-            {"created_at", currentTime}
-        },
-        {
-            {"device_id", "BalconyLight"},
-            {"name", "阳台灯"},
-            {"type", "light"},
-            {"status", "off"},
-            {"created_at", currentTime}
-        },
-        {
-            {"device_id", "DiningroomLight"},
-            {"name", "餐厅灯"},
-            {"type", "light"},
-            {"status", "off"},
-            {"created_at", currentTime}
-        },
-
-        // 空调设备
-        {
-            {"device_id", "LivingroomAc"},
-            {"name", "客厅空调"},
-            {"type", "air_conditioner"},
-            {"status", "off"},
-            {"created_at", currentTime}
-        },
-        {
-            {"device_id", "BedroomAc"},
-            {"name", "卧室空调"},
-            {"type", "air_conditioner"},
-            {"status", "off"},
-            {"created_at", currentTime}
-        },
-
-        // 窗帘设备
-        {
-            {"device_id", "LivingroomCurtain"},
-            {"name", "客厅窗帘"},
-            {"type", "curtain"},
-            {"status", "off"},
-            {"created_at", currentTime}
-        },
-        {
-            {"device_id", "BedroomCurtain"},
-            {"name", "卧室窗帘"},
-            {"type", "curtain"},
-            {"status", "off"},
-            {"created_at", currentTime}
-        },
-
-        // 锁设备
-        {
-            {"device_id", "Lock"},
-            {"name", "门锁"},
-            {"type", "lock"},
-            {"status", "unlocked"},
-            {"created_at", currentTime}
-        }
-    };
+    PowerCommand command;
+    command.device = target.catalogIndex;
+    command.action = action;
+    command.on = on;
+    command.atMSecs = QDateTime::currentMSecsSinceEpoch();
+    homeController->submitPowerCommand(command);
+}
 
-    // 事务包裹批量插入
-    db.transaction();
-    QSqlQuery query;
-    QString insertSql = R"(
-        INSERT OR IGNORE INTO devices (device_id, name, type, status, created_at)
-        VALUES (?, ?, ?, ?, ?)
-    )";
-
-    int insertedCount = 0;
-    for (const auto& device : defaultDevices) {
-        // 1. 每次循环都重置查询对象，清空之前的绑定参数
-        query.clear();
-        // 2. 重新准备SQL语句（每次循环都要做）
-        if (!query.prepare(insertSql)) {
-            qWarning() << "准备SQL失败:" << query.lastError().text();
-            continue;
-        }
+template <DeviceKind Kind>
+void MainWindow::toggleDevicePower(const CustomSceneTarget &target)
+{
+    setDevicePower<Kind>(target, !isDeviceOn<Kind>(target), PowerCommand::Toggle);
+}
 
-        // 绑定参数（显式转QString，避免空值问题）
-        query.addBindValue(device["device_id"].toString());
-        query.addBindValue(device["name"].toString());
-        query.addBindValue(device["type"].toString());
-        query.addBindValue(device["status"].toString());
-        query.addBindValue(device["created_at"].toString());
-
-        // 执行插入
-        if (query.exec()) {
-            if (query.numRowsAffected() > 0) {
-                insertedCount++;
-                qDebug() << "成功插入设备:" << device["device_id"].toString();
-            } else {
-                qDebug() << "设备已存在，跳过插入:" << device["device_id"].toString();
+// 规则和场景序列的命令：power（门锁为 lock）开关设备，mode 和 temperature 只对有相应能力的类型有效
+template <DeviceKind Kind>
+bool MainWindow::applyDeviceCommand(const CustomSceneTarget &target, const RuleAction &action)
+{
+    constexpr const DeviceTypeTraits &traits = DeviceTraits<Kind>::value;
+    if (action.command == QLatin1String(traits.powerCommand)) {
+        // 值无法识别时不动作（例如门锁的 "false" 不能当作上锁）
+        bool on = false;
+        if (!parsePowerValue(traits, action.value, &on)) {
+            qWarning() << "规则" << action.ruleId << "的开关值无效:" << action.deviceId << action.value;
+            return false;
+        }
+        setDevicePower<Kind>(target, on, on ? PowerCommand::TurnOn : PowerCommand::TurnOff);
+        return true;
+    }
+    if constexpr (DeviceTraits<Kind>::value.hasMode) {
+        if (action.command == QLatin1String("mode")) {
+            // 下拉框中没有的模式不改变当前选择
+            if (target.modeBox->findText(action.value) < 0) {
+                qWarning() << "规则" << action.ruleId << "指定的模式不存在:" << action.deviceId << action.value;
+                return false;
             }
-        } else {
-            qWarning() << "插入设备失败:" << device["device_id"].toString()
-                       << "原因:" << query.lastError().text();
+            target.modeBox->setCurrentText(action.value);
+            return true;
         }
     }
-
-    // 提交事务
-    if (db.commit()) {
-        qDebug() << "默认设备检查完成。本次新插入" << insertedCount << "个设备。";
-    } else {
-        qCritical() << "提交设备插入事务失败:" << db.lastError().text();
-        db.rollback(); // 事务失败时回滚
+    if constexpr (DeviceTraits<Kind>::value.hasSetpoint) {
+        if (action.command == QLatin1String("temperature")) {
+            // 超出范围的设定值（例如室外温度加偏移）截到界面可选的范围内
+            int setpoint = qBound(traits.minSetpoint, qRound(action.value.toDouble()), traits.maxSetpoint);
+            target.temperatureBox->setCurrentText(QString::number(setpoint));
+            return true;
+        }
     }
+    qWarning() << "规则" << action.ruleId << "的命令无法执行:" << action.deviceId << action.command;
+    return false;
+}
+
+void MainWindow::setTargetPower(const CustomSceneTarget &target, bool on, PowerCommand::Action action)
+{
+    // 下标为 DeviceKind，编译期生成每种类型的实现
+    using PowerHandler = void (MainWindow::*)(const CustomSceneTarget &, bool, PowerCommand::Action);
+    static constexpr PowerHandler handlers[DeviceKindCount] = {
+        &MainWindow::setDevicePower<DeviceKind::Light>,
+        &MainWindow::setDevicePower<DeviceKind::Curtain>,
+        &MainWindow::setDevicePower<DeviceKind::AirConditioner>,
+        &MainWindow::setDevicePower<DeviceKind::Lock>
+    };
+    (this->*handlers[int(target.kind)])(target, on, action);
+}
+
+bool MainWindow::isTargetOn(const CustomSceneTarget &target) const
+{
+    using StateHandler = bool (MainWindow::*)(const CustomSceneTarget &) const;
+    static constexpr StateHandler handlers[DeviceKindCount] = {
+        &MainWindow::isDeviceOn<DeviceKind::Light>,
+        &MainWindow::isDeviceOn<DeviceKind::Curtain>,
+        &MainWindow::isDeviceOn<DeviceKind::AirConditioner>,
+        &MainWindow::isDeviceOn<DeviceKind::Lock>
+    };
+    return (this->*handlers[int(target.kind)])(target);
+}
+
+// 只改变界面显示，不记录历史（恢复快照时使用）
+void MainWindow::showTargetPower(const CustomSceneTarget &target, bool on)
+{
+    using ShowHandler = void (MainWindow::*)(const CustomSceneTarget &, bool);
+    static constexpr ShowHandler handlers[DeviceKindCount] = {
+        &MainWindow::showDevicePower<DeviceKind::Light>,
+        &MainWindow::showDevicePower<DeviceKind::Curtain>,
+        &MainWindow::showDevicePower<DeviceKind::AirConditioner>,
+        &MainWindow::showDevicePower<DeviceKind::Lock>
+    };
+    (this->*handlers[int(target.kind)])(target, on);
 }
 
-void MainWindow::populateDefaultScenes()
+void MainWindow::setPowerByButton(DeviceKind kind, QPushButton *button, bool on, PowerCommand::Action action)
 {
-    if (!db.isOpen()) {
-        qCritical() << "数据库未打开，无法插入默认场景。";
+    const CustomSceneTarget *target = deviceTarget(button);
+    if (!target || target->kind != kind) {
+        qCDebug(lcControl) << "错误：无效的" << deviceTraits(kind).name << "按钮";
         return;
     }
-    QString currentTime = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-    // 默认场景列表（scene_id + 场景名称）
-    const QList<QVariantMap> defaultScenes = {
-        {{"scene_id", "comingHomeMode"}, {"name", "回家模式"}, {"created_at", currentTime}},
-        {{"scene_id", "leavingHomeMode"}, {"name", "离家模式"}, {"created_at", currentTime}},
-        {{"scene_id", "SleepMode"}, {"name", "睡眠模式"}, {"created_at", currentTime}},
-        {{"scene_id", "WakeUpMode"}, {"name", "起床模式"}, {"created_at", currentTime}}
+    setTargetPower(*target, on, action);
+}
+
+void MainWindow::togglePowerByButton(DeviceKind kind, QPushButton *button)
+{
+    using ToggleHandler = void (MainWindow::*)(const CustomSceneTarget &);
+    static constexpr ToggleHandler handlers[DeviceKindCount] = {
+        &MainWindow::toggleDevicePower<DeviceKind::Light>,
+        &MainWindow::toggleDevicePower<DeviceKind::Curtain>,
+        &MainWindow::toggleDevicePower<DeviceKind::AirConditioner>,
+        &MainWindow::toggleDevicePower<DeviceKind::Lock>
     };
-    db.transaction();
-        QSqlQuery query;
-        QString insertSql = R"(
-            INSERT OR IGNORE INTO scenes (scene_id, name, created_at)
-            VALUES (?, ?, ?)
-        )";
-
-        int insertedCount = 0;
-        for (const auto& scene : defaultScenes) {
-            query.clear();
-            if (!query.prepare(insertSql)) {
-                qWarning() << "准备场景SQL失败:" << query.lastError().text();
-                continue;
-            }
 
-            query.addBindValue(scene["scene_id"].toString());
-            query.addBindValue(scene["name"].toString());
-            query.addBindValue(scene["created_at"].toString());
+    const CustomSceneTarget *target = deviceTarget(button);
+    if (!target || target->kind != kind) {
+        qCDebug(lcControl) << "错误：无效的" << deviceTraits(kind).name << "按钮";
+        return;
+    }
+    (this->*handlers[int(kind)])(*target);
+}
 
-            if (query.exec()) {
-                if (query.numRowsAffected() > 0) {
-                    insertedCount++;
-                    qDebug() << "成功插入场景:" << scene["scene_id"].toString();
-                } else {
-                    qDebug() << "场景已存在，跳过插入:" << scene["scene_id"].toString();
-                }
-            } else {
-                qWarning() << "插入场景失败:" << scene["scene_id"].toString()
-                           << "原因:" << query.lastError().text();
-            }
-        }
+// 找不到时返回 nullptr
+const MainWindow::CustomSceneTarget *MainWindow::deviceTarget(QPushButton *button) const
+{
+    return buttonTargets.value(button, nullptr);
+}
 
-        if (db.commit()) {
-            qDebug() << "默认场景检查完成。本次新插入" << insertedCount << "个场景。";
-        } else {
-            qCritical() << "提交场景插入事务失败:" << db.lastError().text();
-            db.rollback();
-        }
+const MainWindow::CustomSceneTarget *MainWindow::deviceTarget(const QString &deviceId) const
+{
+    auto it = deviceTargets.constFind(deviceId);
+    return it != deviceTargets.constEnd() ? &it.value() : nullptr;
 }
 
-void MainWindow::writeSceneHistory(const QString &sceneId)
+// 没有快照或快照损坏时返回 false，所有设备按数据库中的历史记录恢复
+bool MainWindow::readSnapshot(HomeSnapshot *snapshot) const
 {
-    if (!db.isOpen()) {
-        qWarning() << "数据库未打开，无法记录场景历史。";
-        return;
+    if (!QFile::exists(snapshotPath)) {
+        return false;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    QString errorMessage;
+    if (!HomeSnapshot::readFile(snapshotPath, snapshot, &errorMessage)) {
+        qWarning() << "状态快照无法读取，设备状态按数据库恢复:" << snapshotPath << errorMessage;
+        return false;
+    }
+    qDebug() << "已读入状态快照:" << snapshotPath << "保存时间:" << snapshot->savedAt
+             << "耗时(毫秒):" << timer.nsecsElapsed() / 1e6;
+    return true;
+}
+
+// 按快照恢复界面，不记录历史
+void MainWindow::restoreSnapshot(const HomeSnapshot &snapshot)
+{
+    historySequence = snapshot.historySequence;
+
+    for (const DeviceState &device : qAsConst(snapshot.devices)) {
+        const CustomSceneTarget *target = deviceTarget(device.deviceId);
+        if (!target) {
+            continue;  // 设备目录中已经没有这个设备
+        }
+        if (target->modeBox && !device.mode.isEmpty()) {
+            target->modeBox->setCurrentText(device.mode);
+            target->temperatureBox->setCurrentText(QString::number(device.temperature));
+        }
+        if (isTargetOn(*target) != device.on) {
+            showTargetPower(*target, device.on);
+        }
     }
 
-    // 关键1：每次都新建QSqlQuery对象，绝对避免参数累积
-    QSqlQuery query(db); // 显式关联数据库连接，更稳定
-    QString insertSql = "INSERT INTO scene_history (scene_id,timestamp) VALUES (?,?)";
+    QPushButton *sceneButtons[] = { ui->UserDefinedMode1Button, ui->UserDefinedMode2Button };
+    QString *sceneNames[] = { &customScene1Name, &customScene2Name };
+    QMap<QString, int> *sceneDevices[] = { &customScene1Devices, &customScene2Devices };
+    for (int i = 0; i < qMin(2, snapshot.customScenes.size()); ++i) {
+        const CustomSceneSnapshot &scene = snapshot.customScenes.at(i);
+        if (scene.name.isEmpty()) {
+            continue;
+        }
+        *sceneNames[i] = scene.name;
+        *sceneDevices[i] = scene.devices;
+        sceneButtons[i]->setText(scene.name);
+        sceneButtons[i]->setEnabled(true);
+    }
 
-    // 关键2：先clear，再prepare，确保无残留
-    query.clear();
-    if (!query.prepare(insertSql)) {
-        qCritical() << "准备场景日志SQL失败:" << query.lastError().text();
-        return;
+    // 数据库打开后再补充快照之后新增的任务
+    schedulesFromSnapshot = true;
+    for (const ScheduleJob &job : qAsConst(snapshot.schedules)) {
+        snapshotJobIds.append(job.id);
     }
+    restoreSchedules(snapshot.schedules);
+}
 
-    // 关键3：显式转QString，排除空值/类型问题
-    QString sceneIdClean = sceneId.trimmed(); // 去除首尾空格
-    if (sceneIdClean.isEmpty()) {
-        qCritical() << "场景ID为空，无法记录日志";
-        return;
+HomeSnapshot MainWindow::captureSnapshot() const
+{
+    HomeSnapshot snapshot;
+    snapshot.savedAt = QDateTime::currentDateTime();
+    snapshot.historySequence = historySequence;
+    snapshot.devices.reserve(deviceTargets.size());
+    for (const CustomSceneTarget &target : deviceTargets) {
+        DeviceState device;
+        device.deviceId = target.deviceId;
+        device.on = isTargetOn(target);
+        if (target.modeBox) {
+            device.mode = target.modeBox->currentText();
+            device.temperature = target.temperatureBox->currentText().toInt();
+        }
+        snapshot.devices.append(device);
     }
-    query.addBindValue(sceneIdClean);
-    QString currentTime = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-    query.addBindValue(currentTime);
+    snapshot.customScenes = {
+        { customScene1Name, customScene1Devices },
+        { customScene2Name, customScene2Devices }
+    };
+    snapshot.schedules = sceneScheduler->jobs();
+    return snapshot;
+}
 
-    // 执行并反馈
-    if (!query.exec()) {
-        qCritical() << "记录场景历史失败 for scene" << sceneId
-                    << "Error:" << query.lastError().text();
-    } else {
-        qDebug() << "成功记录场景历史:" << sceneId;
+// 状态变化后调用；已在等待时不重新计时，连续操作最多延迟 SnapshotDelayMs 写入一次
+void MainWindow::scheduleSnapshot()
+{
+    if (!snapshotTimer->isActive()) {
+        snapshotTimer->start();
     }
 }
 
+// 提交的设备记录都来自界面上已经发生的操作，这个序号之前的记录都已反映在界面状态中。
+// 每批提交后更新快照，即使设备状态没有变化（重复的开关命令），回放的记录也不会累积
+void MainWindow::onHistoryCommitted(qint64 sequence)
+{
+    historySequence = sequence;
+    scheduleSnapshot();
+}
 
+// 在界面线程中取得状态并序列化（只有几百字节），文件写入交给存储线程
+void MainWindow::saveSnapshot()
+{
+    QByteArray data = captureSnapshot().serialize();
+    QMetaObject::invokeMethod(storage, [path = snapshotPath, data]() {
+        QString errorMessage;
+        if (!HomeSnapshot::writeFile(path, data, &errorMessage)) {
+            qWarning() << "写入状态快照失败:" << path << errorMessage;
+        }
+    });
+}
 
 void MainWindow::onNetworkError(QNetworkReply::NetworkError error)
 {
@@ -782,16 +1145,14 @@ void MainWindow::on_CurtainButton_clicked()
 
 void MainWindow::on_LockButton_clicked()
 {
-    if(ui->Locklabel->text() == "未锁门")
-    {
-        ui->Locklabel->setText("已锁门");
-        writeDeviceHistory("Lock","lock","locked");
-        updateDeviceStatus("Lock","","","locked");
-    }
+    setPowerByButton(DeviceKind::Lock, ui->LockButton, true, PowerCommand::Lock);
 }
 
 void MainWindow::on_comingHomeModeButton_clicked()
 {
+    static MetricHistogram &sceneSeconds = sceneDurationHistogram("comingHomeMode");
+    MetricTimer sceneTimer(sceneSeconds);
+
     qDebug() << "执行回家模式";
     qDebug() << "当前室外温度:" << outsideTemperature << "°C";
     
@@ -808,109 +1169,198 @@ void MainWindow::on_comingHomeModeButton_clicked()
     // 3. 根据室外温度智能控制空调
     qDebug() << "检查是否需要打开空调";
     turnOnAirConditionerWithSmartControl();
-    writeSceneHistory("comingHomeMode");
+    writeSceneHistory(QStringLiteral("comingHomeMode"));
+
+    // 有人在家，恢复正常的天气轮询频率
+    weatherPollPolicy.setAway(false);
+    rescheduleWeatherPolling(false);
+    updatePreconditioning();
 }
 
-void MainWindow::turnOnLight(QPushButton* lightButton)
-{
-    // 验证按钮有效性
-    if (!lightButton) {
-        qDebug() << "错误：无效的灯光按钮";
+void MainWindow::turnOnLight(QPushButton* lightButton)
+{
+    setPowerByButton(DeviceKind::Light, lightButton, true, PowerCommand::TurnOn);
+}
+
+void MainWindow::turnOffCurtain(QPushButton* curtainButton)
+{
+    setPowerByButton(DeviceKind::Curtain, curtainButton, false, PowerCommand::TurnOff);
+}
+
+// 查询当前小时的空调计划；还没有预报计划时用实况温度临时计算
+bool MainWindow::currentAcPlan(AcPlanner::Room room, AcPlanEntry *entry) const
+{
+    QDateTime now = QDateTime::currentDateTime();
+    if (acPlanner.lookup(room, now, entry)) {
+        qDebug() << "使用预先计算的空调计划，预报室外温度:" << entry->outsideTemp << "°C";
+        return true;
+    }
+
+    // 没有可靠的室外温度时不做判断，避免用过期数据开错模式
+    if (!isOutsideTemperatureUsable()) {
+        return false;
+    }
+    *entry = acPlanner.computeEntry(room, AcPlanner::truncateToHour(now), outsideTemperature);
+    return true;
+}
+
+void MainWindow::turnOnAirConditionerWithSmartControl()
+{
+    AcPlanEntry plan;
+    if (!currentAcPlan(AcPlanner::Livingroom, &plan)) {
+        qDebug() << "室外温度数据缺失或已过期，不开空调";
+        return;
+    }
+
+    // 规则没有要求开空调
+    if (!plan.turnOn) {
+        qDebug() << "室外温度" << plan.outsideTemp << "°C，规则判断不需要开空调";
         return;
     }
     
-    // 获取当前灯光状态
-    bool isOn = lightStates[lightButton];
+    qDebug() << "室外温度:" << plan.outsideTemp << "°C，需要开启空调";
     
-    if (!isOn) {
-        // 如果灯是关闭的，打开它
-        lightStates[lightButton] = true;
-        lightButton->setText("开");
-        lightButton->setStyleSheet("background-color: #FFD700; color: black; font-weight: bold;");
-        lightsOnCount++;
-        qDebug() << "开灯:" << lightButton->objectName() << "新状态:开" << "灯光数量:" << lightsOnCount;
-        updateMainPageLightStatus();
-    } else {
-        qDebug() << "灯已经是打开状态:" << lightButton->objectName();
-    }
+    applyAcPlanEntry(AcPlanner::Livingroom, plan);
+}
+
+// 按计划打开空调并设置模式和温度
+void MainWindow::applyAcPlanEntry(AcPlanner::Room room, const AcPlanEntry &plan)
+{
+    bool isLivingroom = (room == AcPlanner::Livingroom);
+    QPushButton *acButton = isLivingroom ? ui->LivingroomAcButton : ui->BedroomAcButton;
+    QComboBox *modeBox = isLivingroom ? ui->LivingroomAcModecomboBox : ui->BedroomAcModecomboBox;
+    QComboBox *temperatureBox = isLivingroom ? ui->LivingroomTemperaturecomboBox : ui->BedroomTemperaturecomboBox;
+
+    setPowerByButton(DeviceKind::AirConditioner, acButton, true, PowerCommand::TurnOn);
+    modeBox->setCurrentText(plan.mode);
+    temperatureBox->setCurrentText(QString::number(plan.targetTemp));
+    qDebug() << acButton->objectName() << plan.mode << "模式，温度设置为:" << plan.targetTemp << "°C";
+}
 
-    //记录灯光日志
-    QString deviceId = lightButton->objectName().replace("Button","");
-    //通常在场景模式中使用，使用turn_on与单独操作中的toggle区分
-    writeDeviceHistory(deviceId,"turn_on","on");
+// 空调模式和设定温度交给控制核心，能耗统计据此调整功率
+void MainWindow::updateAcSetting(AcPlanner::Room room)
+{
+    bool isLivingroom = (room == AcPlanner::Livingroom);
+    QString mode = (isLivingroom ? ui->LivingroomAcModecomboBox : ui->BedroomAcModecomboBox)->currentText();
+    int setpoint = (isLivingroom ? ui->LivingroomTemperaturecomboBox : ui->BedroomTemperaturecomboBox)->currentText().toInt();
+    QDateTime at = QDateTime::currentDateTime();
+    postToController([controller = homeController, room, mode, setpoint, at]() {
+        controller->setAcSetting(AcPlanner::acDeviceId(room), mode, setpoint, at);
+    });
+    scheduleSnapshot();
+}
 
+// 最近一次室温读数（随预调温的历史数据一起由存储线程读出）；没有读数时按室内比室外高3度估算
+double MainWindow::currentIndoorTemperature(AcPlanner::Room room)
+{
+    if (!qIsNaN(indoorTemperatures[room])) {
+        return indoorTemperatures[room];
+    }
+    return outsideTemperature + 3;
 }
 
-void MainWindow::turnOffCurtain(QPushButton* curtainButton)
+// 重新计算卧室（起床闹钟）和客厅（到家时间）的预调温开机时间；
+// 需要的历史数据由存储线程读出，结果回到界面线程后再安排定时器
+void MainWindow::updatePreconditioning()
 {
-    // 验证按钮有效性
-    if (!curtainButton) {
-        qDebug() << "错误：无效的窗帘按钮";
+    if (!databaseReady) {
+        applyPlanningInputs(PlanningInputs());
         return;
     }
-    
-    // 获取当前窗帘状态
-    bool isOpen = curtainStates[curtainButton];
-    
-    if (isOpen) {
-        // 如果窗帘是打开的，关闭它
-        curtainStates[curtainButton] = false;
-        curtainButton->setText("关");
-        curtainButton->setStyleSheet("");
-        curtainsOpenCount--;
-        qDebug() << "关窗帘:" << curtainButton->objectName() << "新状态:关" << "窗帘数量:" << curtainsOpenCount;
-        updateMainPageCurtainStatus();
-    } else {
-        qDebug() << "窗帘已经是关闭状态:" << curtainButton->objectName();
+
+    QDateTime now = QDateTime::currentDateTime();
+    // 热模型每天重新拟合一次；定时的回家场景优先，没有时离家期间才需要按历史记录预测到家时间
+    bool fitModels = !thermalModelsFittedAt.isValid() || thermalModelsFittedAt.secsTo(now) > 24 * 3600;
+    bool predictArrival = !sceneScheduler->nextFireTime("comingHomeMode").isValid() && weatherPollPolicy.isAway();
+    QMetaObject::invokeMethod(storage, [this, worker = storage, now, fitModels, predictArrival]() {
+        PlanningInputs inputs = worker->loadPlanningInputs(now, fitModels, predictArrival);
+        QMetaObject::invokeMethod(this, [this, inputs]() {
+            applyPlanningInputs(inputs);
+        });
+    });
+}
+
+void MainWindow::applyPlanningInputs(const PlanningInputs &inputs)
+{
+    if (inputs.modelsFitted) {
+        for (int room = 0; room < AcPlanner::RoomCount; ++room) {
+            thermalModels[room] = inputs.models[room];
+        }
+        thermalModelsFittedAt = inputs.at;
+    }
+    for (int room = 0; room < AcPlanner::RoomCount; ++room) {
+        indoorTemperatures[room] = inputs.indoor[room];
     }
-    //记录窗帘日志
-    QString deviceId = curtainButton->objectName().replace("Button","");
-    writeDeviceHistory(deviceId,"turn_off","close");
-    updateDeviceStatus(deviceId,"","","close");
+
+    QDateTime wakeTarget = wakeUpJobId != 0 ? sceneScheduler->job(wakeUpJobId).fireAt : QDateTime();
+    schedulePreconditioning(AcPlanner::Bedroom, wakeTarget);
+
+    QDateTime arrival = sceneScheduler->nextFireTime("comingHomeMode");
+    if (!arrival.isValid() && weatherPollPolicy.isAway()) {
+        arrival = inputs.predictedArrival;
+    }
+    schedulePreconditioning(AcPlanner::Livingroom, arrival);
 }
 
-void MainWindow::turnOnAirConditionerWithSmartControl()
+void MainWindow::schedulePreconditioning(AcPlanner::Room room, const QDateTime &target)
 {
-    // 根据室外温度判断是否需要开空调
-    // 15-26度之间不需要开空调
-    if (outsideTemperature > 15 && outsideTemperature < 26) {
-        qDebug() << "室外温度" << outsideTemperature << "°C 在15-26度之间，不开空调";
+    preconditionTimers[room]->stop();
+    preconditionTargets[room] = QDateTime();
+
+    QDateTime now = QDateTime::currentDateTime();
+    if (!target.isValid() || target <= now) {
         return;
     }
-    
-    // 室外温度>=26度或<=15度，需要开空调
-    qDebug() << "室外温度:" << outsideTemperature << "°C，需要开启空调";
-    
-    // 获取当前空调状态
-    QString status = ui->LivingroomAcButton->text();
-    
-    if (status == "关") {
-        // 开启客厅空调
-        ui->LivingroomAcButton->setText("开");
-        ui->LivingroomAcButton->setStyleSheet("background-color: #FFD700; color: black; font-weight: bold;");
-        ui->LivingroomAcModecomboBox->setEnabled(true);
-        ui->LivingroomTemperaturecomboBox->setEnabled(true);
-        qDebug() << "开空调:" << ui->LivingroomAcButton->objectName() << "新状态:开";
+
+    // 目标时刻的计划不需要开空调，或超出预报范围（下次预报更新时再算）
+    AcPlanEntry plan;
+    if (!acPlanner.lookup(room, target, &plan) || !plan.turnOn) {
+        return;
     }
-    
-    // 根据室外温度智能设置空调模式和温度
-    if (outsideTemperature >= 26) {
-        // 室外温度>=26度，设置制冷模式，温度比室外低2度
-        int targetTemp = outsideTemperature - 2;
-        ui->LivingroomAcModecomboBox->setCurrentText("制冷");
-        ui->LivingroomTemperaturecomboBox->setCurrentText(QString::number(targetTemp));
-        qDebug() << "制冷模式，温度设置为:" << targetTemp << "°C";
-    } else if (outsideTemperature <= 15) {
-        // 室外温度<=15度，设置制热模式，温度比室外高3度
-        int targetTemp = outsideTemperature + 3;
-        ui->LivingroomAcModecomboBox->setCurrentText("制热");
-        ui->LivingroomTemperaturecomboBox->setCurrentText(QString::number(targetTemp));
-        qDebug() << "制热模式，温度设置为:" << targetTemp << "°C";
+
+    const ThermalModel &model = thermalModels[room];
+    double indoor = currentIndoorTemperature(room);
+    int leadMinutes = model.leadMinutes(indoor, plan.outsideTemp, plan.targetTemp);
+    QDateTime start = target.addSecs(-leadMinutes * 60);
+
+    // 等待期间室温会自然向室外温度靠拢，按开机时的预测室温再算一次
+    if (start > now) {
+        double indoorAtStart = model.predict(indoor, plan.outsideTemp, false, false, now.secsTo(start) / 3600.0);
+        leadMinutes = model.leadMinutes(indoorAtStart, plan.outsideTemp, plan.targetTemp);
+        start = target.addSecs(-leadMinutes * 60);
+    }
+
+    if (leadMinutes == 0) {
+        qDebug() << AcPlanner::roomName(room) << "预计到时室温已接近目标，不需要预调温";
+        return;
     }
+
+    preconditionTargets[room] = target;
+    qint64 delayMs = qBound<qint64>(0, now.msecsTo(start), std::numeric_limits<int>::max());
+    preconditionTimers[room]->start(int(delayMs));
+    qDebug() << AcPlanner::roomName(room) << "预调温: 当前室温" << indoor << "°C，目标" << plan.targetTemp
+             << "°C，提前" << leadMinutes << "分钟于" << start.toString("MM-dd hh:mm") << "开空调";
+}
+
+void MainWindow::startPreconditioning(AcPlanner::Room room)
+{
+    QDateTime target = preconditionTargets[room];
+    preconditionTargets[room] = QDateTime();
+
+    AcPlanEntry plan;
+    if (!target.isValid() || !acPlanner.lookup(room, target, &plan) || !plan.turnOn) {
+        return;
+    }
+
+    qDebug() << "开始预调温:" << AcPlanner::roomName(room) << "目标时间" << target.toString("hh:mm");
+    applyAcPlanEntry(room, plan);
 }
 
 void MainWindow::on_leavingHomeModeButton_clicked()
 {
+    static MetricHistogram &sceneSeconds = sceneDurationHistogram("leavingHomeMode");
+    MetricTimer sceneTimer(sceneSeconds);
+
     qDebug() << "执行离家模式";
     
     // 1. 打开所有窗帘
@@ -931,79 +1381,43 @@ void MainWindow::on_leavingHomeModeButton_clicked()
     // 3. 关闭所有空调
     qDebug() << "关闭所有空调";
     turnOffAirConditioner();
-    writeSceneHistory("leavingHomeMode");
+    writeSceneHistory(QStringLiteral("leavingHomeMode"));
+
+    // 无人在家，降低天气轮询频率
+    weatherPollPolicy.setAway(true);
+    rescheduleWeatherPolling(false);
+    updatePreconditioning();
 }
 
 void MainWindow::turnOffLight(QPushButton* lightButton)
 {
-    if (!lightButton) {
-        qDebug() << "错误：无效的灯光按钮";
-        return;
-    }
-    
-    bool isOn = lightStates[lightButton];
-    
-    if (isOn) {
-        lightStates[lightButton] = false;
-        lightButton->setText("关");
-        lightButton->setStyleSheet("");
-        lightsOnCount--;
-        qDebug() << "关灯:" << lightButton->objectName() << "新状态:关" << "灯光数量:" << lightsOnCount;
-        updateMainPageLightStatus();
-    } else {
-        qDebug() << "灯已经是关闭状态:" << lightButton->objectName();
-    }
-    //记录灯光日志
-    QString deviceId = lightButton->objectName().replace("Button","");
-    //通常在场景模式中使用，使用turn_on与单独操作中的toggle区分
-    writeDeviceHistory(deviceId,"turn_off","off");
-
+    setPowerByButton(DeviceKind::Light, lightButton, false, PowerCommand::TurnOff);
 }
 
 void MainWindow::turnOnCurtain(QPushButton* curtainButton)
 {
-    if (!curtainButton) {
-        qDebug() << "错误：无效的窗帘按钮";
-        return;
-    }
-    
-    bool isOpen = curtainStates[curtainButton];
-    
-    if (!isOpen) {
-        curtainStates[curtainButton] = true;
-        curtainButton->setText("开");
-        curtainButton->setStyleSheet("background-color: #FFD700; color: black; font-weight: bold;");
-        curtainsOpenCount++;
-        qDebug() << "开窗帘:" << curtainButton->objectName() << "新状态:开" << "窗帘数量:" << curtainsOpenCount;
-        updateMainPageCurtainStatus();
-    } else {
-        qDebug() << "窗帘已经是打开状态:" << curtainButton->objectName();
-    }
+    setPowerByButton(DeviceKind::Curtain, curtainButton, true, PowerCommand::TurnOn);
 }
 
 void MainWindow::turnOffAirConditioner()
 {
-    // 关闭客厅空调
-    if (ui->LivingroomAcButton->text() == "开") {
-        ui->LivingroomAcButton->setText("关");
-        ui->LivingroomAcButton->setStyleSheet("");
-        ui->LivingroomAcModecomboBox->setEnabled(false);
-        ui->LivingroomTemperaturecomboBox->setEnabled(false);
-        qDebug() << "关空调:" << ui->LivingroomAcButton->objectName();
-    }
-    
-    // 关闭卧室空调
-    if (ui->BedroomAcButton->text() == "开") {
-        ui->BedroomAcButton->setText("关");
-        ui->BedroomAcButton->setStyleSheet("");
-        ui->BedroomAcModecomboBox->setEnabled(false);
-        ui->BedroomTemperaturecomboBox->setEnabled(false);
-        qDebug() << "关空调:" << ui->BedroomAcButton->objectName();
-    }
+    // 关闭客厅空调和卧室空调
+    turnOffAc(AcPlanner::Livingroom);
+    turnOffAc(AcPlanner::Bedroom);
+}
+
+// 关闭某个房间的空调
+void MainWindow::turnOffAc(AcPlanner::Room room)
+{
+    QPushButton *acButton = (room == AcPlanner::Livingroom) ? ui->LivingroomAcButton : ui->BedroomAcButton;
+    setPowerByButton(DeviceKind::AirConditioner, acButton, false, PowerCommand::TurnOff);
 }
 
 void MainWindow::on_SleepModeButton_clicked()
 {
+    static MetricHistogram &sceneSeconds = sceneDurationHistogram("SleepMode");
+    MetricTimer sceneTimer(sceneSeconds);
+
     qDebug() << "执行睡眠模式";
     qDebug() << "当前室外温度:" << outsideTemperature << "°C";
     
@@ -1026,64 +1440,36 @@ void MainWindow::on_SleepModeButton_clicked()
     
     // 4. 关闭客厅空调
     qDebug() << "关闭客厅空调";
-    if (ui->LivingroomAcButton->text() == "开") {
-        ui->LivingroomAcButton->setText("关");
-        ui->LivingroomAcButton->setStyleSheet("");
-        ui->LivingroomAcModecomboBox->setEnabled(false);
-        ui->LivingroomTemperaturecomboBox->setEnabled(false);
-        qDebug() << "关空调:" << ui->LivingroomAcButton->objectName();
-    }
+    turnOffAc(AcPlanner::Livingroom);
     
     // 5. 根据室外温度智能控制卧室空调
     qDebug() << "检查是否需要打开卧室空调";
     turnOnAirConditionerWithSmartControlForBedroom();
     
-    // 6. 点击门锁按钮
-    qDebug() << "点击门锁按钮";
-    on_LockButton_clicked();
-    writeSceneHistory("SleepMode");
+    // 6. 锁门：场景动作记为 turn_on，与门锁按钮的 lock 区分，不算手动操作
+    qDebug() << "锁门";
+    setPowerByButton(DeviceKind::Lock, ui->LockButton, true, PowerCommand::TurnOn);
+    writeSceneHistory(QStringLiteral("SleepMode"));
 }
 
 void MainWindow::turnOnAirConditionerWithSmartControlForBedroom()
 {
-    // 根据室外温度判断是否需要开空调
-    // 15-26度之间不需要开空调
-    if (outsideTemperature > 15 && outsideTemperature < 26) {
-        qDebug() << "室外温度" << outsideTemperature << "°C 在15-26度之间，不开卧室空调";
+    AcPlanEntry plan;
+    if (!currentAcPlan(AcPlanner::Bedroom, &plan)) {
+        qDebug() << "室外温度数据缺失或已过期，不开卧室空调";
         return;
     }
-    
-    // 室外温度>=26度或<=15度，需要开空调
-    qDebug() << "室外温度:" << outsideTemperature << "°C，需要开启卧室空调";
-    
-    // 获取当前空调状态
-    QString status = ui->BedroomAcButton->text();
-    
-    if (status == "关") {
-        // 开启卧室空调
-        ui->BedroomAcButton->setText("开");
-        ui->BedroomAcButton->setStyleSheet("background-color: #FFD700; color: black; font-weight: bold;");
-        ui->BedroomAcModecomboBox->setEnabled(true);
-        ui->BedroomTemperaturecomboBox->setEnabled(true);
-        qDebug() << "开卧室空调:" << ui->BedroomAcButton->objectName() << "新状态:开";
+
+    // 规则没有要求开空调
+    if (!plan.turnOn) {
+        qDebug() << "室外温度" << plan.outsideTemp << "°C，规则判断不需要开卧室空调";
+        return;
     }
     
-    // 设置为睡眠模式
-    ui->BedroomAcModecomboBox->setCurrentText("睡眠");
-    qDebug() << "空调模式设置为:睡眠";
+    qDebug() << "室外温度:" << plan.outsideTemp << "°C，需要开启卧室空调";
     
-    // 根据室外温度智能设置空调温度
-    if (outsideTemperature >= 26) {
-        // 室外温度>=26度，设置制冷模式，温度比室外低2度
-        int targetTemp = outsideTemperature - 2;
-        ui->BedroomTemperaturecomboBox->setCurrentText(QString::number(targetTemp));
-        qDebug() << "制冷模式，温度设置为:" << targetTemp << "°C";
-    } else if (outsideTemperature <= 15) {
-        // 室外温度<=15度，设置制热模式，温度比室外高3度
-        int targetTemp = outsideTemperature + 3;
-        ui->BedroomTemperaturecomboBox->setCurrentText(QString::number(targetTemp));
-        qDebug() << "制热模式，温度设置为:" << targetTemp << "°C";
-    }
+    // 按计划设置空调模式（睡眠）和温度
+    applyAcPlanEntry(AcPlanner::Bedroom, plan);
 }
 
 void MainWindow::on_WakeUpModeButton_clicked()
@@ -1097,62 +1483,117 @@ void MainWindow::on_WakeUpModeButton_clicked()
     
     if (dialog.exec() == QDialog::Accepted) {
         QTime selectedTime = dialog.selectedTime();
-        wakeUpTime = QDateTime::currentDateTime();
-        wakeUpTime.setTime(selectedTime);
-        
-        // 如果选择的时间已经过了今天的当前时间，设置到明天
-        if (wakeUpTime <= QDateTime::currentDateTime()) {
-            wakeUpTime = wakeUpTime.addDays(1);
+        quint8 weekdays = dialog.selectedWeekdays();
+
+        // 取消之前的闹钟，同一时间只保留一个起床闹钟
+        if (wakeUpJobId != 0) {
+            sceneScheduler->cancel(wakeUpJobId);
+            persistScheduleJob(wakeUpJobId);
+            wakeUpJobId = 0;
         }
-        
-        qDebug() << "设置的起床时间:" << wakeUpTime.toString("yyyy-MM-dd hh:mm:ss");
-        
-        // 停止并删除之前的定时器
-        if (wakeUpTimer) {
-            wakeUpTimer->stop();
-            delete wakeUpTimer;
-            wakeUpTimer = nullptr;
+
+        // 闹钟错过30分钟以上（例如关机期间）就不再补执行
+        if (weekdays != 0) {
+            // 按星期重复的闹钟
+            wakeUpJobId = sceneScheduler->scheduleRecurring("WakeUpMode", weekdays, selectedTime,
+                                                            ScheduleJob::RunIfWithin, WakeUpCatchUpMinutes);
+            wakeUpTime = sceneScheduler->job(wakeUpJobId).fireAt;
+        } else {
+            wakeUpTime = QDateTime::currentDateTime();
+            wakeUpTime.setTime(selectedTime);
+
+            // 如果选择的时间已经过了今天的当前时间，设置到明天
+            if (wakeUpTime <= QDateTime::currentDateTime()) {
+                wakeUpTime = wakeUpTime.addDays(1);
+            }
+            wakeUpJobId = sceneScheduler->scheduleOnce("WakeUpMode", wakeUpTime,
+                                                       ScheduleJob::RunIfWithin, WakeUpCatchUpMinutes);
         }
         
-        // 计算到目标时间的间隔（毫秒）
-        qint64 intervalMs = QDateTime::currentDateTime().msecsTo(wakeUpTime);
-        qDebug() << "间隔时间（毫秒）:" << intervalMs;
+        qDebug() << "设置的起床时间:" << wakeUpTime.toString("yyyy-MM-dd hh:mm:ss");
         
-        if (intervalMs > 0) {
-            // 使用 QTimer::singleShot 更可靠
-            wakeUpTimer = new QTimer(this);
-            connect(wakeUpTimer, &QTimer::timeout, this, [this]() {
-                executeWakeUpActions();
-            });
-            wakeUpTimer->start(intervalMs);
-            
-            isWakeUpModeActive = true;
-            qDebug() << "起床模式已启动，距离目标时间还有" << (intervalMs / 1000) << "秒";
-            
-            // 在状态栏显示提示
-            if (wakeUpStatusLabel) {
-                delete wakeUpStatusLabel;
-            }
-            wakeUpStatusLabel = new QLabel(this);
-            wakeUpStatusLabel->setText(QString("起床闹钟: %1").arg(selectedTime.toString("hh:mm")));
-            ui->statusbar->addWidget(wakeUpStatusLabel, 0);
+        if (wakeUpJobId != 0) {
+            persistScheduleJob(wakeUpJobId);
+            qDebug() << "起床模式已启动，距离目标时间还有" << QDateTime::currentDateTime().secsTo(wakeUpTime) << "秒";
+            showWakeUpAlarmStatus(sceneScheduler->job(wakeUpJobId));
         } else {
-            qDebug() << "错误：选择的时间已过";
+            qDebug() << "错误：起床闹钟设置失败";
+        }
+        updatePreconditioning();
+    }
+}
+
+// 在状态栏显示起床闹钟提示
+void MainWindow::showWakeUpAlarmStatus(const ScheduleJob &job)
+{
+    isWakeUpModeActive = true;
+
+    QString timeText = job.kind == ScheduleJob::Recurring ? job.timeOfDay.toString("hh:mm") : job.fireAt.toString("hh:mm");
+    QString repeatText = job.kind == ScheduleJob::Recurring ? " " + SceneScheduler::weekdaysText(job.weekdays) : QString();
+
+    if (wakeUpStatusLabel) {
+        delete wakeUpStatusLabel;
+    }
+    wakeUpStatusLabel = new QLabel(this);
+    wakeUpStatusLabel->setText(QString("起床闹钟: %1%2").arg(timeText, repeatText));
+    ui->statusbar->addWidget(wakeUpStatusLabel, 0);
+}
+
+// 启动时存储线程一次查询读出全部定时任务，放回调度器
+void MainWindow::restoreSchedules(const QVector<ScheduleJob> &jobs)
+{
+    sceneScheduler->restore(jobs);
+
+    // 恢复起床闹钟的状态栏提示
+    for (const ScheduleJob &job : jobs) {
+        if (job.sceneId == "WakeUpMode" && sceneScheduler->contains(job.id)) {
+            wakeUpJobId = job.id;
+            wakeUpTime = sceneScheduler->job(job.id).fireAt;
+            showWakeUpAlarmStatus(sceneScheduler->job(job.id));
+            break;
         }
     }
+    updatePreconditioning();
+}
+
+// 把任务的当前状态写回数据库：任务仍在调度器中则更新，否则删除
+void MainWindow::persistScheduleJob(quint64 jobId)
+{
+    scheduleSnapshot();
+    if (!databaseReady) {
+        return;
+    }
+
+    if (sceneScheduler->contains(jobId)) {
+        ScheduleJob job = sceneScheduler->job(jobId);
+        QMetaObject::invokeMethod(storage, [worker = storage, job]() {
+            worker->saveSchedule(job);
+        });
+    } else {
+        QMetaObject::invokeMethod(storage, [worker = storage, jobId]() {
+            worker->removeSchedule(jobId);
+        });
+    }
 }
 
 void MainWindow::cancelWakeUpAlarm()
 {
     qDebug() << "删除闹钟";
     
-    if (wakeUpTimer) {
-        wakeUpTimer->stop();
-        delete wakeUpTimer;
-        wakeUpTimer = nullptr;
-        qDebug() << "定时器已停止并删除";
+    if (wakeUpJobId != 0) {
+        sceneScheduler->cancel(wakeUpJobId);
+        persistScheduleJob(wakeUpJobId);
+        wakeUpJobId = 0;
+        qDebug() << "定时任务已取消";
     }
     
+    clearWakeUpAlarmStatus();
+    updatePreconditioning();
+    qDebug() << "闹钟已删除";
+}
+
+void MainWindow::clearWakeUpAlarmStatus()
+{
     if (wakeUpStatusLabel) {
         ui->statusbar->removeWidget(wakeUpStatusLabel);
         delete wakeUpStatusLabel;
@@ -1161,28 +1602,64 @@ void MainWindow::cancelWakeUpAlarm()
     }
     
     isWakeUpModeActive = false;
-    qDebug() << "闹钟已删除";
 }
 
-void MainWindow::executeWakeUpActions()
+// 调度器触发的定时场景
+void MainWindow::onScheduledJobTriggered(quint64 jobId, const QString &sceneId)
 {
-    qDebug() << "执行起床操作";
-    
-    // 停止并删除定时器
-    if (wakeUpTimer) {
-        wakeUpTimer->stop();
-        delete wakeUpTimer;
-        wakeUpTimer = nullptr;
+    // 单次任务触发后从数据库删除，循环任务保存下一次触发时间
+    persistScheduleJob(jobId);
+
+    if (jobId == wakeUpJobId) {
+        // 单次闹钟触发后移除状态栏提示；循环闹钟保留
+        if (!sceneScheduler->contains(jobId)) {
+            wakeUpJobId = 0;
+            clearWakeUpAlarmStatus();
+        } else {
+            wakeUpTime = sceneScheduler->job(jobId).fireAt;
+        }
     }
-    
-    // 移除状态栏提示
-    if (wakeUpStatusLabel) {
-        ui->statusbar->removeWidget(wakeUpStatusLabel);
-        delete wakeUpStatusLabel;
-        wakeUpStatusLabel = nullptr;
+
+    runSceneById(sceneId);
+    updatePreconditioning();
+}
+
+// 按场景ID执行场景，供定时任务等非按钮入口使用；未知或尚未配置的场景返回 false
+bool MainWindow::runSceneById(const QString &sceneId)
+{
+    if (sceneId == "comingHomeMode") {
+        on_comingHomeModeButton_clicked();
+    } else if (sceneId == "leavingHomeMode") {
+        on_leavingHomeModeButton_clicked();
+    } else if (sceneId == "SleepMode") {
+        on_SleepModeButton_clicked();
+    } else if (sceneId == "WakeUpMode") {
+        executeWakeUpActions();
+    } else if (sceneId == "UserDefinedMode1") {
+        if (customScene1Name.isEmpty()) {
+            qWarning() << "自定义模式1尚未配置，无法执行";
+            return false;
+        }
+        on_UserDefinedMode1Button_clicked();
+    } else if (sceneId == "UserDefinedMode2") {
+        if (customScene2Name.isEmpty()) {
+            qWarning() << "自定义模式2尚未配置，无法执行";
+            return false;
+        }
+        on_UserDefinedMode2Button_clicked();
+    } else {
+        qWarning() << "未知的场景ID:" << sceneId;
+        return false;
     }
-    
-    isWakeUpModeActive = false;
+    return true;
+}
+
+void MainWindow::executeWakeUpActions()
+{
+    static MetricHistogram &sceneSeconds = sceneDurationHistogram("WakeUpMode");
+    MetricTimer sceneTimer(sceneSeconds);
+
+    qDebug() << "执行起床操作";
     
     // 1. 打开卧室窗帘
     qDebug() << "打开卧室窗帘";
@@ -1190,27 +1667,94 @@ void MainWindow::executeWakeUpActions()
     
     // 2. 关闭卧室空调
     qDebug() << "关闭卧室空调";
-    if (ui->BedroomAcButton->text() == "开") {
-        ui->BedroomAcButton->setText("关");
-        ui->BedroomAcButton->setStyleSheet("");
-        ui->BedroomAcModecomboBox->setEnabled(false);
-        ui->BedroomTemperaturecomboBox->setEnabled(false);
-        qDebug() << "关卧室空调:" << ui->BedroomAcButton->objectName();
-    }
-    
-    // 3. 如果时间早于7点，打开卧室灯
-    QTime currentTime = QTime::currentTime();
-    qDebug() << "当前时间:" << currentTime.toString("hh:mm");
-    
-    if (currentTime.hour() < 7) {
-        qDebug() << "当前时间早于7点，打开卧室灯";
-        turnOnLight(ui->BedroomLightButton);
-    } else {
-        qDebug() << "当前时间晚于7点或等于7点，不开灯";
-    }
+    turnOffAc(AcPlanner::Bedroom);
     
+    // 3. 其余操作（例如早于7点打开卧室灯）由规则引擎根据起床事件执行
+    writeSceneHistory(QStringLiteral("WakeUpMode"));
     qDebug() << "起床操作执行完成";
-    writeSceneHistory("WakeUpMode");
+}
+
+// 执行规则产生的设备命令
+void MainWindow::applyRuleAction(const RuleAction &action)
+{
+    executeDeviceAction(action);
+}
+
+// 规则、场景序列和控制接口的设备命令，设备或命令无效时返回 false
+bool MainWindow::executeDeviceAction(const RuleAction &action)
+{
+    // 下标为 DeviceKind，命令的能力检查在编译期按类型生成
+    using CommandHandler = bool (MainWindow::*)(const CustomSceneTarget &, const RuleAction &);
+    static constexpr CommandHandler handlers[DeviceKindCount] = {
+        &MainWindow::applyDeviceCommand<DeviceKind::Light>,
+        &MainWindow::applyDeviceCommand<DeviceKind::Curtain>,
+        &MainWindow::applyDeviceCommand<DeviceKind::AirConditioner>,
+        &MainWindow::applyDeviceCommand<DeviceKind::Lock>
+    };
+
+    const CustomSceneTarget *target = deviceTarget(action.deviceId);
+    if (!target) {
+        qWarning() << "规则" << action.ruleId << "指定的设备不存在:" << action.deviceId;
+        return false;
+    }
+    return (this->*handlers[int(target->kind)])(*target, action);
+}
+
+// 控制接口的一批请求：设备命令按规则动作执行，场景按场景ID执行，都与按钮走同一条路径（界面、控制核心、历史记录）；
+// 查询转到控制线程，排在本批命令转发的操作之后，能读到它们的结果；回复经界面线程交回网络线程，保持请求顺序
+void MainWindow::onControlRequests(const ControlBatch &batch)
+{
+    ControlBatch executed = batch;
+    for (ControlRequest &request : executed.requests) {
+        if (!request.error.isEmpty()) {
+            continue;
+        }
+        if (request.op == ControlRequest::Set) {
+            // 同一请求中前面已执行的命令不回滚
+            for (const RuleAction &action : qAsConst(request.commands)) {
+                if (!executeDeviceAction(action)) {
+                    request.error = QString("命令无法执行: %1 %2 %3").arg(action.deviceId, action.command, action.value);
+                    break;
+                }
+            }
+        } else if (request.op == ControlRequest::Scene) {
+            if (!runSceneById(request.sceneId)) {
+                request.error = "未知或未配置的场景: " + request.sceneId;
+            }
+        }
+    }
+
+    postToController([this, controller = homeController, executed]() mutable {
+        for (ControlRequest &request : executed.requests) {
+            if (request.op != ControlRequest::Get || !request.error.isEmpty()) {
+                continue;
+            }
+            const QStringList ids = request.deviceIds.isEmpty() ? controller->deviceIds() : request.deviceIds;
+            request.states.reserve(ids.size());
+            for (const QString &deviceId : ids) {
+                if (!controller->contains(deviceId)) {
+                    request.error = "设备不存在: " + deviceId;
+                    request.states.clear();
+                    break;
+                }
+                request.states.append(controller->device(deviceId));
+            }
+        }
+        QMetaObject::invokeMethod(this, [this, executed]() {
+            if (controlServer) {
+                QMetaObject::invokeMethod(controlServer, [server = controlServer, executed]() {
+                    server->sendResponses(executed);
+                });
+            }
+        });
+    });
+}
+
+// 规则重新加载后：空调计划按新规则重算，天气轮询使用新的温度阈值
+void MainWindow::onRulesReloaded()
+{
+    acPlanner.recomputeAll();
+    weatherPollPolicy.setThresholds(planningRules->conditionValues("sensor.outside"));
 }
 
 void MainWindow::on_LightBackpushButton_clicked()
@@ -1276,174 +1820,61 @@ void MainWindow::on_AllturnOffLightButton_clicked()
 
 void MainWindow::toggleLight(QPushButton* lightButton)
 {
-    // 验证按钮有效性
-    if (!lightButton) {
-        qDebug() << "错误：无效的灯光按钮";
-        return;
-    }
-    
-    // 获取当前灯光状态
-    bool isOn = lightStates[lightButton];
-    qDebug() << "切换灯光前状态:" << (isOn ? "开" : "关");
-    
-    // 切换灯光状态
-    lightStates[lightButton] = !isOn;
-    
-    if (!isOn) {
-        // 开启灯光（之前是关闭状态）
-        lightButton->setText("开");
-        lightButton->setStyleSheet("background-color: #FFD700; color: black; font-weight: bold;");
-        lightsOnCount++;
-        qDebug() << "开灯:" << lightButton->objectName() << "新状态:开" << "灯光数量:" << lightsOnCount;
-    } else {
-        // 关闭灯光（之前是开启状态）
-        lightButton->setText("关");
-        lightButton->setStyleSheet("");
-        lightsOnCount--;
-        qDebug() << "关灯:" << lightButton->objectName() << "新状态:关" << "灯光数量:" << lightsOnCount;
-    }
-    
-    // 更新主页面灯光数量
-    updateMainPageLightStatus();
-
-    //记录灯光变化日志
-    //获取id
-    QString deviceId = lightButton->objectName().replace("Button","");
-
-    QString actionType = "toggle";
-    QString actionValue = !isOn ? "on" : "off"; // 新的状态
-    writeDeviceHistory(deviceId,actionType,actionValue);
-    updateDeviceStatus(deviceId, "", "", actionValue);
+    togglePowerByButton(DeviceKind::Light, lightButton);
 }
 
 void MainWindow::toggleCurtain(QPushButton* curtainButton)
 {
-    // 验证按钮有效性
-    if (!curtainButton) {
-        qDebug() << "错误：无效的窗帘按钮";
-        return;
-    }
-    
-    // 获取当前窗帘状态
-    bool isOpen = curtainStates[curtainButton];
-    qDebug() << "切换窗帘前状态:" << (isOpen ? "开" : "关");
-    
-    // 切换窗帘状态
-    curtainStates[curtainButton] = !isOpen;
-    
-    if (!isOpen) {
-        // 开启窗帘（之前是关闭状态）
-        curtainButton->setText("开");
-        curtainButton->setStyleSheet("background-color: #FFD700; color: black; font-weight: bold;");
-        curtainsOpenCount++;
-        qDebug() << "开窗帘:" << curtainButton->objectName() << "新状态:开" << "窗帘数量:" << curtainsOpenCount;
-    } else {
-        // 关闭窗帘（之前是开启状态）
-        curtainButton->setText("关");
-        curtainButton->setStyleSheet("");
-        curtainsOpenCount--;
-        qDebug() << "关窗帘:" << curtainButton->objectName() << "新状态:关" << "窗帘数量:" << curtainsOpenCount;
-    }
-    
-    // 更新主页面窗帘数量
-    updateMainPageCurtainStatus();
-    //更新状态、写入日志
-    QString deviceId = curtainButton->objectName().replace("Button","");
-    QString actionType = "toggle";
-    QString actionValue = !isOpen?"open":"close";
-    writeDeviceHistory(deviceId,actionType,actionValue);
-    updateDeviceStatus(deviceId,"","",actionValue);
+    togglePowerByButton(DeviceKind::Curtain, curtainButton);
 }
 
 void MainWindow::updateMainPageLightStatus()
 {
+    static MetricHistogram &refreshSeconds = uiRefreshHistogram("light_status");
+    MetricTimer refreshTimer(refreshSeconds);
+
     // 确保lightsOnCount不会小于0
     if (lightsOnCount < 0) {
         lightsOnCount = 0;
-        qDebug() << "修正负数灯光计数:" << lightsOnCount;
+        qCDebug(lcControl) << "修正负数灯光计数:" << lightsOnCount;
     }
     
     // 更新主页面灯光状态标签
-    qDebug()<<"lightsoncount大小"<<lightsOnCount;
+    qCDebug(lcControl)<<"lightsoncount大小"<<lightsOnCount;
     QString lightStatusText = QString("已打开灯光数：%1").arg(lightsOnCount);
     ui->Lightlabel->setText(lightStatusText);
     
-    qDebug() << "更新主页面灯光状态:" << lightStatusText;
+    qCDebug(lcControl) << "更新主页面灯光状态:" << lightStatusText;
 }
 
 void MainWindow::updateMainPageCurtainStatus()
 {
+    static MetricHistogram &refreshSeconds = uiRefreshHistogram("curtain_status");
+    MetricTimer refreshTimer(refreshSeconds);
+
     // 确保curtainsOpenCount不会小于0
     if (curtainsOpenCount < 0) {
         curtainsOpenCount = 0;
-        qDebug() << "修正负数窗帘计数:" << curtainsOpenCount;
+        qCDebug(lcControl) << "修正负数窗帘计数:" << curtainsOpenCount;
     }
     
     // 更新主页面窗帘状态标签
     QString curtainStatusText = QString("已打开窗帘数：%1").arg(curtainsOpenCount);
     ui->Curtainlabel->setText(curtainStatusText);
     
-    qDebug() << "更新主页面窗帘状态:" << curtainStatusText;
+    qCDebug(lcControl) << "更新主页面窗帘状态:" << curtainStatusText;
 }
 
 
 void MainWindow::on_LivingroomAcButton_clicked()
 {
-    // 获取当前空调状态
-    QString status = ui->LivingroomAcButton->text();
-    qDebug() << "切换空调前状态:" << status;
-
-
-    if (status == "关") {
-        // 开启空调（之前是关闭状态）
-        ui->LivingroomAcButton->setText("开");
-        ui->LivingroomAcButton->setStyleSheet("background-color: #FFD700; color: black; font-weight: bold;");
-        ui->LivingroomAcModecomboBox->setEnabled(true);
-        ui->LivingroomTemperaturecomboBox->setEnabled(true);
-        qDebug() << "开空调:" << ui->LivingroomAcButton->objectName() << "新状态:开";
-    } else if(status == "开"){
-        // 关闭空调（之前是开启状态）
-        ui->LivingroomAcButton->setText("关");
-        ui->LivingroomAcButton->setStyleSheet("");
-        ui->LivingroomAcModecomboBox->setEnabled(false);
-        ui->LivingroomTemperaturecomboBox->setEnabled(false);
-        qDebug() << "关空调:" << ui->LivingroomAcButton->objectName() << "新状态:关" ;
-    }
-    //更新状态、写入日志
-    QString deviceId = "LivingroomAc";
-    QString actionType = "toggle";
-    QString actionValue = (status == "关") ? "on" : "off";
-    writeDeviceHistory(deviceId,actionType,actionValue);
-    updateDeviceStatus(deviceId,"","",actionValue);
+    togglePowerByButton(DeviceKind::AirConditioner, ui->LivingroomAcButton);
 }
 
 
 void MainWindow::on_BedroomAcButton_clicked()
 {
-    // 获取当前空调状态
-    QString status = ui->BedroomAcButton->text();
-
-
-    if (status == "关") {
-        // 开启空调（之前是关闭状态）
-        ui->BedroomAcButton->setText("开");
-        ui->BedroomAcButton->setStyleSheet("background-color: #FFD700; color: black; font-weight: bold;");
-        ui->BedroomAcModecomboBox->setEnabled(true);
-        ui->BedroomTemperaturecomboBox->setEnabled(true);
-        qDebug() << "开空调:" << ui->BedroomAcButton->objectName() << "新状态:开";
-    } else if(status == "开"){
-        // 关闭空调（之前是开启状态）
-        ui->BedroomAcButton->setText("关");
-        ui->BedroomAcButton->setStyleSheet("");
-        ui->BedroomAcModecomboBox->setEnabled(false);
-        ui->BedroomTemperaturecomboBox->setEnabled(false);
-        qDebug() << "关空调:" << ui->BedroomAcButton->objectName() << "新状态:关" ;
-    }
-    QString deviceId = "BedroomAc";
-    QString actionType = "toggle";
-    QString actionValue = (status == "关") ? "on" : "off";
-    writeDeviceHistory(deviceId,actionType,actionValue);
-    updateDeviceStatus(deviceId,"","",actionValue);
+    togglePowerByButton(DeviceKind::AirConditioner, ui->BedroomAcButton);
 }
 
 
@@ -1485,6 +1916,7 @@ void MainWindow::on_UserDefinedModeButton_clicked()
             customScene1Devices = selectedDevices;
             ui->UserDefinedMode1Button->setText(sceneName);
             ui->UserDefinedMode1Button->setEnabled(true);
+            scheduleSnapshot();
             qDebug() << "保存到自定义模式1";
         } else if (customScene2Name.isEmpty()) {
             // 保存到自定义模式2
@@ -1492,6 +1924,7 @@ void MainWindow::on_UserDefinedModeButton_clicked()
             customScene2Devices = selectedDevices;
             ui->UserDefinedMode2Button->setText(sceneName);
             ui->UserDefinedMode2Button->setEnabled(true);
+            scheduleSnapshot();
             qDebug() << "保存到自定义模式2";
         } else {
             // 已经有两个自定义场景了，提示用户
@@ -1504,6 +1937,9 @@ void MainWindow::on_UserDefinedModeButton_clicked()
 
 void MainWindow::on_UserDefinedMode1Button_clicked()
 {
+    static MetricHistogram &sceneSeconds = sceneDurationHistogram("UserDefinedMode1");
+    MetricTimer sceneTimer(sceneSeconds);
+
     qDebug() << "执行自定义模式1";
     
     if (customScene1Name.isEmpty()) {
@@ -1513,11 +1949,14 @@ void MainWindow::on_UserDefinedMode1Button_clicked()
     
     // 执行自定义模式1的设备操作
     executeCustomScene(customScene1Devices);
-    writeSceneHistory("UserDefinedMode1");
+    writeSceneHistory(QStringLiteral("UserDefinedMode1"));
 }
 
 void MainWindow::on_UserDefinedMode2Button_clicked()
 {
+    static MetricHistogram &sceneSeconds = sceneDurationHistogram("UserDefinedMode2");
+    MetricTimer sceneTimer(sceneSeconds);
+
     qDebug() << "执行自定义模式2";
     
     if (customScene2Name.isEmpty()) {
@@ -1527,7 +1966,7 @@ void MainWindow::on_UserDefinedMode2Button_clicked()
     
     // 执行自定义模式2的设备操作
     executeCustomScene(customScene2Devices);
-    writeSceneHistory("UserDefinedMode2");
+    writeSceneHistory(QStringLiteral("UserDefinedMode2"));
 }
 
 void MainWindow::deleteCustomScene1()
@@ -1541,6 +1980,7 @@ void MainWindow::deleteCustomScene1()
     // 重置按钮文本和状态
     ui->UserDefinedMode1Button->setText("自定义模式1");
     ui->UserDefinedMode1Button->setEnabled(false);
+    scheduleSnapshot();
 }
 
 void MainWindow::deleteCustomScene2()
@@ -1554,127 +1994,102 @@ void MainWindow::deleteCustomScene2()
     // 重置按钮文本和状态
     ui->UserDefinedMode2Button->setText("自定义模式2");
     ui->UserDefinedMode2Button->setEnabled(false);
+    scheduleSnapshot();
 }
 
 void MainWindow::executeCustomScene(const QMap<QString, int> &deviceStates)
 {
-    qDebug() << "执行自定义场景，设备数量:" << deviceStates.size();
-    
-    // 遍历设备状态，执行相应的操作
-    for (auto it = deviceStates.begin(); it != deviceStates.end(); ++it) {
-        QString deviceName = it.key();
+    qCDebug(lcControl) << "执行自定义场景，设备数量:" << deviceStates.size();
+
+    // 遍历设备状态，按设备名查表执行相应的操作；0 保持不变，1 开，2 关
+    for (auto it = deviceStates.constBegin(); it != deviceStates.constEnd(); ++it) {
         int status = it.value();
-        
-        qDebug() << "设备:" << deviceName << "目标状态:" << status;
-        
-        // 根据设备名称和状态执行相应的操作
-        if (deviceName == "客厅灯") {
-            if (status == 1) {
-                turnOnLight(ui->LivingroomLightButton);
-            } else if (status == 2) {
-                turnOffLight(ui->LivingroomLightButton);
-            }
-            // status == 0 时保持不变，不执行任何操作
-        } else if (deviceName == "厨房灯") {
-            if (status == 1) {
-                turnOnLight(ui->KitchenLightButton);
-            } else if (status == 2) {
-                turnOffLight(ui->KitchenLightButton);
-            }
-        } else if (deviceName == "卧室灯") {
-            if (status == 1) {
-                turnOnLight(ui->BedroomLightButton);
-            } else if (status == 2) {
-                turnOffLight(ui->BedroomLightButton);
-            }
-        } else if (deviceName == "浴室灯") {
-            if (status == 1) {
-                turnOnLight(ui->BathroomLightButton);
-            } else if (status == 2) {
-                turnOffLight(ui->BathroomLightButton);
-            }
-        } else if (deviceName == "书房灯") {
-            if (status == 1) {
-                turnOnLight(ui->StudyroomLightButton);
-            } else if (status == 2) {
-                turnOffLight(ui->StudyroomLightButton);
-            }
-        } else if (deviceName == "阳台灯") {
-            if (status == 1) {
-                turnOnLight(ui->BalconyLightButton);
-            } else if (status == 2) {
-                turnOffLight(ui->BalconyLightButton);
-            }
-        } else if (deviceName == "餐厅灯") {
-            if (status == 1) {
-                turnOnLight(ui->DiningroomLightButton);
-            } else if (status == 2) {
-                turnOffLight(ui->DiningroomLightButton);
-            }
-        } else if (deviceName == "客厅窗帘") {
-            if (status == 1) {
-                turnOnCurtain(ui->LivingroomCurtainButton);
-            } else if (status == 2) {
-                turnOffCurtain(ui->LivingroomCurtainButton);
-            }
-            // status == 0 时保持不变
-        } else if (deviceName == "卧室窗帘") {
-            if (status == 1) {
-                turnOnCurtain(ui->BedroomCurtainButton);
-            } else if (status == 2) {
-                turnOffCurtain(ui->BedroomCurtainButton);
-            }
-            // status == 0 时保持不变
-        } else if (deviceName == "客厅空调") {
-            if (status == 1) {
-                if (ui->LivingroomAcButton->text() == "关") {
-                    ui->LivingroomAcButton->setText("开");
-                    ui->LivingroomAcButton->setStyleSheet("background-color: #FFD700; color: black; font-weight: bold;");
-                    ui->LivingroomAcModecomboBox->setEnabled(true);
-                    ui->LivingroomTemperaturecomboBox->setEnabled(true);
-                    qDebug() << "开客厅空调";
-                }
-            } else if (status == 2) {
-                if (ui->LivingroomAcButton->text() == "开") {
-                    ui->LivingroomAcButton->setText("关");
-                    ui->LivingroomAcButton->setStyleSheet("");
-                    ui->LivingroomAcModecomboBox->setEnabled(false);
-                    ui->LivingroomTemperaturecomboBox->setEnabled(false);
-                    qDebug() << "关客厅空调";
-                }
-            }
-            // status == 0 时保持不变
-        } else if (deviceName == "卧室空调") {
-            if (status == 1) {
-                if (ui->BedroomAcButton->text() == "关") {
-                    ui->BedroomAcButton->setText("开");
-                    ui->BedroomAcButton->setStyleSheet("background-color: #FFD700; color: black; font-weight: bold;");
-                    ui->BedroomAcModecomboBox->setEnabled(true);
-                    ui->BedroomTemperaturecomboBox->setEnabled(true);
-                    qDebug() << "开卧室空调";
-                }
-            } else if (status == 2) {
-                if (ui->BedroomAcButton->text() == "开") {
-                    ui->BedroomAcButton->setText("关");
-                    ui->BedroomAcButton->setStyleSheet("");
-                    ui->BedroomAcModecomboBox->setEnabled(false);
-                    ui->BedroomTemperaturecomboBox->setEnabled(false);
-                    qDebug() << "关卧室空调";
-                }
-            }
-            // status == 0 时保持不变
-        } else if (deviceName == "门锁") {
-            if (status == 1 || status == 2) {
-                // 门锁的操作比较特殊，直接调用现有的槽函数
-                on_LockButton_clicked();
-            }
-            // status == 0 时保持不变
+        qCDebug(lcControl) << "设备:" << it.key() << "目标状态:" << status;
+        if (status != 1 && status != 2) {
+            continue;
+        }
+        auto target = customSceneTargets.constFind(it.key());
+        if (target == customSceneTargets.constEnd()) {
+            continue;
         }
+
+        bool turnOn = (status == 1);
+        setTargetPower(**target, turnOn, turnOn ? PowerCommand::TurnOn : PowerCommand::TurnOff);
     }
-    
-    qDebug() << "自定义场景执行完成";
+
+    qCDebug(lcControl) << "自定义场景执行完成";
+}
+
+// 统计保存在存储线程的内存中，打开时不查询数据库
+void MainWindow::showSceneUsage()
+{
+    SceneAnalytics *analytics = databaseReady ? storage->sceneAnalytics() : nullptr;
+    if (!analytics) {
+        ui->statusbar->showMessage("场景统计尚未就绪", 3000);
+        return;
+    }
+
+    QVector<SceneUsage> usage = analytics->usage();
+    // 自定义场景显示用户起的名称
+    for (SceneUsage &scene : usage) {
+        if (scene.sceneId == QLatin1String("UserDefinedMode1") && !customScene1Name.isEmpty()) {
+            scene.name = customScene1Name;
+        } else if (scene.sceneId == QLatin1String("UserDefinedMode2") && !customScene2Name.isEmpty()) {
+            scene.name = customScene2Name;
+        }
+    }
+    SceneUsageDialog dialog(usage, analytics->overrideMinutes(), this);
+    dialog.exec();
 }
 
+// 异常告警只提示不拦截操作，日志由检测器输出
+void MainWindow::onAnomalyDetected(const AnomalyAlert &alert)
+{
+    const DeviceInfo *device = DeviceCatalog::instance().find(alert.deviceId);
+    QString deviceName = device ? device->name : alert.deviceId;
+    ui->statusbar->showMessage(QString("异常：%1（%2）").arg(alert.description, deviceName), 10000);
+}
+
+// 按设备目录生成设备ID -> 控件的执行表，规则命令、快照恢复和数据库恢复按设备ID查表；
+// 另外生成设备名和按钮到表中条目的索引，供自定义场景（使用目录中的设备名）和手动操作使用。
+// 按钮命名为 <设备ID>Button，目录中没有对应控件的设备不参与界面操作
+void MainWindow::buildCustomSceneTargets()
+{
+    deviceTargets.clear();
+    buttonTargets.clear();
+    customSceneTargets.clear();
+
+    const QVector<DeviceInfo> &catalog = DeviceCatalog::instance().devices();
+    for (int index = 0; index < catalog.size(); ++index) {
+        const DeviceInfo &device = catalog.at(index);
+        DeviceKind kind;
+        QPushButton *button = findChild<QPushButton*>(device.id + "Button");
+        if (!deviceKindFromType(device.type, &kind) || !button) {
+            qDebug() << "设备在界面上没有对应的控件:" << device.id;
+            continue;
+        }
 
+        CustomSceneTarget target;
+        target.kind = kind;
+        target.catalogIndex = index;
+        target.deviceId = device.id;
+        target.button = button;
+        if (deviceTraits(kind).hasMode) {
+            // 模式下拉框按设备ID命名，温度下拉框按房间命名
+            target.modeBox = findChild<QComboBox*>(device.id + "ModecomboBox");
+            target.temperatureBox = findChild<QComboBox*>(device.room + "TemperaturecomboBox");
+            if (!target.modeBox || !target.temperatureBox) {
+                qDebug() << "空调缺少模式或温度下拉框:" << device.id;
+                continue;
+            }
+        }
+        deviceTargets.insert(device.id, target);
+    }
 
+    // 表填完之后再建索引，指向的条目不会再移动
+    for (const CustomSceneTarget &target : qAsConst(deviceTargets)) {
+        buttonTargets.insert(target.button, &target);
+        customSceneTargets.insert(catalog.at(target.catalogIndex).name, &target);
+    }
+}
 
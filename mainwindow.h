@@ -5,9 +5,8 @@
 #include <QLabel>
 #include <QPushButton>
 #include <QMap>
-#include <QNetworkAccessManager>
+#include <QHash>
 #include <QNetworkReply>
-#include <QNetworkRequest>
 #include <QTimer>
 #include <QJsonObject>
 #include <QJsonDocument>
@@ -15,24 +14,42 @@
 #include <QTime>
 #include <QString>
 #include <QDateTime>
+#include <QThread>
 #include "timepickerdialog.h"
 #include "userdefinedscenedialog.h"
-#include <QSqlDatabase>
-#include <QSqlQuery>
-#include<QSqlError>
-#include<QDateTime>
+#include "weathercache.h"
+#include "weatherprovider.h"
+#include "retrypolicy.h"
+#include "acplanner.h"
+#include "anomalydetector.h"
+#include "controlserver.h"
+#include "ruleengine.h"
+#include "thermalmodel.h"
+#include "sensorstore.h"
+#include "homecontroller.h"
+#include "networkworker.h"
+#include "storageworker.h"
+#include "weatherpollpolicy.h"
+#include "scenescheduler.h"
+#include "scenesequencer.h"
+#include "devicetraits.h"
+#include "homesnapshot.h"
 #include <QMessageBox>
 #include <QMenu>
 #include <QAction>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
+class QComboBox;
 QT_END_NAMESPACE
 
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
+    // 测试只通过 MainWindowTestAccess（tests/mainwindowtestaccess.h）访问内部状态
+    friend class MainWindowTestAccess;
+
 public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
@@ -88,15 +105,23 @@ private slots:
     void turnOnAirConditionerWithSmartControlForBedroom();
     void executeWakeUpActions();
     void cancelWakeUpAlarm();
+    void onScheduledJobTriggered(quint64 jobId, const QString &sceneId);
+    void persistScheduleJob(quint64 jobId);
     void executeCustomScene(const QMap<QString, int> &deviceStates); // 0: 保持不变, 1: 开, 2: 关
+    void showSceneUsage();
+    void onAnomalyDetected(const AnomalyAlert &alert);
+
+    // 规则引擎相关槽函数
+    void applyRuleAction(const RuleAction &action);
+    void onControlRequests(const ControlBatch &batch);
+    void onRulesReloaded();
 
-    // 网络更新槽函数
+    // 网络更新槽函数：请求和解析在网络线程中进行，这里只处理结果
     void updateWeatherFromNetwork();
-    void onWeatherReplyFinished();
+    void onWeatherFetched(const WeatherFetchResult &result);
     void onNetworkError(QNetworkReply::NetworkError error);
-    
-    // 网络请求完成槽函数
-    void onNetworkReplyFinished(QNetworkReply *reply);
+    void updateForecastFromNetwork();
+    void onForecastFetched(const ForecastFetchResult &result);
 
     void on_LivingroomAcButton_clicked();
 
@@ -105,31 +130,117 @@ private slots:
     void on_AllCloseCurtainButton_clicked();
 
 private:
+    // 设备对应的控件：规则命令和状态恢复按设备ID查表，自定义场景按设备名、按钮操作按按钮查索引
+    struct CustomSceneTarget {
+        DeviceKind kind = DeviceKind::Light;
+        int catalogIndex = -1;  // DeviceCatalog::devices() 中的下标，开关操作按它提交给控制线程
+        QString deviceId;
+        QPushButton *button = nullptr;
+        QComboBox *modeBox = nullptr;         // 仅空调
+        QComboBox *temperatureBox = nullptr;  // 仅空调
+    };
+    void buildCustomSceneTargets();
+    const CustomSceneTarget *deviceTarget(QPushButton *button) const;
+    const CustomSceneTarget *deviceTarget(const QString &deviceId) const;
+
+    // 设备开关的通用实现：状态值、能力和设定温度范围取自 DeviceTraits<Kind>，
+    // 只有读写界面状态的两个函数按类型特化；按类型分发时查 DeviceKind 下标的函数指针表
+    template <DeviceKind Kind> bool isDeviceOn(const CustomSceneTarget &target) const;
+    template <DeviceKind Kind> void showDevicePower(const CustomSceneTarget &target, bool on);
+    template <DeviceKind Kind> void setDevicePower(const CustomSceneTarget &target, bool on, PowerCommand::Action action);
+    template <DeviceKind Kind> void toggleDevicePower(const CustomSceneTarget &target);
+    template <DeviceKind Kind> bool applyDeviceCommand(const CustomSceneTarget &target, const RuleAction &action);
+    bool executeDeviceAction(const RuleAction &action);
+    void setTargetPower(const CustomSceneTarget &target, bool on, PowerCommand::Action action);
+    bool isTargetOn(const CustomSceneTarget &target) const;
+    void showTargetPower(const CustomSceneTarget &target, bool on);
+    void setPowerByButton(DeviceKind kind, QPushButton *button, bool on, PowerCommand::Action action);
+    void togglePowerByButton(DeviceKind kind, QPushButton *button);
+
+    // 状态快照：启动时在第一次绘制之前恢复，状态变化和历史记录提交后合并写入
+    bool readSnapshot(HomeSnapshot *snapshot) const;
+    void restoreSnapshot(const HomeSnapshot &snapshot);
+    HomeSnapshot captureSnapshot() const;
+    void scheduleSnapshot();
+    void saveSnapshot();
+    void onHistoryCommitted(qint64 sequence);
+
     void setupConnections();
+    void startWorkerThreads(const HomeSnapshot *snapshot);
+    void stopWorkerThreads();
+    void onStorageReady(const DeviceRecovery &recovery, const QVector<ScheduleJob> &jobs);
     void switchToMainPage();
+    bool runSceneById(const QString &sceneId);
+    void clearWakeUpAlarmStatus();
+    void showWakeUpAlarmStatus(const ScheduleJob &job);
+    void restoreSchedules(const QVector<ScheduleJob> &jobs);
     void startNetworkUpdate();
     void updateCurrentTime();
     bool parseWeatherData(const QJsonObject& jsonObj);
+    void loadWeatherCache();
+    void showCachedWeather();
+    bool isOutsideTemperatureUsable() const;
+    void recordWeatherSuccess();
+    void rescheduleWeatherPolling(bool newObservation);
+    void applyForecast(const QVector<HourlyForecast> &forecast);
+    void recordTemperatureReadings(const QJsonObject &jsonObj);
+    bool currentAcPlan(AcPlanner::Room room, AcPlanEntry *entry) const;
+    void applyAcPlanEntry(AcPlanner::Room room, const AcPlanEntry &plan);
+    void turnOffAc(AcPlanner::Room room);
+    void updateAcSetting(AcPlanner::Room room);
+    double currentIndoorTemperature(AcPlanner::Room room);
+    void updatePreconditioning();
+    void applyPlanningInputs(const PlanningInputs &inputs);
+    void schedulePreconditioning(AcPlanner::Room room, const QDateTime &target);
+    void startPreconditioning(AcPlanner::Room room);
+    void handleWeatherFailure();
 
-    //数据库相关
-    QSqlDatabase db;
-    bool initDatabase();
-    void writeDeviceHistory(const QString& deviceId, const QString& actionType, const QString& actionValue);
-    void updateDeviceStatus(const QString& deviceId, const QString& name, const QString& type, const QString& status);
-    void populateDefaultDevices();//向device表内插入设备
-    void populateDefaultScenes();
+    //数据库相关：写入转发给控制线程，由存储线程落盘
+    template <typename Function> void postToController(Function function);
     void writeSceneHistory(const QString &sceneId);
 
+    // 线程模型：界面线程只绘制和转发输入
+    //   存储线程：唯一的 SQLite 连接，建表、历史写入、温度序列、能耗统计和所有查询
+    //   网络线程：天气请求、JSON 解析、指标导出服务和本机控制接口
+    //   控制线程：设备状态、规则引擎、场景序列和异常检测
+    // 线程之间只通过队列连接的信号、QMetaObject::invokeMethod、控制核心的开关操作队列和存储线程的写入队列交互
+    QThread *storageThread;
+    QThread *networkThread;
+    QThread *controllerThread;
+    StorageWorker *storage;
+    NetworkWorker *networkWorker;
+    HomeController *homeController;  // 控制核心，运行在控制线程
+    SceneSequencer *sceneSequencer;  // 带等待和渐变的场景步骤，运行在控制线程
+    AnomalyDetector *anomalyDetector;  // 设备、场景和传感器事件的异常检测，运行在控制线程
+    ControlServer *controlServer;  // 本机控制接口，运行在网络线程；没有启动时为空
+    bool databaseReady;  // 存储线程已打开数据库并读出设备和定时任务
+
     Ui::MainWindow *ui;
     QLabel statusTimeLabel;
     QLabel statusWeatherLabel;
     QLabel statusTemperatureLabel;
     
     // 网络相关成员变量
-    QNetworkAccessManager *networkManager;
-    QNetworkReply *weatherReply;
+    bool weatherRequestPending;   // 网络线程中有未完成的请求
+    bool forecastRequestPending;
     QTimer *timeUpdateTimer;
     QTimer *weatherUpdateTimer;
+    WeatherCache weatherCache;  // 最近一次成功的天气数据
+    QTimer *weatherRetryTimer;  // 失败后按退避时间重试
+    ExponentialBackoff weatherBackoff;
+    CircuitBreaker weatherBreaker;
+    WeatherPollPolicy weatherPollPolicy;  // 自适应轮询间隔
+    QTimer *forecastUpdateTimer;
+    AcPlanner acPlanner;  // 未来24小时的空调计划
+    RuleEngine *ruleEngine;  // 智能控制规则，运行在控制线程
+    RuleEngine *planningRules;  // 同一份规则的副本，只供空调计划试算和读取阈值，不接收设备事件
+
+    // 预调温：按热模型提前开空调，起床或到家时刚好达到目标温度
+    ThermalModel thermalModels[AcPlanner::RoomCount];
+    QDateTime thermalModelsFittedAt;
+    double indoorTemperatures[AcPlanner::RoomCount];  // 存储线程读出的最近室温，NaN 表示没有读数
+    QTimer *preconditionTimers[AcPlanner::RoomCount];
+    QDateTime preconditionTargets[AcPlanner::RoomCount];
     
     // 灯光相关成员变量
     QMap<QPushButton*, bool> lightStates;
@@ -142,8 +253,12 @@ private:
     // 场景功能相关成员变量
     int outsideTemperature;  // 室外温度
     
+    // 场景调度器（定时任务）
+    SceneScheduler *sceneScheduler;
+
     // 起床模式相关成员变量
-    QTimer *wakeUpTimer;
+    static constexpr int WakeUpCatchUpMinutes = 30;  // 起床闹钟错过超过30分钟不再补执行
+    quint64 wakeUpJobId;  // 起床闹钟在调度器中的任务ID，0表示没有闹钟
     QDateTime wakeUpTime;
     QLabel *wakeUpStatusLabel;
     bool isWakeUpModeActive;
@@ -153,6 +268,17 @@ private:
     QMap<QString, int> customScene2Devices; // 0: 保持不变, 1: 开, 2: 关
     QString customScene1Name;
     QString customScene2Name;
+    QHash<QString, CustomSceneTarget> deviceTargets;                // 设备ID -> 设备的控件
+    QHash<QPushButton*, const CustomSceneTarget*> buttonTargets;    // 按钮 -> deviceTargets 中的条目
+    QHash<QString, const CustomSceneTarget*> customSceneTargets;    // 设备名 -> deviceTargets 中的条目
+
+    // 状态快照
+    static constexpr int SnapshotDelayMs = 1000;  // 状态变化后最多等待1秒写入，期间的变化合并为一次
+    QString snapshotPath;
+    QTimer *snapshotTimer;
+    qint64 historySequence;           // 界面状态已包含的 device_history 序号，写入快照；-1 表示未知
+    bool schedulesFromSnapshot;       // 定时任务已从快照恢复，数据库就绪后只补充和同步
+    QVector<quint64> snapshotJobIds;  // 从快照恢复的任务
 
 };
 #endif // MAINWINDOW_H
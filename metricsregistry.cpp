@@ -0,0 +1,174 @@
+#include "metricsregistry.h"
+#include <QMutexLocker>
+#include <algorithm>
+#include <cmath>
+
+// atomic<double> 在 C++17 中没有 fetch_add，用比较交换实现
+static void atomicAdd(std::atomic<double> &target, double delta)
+{
+    double expected = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(expected, expected + delta, std::memory_order_relaxed)) {
+    }
+}
+
+static QByteArray formatValue(double v)
+{
+    if (std::isinf(v)) {
+        return v > 0 ? "+Inf" : "-Inf";
+    }
+    return QByteArray::number(v, 'g', 15);
+}
+
+// 把 le 标签拼到已有的标签后面
+static QByteArray seriesLabels(const QString &labels, const QByteArray &extra = QByteArray())
+{
+    QByteArray all = labels.toUtf8();
+    if (!extra.isEmpty()) {
+        if (!all.isEmpty()) {
+            all += ',';
+        }
+        all += extra;
+    }
+    return all.isEmpty() ? QByteArray() : '{' + all + '}';
+}
+
+void MetricGauge::add(double delta)
+{
+    atomicAdd(current, delta);
+}
+
+MetricHistogram::MetricHistogram(const QVector<double> &upperBounds)
+    : upperBounds(upperBounds)
+    , buckets(new std::atomic<quint64>[upperBounds.size() + 1])
+{
+    std::sort(this->upperBounds.begin(), this->upperBounds.end());
+    for (int i = 0; i <= this->upperBounds.size(); ++i) {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void MetricHistogram::observe(double v)
+{
+    // 第一个上限 >= v 的桶；都小于 v 时落到 +Inf
+    int index = int(std::lower_bound(upperBounds.cbegin(), upperBounds.cend(), v) - upperBounds.cbegin());
+    buckets[index].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    atomicAdd(sumValue, v);
+}
+
+MetricTimer::MetricTimer(MetricHistogram &histogram)
+    : histogram(histogram)
+{
+    timer.start();
+}
+
+MetricTimer::~MetricTimer()
+{
+    histogram.observe(timer.nsecsElapsed() / 1e9);
+}
+
+MetricsRegistry &MetricsRegistry::instance()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricCounter &MetricsRegistry::counter(const QString &name, const QString &help, const QString &labels)
+{
+    QMutexLocker locker(&mutex);
+    Family<MetricCounter> &family = counters[name];
+    if (family.help.isEmpty()) {
+        family.help = help;
+    }
+    std::unique_ptr<MetricCounter> &series = family.series[labels];
+    if (!series) {
+        series.reset(new MetricCounter);
+    }
+    return *series;
+}
+
+MetricGauge &MetricsRegistry::gauge(const QString &name, const QString &help, const QString &labels)
+{
+    QMutexLocker locker(&mutex);
+    Family<MetricGauge> &family = gauges[name];
+    if (family.help.isEmpty()) {
+        family.help = help;
+    }
+    std::unique_ptr<MetricGauge> &series = family.series[labels];
+    if (!series) {
+        series.reset(new MetricGauge);
+    }
+    return *series;
+}
+
+MetricHistogram &MetricsRegistry::histogram(const QString &name, const QString &help, const QString &labels,
+                                            const QVector<double> &upperBounds)
+{
+    QMutexLocker locker(&mutex);
+    Family<MetricHistogram> &family = histograms[name];
+    if (family.help.isEmpty()) {
+        family.help = help;
+    }
+    std::unique_ptr<MetricHistogram> &series = family.series[labels];
+    if (!series) {
+        series.reset(new MetricHistogram(upperBounds));
+    }
+    return *series;
+}
+
+QByteArray MetricsRegistry::exposition() const
+{
+    QMutexLocker locker(&mutex);
+    QByteArray out;
+
+    for (const auto &family : counters) {
+        QByteArray name = family.first.toUtf8();
+        out += "# HELP " + name + ' ' + family.second.help.toUtf8() + '\n';
+        out += "# TYPE " + name + " counter\n";
+        for (const auto &series : family.second.series) {
+            out += name + seriesLabels(series.first) + ' ' + QByteArray::number(series.second->value()) + '\n';
+        }
+    }
+
+    for (const auto &family : gauges) {
+        QByteArray name = family.first.toUtf8();
+        out += "# HELP " + name + ' ' + family.second.help.toUtf8() + '\n';
+        out += "# TYPE " + name + " gauge\n";
+        for (const auto &series : family.second.series) {
+            out += name + seriesLabels(series.first) + ' ' + formatValue(series.second->value()) + '\n';
+        }
+    }
+
+    for (const auto &family : histograms) {
+        QByteArray name = family.first.toUtf8();
+        out += "# HELP " + name + ' ' + family.second.help.toUtf8() + '\n';
+        out += "# TYPE " + name + " histogram\n";
+        for (const auto &series : family.second.series) {
+            const MetricHistogram &histogram = *series.second;
+            QVector<double> bounds = histogram.bounds();
+            quint64 cumulative = 0;
+            for (int i = 0; i <= bounds.size(); ++i) {
+                cumulative += histogram.bucketCount(i);
+                QByteArray le = i < bounds.size() ? formatValue(bounds.at(i)) : QByteArray("+Inf");
+                out += name + "_bucket" + seriesLabels(series.first, "le=\"" + le + '"')
+                       + ' ' + QByteArray::number(cumulative) + '\n';
+            }
+            out += name + "_sum" + seriesLabels(series.first) + ' ' + formatValue(histogram.sum()) + '\n';
+            out += name + "_count" + seriesLabels(series.first) + ' ' + QByteArray::number(histogram.count()) + '\n';
+        }
+    }
+    return out;
+}
+
+QString MetricsRegistry::label(const QString &key, const QString &value)
+{
+    QString escaped = value;
+    escaped.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+    return key + "=\"" + escaped + '"';
+}
+
+QVector<double> MetricsRegistry::latencyBuckets()
+{
+    return {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+            0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0};
+}
@@ -0,0 +1,105 @@
+#ifndef METRICSREGISTRY_H
+#define METRICSREGISTRY_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <map>
+#include <memory>
+
+// 计数器：只增不减
+class MetricCounter
+{
+public:
+    void inc(quint64 n = 1) { count.fetch_add(n, std::memory_order_relaxed); }
+    quint64 value() const { return count.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<quint64> count{0};
+};
+
+// 仪表：当前值，可增可减
+class MetricGauge
+{
+public:
+    void set(double v) { current.store(v, std::memory_order_relaxed); }
+    void add(double delta);
+    double value() const { return current.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> current{0.0};
+};
+
+// 直方图：固定的桶上限，每个桶单独计数，导出时再累加成 Prometheus 的累计桶
+class MetricHistogram
+{
+public:
+    explicit MetricHistogram(const QVector<double> &upperBounds);
+
+    void observe(double v);
+
+    QVector<double> bounds() const { return upperBounds; }
+    quint64 bucketCount(int index) const { return buckets[index].load(std::memory_order_relaxed); }
+    quint64 count() const { return total.load(std::memory_order_relaxed); }
+    double sum() const { return sumValue.load(std::memory_order_relaxed); }
+
+private:
+    QVector<double> upperBounds;
+    std::unique_ptr<std::atomic<quint64>[]> buckets;  // 最后一个是 +Inf
+    std::atomic<quint64> total{0};
+    std::atomic<double> sumValue{0.0};
+};
+
+// 作用域计时：析构时把经过的秒数记入直方图
+class MetricTimer
+{
+public:
+    explicit MetricTimer(MetricHistogram &histogram);
+    ~MetricTimer();
+
+private:
+    MetricHistogram &histogram;
+    QElapsedTimer timer;
+};
+
+// 全局指标注册表
+// 注册（查找或创建）和导出需要加锁；返回的引用在程序运行期间一直有效，
+// 热路径上先缓存引用，之后的更新只是原子操作，不加锁
+class MetricsRegistry
+{
+public:
+    static MetricsRegistry &instance();
+
+    // labels 为 Prometheus 标签串，例如 label("type", "light")，同名指标的不同标签是不同的序列
+    MetricCounter &counter(const QString &name, const QString &help, const QString &labels = QString());
+    MetricGauge &gauge(const QString &name, const QString &help, const QString &labels = QString());
+    MetricHistogram &histogram(const QString &name, const QString &help, const QString &labels = QString(),
+                               const QVector<double> &upperBounds = latencyBuckets());
+
+    // Prometheus 文本格式（0.0.4）
+    QByteArray exposition() const;
+
+    // key="value"，转义反斜杠、引号和换行
+    static QString label(const QString &key, const QString &value);
+    // 100微秒 ~ 10秒，适合函数、SQL和网络请求的耗时（单位：秒）
+    static QVector<double> latencyBuckets();
+
+private:
+    MetricsRegistry() = default;
+
+    template <typename T>
+    struct Family {
+        QString help;
+        std::map<QString, std::unique_ptr<T>> series;  // 标签串 -> 序列
+    };
+
+    mutable QMutex mutex;
+    std::map<QString, Family<MetricCounter>> counters;
+    std::map<QString, Family<MetricGauge>> gauges;
+    std::map<QString, Family<MetricHistogram>> histograms;
+};
+
+#endif // METRICSREGISTRY_H
@@ -0,0 +1,97 @@
+#include "metricsserver.h"
+#include "metricsregistry.h"
+#include <QDebug>
+#include <QTcpSocket>
+
+static const int MaxRequestHeaderBytes = 8192;
+
+MetricsServer::MetricsServer(QObject *parent)
+    : QObject(parent)
+{
+    connect(&server, &QTcpServer::newConnection, this, &MetricsServer::onNewConnection);
+}
+
+bool MetricsServer::listen(quint16 port)
+{
+    // 只监听本机地址，指标不对局域网开放
+    if (!server.listen(QHostAddress::LocalHost, port)) {
+        qWarning() << "指标服务监听失败:" << server.errorString();
+        return false;
+    }
+    qDebug() << "指标服务已启动: http://127.0.0.1:" << server.serverPort() << "/metrics";
+    return true;
+}
+
+quint16 MetricsServer::port() const
+{
+    return server.serverPort();
+}
+
+quint16 MetricsServer::portFromEnvironment()
+{
+    QByteArray value = qgetenv("SMARTHOME_METRICS_PORT");
+    if (value.isEmpty()) {
+        return DefaultPort;
+    }
+    return quint16(value.toUInt());
+}
+
+void MetricsServer::onNewConnection()
+{
+    while (QTcpSocket *socket = server.nextPendingConnection()) {
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            handleRequest(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            pendingRequests.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void MetricsServer::handleRequest(QTcpSocket *socket)
+{
+    QByteArray &buffer = pendingRequests[socket];
+    buffer.append(socket->readAll());
+
+    // 请求头未读完，等待更多数据；过长的请求直接断开
+    int headerEnd = buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        if (buffer.size() > MaxRequestHeaderBytes) {
+            pendingRequests.remove(socket);
+            socket->abort();
+        }
+        return;
+    }
+
+    QByteArray requestLine = buffer.left(buffer.indexOf('\n')).trimmed();
+    pendingRequests.remove(socket);
+
+    // 请求行：GET /metrics HTTP/1.1
+    QList<QByteArray> parts = requestLine.split(' ');
+    QByteArray method = parts.value(0);
+    QByteArray target = parts.value(1);
+    QByteArray path = target.left(target.indexOf('?') < 0 ? target.size() : target.indexOf('?'));
+
+    if (method != "GET") {
+        writeResponse(socket, 405, "Method Not Allowed", "text/plain; charset=utf-8", "only GET is supported\n");
+    } else if (path != "/metrics") {
+        writeResponse(socket, 404, "Not Found", "text/plain; charset=utf-8", "see /metrics\n");
+    } else {
+        writeResponse(socket, 200, "OK", "text/plain; version=0.0.4; charset=utf-8",
+                      MetricsRegistry::instance().exposition());
+    }
+}
+
+void MetricsServer::writeResponse(QTcpSocket *socket, int status, const QByteArray &reason,
+                                  const QByteArray &contentType, const QByteArray &body)
+{
+    QByteArray response = "HTTP/1.1 " + QByteArray::number(status) + ' ' + reason + "\r\n";
+    response += "Content-Type: " + contentType + "\r\n";
+    response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    response += "Connection: close\r\n\r\n";
+    response += body;
+
+    socket->write(response);
+    socket->disconnectFromHost();
+}
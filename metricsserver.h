@@ -0,0 +1,39 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QTcpServer>
+
+class QTcpSocket;
+
+// 指标导出：只监听本机，GET /metrics 返回 MetricsRegistry 的 Prometheus 文本格式
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const quint16 DefaultPort = 9464;
+
+    explicit MetricsServer(QObject *parent = nullptr);
+
+    bool listen(quint16 port);
+    quint16 port() const;
+
+    // 环境变量 SMARTHOME_METRICS_PORT 指定端口，为0时不启动
+    static quint16 portFromEnvironment();
+
+private slots:
+    void onNewConnection();
+
+private:
+    void handleRequest(QTcpSocket *socket);
+    void writeResponse(QTcpSocket *socket, int status, const QByteArray &reason,
+                       const QByteArray &contentType, const QByteArray &body);
+
+    QTcpServer server;
+    QHash<QTcpSocket*, QByteArray> pendingRequests;  // 尚未读完请求头的连接
+};
+
+#endif // METRICSSERVER_H
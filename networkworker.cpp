@@ -0,0 +1,191 @@
+#include "networkworker.h"
+#include "metricsserver.h"
+#include "weatherprovider.h"
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+
+NetworkWorker::NetworkWorker(WeatherProvider *provider, QObject *parent)
+    : QObject(parent)
+    , provider(provider)
+    , manager(nullptr)
+    , weatherReply(nullptr)
+    , forecastReply(nullptr)
+    , metricsServer(nullptr)
+{
+    qRegisterMetaType<WeatherFetchResult>("WeatherFetchResult");
+    qRegisterMetaType<ForecastFetchResult>("ForecastFetchResult");
+}
+
+NetworkWorker::~NetworkWorker()
+{
+    if (weatherReply) {
+        weatherReply->abort();
+        weatherReply->deleteLater();
+    }
+    if (forecastReply) {
+        forecastReply->abort();
+        forecastReply->deleteLater();
+    }
+    delete provider;
+}
+
+QNetworkAccessManager *NetworkWorker::networkManager()
+{
+    if (!manager) {
+        manager = new QNetworkAccessManager(this);
+    }
+    return manager;
+}
+
+void NetworkWorker::fetchWeather(const QByteArray &etag, const QByteArray &lastModified)
+{
+    // 上一次请求尚未完成，不重复发起
+    if (weatherReply) {
+        qDebug() << "天气请求进行中，跳过本次更新";
+        return;
+    }
+
+    QNetworkRequest request = provider->currentWeatherRequest();
+    // 条件请求：数据未变化时服务器返回304，不必重新传输和解析
+    if (!etag.isEmpty()) {
+        request.setRawHeader("If-None-Match", etag);
+    }
+    if (!lastModified.isEmpty()) {
+        request.setRawHeader("If-Modified-Since", lastModified);
+    }
+
+    weatherFetchTimer.start();
+    weatherReply = networkManager()->get(request);
+    connect(weatherReply, &QNetworkReply::finished, this, &NetworkWorker::onWeatherReplyFinished);
+}
+
+void NetworkWorker::fetchForecast()
+{
+    if (forecastReply) {
+        qDebug() << "预报请求进行中，跳过本次更新";
+        return;
+    }
+
+    forecastFetchTimer.start();
+    forecastReply = networkManager()->get(provider->hourlyForecastRequest());
+    connect(forecastReply, &QNetworkReply::finished, this, &NetworkWorker::onForecastReplyFinished);
+}
+
+void NetworkWorker::startMetricsServer(quint16 port)
+{
+    if (port == 0 || metricsServer) {
+        return;
+    }
+    metricsServer = new MetricsServer(this);
+    metricsServer->listen(port);
+}
+
+void NetworkWorker::onWeatherReplyFinished()
+{
+    QNetworkReply *reply = weatherReply;
+    weatherReply = nullptr;
+    reply->deleteLater();
+
+    WeatherFetchResult result;
+    result.seconds = weatherFetchTimer.nsecsElapsed() / 1e9;
+
+    int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (httpStatus == 304) {
+        result.status = WeatherFetchResult::NotModified;
+        emit weatherFetched(result);
+        return;
+    }
+
+    if (reply->error() != QNetworkReply::NoError) {
+        result.status = WeatherFetchResult::NetworkError;
+        result.error = reply->errorString();
+        emit weatherFetched(result);
+        return;
+    }
+
+    QByteArray responseData = reply->readAll();
+    qDebug() << "天气请求成功，响应代码:" << httpStatus << "数据长度:" << responseData.size();
+
+    QJsonParseError jsonError;
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(responseData, &jsonError);
+    if (jsonError.error != QJsonParseError::NoError) {
+        result.status = WeatherFetchResult::InvalidResponse;
+        result.error = jsonError.errorString();
+        emit weatherFetched(result);
+        return;
+    }
+
+    // 检查API返回的状态码
+    QJsonObject jsonObj = jsonDoc.object();
+    if (jsonObj.contains("code") && jsonObj["code"].toString() != "200") {
+        result.status = WeatherFetchResult::InvalidResponse;
+        result.error = "和风天气API返回错误: " + jsonObj["code"].toString();
+        emit weatherFetched(result);
+        return;
+    }
+
+    result.status = WeatherFetchResult::Updated;
+    result.observation = jsonObj;
+    result.etag = reply->rawHeader("ETag");
+    result.lastModified = reply->rawHeader("Last-Modified");
+    emit weatherFetched(result);
+}
+
+void NetworkWorker::onForecastReplyFinished()
+{
+    QNetworkReply *reply = forecastReply;
+    forecastReply = nullptr;
+    reply->deleteLater();
+
+    ForecastFetchResult result;
+    result.seconds = forecastFetchTimer.nsecsElapsed() / 1e9;
+
+    if (reply->error() != QNetworkReply::NoError) {
+        result.error = reply->errorString();
+        emit forecastFetched(result);
+        return;
+    }
+
+    QJsonParseError jsonError;
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(reply->readAll(), &jsonError);
+    if (jsonError.error != QJsonParseError::NoError) {
+        result.error = "预报JSON解析错误: " + jsonError.errorString();
+        emit forecastFetched(result);
+        return;
+    }
+
+    QJsonObject jsonObj = jsonDoc.object();
+    if (jsonObj["code"].toString() != "200") {
+        result.error = "和风天气预报API返回错误: " + jsonObj["code"].toString();
+        emit forecastFetched(result);
+        return;
+    }
+
+    result.ok = true;
+    result.forecast = parseForecast(jsonObj);
+    emit forecastFetched(result);
+}
+
+// 逐小时预报：时间和温度都有效的小时才保留
+QVector<HourlyForecast> NetworkWorker::parseForecast(const QJsonObject &jsonObj)
+{
+    QJsonArray hourly = jsonObj["hourly"].toArray();
+    QVector<HourlyForecast> forecast;
+    forecast.reserve(hourly.size());
+    for (const QJsonValue &value : hourly) {
+        QJsonObject hourObj = value.toObject();
+        HourlyForecast item;
+        item.hour = QDateTime::fromString(hourObj["fxTime"].toString(), Qt::ISODate);
+        bool ok = false;
+        item.temp = hourObj["temp"].toString().toInt(&ok);
+        if (item.hour.isValid() && ok) {
+            forecast.append(item);
+        }
+    }
+    return forecast;
+}
@@ -0,0 +1,84 @@
+#ifndef NETWORKWORKER_H
+#define NETWORKWORKER_H
+
+#include "acplanner.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+class MetricsServer;
+class QNetworkAccessManager;
+class QNetworkReply;
+class WeatherProvider;
+
+// 一次实况天气请求的结果，JSON 已在网络线程中解析
+struct WeatherFetchResult
+{
+    enum Status {
+        Updated,          // 200，observation 是完整的API响应
+        NotModified,      // 304，缓存内容仍然有效
+        NetworkError,     // 请求失败
+        InvalidResponse   // JSON 无法解析或API返回错误码
+    };
+
+    Status status = NetworkError;
+    QJsonObject observation;
+    QByteArray etag;
+    QByteArray lastModified;
+    QString error;
+    double seconds = 0.0;  // 请求耗时
+};
+Q_DECLARE_METATYPE(WeatherFetchResult)
+
+// 一次逐小时预报请求的结果
+struct ForecastFetchResult
+{
+    bool ok = false;                    // 请求成功且API返回200
+    QVector<HourlyForecast> forecast;   // 时间和温度都有效的小时
+    QString error;
+    double seconds = 0.0;
+};
+Q_DECLARE_METATYPE(ForecastFetchResult)
+
+// 网络线程：持有 QNetworkAccessManager 和指标导出服务，天气响应的读取和 JSON 解析都在这里完成，
+// 界面线程只收到解析好的结果。重试、熔断和缓存仍由界面线程根据结果决定
+class NetworkWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 接管 provider 的所有权
+    explicit NetworkWorker(WeatherProvider *provider, QObject *parent = nullptr);
+    ~NetworkWorker();
+
+public slots:
+    // 条件请求头由调用方按天气缓存给出，为空时发普通请求；上一次请求未完成时忽略
+    void fetchWeather(const QByteArray &etag, const QByteArray &lastModified);
+    void fetchForecast();
+    // 端口为0时不启动
+    void startMetricsServer(quint16 port);
+
+signals:
+    void weatherFetched(const WeatherFetchResult &result);
+    void forecastFetched(const ForecastFetchResult &result);
+
+private:
+    QNetworkAccessManager *networkManager();
+    void onWeatherReplyFinished();
+    void onForecastReplyFinished();
+    static QVector<HourlyForecast> parseForecast(const QJsonObject &jsonObj);
+
+    WeatherProvider *provider;
+    QNetworkAccessManager *manager;  // 第一次请求时在网络线程中创建
+    QNetworkReply *weatherReply;
+    QNetworkReply *forecastReply;
+    QElapsedTimer weatherFetchTimer;
+    QElapsedTimer forecastFetchTimer;
+    MetricsServer *metricsServer;
+};
+
+#endif // NETWORKWORKER_H
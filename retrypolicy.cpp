@@ -0,0 +1,91 @@
+#include "retrypolicy.h"
+#include <QRandomGenerator>
+
+ExponentialBackoff::ExponentialBackoff(int baseDelayMs, int maxDelayMs)
+    : baseDelay(baseDelayMs)
+    , maxDelay(maxDelayMs)
+    , attemptCount(0)
+{
+}
+
+int ExponentialBackoff::nextDelayMs()
+{
+    // 限制移位次数，避免溢出
+    int shift = qMin(attemptCount, 20);
+    qint64 ceiling = qMin<qint64>(maxDelay, qint64(baseDelay) << shift);
+    attemptCount++;
+
+    // 保留一秒的下限，防止抖动后立即重试
+    int delay = QRandomGenerator::global()->bounded(int(ceiling) + 1);
+    return qMax(delay, 1000);
+}
+
+void ExponentialBackoff::reset()
+{
+    attemptCount = 0;
+}
+
+int ExponentialBackoff::attempts() const
+{
+    return attemptCount;
+}
+
+CircuitBreaker::CircuitBreaker(int failureThreshold, int cooldownMs)
+    : threshold(failureThreshold)
+    , cooldown(cooldownMs)
+    , consecutiveFailures(0)
+    , currentState(Closed)
+{
+}
+
+bool CircuitBreaker::allowRequest(const QDateTime &now)
+{
+    switch (currentState) {
+    case Closed:
+        return true;
+    case Open:
+        if (remainingCooldownMs(now) > 0) {
+            return false;
+        }
+        // 冷却结束，只放行一次试探请求
+        currentState = HalfOpen;
+        return true;
+    case HalfOpen:
+        // 试探请求尚未返回，不再放行
+        return false;
+    }
+    return false;
+}
+
+void CircuitBreaker::recordSuccess()
+{
+    consecutiveFailures = 0;
+    currentState = Closed;
+}
+
+void CircuitBreaker::recordFailure(const QDateTime &now)
+{
+    consecutiveFailures++;
+    if (currentState == HalfOpen || consecutiveFailures >= threshold) {
+        currentState = Open;
+        openedAt = now;
+    }
+}
+
+CircuitBreaker::State CircuitBreaker::state() const
+{
+    return currentState;
+}
+
+qint64 CircuitBreaker::remainingCooldownMs(const QDateTime &now) const
+{
+    if (currentState != Open) {
+        return 0;
+    }
+    qint64 elapsed = openedAt.msecsTo(now);
+    if (elapsed < 0) {
+        // 系统时间被调回，重新计时
+        return cooldown;
+    }
+    return qMax<qint64>(0, cooldown - elapsed);
+}
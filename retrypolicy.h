@@ -0,0 +1,54 @@
+#ifndef RETRYPOLICY_H
+#define RETRYPOLICY_H
+
+#include <QDateTime>
+#include <QtGlobal>
+
+// 指数退避：第n次重试的等待时间在 [0, min(maxDelay, baseDelay * 2^n)] 内随机（full jitter），
+// 多台面板同时断网恢复时不会在同一时刻一起重试
+class ExponentialBackoff
+{
+public:
+    ExponentialBackoff(int baseDelayMs = 5000, int maxDelayMs = 10 * 60 * 1000);
+
+    // 返回下一次重试的等待时间，并增加重试次数
+    int nextDelayMs();
+    void reset();
+    int attempts() const;
+
+private:
+    int baseDelay;
+    int maxDelay;
+    int attemptCount;
+};
+
+// 熔断器：连续失败达到阈值后断开，冷却期内不再发起请求；
+// 冷却期结束后放行一次试探请求（半开），成功则闭合，失败则重新断开
+class CircuitBreaker
+{
+public:
+    enum State {
+        Closed,
+        Open,
+        HalfOpen
+    };
+
+    CircuitBreaker(int failureThreshold = 5, int cooldownMs = 30 * 60 * 1000);
+
+    bool allowRequest(const QDateTime &now = QDateTime::currentDateTime());
+    void recordSuccess();
+    void recordFailure(const QDateTime &now = QDateTime::currentDateTime());
+
+    State state() const;
+    // 距离允许下一次试探请求还有多久（毫秒），闭合状态下为0
+    qint64 remainingCooldownMs(const QDateTime &now = QDateTime::currentDateTime()) const;
+
+private:
+    int threshold;
+    int cooldown;
+    int consecutiveFailures;
+    State currentState;
+    QDateTime openedAt;
+};
+
+#endif // RETRYPOLICY_H
@@ -0,0 +1,317 @@
+#include "ruleengine.h"
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QStandardPaths>
+#include <QtMath>
+
+// 动作可能改变设备状态并触发新的规则，限制连锁深度防止规则互相触发形成死循环
+static const int MaxEvaluationDepth = 8;
+
+RuleEngine::RuleEngine(QObject *parent)
+    : QObject(parent)
+    , evaluationDepth(0)
+{
+    qRegisterMetaType<RuleAction>("RuleAction");
+}
+
+bool RuleEngine::loadRules(const QByteArray &json, QString *errorMessage)
+{
+    QJsonParseError jsonError;
+    QJsonDocument doc = QJsonDocument::fromJson(json, &jsonError);
+    if (jsonError.error != QJsonParseError::NoError || !doc.isArray()) {
+        if (errorMessage) {
+            *errorMessage = "规则JSON解析失败: " + jsonError.errorString();
+        }
+        return false;
+    }
+
+    QVector<Rule> newRules;
+    const QJsonArray ruleArray = doc.array();
+    for (const QJsonValue &ruleValue : ruleArray) {
+        QJsonObject ruleObj = ruleValue.toObject();
+        Rule rule;
+        rule.id = ruleObj["id"].toString();
+        rule.description = ruleObj["description"].toString();
+
+        const QJsonArray whenArray = ruleObj["when"].toArray();
+        for (const QJsonValue &conditionValue : whenArray) {
+            QJsonObject conditionObj = conditionValue.toObject();
+            QString op = conditionObj["op"].toString();
+            RuleCondition condition;
+            if (!parseOp(op, &condition.op)) {
+                if (errorMessage) {
+                    *errorMessage = QString("规则 %1 的比较运算符无效: %2").arg(rule.id, op);
+                }
+                return false;
+            }
+            condition.input = inputIndex(conditionObj["input"].toString());
+            condition.value = conditionObj["value"].toDouble();
+            rule.conditions.append(condition);
+        }
+
+        const QJsonArray thenArray = ruleObj["then"].toArray();
+        for (const QJsonValue &actionValue : thenArray) {
+            QJsonObject actionObj = actionValue.toObject();
+            RuleActionTemplate action;
+            action.deviceId = actionObj["device"].toString();
+            action.command = actionObj["command"].toString();
+            action.value = actionObj["value"].toVariant().toString();
+            if (actionObj.contains("input")) {
+                action.valueInput = inputIndex(actionObj["input"].toString());
+                action.offset = actionObj["offset"].toDouble();
+            }
+            rule.actions.append(action);
+        }
+
+        if (rule.id.isEmpty() || rule.conditions.isEmpty() || rule.actions.isEmpty()) {
+            if (errorMessage) {
+                *errorMessage = QString("规则缺少 id、when 或 then: %1").arg(rule.id);
+            }
+            return false;
+        }
+        newRules.append(rule);
+    }
+
+    // 重建输入 -> 规则索引
+    rules = newRules;
+    rulesByInput.fill(QVector<int>(), inputKeys.size());
+    for (int ruleIndex = 0; ruleIndex < rules.size(); ++ruleIndex) {
+        for (const RuleCondition &condition : rules.at(ruleIndex).conditions) {
+            QVector<int> &dependents = rulesByInput[condition.input];
+            if (!dependents.contains(ruleIndex)) {
+                dependents.append(ruleIndex);
+            }
+        }
+    }
+
+    qDebug() << "规则加载完成，共" << rules.size() << "条规则，" << inputKeys.size() << "个输入";
+    emit rulesReloaded();
+    return true;
+}
+
+bool RuleEngine::loadDefaultRules()
+{
+    QString userRules = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/rules.json";
+    QString path = QFile::exists(userRules) ? userRules : QString(":/rules/default_rules.json");
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCritical() << "无法读取规则文件:" << path;
+        return false;
+    }
+
+    QString errorMessage;
+    if (!loadRules(file.readAll(), &errorMessage)) {
+        qCritical() << "加载规则失败:" << path << errorMessage;
+        return false;
+    }
+    qDebug() << "已加载规则文件:" << path;
+    return true;
+}
+
+int RuleEngine::inputIndex(const QString &key)
+{
+    auto it = inputIds.constFind(key);
+    if (it != inputIds.constEnd()) {
+        return it.value();
+    }
+
+    int index = inputKeys.size();
+    inputIds.insert(key, index);
+    inputKeys.append(key);
+    inputValues.append(qQNaN());
+    rulesByInput.append(QVector<int>());
+    return index;
+}
+
+int RuleEngine::findInput(const QString &key) const
+{
+    return inputIds.value(key, -1);
+}
+
+void RuleEngine::setInput(const QString &key, double value)
+{
+    setInput(inputIndex(key), value);
+}
+
+void RuleEngine::setInput(int input, double value)
+{
+    if (input < 0 || input >= inputValues.size()) {
+        return;
+    }
+    // 值没有变化时不需要重新计算
+    if (inputValues.at(input) == value) {
+        return;
+    }
+    inputValues[input] = value;
+    evaluateDependents(input);
+}
+
+double RuleEngine::inputValue(const QString &key) const
+{
+    int input = findInput(key);
+    return input >= 0 ? inputValues.at(input) : qQNaN();
+}
+
+double RuleEngine::inputValue(int input) const
+{
+    return (input >= 0 && input < inputValues.size()) ? inputValues.at(input) : qQNaN();
+}
+
+void RuleEngine::fireEvent(const QString &key)
+{
+    fireEvent(inputIndex(key));
+}
+
+void RuleEngine::fireEvent(int input)
+{
+    setInput(input, 1.0);
+    // 恢复为0，相关规则回到不满足状态，下次事件可以再次触发
+    setInput(input, 0.0);
+}
+
+QVector<RuleAction> RuleEngine::dryRun(const QString &eventKey, const QHash<QString, double> &overrides) const
+{
+    QVector<RuleAction> actions;
+    int eventInput = findInput(eventKey);
+    if (eventInput < 0) {
+        return actions;
+    }
+
+    QVector<double> values = inputValues;
+    for (auto it = overrides.constBegin(); it != overrides.constEnd(); ++it) {
+        int input = findInput(it.key());
+        if (input >= 0) {
+            values[input] = it.value();
+        }
+    }
+    values[eventInput] = 1.0;
+
+    for (int ruleIndex : rulesByInput.at(eventInput)) {
+        const Rule &rule = rules.at(ruleIndex);
+        if (!evaluateRule(rule, values)) {
+            continue;
+        }
+        for (const RuleActionTemplate &action : rule.actions) {
+            actions.append(resolveAction(rule, action, values));
+        }
+    }
+    return actions;
+}
+
+QVector<double> RuleEngine::conditionValues(const QString &key) const
+{
+    QVector<double> values;
+    int input = findInput(key);
+    if (input < 0) {
+        return values;
+    }
+    for (int ruleIndex : rulesByInput.at(input)) {
+        for (const RuleCondition &condition : rules.at(ruleIndex).conditions) {
+            if (condition.input == input && !values.contains(condition.value)) {
+                values.append(condition.value);
+            }
+        }
+    }
+    return values;
+}
+
+int RuleEngine::ruleCount() const
+{
+    return rules.size();
+}
+
+bool RuleEngine::parseOp(const QString &text, RuleCondition::Op *op)
+{
+    static const QHash<QString, RuleCondition::Op> ops = {
+        {"<", RuleCondition::Less}, {"<=", RuleCondition::LessEqual},
+        {">", RuleCondition::Greater}, {">=", RuleCondition::GreaterEqual},
+        {"==", RuleCondition::Equal}, {"!=", RuleCondition::NotEqual}
+    };
+    auto it = ops.constFind(text);
+    if (it == ops.constEnd()) {
+        return false;
+    }
+    *op = it.value();
+    return true;
+}
+
+bool RuleEngine::evaluateCondition(const RuleCondition &condition, double value)
+{
+    // NaN（未设置的输入）与任何值比较都不成立
+    switch (condition.op) {
+    case RuleCondition::Less:
+        return value < condition.value;
+    case RuleCondition::LessEqual:
+        return value <= condition.value;
+    case RuleCondition::Greater:
+        return value > condition.value;
+    case RuleCondition::GreaterEqual:
+        return value >= condition.value;
+    case RuleCondition::Equal:
+        return value == condition.value;
+    case RuleCondition::NotEqual:
+        return !qIsNaN(value) && value != condition.value;
+    }
+    return false;
+}
+
+bool RuleEngine::evaluateRule(const Rule &rule, const QVector<double> &values) const
+{
+    for (const RuleCondition &condition : rule.conditions) {
+        if (!evaluateCondition(condition, values.at(condition.input))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+RuleAction RuleEngine::resolveAction(const Rule &rule, const RuleActionTemplate &action, const QVector<double> &values) const
+{
+    RuleAction resolved;
+    resolved.ruleId = rule.id;
+    resolved.deviceId = action.deviceId;
+    resolved.command = action.command;
+    if (action.valueInput >= 0) {
+        resolved.value = QString::number(qRound(values.at(action.valueInput) + action.offset));
+    } else {
+        resolved.value = action.value;
+    }
+    return resolved;
+}
+
+void RuleEngine::evaluateDependents(int input)
+{
+    if (evaluationDepth >= MaxEvaluationDepth) {
+        qWarning() << "规则连锁触发层数过多，停止计算:" << inputKeys.at(input);
+        return;
+    }
+
+    // 先算出全部结果再执行动作，动作引起的输入变化在下一层处理
+    QVector<RuleAction> fired;
+    for (int ruleIndex : rulesByInput.at(input)) {
+        Rule &rule = rules[ruleIndex];
+        bool result = evaluateRule(rule, inputValues);
+        if (result && !rule.lastResult) {
+            for (const RuleActionTemplate &action : rule.actions) {
+                fired.append(resolveAction(rule, action, inputValues));
+            }
+        }
+        rule.lastResult = result;
+    }
+
+    if (fired.isEmpty()) {
+        return;
+    }
+
+    evaluationDepth++;
+    for (const RuleAction &action : fired) {
+        qDebug() << "规则触发:" << action.ruleId << action.deviceId << action.command << action.value;
+        emit actionTriggered(action);
+    }
+    evaluationDepth--;
+}
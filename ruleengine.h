@@ -0,0 +1,122 @@
+#ifndef RULEENGINE_H
+#define RULEENGINE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+// 规则条件：输入值与常量比较
+struct RuleCondition
+{
+    enum Op {
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Equal,
+        NotEqual
+    };
+
+    int input = -1;   // 输入在规则引擎中的编号
+    Op op = Equal;
+    double value = 0.0;
+};
+
+// 规则动作模板：值可以是常量，也可以是某个输入加偏移（例如室外温度-2）
+struct RuleActionTemplate
+{
+    QString deviceId;
+    QString command;      // power / mode / temperature / lock
+    QString value;        // 常量值
+    int valueInput = -1;  // >=0 时值取该输入
+    double offset = 0.0;
+};
+
+// 规则触发后产生的设备命令
+struct RuleAction
+{
+    QString ruleId;
+    QString deviceId;
+    QString command;
+    QString value;
+};
+Q_DECLARE_METATYPE(RuleAction)
+
+struct Rule
+{
+    QString id;
+    QString description;
+    QVector<RuleCondition> conditions;
+    QVector<RuleActionTemplate> actions;
+    bool lastResult = false;  // 边沿触发：条件从不满足变为满足时才执行动作
+};
+
+// 增量规则引擎：
+// 输入（传感器值、时间、设备状态、场景事件）用字符串键注册后转为整数编号，
+// 每个输入维护一个依赖它的规则列表，输入变化时只重新计算这些规则
+//
+// 输入键约定：
+//   sensor.outside       室外温度
+//   time.hour            当前小时
+//   time.weekday         星期（1=周一 ... 7=周日）
+//   device.<设备ID>      设备状态（1开/0关）
+//   setpoint.<设备ID>    空调当前的设定温度，收到设定之前没有值
+//   scene.<场景ID>       场景事件（触发时瞬间为1）
+//   plan.<房间>          空调计划的计算事件，由 AcPlanner 试算使用
+class RuleEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RuleEngine(QObject *parent = nullptr);
+
+    // 从JSON加载规则，替换现有规则
+    bool loadRules(const QByteArray &json, QString *errorMessage = nullptr);
+    // 加载内置规则，配置目录中存在 rules.json 时优先使用
+    bool loadDefaultRules();
+
+    int inputIndex(const QString &key);
+    int findInput(const QString &key) const;
+
+    void setInput(const QString &key, double value);
+    void setInput(int input, double value);
+    double inputValue(const QString &key) const;
+    double inputValue(int input) const;
+
+    // 触发瞬时事件：输入置1并计算依赖的规则，随后恢复为0
+    void fireEvent(const QString &key);
+    void fireEvent(int input);
+
+    // 试算：在当前输入的基础上覆盖部分输入，返回事件会触发的动作，不改变引擎状态
+    QVector<RuleAction> dryRun(const QString &eventKey, const QHash<QString, double> &overrides) const;
+
+    // 所有规则中与某个输入比较的常量，例如 sensor.outside 的阈值 15 和 26
+    QVector<double> conditionValues(const QString &key) const;
+
+    int ruleCount() const;
+
+    // 比较运算符 "<" "<=" ">" ">=" "==" "!="，场景序列的条件使用同样的写法
+    static bool parseOp(const QString &text, RuleCondition::Op *op);
+    static bool evaluateCondition(const RuleCondition &condition, double value);
+
+signals:
+    void actionTriggered(const RuleAction &action);
+    void rulesReloaded();
+
+private:
+    bool evaluateRule(const Rule &rule, const QVector<double> &values) const;
+    RuleAction resolveAction(const Rule &rule, const RuleActionTemplate &action, const QVector<double> &values) const;
+    void evaluateDependents(int input);
+
+    QHash<QString, int> inputIds;
+    QVector<QString> inputKeys;
+    QVector<double> inputValues;              // 未设置的输入为 NaN，与它比较的条件都不成立
+    QVector<QVector<int>> rulesByInput;       // 输入编号 -> 依赖该输入的规则
+    QVector<Rule> rules;
+    int evaluationDepth;
+};
+
+#endif // RULEENGINE_H
@@ -0,0 +1,314 @@
+#include "sceneanalytics.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QStringList>
+#include <algorithm>
+
+static const QString TimestampFormat = QStringLiteral("yyyy-MM-dd hh:mm:ss");
+
+// 界面上用户直接操作的记录类型，场景和规则的 turn_on/turn_off 不算
+static const QStringList ManualActions = { QStringLiteral("toggle"), QStringLiteral("lock") };
+
+int SceneUsage::busiestHour() const
+{
+    if (runs == 0 || runsByHour.isEmpty()) {
+        return -1;
+    }
+    return int(std::max_element(runsByHour.cbegin(), runsByHour.cend()) - runsByHour.cbegin());
+}
+
+SceneAnalytics::SceneAnalytics(const QSqlDatabase &database, int overrideMinutes)
+    : db(database)
+    , overrideSecs(overrideMinutes * 60)
+{
+}
+
+bool SceneAnalytics::ensureSchema()
+{
+    if (!db.isOpen()) {
+        qWarning() << "数据库未打开，无法初始化scene_usage表。";
+        return false;
+    }
+
+    // 新建表和回填在同一个事务中：回填失败时表也不保留，下次打开时重新回填
+    bool created = !db.tables().contains("scene_usage");
+    if (created && !db.transaction()) {
+        qCritical() << "开始scene_usage初始化事务失败:" << db.lastError().text();
+        return false;
+    }
+    auto fail = [this, created]() {
+        if (created) {
+            db.rollback();
+        }
+        rollback();
+        return false;
+    };
+
+    QSqlQuery query(db);
+    if (!query.exec(R"(
+        CREATE TABLE IF NOT EXISTS scene_usage (
+            scene_id TEXT NOT NULL,
+            hour_of_week INTEGER NOT NULL,
+            runs INTEGER NOT NULL DEFAULT 0,
+            overridden INTEGER NOT NULL DEFAULT 0,
+            PRIMARY KEY (scene_id, hour_of_week)
+        )
+    )")) {
+        qCritical() << "创建scene_usage表失败:" << query.lastError().text();
+        return fail();
+    }
+
+    upsertQuery = QSqlQuery(db);
+    if (!upsertQuery.prepare(R"(
+            INSERT INTO scene_usage (scene_id, hour_of_week, runs, overridden) VALUES (?, ?, ?, ?)
+            ON CONFLICT (scene_id, hour_of_week)
+            DO UPDATE SET runs = runs + excluded.runs, overridden = overridden + excluded.overridden
+        )")) {
+        qCritical() << "准备scene_usage写入语句失败:" << upsertQuery.lastError().text();
+        return fail();
+    }
+
+    if (query.exec("SELECT scene_id, name FROM scenes")) {
+        QMutexLocker locker(&mutex);
+        while (query.next()) {
+            sceneNames.insert(query.value(0).toString(), query.value(1).toString());
+        }
+    }
+
+    if (created) {
+        if (!backfill()) {
+            return fail();
+        }
+        if (!db.commit()) {
+            qCritical() << "提交场景统计回填失败:" << db.lastError().text();
+            return fail();
+        }
+        commit();
+    }
+    return loadUsage();
+}
+
+// 按时间顺序合并 scene_history（本地时间）和手动操作的 device_history（UTC），逐条走增量更新的路径；
+// 在 ensureSchema 建表的事务中执行
+bool SceneAnalytics::backfill()
+{
+    QSqlQuery sceneQuery(db);
+    sceneQuery.setForwardOnly(true);
+    QSqlQuery deviceQuery(db);
+    deviceQuery.setForwardOnly(true);
+    QStringList placeholders;
+    for (int i = 0; i < ManualActions.size(); ++i) {
+        placeholders << "?";
+    }
+    deviceQuery.prepare(QString("SELECT action_type, timestamp FROM device_history WHERE action_type IN (%1) "
+                                "ORDER BY timestamp, id").arg(placeholders.join(", ")));
+    for (const QString &action : ManualActions) {
+        deviceQuery.addBindValue(action);
+    }
+    if (!sceneQuery.exec("SELECT scene_id, timestamp FROM scene_history ORDER BY timestamp, id")
+        || !deviceQuery.exec()) {
+        qCritical() << "读取场景统计的历史记录失败:" << sceneQuery.lastError().text()
+                    << deviceQuery.lastError().text();
+        return false;
+    }
+
+    // 跳过没有时间的记录
+    auto nextScene = [&sceneQuery]() {
+        while (sceneQuery.next()) {
+            QDateTime at = QDateTime::fromString(sceneQuery.value(1).toString(), TimestampFormat);
+            if (at.isValid()) {
+                return at;
+            }
+        }
+        return QDateTime();
+    };
+    auto nextDevice = [&deviceQuery]() {
+        while (deviceQuery.next()) {
+            QDateTime at = QDateTime::fromString(deviceQuery.value(1).toString(), TimestampFormat);
+            if (at.isValid()) {
+                at.setTimeSpec(Qt::UTC);
+                return at.toLocalTime();
+            }
+        }
+        return QDateTime();
+    };
+
+    int sceneRows = 0;
+    QDateTime sceneAt = nextScene();
+    QDateTime deviceAt = nextDevice();
+    while (sceneAt.isValid() || deviceAt.isValid()) {
+        // 同一秒内先计场景运行，紧接着的手动操作算作调整
+        if (sceneAt.isValid() && (!deviceAt.isValid() || sceneAt <= deviceAt)) {
+            recordSceneRun(sceneQuery.value(0).toString(), sceneAt);
+            ++sceneRows;
+            sceneAt = nextScene();
+        } else {
+            recordDeviceAction(deviceQuery.value(0).toString(), deviceAt);
+            deviceAt = nextDevice();
+        }
+    }
+    qDebug() << "场景统计已从" << sceneRows << "条场景记录回填";
+    return true;
+}
+
+bool SceneAnalytics::loadUsage()
+{
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT scene_id, hour_of_week, runs, overridden FROM scene_usage")) {
+        qCritical() << "读取场景统计失败:" << query.lastError().text();
+        return false;
+    }
+
+    QMutexLocker locker(&mutex);
+    scenes.clear();
+    while (query.next()) {
+        int hour = query.value(1).toInt();
+        if (hour < 0 || hour >= HoursPerWeek) {
+            continue;
+        }
+        SceneUsage &usage = entry(query.value(0).toString());
+        int runs = query.value(2).toInt();
+        int overridden = query.value(3).toInt();
+        usage.runs += runs;
+        usage.runsByHour[hour] += runs;
+        usage.overridden += overridden;
+        usage.overriddenByHour[hour] += overridden;
+    }
+    return true;
+}
+
+void SceneAnalytics::recordSceneRun(const QString &sceneId, const QDateTime &at)
+{
+    int hour = hourOfWeek(at);
+    if (hour < 0 || !addToRow(sceneId, hour, 1, 0)) {
+        return;
+    }
+    lastRun.sceneId = sceneId;
+    lastRun.at = at;
+    lastRun.hour = hour;
+    lastRun.overridden = false;
+    staged.append({ sceneId, hour, true });
+}
+
+void SceneAnalytics::recordDeviceAction(const QString &actionType, const QDateTime &at)
+{
+    if (lastRun.hour < 0 || lastRun.overridden || !isManualAction(actionType)) {
+        return;
+    }
+    qint64 secs = lastRun.at.secsTo(at);
+    if (secs < 0 || secs > overrideSecs) {
+        return;
+    }
+    if (!addToRow(lastRun.sceneId, lastRun.hour, 0, 1)) {
+        return;
+    }
+    lastRun.overridden = true;
+    staged.append({ lastRun.sceneId, lastRun.hour, false });
+}
+
+void SceneAnalytics::commit()
+{
+    if (!staged.isEmpty()) {
+        QMutexLocker locker(&mutex);
+        for (const Change &change : qAsConst(staged)) {
+            SceneUsage &usage = entry(change.sceneId);
+            if (change.run) {
+                ++usage.runs;
+                ++usage.runsByHour[change.hour];
+            } else {
+                ++usage.overridden;
+                ++usage.overriddenByHour[change.hour];
+            }
+        }
+    }
+    staged.resize(0);
+    committedRun = lastRun;
+}
+
+void SceneAnalytics::rollback()
+{
+    staged.resize(0);
+    lastRun = committedRun;
+}
+
+QVector<SceneUsage> SceneAnalytics::usage() const
+{
+    QVector<SceneUsage> list;
+    {
+        QMutexLocker locker(&mutex);
+        list.reserve(scenes.size());
+        for (const SceneUsage &usage : scenes) {
+            list.append(usage);
+        }
+    }
+    std::sort(list.begin(), list.end(), [](const SceneUsage &a, const SceneUsage &b) {
+        return a.runs != b.runs ? a.runs > b.runs : a.sceneId < b.sceneId;
+    });
+    return list;
+}
+
+SceneUsage SceneAnalytics::usage(const QString &sceneId) const
+{
+    QMutexLocker locker(&mutex);
+    auto it = scenes.constFind(sceneId);
+    if (it != scenes.constEnd()) {
+        return it.value();
+    }
+    SceneUsage empty;
+    empty.sceneId = sceneId;
+    empty.name = sceneNames.value(sceneId, sceneId);
+    empty.runsByHour.fill(0, HoursPerWeek);
+    empty.overriddenByHour.fill(0, HoursPerWeek);
+    return empty;
+}
+
+int SceneAnalytics::overrideMinutes() const
+{
+    return overrideSecs / 60;
+}
+
+// 星期一0点为0，星期日23点为167；无效时间返回 -1
+int SceneAnalytics::hourOfWeek(const QDateTime &at)
+{
+    if (!at.isValid()) {
+        return -1;
+    }
+    QDateTime local = at.toLocalTime();
+    return (local.date().dayOfWeek() - 1) * 24 + local.time().hour();
+}
+
+bool SceneAnalytics::isManualAction(const QString &actionType)
+{
+    return ManualActions.contains(actionType);
+}
+
+// 在调用方的事务中执行（存储线程的批量写入或回填）
+bool SceneAnalytics::addToRow(const QString &sceneId, int hour, int runs, int overridden)
+{
+    upsertQuery.bindValue(0, sceneId);
+    upsertQuery.bindValue(1, hour);
+    upsertQuery.bindValue(2, runs);
+    upsertQuery.bindValue(3, overridden);
+    if (!upsertQuery.exec()) {
+        qCritical() << "更新场景统计失败:" << sceneId << hour << upsertQuery.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// 调用方持有 mutex
+SceneUsage &SceneAnalytics::entry(const QString &sceneId)
+{
+    auto it = scenes.find(sceneId);
+    if (it == scenes.end()) {
+        SceneUsage usage;
+        usage.sceneId = sceneId;
+        usage.name = sceneNames.value(sceneId, sceneId);
+        usage.runsByHour.fill(0, HoursPerWeek);
+        usage.overriddenByHour.fill(0, HoursPerWeek);
+        it = scenes.insert(sceneId, usage);
+    }
+    return it.value();
+}
@@ -0,0 +1,91 @@
+#ifndef SCENEANALYTICS_H
+#define SCENEANALYTICS_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QVector>
+
+// 一个场景的使用统计
+struct SceneUsage
+{
+    QString sceneId;
+    QString name;              // scenes 表中的名称，没有时为场景ID
+    int runs = 0;
+    int overridden = 0;        // 运行后 overrideMinutes 分钟内被手动操作过的次数
+    QVector<int> runsByHour;   // 168个小时槽：(星期几 - 1) * 24 + 小时，本地时间
+    QVector<int> overriddenByHour;
+
+    int busiestHour() const;   // 运行次数最多的小时槽，没有运行时为 -1
+};
+
+// 场景使用统计：每个场景按星期几和小时的运行次数，以及运行后短时间内被手动操作（toggle、门锁按钮）的次数。
+// 由存储线程写入的场景和设备记录逐条驱动，每条记录只更新内存中的一个槽和 scene_usage 表中的一行，
+// 不再扫描历史；只有第一次创建 scene_usage 表时用已有的 scene_history 和 device_history 回填一次
+//
+// 手动操作计入最近一次运行的场景（新的场景运行之后不再计入之前的场景），每次运行最多计一次
+//
+// 写入在存储线程中进行，每条记录在调用方的事务中更新 scene_usage，事务提交后调用 commit 才进入内存统计，
+// 回滚时调用 rollback 丢弃；查询只读内存中的统计，可以在任意线程调用，不访问数据库
+class SceneAnalytics
+{
+public:
+    static constexpr int HoursPerWeek = 7 * 24;
+    static constexpr int DefaultOverrideMinutes = 10;
+
+    explicit SceneAnalytics(const QSqlDatabase &database, int overrideMinutes = DefaultOverrideMinutes);
+
+    // 创建 scene_usage 表并读入统计；新建表时在同一个事务中用已有历史回填
+    bool ensureSchema();
+
+    // 只对已经写入的记录调用
+    void recordSceneRun(const QString &sceneId, const QDateTime &at);
+    void recordDeviceAction(const QString &actionType, const QDateTime &at);
+    // 调用方的事务提交或回滚之后调用：提交时本批的统计进入内存，回滚时丢弃，最近一次运行恢复到上次提交时
+    void commit();
+    void rollback();
+
+    // 以下函数可以在任意线程调用
+    QVector<SceneUsage> usage() const;  // 按运行次数从多到少
+    SceneUsage usage(const QString &sceneId) const;
+    int overrideMinutes() const;
+
+    static int hourOfWeek(const QDateTime &at);
+    static bool isManualAction(const QString &actionType);
+
+private:
+    struct LastRun {
+        QString sceneId;
+        QDateTime at;
+        int hour = -1;
+        bool overridden = false;
+    };
+
+    // 已写入 scene_usage、尚未提交的一次运行或调整
+    struct Change {
+        QString sceneId;
+        int hour = -1;
+        bool run = false;  // false 为一次调整
+    };
+
+    bool backfill();
+    bool loadUsage();
+    bool addToRow(const QString &sceneId, int hour, int runs, int overridden);
+    SceneUsage &entry(const QString &sceneId);
+
+    QSqlDatabase db;
+    const int overrideSecs;
+    QSqlQuery upsertQuery;
+    LastRun lastRun;           // 包含未提交的记录
+    LastRun committedRun;      // 上次提交时的 lastRun
+    QVector<Change> staged;    // 保留容量，每批提交后清空
+
+    mutable QMutex mutex;                // 保护 scenes，写入在存储线程，查询可能来自界面线程
+    QHash<QString, SceneUsage> scenes;   // 场景ID -> 统计
+    QHash<QString, QString> sceneNames;
+};
+
+#endif // SCENEANALYTICS_H
@@ -0,0 +1,454 @@
+#include "scenescheduler.h"
+#include <QDebug>
+#include <QStringList>
+#include <QVector>
+
+SceneScheduler::SceneScheduler(QObject *parent)
+    : QObject(parent)
+    , currentTick(QDateTime::currentSecsSinceEpoch())
+    , nextJobId(1)
+{
+    for (int level = 0; level < LevelCount; ++level) {
+        for (int slot = 0; slot < SlotCount; ++slot) {
+            wheel[level][slot] = nullptr;
+        }
+    }
+
+    tickTimer.setInterval(1000);
+    tickTimer.setTimerType(Qt::PreciseTimer);
+    connect(&tickTimer, &QTimer::timeout, this, &SceneScheduler::onTick);
+}
+
+SceneScheduler::~SceneScheduler()
+{
+}
+
+QDateTime SceneScheduler::currentTime() const
+{
+    return simulatedTime.isValid() ? simulatedTime : QDateTime::currentDateTime();
+}
+
+void SceneScheduler::setSimulatedTime(const QDateTime &now)
+{
+    simulatedTime = now;
+    if (!nodes.empty()) {
+        onTick();
+    }
+}
+
+quint64 SceneScheduler::scheduleOnce(const QString &sceneId, const QDateTime &when,
+                                     ScheduleJob::CatchUpPolicy policy, int catchUpMinutes)
+{
+    ScheduleJob job;
+    job.sceneId = sceneId;
+    job.kind = ScheduleJob::OneShot;
+    job.fireAt = when;
+    job.catchUpPolicy = policy;
+    job.catchUpMinutes = catchUpMinutes;
+    return addJob(job);
+}
+
+quint64 SceneScheduler::scheduleRecurring(const QString &sceneId, quint8 weekdays, const QTime &time,
+                                          ScheduleJob::CatchUpPolicy policy, int catchUpMinutes)
+{
+    ScheduleJob job;
+    job.sceneId = sceneId;
+    job.kind = ScheduleJob::Recurring;
+    job.weekdays = weekdays & 0x7F;
+    job.timeOfDay = time;
+    job.catchUpPolicy = policy;
+    job.catchUpMinutes = catchUpMinutes;
+    job.fireAt = nextOccurrence(job.weekdays, time, currentTime());
+    if (!job.fireAt.isValid()) {
+        qWarning() << "循环任务没有选择星期，忽略:" << sceneId;
+        return 0;
+    }
+    return addJob(job);
+}
+
+quint64 SceneScheduler::addJob(const ScheduleJob &job)
+{
+    if (!job.fireAt.isValid()) {
+        return 0;
+    }
+
+    ensureTimerRunning();
+
+    ScheduleJob newJob = job;
+    if (newJob.id == 0) {
+        newJob.id = nextJobId++;
+    } else {
+        nextJobId = qMax(nextJobId, newJob.id + 1);
+    }
+
+    Node &node = nodes[newJob.id];
+    node.job = newJob;
+    node.expiryTick = newJob.fireAt.toSecsSinceEpoch();
+    insertNode(&node);
+
+    qDebug() << "添加定时任务:" << newJob.id << newJob.sceneId << "触发时间:" << newJob.fireAt.toString("yyyy-MM-dd hh:mm:ss");
+    return newJob.id;
+}
+
+bool SceneScheduler::cancel(quint64 jobId)
+{
+    auto it = nodes.find(jobId);
+    if (it == nodes.end()) {
+        return false;
+    }
+
+    unlinkNode(&it->second);
+    nodes.erase(it);
+    if (nodes.empty()) {
+        tickTimer.stop();
+    }
+    qDebug() << "取消定时任务:" << jobId;
+    return true;
+}
+
+void SceneScheduler::restore(const QVector<ScheduleJob> &jobs)
+{
+    if (jobs.isEmpty()) {
+        return;
+    }
+
+    ensureTimerRunning();
+    nodes.reserve(nodes.size() + size_t(jobs.size()));
+
+    QDateTime now = currentTime();
+    QVector<quint64> skipped;
+    for (const ScheduleJob &job : jobs) {
+        if (job.id == 0 || !job.fireAt.isValid()) {
+            continue;
+        }
+        nextJobId = qMax(nextJobId, job.id + 1);
+
+        Node &node = nodes[job.id];
+        node.job = job;
+        if (skipIfMissed(&node, now)) {
+            skipped.append(job.id);
+            if (!nodes.count(job.id)) {
+                continue;  // 错过的单次任务已删除
+            }
+        }
+        // 需要补执行的任务已经过期，放入当前槽，下一次 tick 触发
+        node.expiryTick = node.job.fireAt.toSecsSinceEpoch();
+        insertNode(&node);
+    }
+
+    if (nodes.empty()) {
+        tickTimer.stop();
+    }
+    qDebug() << "恢复定时任务" << jobs.size() << "个，跳过错过的任务" << skipped.size() << "个";
+
+    for (quint64 jobId : skipped) {
+        emit jobSkipped(jobId);
+    }
+}
+
+bool SceneScheduler::shouldCatchUp(const ScheduleJob &job, const QDateTime &now)
+{
+    switch (job.catchUpPolicy) {
+    case ScheduleJob::RunOnce:
+        return true;
+    case ScheduleJob::Skip:
+        return false;
+    case ScheduleJob::RunIfWithin:
+        return job.fireAt.secsTo(now) <= qint64(job.catchUpMinutes) * 60;
+    }
+    return true;
+}
+
+// 任务已错过且策略要求跳过时：单次任务删除，循环任务推迟到下一次，返回true
+// 调用前节点不能在时间轮中
+bool SceneScheduler::skipIfMissed(Node *node, const QDateTime &now)
+{
+    // 允许1秒误差，正常 tick 触发的任务不算错过
+    if (node->job.fireAt.secsTo(now) <= 1 || shouldCatchUp(node->job, now)) {
+        return false;
+    }
+
+    qDebug() << "跳过错过的定时任务:" << node->job.id << node->job.sceneId
+             << "原定时间:" << node->job.fireAt.toString("yyyy-MM-dd hh:mm:ss");
+    if (node->job.kind == ScheduleJob::Recurring) {
+        node->job.fireAt = nextOccurrence(node->job.weekdays, node->job.timeOfDay, now);
+        if (node->job.fireAt.isValid()) {
+            return true;
+        }
+    }
+    quint64 jobId = node->job.id;
+    nodes.erase(jobId);
+    return true;
+}
+
+bool SceneScheduler::contains(quint64 jobId) const
+{
+    return nodes.find(jobId) != nodes.end();
+}
+
+ScheduleJob SceneScheduler::job(quint64 jobId) const
+{
+    auto it = nodes.find(jobId);
+    return it != nodes.end() ? it->second.job : ScheduleJob();
+}
+
+int SceneScheduler::jobCount() const
+{
+    return int(nodes.size());
+}
+
+QVector<ScheduleJob> SceneScheduler::jobs() const
+{
+    QVector<ScheduleJob> list;
+    list.reserve(int(nodes.size()));
+    for (const auto &entry : nodes) {
+        list.append(entry.second.job);
+    }
+    return list;
+}
+
+QDateTime SceneScheduler::nextFireTime(const QString &sceneId) const
+{
+    QDateTime earliest;
+    for (const auto &entry : nodes) {
+        const ScheduleJob &candidate = entry.second.job;
+        if (candidate.sceneId == sceneId && (!earliest.isValid() || candidate.fireAt < earliest)) {
+            earliest = candidate.fireAt;
+        }
+    }
+    return earliest;
+}
+
+QDateTime SceneScheduler::nextOccurrence(quint8 weekdays, const QTime &time, const QDateTime &after)
+{
+    if ((weekdays & 0x7F) == 0 || !time.isValid()) {
+        return QDateTime();
+    }
+
+    // 最多向后看8天（今天的时刻已过且只选了今天的星期）
+    for (int day = 0; day <= 7; ++day) {
+        QDate date = after.date().addDays(day);
+        if (!(weekdays & (1 << (date.dayOfWeek() - 1)))) {
+            continue;
+        }
+        QDateTime candidate(date, time);
+        if (candidate > after) {
+            return candidate;
+        }
+    }
+    return QDateTime();
+}
+
+QString SceneScheduler::weekdaysText(quint8 weekdays)
+{
+    weekdays &= 0x7F;
+    if (weekdays == 0x7F) {
+        return "每天";
+    }
+    if (weekdays == 0x1F) {
+        return "周一至周五";
+    }
+    if (weekdays == 0x60) {
+        return "周末";
+    }
+
+    static const char *names[] = {"周一", "周二", "周三", "周四", "周五", "周六", "周日"};
+    QStringList days;
+    for (int i = 0; i < 7; ++i) {
+        if (weekdays & (1 << i)) {
+            days << names[i];
+        }
+    }
+    return days.join("、");
+}
+
+// 按到期时间与当前 tick 的距离选择层级（与 Linux 内核经典时间轮相同的算法）
+void SceneScheduler::insertNode(Node *node)
+{
+    qint64 expires = node->expiryTick;
+    qint64 delta = expires - currentTick;
+    int level = 0;
+    int slot = 0;
+
+    if (delta < 0) {
+        // 已经过期，放到当前槽，下一次 tick 立即触发
+        slot = int(currentTick & SlotMask);
+    } else if (delta < (qint64(1) << SlotBits)) {
+        slot = int(expires & SlotMask);
+    } else if (delta < (qint64(1) << (2 * SlotBits))) {
+        level = 1;
+        slot = int((expires >> SlotBits) & SlotMask);
+    } else if (delta < (qint64(1) << (3 * SlotBits))) {
+        level = 2;
+        slot = int((expires >> (2 * SlotBits)) & SlotMask);
+    } else {
+        // 超出时间轮范围（约194天）的任务先放在最远的位置，级联时重新计算
+        if (delta >= (qint64(1) << (4 * SlotBits))) {
+            expires = currentTick + (qint64(1) << (4 * SlotBits)) - 1;
+        }
+        level = 3;
+        slot = int((expires >> (3 * SlotBits)) & SlotMask);
+    }
+
+    node->level = level;
+    node->slot = slot;
+    node->prev = nullptr;
+    node->next = wheel[level][slot];
+    if (node->next) {
+        node->next->prev = node;
+    }
+    wheel[level][slot] = node;
+}
+
+void SceneScheduler::unlinkNode(Node *node)
+{
+    if (node->level < 0) {
+        return;
+    }
+
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        wheel[node->level][node->slot] = node->next;
+    }
+    if (node->next) {
+        node->next->prev = node->prev;
+    }
+    node->prev = nullptr;
+    node->next = nullptr;
+    node->level = -1;
+    node->slot = -1;
+}
+
+// 把上层某个槽中的任务重新分配到下层
+int SceneScheduler::cascade(int level, int index)
+{
+    Node *node = wheel[level][index];
+    wheel[level][index] = nullptr;
+    while (node) {
+        Node *next = node->next;
+        insertNode(node);
+        node = next;
+    }
+    return index;
+}
+
+void SceneScheduler::processTick()
+{
+    int index = int(currentTick & SlotMask);
+    if (index == 0) {
+        if (cascade(1, int((currentTick >> SlotBits) & SlotMask)) == 0) {
+            if (cascade(2, int((currentTick >> (2 * SlotBits)) & SlotMask)) == 0) {
+                cascade(3, int((currentTick >> (3 * SlotBits)) & SlotMask));
+            }
+        }
+    }
+
+    // 先取出到期任务，再逐个触发：触发的场景可能会添加或取消任务
+    QVector<quint64> dueJobs;
+    Node *node = wheel[0][index];
+    wheel[0][index] = nullptr;
+    while (node) {
+        Node *next = node->next;
+        node->prev = nullptr;
+        node->next = nullptr;
+        node->level = -1;
+        node->slot = -1;
+        dueJobs.append(node->job.id);
+        node = next;
+    }
+
+    currentTick++;
+
+    for (quint64 jobId : dueJobs) {
+        auto it = nodes.find(jobId);
+        if (it == nodes.end()) {
+            continue;  // 已被前面触发的场景取消
+        }
+
+        QString sceneId = it->second.job.sceneId;
+        it->second.job.lastRun = currentTime();
+        if (it->second.job.kind == ScheduleJob::Recurring) {
+            // 循环任务计算下一次触发时间后重新放回时间轮
+            Node &recurring = it->second;
+            QDateTime after = qMax(recurring.job.fireAt, currentTime());
+            recurring.job.fireAt = nextOccurrence(recurring.job.weekdays, recurring.job.timeOfDay, after);
+            recurring.expiryTick = recurring.job.fireAt.toSecsSinceEpoch();
+            insertNode(&recurring);
+        } else {
+            nodes.erase(it);
+        }
+
+        qDebug() << "定时任务触发:" << jobId << sceneId;
+        emit jobTriggered(jobId, sceneId);
+    }
+}
+
+// 休眠唤醒或系统时间变化后，按每个任务的绝对触发时间重新放入时间轮
+void SceneScheduler::rebuild(qint64 nowTick)
+{
+    qDebug() << "检测到系统时间跳变，重建时间轮，任务数:" << nodes.size();
+
+    for (int level = 0; level < LevelCount; ++level) {
+        for (int slot = 0; slot < SlotCount; ++slot) {
+            wheel[level][slot] = nullptr;
+        }
+    }
+
+    currentTick = nowTick;
+    QDateTime now = QDateTime::fromSecsSinceEpoch(nowTick);
+    QVector<quint64> jobIds;
+    jobIds.reserve(int(nodes.size()));
+    for (const auto &entry : nodes) {
+        jobIds.append(entry.first);
+    }
+
+    // 休眠期间错过的任务同样按补执行策略处理
+    QVector<quint64> skipped;
+    for (quint64 jobId : jobIds) {
+        Node &node = nodes[jobId];
+        node.prev = nullptr;
+        node.next = nullptr;
+        node.level = -1;
+        if (skipIfMissed(&node, now)) {
+            skipped.append(jobId);
+            if (!nodes.count(jobId)) {
+                continue;
+            }
+        }
+        node.expiryTick = node.job.fireAt.toSecsSinceEpoch();
+        insertNode(&node);
+    }
+
+    for (quint64 jobId : skipped) {
+        emit jobSkipped(jobId);
+    }
+}
+
+void SceneScheduler::onTick()
+{
+    qint64 nowTick = currentTime().toSecsSinceEpoch();
+    qint64 drift = nowTick - currentTick;
+
+    if (drift < 0 || drift > MaxCatchUpTicks) {
+        rebuild(nowTick);
+    }
+
+    while (currentTick <= nowTick && !nodes.empty()) {
+        processTick();
+    }
+
+    if (nodes.empty()) {
+        tickTimer.stop();
+    }
+}
+
+void SceneScheduler::ensureTimerRunning()
+{
+    if (tickTimer.isActive()) {
+        return;
+    }
+    // 时间轮空闲期间不 tick，重新启动时从当前时间开始
+    currentTick = currentTime().toSecsSinceEpoch();
+    tickTimer.start();
+}
@@ -0,0 +1,119 @@
+#ifndef SCENESCHEDULER_H
+#define SCENESCHEDULER_H
+
+#include <QDateTime>
+#include <QObject>
+#include <QString>
+#include <QTime>
+#include <QTimer>
+#include <QVector>
+#include <unordered_map>
+
+// 定时任务：到时间后触发一个场景
+struct ScheduleJob
+{
+    enum Kind {
+        OneShot,    // 单次
+        Recurring   // 按星期循环
+    };
+
+    // 错过触发时间（关机、休眠）后的补执行策略
+    enum CatchUpPolicy {
+        RunOnce,        // 补执行一次
+        Skip,           // 跳过
+        RunIfWithin     // 错过不超过 catchUpMinutes 分钟才补执行
+    };
+
+    quint64 id = 0;
+    QString sceneId;
+    Kind kind = OneShot;
+    QDateTime fireAt;       // 下一次触发时间
+    quint8 weekdays = 0;    // 循环任务：bit0=周一 ... bit6=周日
+    QTime timeOfDay;        // 循环任务的触发时刻
+    CatchUpPolicy catchUpPolicy = RunOnce;
+    int catchUpMinutes = 0;
+    QDateTime lastRun;      // 最近一次触发时间
+};
+
+// 场景调度器：分层时间轮，整个调度器只使用一个1秒的 QTimer
+// 4层、每层64个槽，单个任务的插入和取消都是 O(1)；
+// 每次 tick 比较系统时间，发现休眠唤醒或系统时间被修改时按绝对时间重建时间轮
+class SceneScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SceneScheduler(QObject *parent = nullptr);
+    ~SceneScheduler();
+
+    quint64 scheduleOnce(const QString &sceneId, const QDateTime &when,
+                         ScheduleJob::CatchUpPolicy policy = ScheduleJob::RunOnce, int catchUpMinutes = 0);
+    quint64 scheduleRecurring(const QString &sceneId, quint8 weekdays, const QTime &time,
+                              ScheduleJob::CatchUpPolicy policy = ScheduleJob::RunOnce, int catchUpMinutes = 0);
+    bool cancel(quint64 jobId);
+
+    // 启动时批量恢复已保存的任务，保留原任务ID，错过的任务按各自的补执行策略处理
+    void restore(const QVector<ScheduleJob> &jobs);
+
+    bool contains(quint64 jobId) const;
+    ScheduleJob job(quint64 jobId) const;
+    int jobCount() const;
+    // 所有任务，顺序不固定
+    QVector<ScheduleJob> jobs() const;
+    // 某个场景最近一次将要触发的时间，没有任务时返回无效时间
+    QDateTime nextFireTime(const QString &sceneId) const;
+
+    // 以指定时间作为时钟（测试使用），设置后立即处理到该时间为止的 tick；无效时间恢复使用系统时间
+    void setSimulatedTime(const QDateTime &now);
+
+    // 计算循环任务在 after 之后的下一次触发时间，weekdays 为空时返回无效时间
+    static QDateTime nextOccurrence(quint8 weekdays, const QTime &time, const QDateTime &after);
+    // 星期掩码的中文描述，例如 "周一至周五"
+    static QString weekdaysText(quint8 weekdays);
+    // 错过触发时间的任务是否需要补执行
+    static bool shouldCatchUp(const ScheduleJob &job, const QDateTime &now);
+
+signals:
+    void jobTriggered(quint64 jobId, const QString &sceneId);
+    // 错过的任务按策略被跳过：单次任务已删除，循环任务已推迟到下一次
+    void jobSkipped(quint64 jobId);
+
+private slots:
+    void onTick();
+
+private:
+    static constexpr int LevelCount = 4;
+    static constexpr int SlotBits = 6;
+    static constexpr int SlotCount = 1 << SlotBits;  // 每层64个槽
+    static constexpr int SlotMask = SlotCount - 1;
+    static constexpr qint64 MaxCatchUpTicks = 120;   // 超过2分钟没有 tick 视为休眠或时间跳变
+
+    // 时间轮节点，放在 unordered_map 中，地址在任务存在期间保持不变
+    struct Node {
+        ScheduleJob job;
+        qint64 expiryTick = 0;  // 触发时刻（自1970年起的秒数）
+        int level = -1;         // -1 表示不在时间轮中
+        int slot = -1;
+        Node *prev = nullptr;
+        Node *next = nullptr;
+    };
+
+    QDateTime currentTime() const;
+    quint64 addJob(const ScheduleJob &job);
+    bool skipIfMissed(Node *node, const QDateTime &now);
+    void insertNode(Node *node);
+    void unlinkNode(Node *node);
+    int cascade(int level, int index);
+    void processTick();
+    void rebuild(qint64 nowTick);
+    void ensureTimerRunning();
+
+    std::unordered_map<quint64, Node> nodes;
+    Node *wheel[LevelCount][SlotCount];
+    qint64 currentTick;  // 下一个待处理的 tick
+    quint64 nextJobId;
+    QTimer tickTimer;
+    QDateTime simulatedTime;  // 无效时使用系统时间
+};
+
+#endif // SCENESCHEDULER_H
@@ -0,0 +1,397 @@
+#include "scenesequencer.h"
+#include "homecontroller.h"
+#include "metricsregistry.h"
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QStandardPaths>
+#include <QtMath>
+#include <limits>
+
+const QString SceneSequencer::SceneGroup = QStringLiteral("scene");
+
+SceneSequencer::SceneSequencer(QObject *parent)
+    : QObject(parent)
+    , ruleEngine(nullptr)
+    , nextRunId(1)
+    , wakeTimer(this)
+    , runningGauge(&MetricsRegistry::instance().gauge("smarthome_scene_sequences_running",
+                                                      "Scene sequences waiting or running"))
+{
+    qRegisterMetaType<RuleAction>("RuleAction");
+    clock.start();
+    wakeTimer.setSingleShot(true);
+    connect(&wakeTimer, &QTimer::timeout, this, &SceneSequencer::onWakeUp);
+}
+
+void SceneSequencer::setRuleEngine(RuleEngine *engine)
+{
+    ruleEngine = engine;
+}
+
+// 端点可以是数字，也可以是 {"input": ..., "offset": ...}
+static bool parseValue(const QJsonValue &json, RuleEngine *engine, SequenceValue *value)
+{
+    if (json.isDouble()) {
+        value->value = json.toDouble();
+        return true;
+    }
+    QJsonObject obj = json.toObject();
+    if (!obj.contains("input") || !engine) {
+        return false;
+    }
+    value->input = engine->inputIndex(obj["input"].toString());
+    value->offset = obj["offset"].toDouble();
+    return true;
+}
+
+bool SceneSequencer::loadSequences(const QByteArray &json, QString *errorMessage)
+{
+    QJsonParseError jsonError;
+    QJsonDocument doc = QJsonDocument::fromJson(json, &jsonError);
+    if (jsonError.error != QJsonParseError::NoError || !doc.isArray()) {
+        if (errorMessage) {
+            *errorMessage = "场景序列JSON解析失败: " + jsonError.errorString();
+        }
+        return false;
+    }
+
+    auto fail = [errorMessage](const QString &message) {
+        if (errorMessage) {
+            *errorMessage = message;
+        }
+        return false;
+    };
+
+    QHash<QString, SceneSequence> loaded;
+    const QJsonArray sequenceArray = doc.array();
+    for (const QJsonValue &sequenceValue : sequenceArray) {
+        QJsonObject sequenceObj = sequenceValue.toObject();
+        SceneSequence sequence;
+        sequence.id = sequenceObj["id"].toString();
+        sequence.description = sequenceObj["description"].toString();
+
+        const QJsonArray stepArray = sequenceObj["steps"].toArray();
+        for (const QJsonValue &stepValue : stepArray) {
+            QJsonObject stepObj = stepValue.toObject();
+            SequenceStep step;
+            if (stepObj.contains("wait")) {
+                step.kind = SequenceStep::Wait;
+                step.durationMs = qRound(stepObj["wait"].toDouble() * 1000);
+            } else if (stepObj.contains("if")) {
+                QJsonObject conditionObj = stepObj["if"].toObject();
+                QString op = conditionObj["op"].toString();
+                if (!ruleEngine || !RuleEngine::parseOp(op, &step.condition.op)) {
+                    return fail(QString("序列 %1 的条件无效: %2").arg(sequence.id, op));
+                }
+                step.kind = SequenceStep::Condition;
+                step.condition.input = ruleEngine->inputIndex(conditionObj["input"].toString());
+                step.condition.value = conditionObj["value"].toDouble();
+            } else {
+                step.action.deviceId = stepObj["device"].toString();
+                step.action.command = stepObj["command"].toString();
+                if (step.action.deviceId.isEmpty() || step.action.command.isEmpty()) {
+                    return fail(QString("序列 %1 的步骤缺少 device 或 command").arg(sequence.id));
+                }
+                if (stepObj.contains("ramp")) {
+                    QJsonObject rampObj = stepObj["ramp"].toObject();
+                    step.kind = SequenceStep::Ramp;
+                    step.durationMs = qRound(rampObj["seconds"].toDouble() * 1000);
+                    step.rampSteps = qMax(1, rampObj["steps"].toInt(1));
+                    if (!parseValue(rampObj["from"], ruleEngine, &step.from)
+                        || !parseValue(rampObj["to"], ruleEngine, &step.to)) {
+                        return fail(QString("序列 %1 的渐变缺少 from 或 to").arg(sequence.id));
+                    }
+                } else {
+                    step.kind = SequenceStep::Action;
+                    step.action.value = stepObj["value"].toVariant().toString();
+                    if (stepObj.contains("input")) {
+                        if (!ruleEngine) {
+                            return fail(QString("序列 %1 引用了输入，但没有规则引擎").arg(sequence.id));
+                        }
+                        step.action.valueInput = ruleEngine->inputIndex(stepObj["input"].toString());
+                        step.action.offset = stepObj["offset"].toDouble();
+                    }
+                }
+            }
+            sequence.steps.append(step);
+        }
+
+        if (sequence.id.isEmpty() || sequence.steps.isEmpty()) {
+            return fail(QString("序列缺少 id 或 steps: %1").arg(sequence.id));
+        }
+        loaded.insert(sequence.id, sequence);
+    }
+
+    sequences = loaded;
+    qDebug() << "场景序列加载完成，共" << sequences.size() << "个序列";
+    return true;
+}
+
+bool SceneSequencer::loadDefaultSequences()
+{
+    QString userSequences = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/sequences.json";
+    QString path = QFile::exists(userSequences) ? userSequences : QString(":/rules/default_sequences.json");
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCritical() << "无法读取场景序列文件:" << path;
+        return false;
+    }
+
+    QString errorMessage;
+    if (!loadSequences(file.readAll(), &errorMessage)) {
+        qCritical() << "加载场景序列失败:" << path << errorMessage;
+        return false;
+    }
+    qDebug() << "已加载场景序列文件:" << path;
+    return true;
+}
+
+bool SceneSequencer::contains(const QString &sequenceId) const
+{
+    return sequences.contains(sequenceId);
+}
+
+int SceneSequencer::sequenceCount() const
+{
+    return sequences.size();
+}
+
+quint64 SceneSequencer::start(const QString &sequenceId, const QString &group)
+{
+    if (!contains(sequenceId)) {
+        return 0;
+    }
+    if (!group.isEmpty()) {
+        cancelGroup(group);
+    }
+    // 取消时发出的信号可能引起序列重新加载，取消之后再取定义
+    auto definition = sequences.constFind(sequenceId);
+    if (definition == sequences.constEnd()) {
+        return 0;
+    }
+
+    quint64 runId = nextRunId++;
+    Run &run = runs[runId];
+    run.id = runId;
+    run.sequenceId = definition->id;
+    run.group = group;
+    run.steps = definition->steps;
+    if (!group.isEmpty()) {
+        groupRuns.insert(group, runId);
+    }
+    runningGauge->set(runs.size());
+    qCDebug(lcControl) << "开始执行场景序列:" << sequenceId << "执行ID:" << runId;
+
+    resume(runId);
+    return runId;
+}
+
+bool SceneSequencer::cancel(quint64 runId)
+{
+    if (runs.find(runId) == runs.end()) {
+        return false;
+    }
+    qDebug() << "取消场景序列，执行ID:" << runId;
+    finish(runId, false);
+    return true;
+}
+
+int SceneSequencer::cancelGroup(const QString &group)
+{
+    const QList<quint64> members = groupRuns.values(group);
+    for (quint64 runId : members) {
+        cancel(runId);
+    }
+    return members.size();
+}
+
+bool SceneSequencer::isRunning(quint64 runId) const
+{
+    return runs.find(runId) != runs.end();
+}
+
+int SceneSequencer::runningCount() const
+{
+    return int(runs.size());
+}
+
+void SceneSequencer::startScene(const QString &sceneId)
+{
+    // 没有同名序列的场景也要取消上一个场景剩余的步骤
+    if (!contains(sceneId)) {
+        cancelGroup(SceneGroup);
+        return;
+    }
+    start(sceneId, SceneGroup);
+}
+
+// 从当前步骤连续执行，直到遇到等待、序列结束或条件不成立
+// 发出的动作可能被直接连接的槽函数用来取消本序列，每一步都重新查找
+void SceneSequencer::resume(quint64 runId)
+{
+    for (;;) {
+        auto it = runs.find(runId);
+        if (it == runs.end()) {
+            return;
+        }
+        Run &run = it->second;
+        run.wakeAtMs = -1;
+        if (run.step >= run.steps.size()) {
+            finish(runId, true);
+            return;
+        }
+
+        const SequenceStep &step = run.steps.at(run.step);
+        switch (step.kind) {
+        case SequenceStep::Action:
+            run.step++;
+            emitAction(run, step.action, QString());
+            break;
+
+        case SequenceStep::Wait:
+            run.step++;
+            if (step.durationMs > 0) {
+                scheduleWake(run, step.durationMs);
+                return;
+            }
+            break;
+
+        case SequenceStep::Condition:
+            if (!ruleEngine
+                || !RuleEngine::evaluateCondition(step.condition, ruleEngine->inputValue(step.condition.input))) {
+                qDebug() << "场景序列条件不成立，提前结束:" << run.sequenceId;
+                finish(runId, false);
+                return;
+            }
+            run.step++;
+            break;
+
+        case SequenceStep::Ramp: {
+            if (run.rampStep == 0) {
+                run.rampFrom = resolveValue(step.from);
+                run.rampTo = resolveValue(step.to);
+                if (qIsNaN(run.rampFrom) || qIsNaN(run.rampTo)) {
+                    qDebug() << "渐变的输入没有数据，跳过:" << run.sequenceId << step.action.deviceId;
+                    run.step++;
+                    break;
+                }
+            }
+
+            // 共输出 rampSteps+1 个值，第一个值立即输出，相邻两值间隔 durationMs/rampSteps；
+            // 取整后与上一个值相同时不重复发命令
+            double progress = double(run.rampStep) / step.rampSteps;
+            int value = qRound(run.rampFrom + (run.rampTo - run.rampFrom) * progress);
+            bool last = (run.rampStep == step.rampSteps);
+            bool changed = (run.rampStep == 0 || value != run.rampLast);
+            run.rampLast = value;
+            if (last) {
+                run.rampStep = 0;
+                run.step++;
+            } else {
+                run.rampStep++;
+                scheduleWake(run, step.durationMs / step.rampSteps);
+            }
+            if (changed) {
+                emitAction(run, step.action, QString::number(value));
+            }
+            if (!last) {
+                return;
+            }
+            break;
+        }
+        }
+    }
+}
+
+void SceneSequencer::finish(quint64 runId, bool completed)
+{
+    auto it = runs.find(runId);
+    if (it == runs.end()) {
+        return;
+    }
+    const QString sequenceId = it->second.sequenceId;
+    if (!it->second.group.isEmpty()) {
+        groupRuns.remove(it->second.group, runId);
+    }
+    runs.erase(it);
+    runningGauge->set(runs.size());
+    emit sequenceFinished(runId, sequenceId, completed);
+}
+
+void SceneSequencer::scheduleWake(Run &run, qint64 delayMs)
+{
+    run.wakeAtMs = clock.elapsed() + qMax<qint64>(0, delayMs);
+    bool earliest = wakeQueue.empty() || run.wakeAtMs < wakeQueue.top().first;
+    wakeQueue.emplace(run.wakeAtMs, run.id);
+    if (earliest) {
+        armTimer();
+    }
+}
+
+void SceneSequencer::armTimer()
+{
+    // 大量取消后堆中主要是失效的条目，按仍在等待的执行重建
+    if (wakeQueue.size() > 2 * runs.size() + 64) {
+        std::vector<WakeEntry> live;
+        live.reserve(runs.size());
+        for (const auto &entry : runs) {
+            if (entry.second.wakeAtMs >= 0) {
+                live.emplace_back(entry.second.wakeAtMs, entry.first);
+            }
+        }
+        wakeQueue = decltype(wakeQueue)(std::greater<WakeEntry>(), std::move(live));
+    }
+
+    if (wakeQueue.empty()) {
+        wakeTimer.stop();
+        return;
+    }
+    qint64 delay = wakeQueue.top().first - clock.elapsed();
+    wakeTimer.start(int(qBound<qint64>(0, delay, std::numeric_limits<int>::max())));
+}
+
+void SceneSequencer::onWakeUp()
+{
+    const qint64 now = clock.elapsed();
+    while (!wakeQueue.empty() && wakeQueue.top().first <= now) {
+        WakeEntry entry = wakeQueue.top();
+        wakeQueue.pop();
+        auto it = runs.find(entry.second);
+        // 已取消，或执行已经安排了别的唤醒时间
+        if (it == runs.end() || it->second.wakeAtMs != entry.first) {
+            continue;
+        }
+        resume(entry.second);
+    }
+    armTimer();
+}
+
+double SceneSequencer::resolveValue(const SequenceValue &value) const
+{
+    if (value.input < 0) {
+        return value.value;
+    }
+    return ruleEngine ? ruleEngine->inputValue(value.input) + value.offset : qQNaN();
+}
+
+void SceneSequencer::emitAction(const Run &run, const RuleActionTemplate &action, const QString &value)
+{
+    RuleAction resolved;
+    resolved.ruleId = run.sequenceId;
+    resolved.deviceId = action.deviceId;
+    resolved.command = action.command;
+    if (!value.isNull()) {
+        resolved.value = value;
+    } else if (action.valueInput >= 0) {
+        resolved.value = QString::number(qRound(resolveValue({0.0, action.valueInput, action.offset})));
+    } else {
+        resolved.value = action.value;
+    }
+    qCDebug(lcControl) << "场景序列动作:" << resolved.ruleId << resolved.deviceId << resolved.command << resolved.value;
+    emit actionTriggered(resolved);
+}
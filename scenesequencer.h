@@ -0,0 +1,137 @@
+#ifndef SCENESEQUENCER_H
+#define SCENESEQUENCER_H
+
+#include "ruleengine.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMultiHash>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class MetricGauge;
+
+// 渐变的端点：常量，或某个输入加偏移（例如室外温度-2）
+struct SequenceValue
+{
+    double value = 0.0;
+    int input = -1;     // >=0 时取该输入的当前值
+    double offset = 0.0;
+};
+
+// 场景序列的一个步骤
+struct SequenceStep
+{
+    enum Kind {
+        Action,     // 立即执行一条设备命令
+        Wait,       // 等待一段时间，不占用线程
+        Ramp,       // 在一段时间内分若干步把设定值从 from 调到 to
+        Condition   // 条件不成立时结束序列
+    };
+
+    Kind kind = Action;
+    RuleActionTemplate action;    // Action 的命令；Ramp 只使用设备和命令
+    int durationMs = 0;           // Wait 的等待时间，Ramp 的总时长
+    SequenceValue from;
+    SequenceValue to;
+    int rampSteps = 1;
+    RuleCondition condition;
+};
+
+struct SceneSequence
+{
+    QString id;
+    QString description;
+    QVector<SequenceStep> steps;
+};
+
+// 场景序列执行器：每个正在执行的序列是一个可恢复的状态机（当前步骤 + 渐变进度），
+// 等待时只在最小堆中留一个唤醒时间，整个执行器只用一个单次 QTimer，不阻塞线程；
+// 同时运行上千个序列只占用内存
+//
+// 序列分组执行：同一组中启动新序列会取消组内正在执行的序列，
+// 场景使用 "scene" 组，新场景执行时取消上一个场景还没有完成的步骤
+//
+// 条件读取规则引擎的输入，需与规则引擎在同一线程中使用
+class SceneSequencer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const QString SceneGroup;
+
+    explicit SceneSequencer(QObject *parent = nullptr);
+
+    // 条件和渐变端点中的输入键在加载时转为规则引擎的输入编号，需在加载序列之前设置
+    void setRuleEngine(RuleEngine *engine);
+
+    // 从JSON加载序列，替换现有定义；正在执行的序列继续使用旧定义直到结束
+    bool loadSequences(const QByteArray &json, QString *errorMessage = nullptr);
+    // 加载内置序列，配置目录中存在 sequences.json 时优先使用
+    bool loadDefaultSequences();
+
+    bool contains(const QString &sequenceId) const;
+    int sequenceCount() const;
+
+    // 启动序列，返回执行ID；序列不存在时返回0。group 为空时不取消其他序列
+    quint64 start(const QString &sequenceId, const QString &group = QString());
+    bool cancel(quint64 runId);
+    int cancelGroup(const QString &group);
+    bool isRunning(quint64 runId) const;
+    int runningCount() const;
+
+public slots:
+    // 场景执行后调用：取消上一个场景未完成的步骤，有同名序列时开始执行
+    void startScene(const QString &sceneId);
+
+signals:
+    void actionTriggered(const RuleAction &action);
+    // completed 为 false 表示被取消或条件不成立提前结束
+    void sequenceFinished(quint64 runId, const QString &sequenceId, bool completed);
+
+private slots:
+    void onWakeUp();
+
+private:
+    struct Run {
+        quint64 id = 0;
+        QString sequenceId;
+        QString group;
+        QVector<SequenceStep> steps;  // 与定义隐式共享，不复制步骤
+        int step = 0;
+        int rampStep = 0;             // 当前渐变已输出的值的个数
+        double rampFrom = 0.0;
+        double rampTo = 0.0;
+        int rampLast = 0;
+        qint64 wakeAtMs = -1;         // 等待中的唤醒时间，-1 表示不在等待
+    };
+
+    using WakeEntry = std::pair<qint64, quint64>;  // 唤醒时间, 执行ID
+
+    void resume(quint64 runId);
+    void finish(quint64 runId, bool completed);
+    void scheduleWake(Run &run, qint64 delayMs);
+    void armTimer();
+    double resolveValue(const SequenceValue &value) const;
+    void emitAction(const Run &run, const RuleActionTemplate &action, const QString &value);
+
+    RuleEngine *ruleEngine;
+    QHash<QString, SceneSequence> sequences;
+    std::unordered_map<quint64, Run> runs;
+    QMultiHash<QString, quint64> groupRuns;
+    // 取消的执行不从堆中删除，出堆时发现执行已不存在或唤醒时间不符就跳过
+    std::priority_queue<WakeEntry, std::vector<WakeEntry>, std::greater<WakeEntry>> wakeQueue;
+    quint64 nextRunId;
+    QElapsedTimer clock;  // 单调时钟，不受系统时间修改的影响
+    QTimer wakeTimer;     // 子对象，随执行器一起移到控制线程
+    MetricGauge *runningGauge;
+};
+
+#endif // SCENESEQUENCER_H
@@ -0,0 +1,119 @@
+#include "sceneusagedialog.h"
+#include <QColor>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <algorithm>
+
+static const char *const WeekdayNames[] = { "周一", "周二", "周三", "周四", "周五", "周六", "周日" };
+
+SceneUsageDialog::SceneUsageDialog(const QVector<SceneUsage> &usage, int overrideMinutes, QWidget *parent)
+    : QDialog(parent)
+    , usage(usage)
+    , overrideMinutes(overrideMinutes)
+    , sceneTable(nullptr)
+    , hourTable(nullptr)
+    , hourLabel(nullptr)
+{
+    initUI();
+}
+
+QString SceneUsageDialog::hourOfWeekText(int hour)
+{
+    if (hour < 0 || hour >= SceneAnalytics::HoursPerWeek) {
+        return QString("-");
+    }
+    return QString("%1 %2时").arg(QString::fromUtf8(WeekdayNames[hour / 24])).arg(hour % 24, 2, 10, QChar('0'));
+}
+
+void SceneUsageDialog::initUI()
+{
+    setWindowTitle("场景使用统计");
+    resize(760, 560);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+    // 场景汇总
+    const QStringList headers = {
+        "场景", "运行次数", QString("%1分钟内被手动调整").arg(overrideMinutes), "调整比例", "最常用时段"
+    };
+    sceneTable = new QTableWidget(usage.size(), headers.size(), this);
+    sceneTable->setHorizontalHeaderLabels(headers);
+    sceneTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    sceneTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    sceneTable->setSelectionMode(QAbstractItemView::SingleSelection);
+    sceneTable->verticalHeader()->setVisible(false);
+    sceneTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    for (int row = 0; row < usage.size(); ++row) {
+        const SceneUsage &scene = usage.at(row);
+        double rate = scene.runs > 0 ? 100.0 * scene.overridden / scene.runs : 0.0;
+        sceneTable->setItem(row, 0, new QTableWidgetItem(scene.name));
+        sceneTable->setItem(row, 1, new QTableWidgetItem(QString::number(scene.runs)));
+        sceneTable->setItem(row, 2, new QTableWidgetItem(QString::number(scene.overridden)));
+        sceneTable->setItem(row, 3, new QTableWidgetItem(QString::number(rate, 'f', 1) + "%"));
+        sceneTable->setItem(row, 4, new QTableWidgetItem(hourOfWeekText(scene.busiestHour())));
+    }
+    mainLayout->addWidget(sceneTable);
+
+    // 选中场景的每周时段分布：7行（星期）× 24列（小时）
+    hourLabel = new QLabel(this);
+    mainLayout->addWidget(hourLabel);
+    hourTable = new QTableWidget(7, 24, this);
+    hourTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    hourTable->setSelectionMode(QAbstractItemView::NoSelection);
+    for (int day = 0; day < 7; ++day) {
+        hourTable->setVerticalHeaderItem(day, new QTableWidgetItem(QString::fromUtf8(WeekdayNames[day])));
+    }
+    for (int hour = 0; hour < 24; ++hour) {
+        hourTable->setHorizontalHeaderItem(hour, new QTableWidgetItem(QString::number(hour)));
+    }
+    hourTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    hourTable->verticalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    mainLayout->addWidget(hourTable);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    buttonLayout->addStretch();
+    QPushButton *closeButton = new QPushButton("关闭", this);
+    buttonLayout->addWidget(closeButton);
+    mainLayout->addLayout(buttonLayout);
+
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::accept);
+    connect(sceneTable, &QTableWidget::currentCellChanged, this, [this](int row) {
+        showScene(row);
+    });
+
+    if (usage.isEmpty()) {
+        hourLabel->setText("还没有场景运行记录");
+    } else {
+        sceneTable->selectRow(0);
+        showScene(0);
+    }
+}
+
+void SceneUsageDialog::showScene(int row)
+{
+    if (row < 0 || row >= usage.size()) {
+        return;
+    }
+    const SceneUsage &scene = usage.at(row);
+    hourLabel->setText(QString("%1：各时段运行次数（括号内为被手动调整的次数）").arg(scene.name));
+
+    // 颜色深浅按本场景运行最多的时段归一化
+    int maxRuns = scene.runsByHour.isEmpty() ? 0 : *std::max_element(scene.runsByHour.cbegin(), scene.runsByHour.cend());
+    for (int hour = 0; hour < SceneAnalytics::HoursPerWeek; ++hour) {
+        int runs = scene.runsByHour.value(hour);
+        int overridden = scene.overriddenByHour.value(hour);
+        QString text;
+        if (runs > 0) {
+            text = overridden > 0 ? QString("%1(%2)").arg(runs).arg(overridden) : QString::number(runs);
+        }
+        QTableWidgetItem *item = new QTableWidgetItem(text);
+        item->setTextAlignment(Qt::AlignCenter);
+        if (runs > 0 && maxRuns > 0) {
+            int alpha = 40 + 215 * runs / maxRuns;
+            item->setBackground(QColor(255, 165, 0, alpha));
+        }
+        hourTable->setItem(hour / 24, hour % 24, item);
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef SCENEUSAGEDIALOG_H
+#define SCENEUSAGEDIALOG_H
+
+#include "sceneanalytics.h"
+#include <QDialog>
+#include <QLabel>
+#include <QTableWidget>
+#include <QVector>
+
+// 场景使用统计页：上方每个场景一行（运行次数、运行后被手动调整的次数和比例、最常用的时段），
+// 下方是选中场景按星期几和小时的运行次数。数据是打开时取得的内存统计，不查询数据库
+class SceneUsageDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    SceneUsageDialog(const QVector<SceneUsage> &usage, int overrideMinutes, QWidget *parent = nullptr);
+
+    static QString hourOfWeekText(int hour);  // 例如 "周一 07时"
+
+private:
+    void initUI();
+    void showScene(int row);
+
+    QVector<SceneUsage> usage;
+    int overrideMinutes;
+    QTableWidget *sceneTable;
+    QTableWidget *hourTable;
+    QLabel *hourLabel;
+};
+
+#endif // SCENEUSAGEDIALOG_H
@@ -0,0 +1,115 @@
+#include "schedulestore.h"
+#include <QDebug>
+#include <QSqlError>
+#include <QSqlQuery>
+
+static const char *TimestampFormat = "yyyy-MM-dd hh:mm:ss";
+
+ScheduleStore::ScheduleStore(const QSqlDatabase &database)
+    : db(database)
+{
+}
+
+bool ScheduleStore::ensureSchema()
+{
+    if (!db.isOpen()) {
+        qWarning() << "数据库未打开，无法初始化schedules表。";
+        return false;
+    }
+
+    QSqlQuery query(db);
+    // kind: 0 单次 1 循环；catchup_policy: 0 补执行一次 1 跳过 2 错过N分钟内补执行
+    if (!query.exec(R"(
+        CREATE TABLE IF NOT EXISTS schedules (
+            job_id INTEGER NOT NULL PRIMARY KEY,
+            scene_id TEXT NOT NULL,
+            kind INTEGER NOT NULL DEFAULT 0,
+            fire_at TEXT NOT NULL,
+            weekdays INTEGER NOT NULL DEFAULT 0,
+            time_of_day TEXT,
+            catchup_policy INTEGER NOT NULL DEFAULT 0,
+            catchup_minutes INTEGER NOT NULL DEFAULT 0,
+            last_run TEXT
+        )
+    )")) {
+        qCritical() << "创建schedules表失败:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QVector<ScheduleJob> ScheduleStore::loadAll()
+{
+    QVector<ScheduleJob> jobs;
+    if (!db.isOpen()) {
+        return jobs;
+    }
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT job_id, scene_id, kind, fire_at, weekdays, time_of_day, "
+                    "catchup_policy, catchup_minutes, last_run FROM schedules")) {
+        qCritical() << "读取定时任务失败:" << query.lastError().text();
+        return jobs;
+    }
+
+    while (query.next()) {
+        ScheduleJob job;
+        job.id = query.value(0).toULongLong();
+        job.sceneId = query.value(1).toString();
+        job.kind = query.value(2).toInt() == 1 ? ScheduleJob::Recurring : ScheduleJob::OneShot;
+        job.fireAt = QDateTime::fromString(query.value(3).toString(), TimestampFormat);
+        job.weekdays = quint8(query.value(4).toUInt());
+        job.timeOfDay = QTime::fromString(query.value(5).toString(), "hh:mm:ss");
+        job.catchUpPolicy = ScheduleJob::CatchUpPolicy(qBound(0, query.value(6).toInt(), 2));
+        job.catchUpMinutes = query.value(7).toInt();
+        job.lastRun = QDateTime::fromString(query.value(8).toString(), TimestampFormat);
+        jobs.append(job);
+    }
+    return jobs;
+}
+
+bool ScheduleStore::save(const ScheduleJob &job)
+{
+    if (!db.isOpen() || job.id == 0) {
+        return false;
+    }
+
+    QSqlQuery query(db);
+    query.prepare(R"(
+        INSERT OR REPLACE INTO schedules
+            (job_id, scene_id, kind, fire_at, weekdays, time_of_day, catchup_policy, catchup_minutes, last_run)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)
+    )");
+    query.addBindValue(job.id);
+    query.addBindValue(job.sceneId);
+    query.addBindValue(job.kind == ScheduleJob::Recurring ? 1 : 0);
+    query.addBindValue(job.fireAt.toString(TimestampFormat));
+    query.addBindValue(int(job.weekdays));
+    query.addBindValue(job.timeOfDay.isValid() ? job.timeOfDay.toString("hh:mm:ss") : QString());
+    query.addBindValue(int(job.catchUpPolicy));
+    query.addBindValue(job.catchUpMinutes);
+    query.addBindValue(job.lastRun.isValid() ? job.lastRun.toString(TimestampFormat) : QString());
+
+    if (!query.exec()) {
+        qCritical() << "保存定时任务失败:" << job.id << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool ScheduleStore::remove(quint64 jobId)
+{
+    if (!db.isOpen()) {
+        return false;
+    }
+
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM schedules WHERE job_id = ?");
+    query.addBindValue(jobId);
+    if (!query.exec()) {
+        qCritical() << "删除定时任务失败:" << jobId << query.lastError().text();
+        return false;
+    }
+    return true;
+}
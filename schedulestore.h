@@ -0,0 +1,23 @@
+#ifndef SCHEDULESTORE_H
+#define SCHEDULESTORE_H
+
+#include "scenescheduler.h"
+#include <QSqlDatabase>
+#include <QVector>
+
+// 定时任务的持久化：schedules 表，启动时一次查询全部读出
+class ScheduleStore
+{
+public:
+    explicit ScheduleStore(const QSqlDatabase &database);
+
+    bool ensureSchema();
+    QVector<ScheduleJob> loadAll();
+    bool save(const ScheduleJob &job);
+    bool remove(quint64 jobId);
+
+private:
+    QSqlDatabase db;
+};
+
+#endif // SCHEDULESTORE_H
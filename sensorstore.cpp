@@ -0,0 +1,245 @@
+#include "sensorstore.h"
+#include <QDebug>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QVariantList>
+
+const QString SensorStore::OutsideRoom = "outside";
+const QString SensorStore::SimulatedSource = "simulated";
+
+static const int FlushBatchSize = 64;               // 缓冲区达到该数量立即写入
+static const int FlushIntervalMs = 30 * 1000;       // 最长30秒写入一次
+static const int DownsampleIntervalMs = 60 * 60 * 1000;  // 每小时降采样一次
+static const int RawRetentionDays = 1;
+static const int FiveMinuteRetentionDays = 7;
+
+static const char *TimestampFormat = "yyyy-MM-dd hh:mm:ss";
+
+SensorStore::SensorStore(const QSqlDatabase &database, QObject *parent)
+    : QObject(parent)
+    , db(database)
+{
+    connect(&flushTimer, &QTimer::timeout, this, &SensorStore::flush);
+    connect(&downsampleTimer, &QTimer::timeout, this, &SensorStore::downsample);
+    flushTimer.start(FlushIntervalMs);
+    downsampleTimer.start(DownsampleIntervalMs);
+}
+
+SensorStore::~SensorStore()
+{
+    flush();
+}
+
+bool SensorStore::ensureSchema()
+{
+    if (!db.isOpen()) {
+        qWarning() << "数据库未打开，无法初始化sensor表。";
+        return false;
+    }
+
+    QSqlQuery query(db);
+    if (!query.exec(R"(
+        CREATE TABLE IF NOT EXISTS sensor (
+            id INTEGER NOT NULL PRIMARY KEY,
+            temperature REAL NOT NULL,
+            timestamp DATE
+        )
+    )")) {
+        qCritical() << "创建sensor表失败:" << query.lastError().text();
+        return false;
+    }
+
+    // 旧表只有 id/temperature/timestamp 三列，缺少的列逐个补上
+    QSqlRecord columns = db.record("sensor");
+    const QList<QPair<QString, QString>> extraColumns = {
+        {"room", "ALTER TABLE sensor ADD COLUMN room TEXT NOT NULL DEFAULT 'outside'"},
+        {"source", "ALTER TABLE sensor ADD COLUMN source TEXT NOT NULL DEFAULT 'weather'"},
+        {"resolution", "ALTER TABLE sensor ADD COLUMN resolution INTEGER NOT NULL DEFAULT 0"}
+    };
+    for (const auto &column : extraColumns) {
+        if (columns.contains(column.first)) {
+            continue;
+        }
+        if (!query.exec(column.second)) {
+            qCritical() << "为sensor表添加列失败:" << column.first << query.lastError().text();
+            return false;
+        }
+        qDebug() << "sensor表已添加列:" << column.first;
+    }
+
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_sensor_room_time ON sensor (room, timestamp)")) {
+        qCritical() << "创建sensor索引失败:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+void SensorStore::append(const QString &room, const QString &source, double temperature, const QDateTime &timestamp)
+{
+    SensorReading reading;
+    reading.room = room;
+    reading.source = source;
+    reading.temperature = temperature;
+    reading.timestamp = timestamp;
+    buffer.append(reading);
+
+    if (buffer.size() >= FlushBatchSize) {
+        flush();
+    }
+}
+
+void SensorStore::flush()
+{
+    if (buffer.isEmpty()) {
+        return;
+    }
+    if (!db.isOpen()) {
+        qWarning() << "数据库未打开，丢弃" << buffer.size() << "条温度读数。";
+        buffer.clear();
+        return;
+    }
+
+    // 按列组织绑定值，一次 execBatch 写入整个缓冲区
+    QVariantList rooms, sources, temperatures, timestamps, resolutions;
+    for (const SensorReading &reading : buffer) {
+        rooms << reading.room;
+        sources << reading.source;
+        temperatures << reading.temperature;
+        timestamps << reading.timestamp.toString(TimestampFormat);
+        resolutions << reading.resolution;
+    }
+
+    db.transaction();
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO sensor (room, source, temperature, timestamp, resolution) VALUES (?, ?, ?, ?, ?)");
+    query.addBindValue(rooms);
+    query.addBindValue(sources);
+    query.addBindValue(temperatures);
+    query.addBindValue(timestamps);
+    query.addBindValue(resolutions);
+
+    if (!query.execBatch() || !db.commit()) {
+        qCritical() << "批量写入温度读数失败:" << query.lastError().text();
+        db.rollback();
+        return;
+    }
+
+    qDebug() << "批量写入温度读数:" << buffer.size() << "条";
+    buffer.clear();
+}
+
+void SensorStore::downsample()
+{
+    if (!db.isOpen()) {
+        return;
+    }
+
+    // 先把缓冲区写完，避免降采样漏掉
+    flush();
+
+    QDateTime now = QDateTime::currentDateTime();
+
+    // 原始数据 -> 5分钟均值
+    const QString fiveMinuteBucket =
+        "strftime('%Y-%m-%d %H:', timestamp) || printf('%02d', (CAST(strftime('%M', timestamp) AS INTEGER) / 5) * 5) || ':00'";
+    downsampleLevel(0, 300, fiveMinuteBucket, now.addDays(-RawRetentionDays));
+
+    // 5分钟均值 -> 小时均值
+    const QString hourBucket = "strftime('%Y-%m-%d %H:00:00', timestamp)";
+    downsampleLevel(300, 3600, hourBucket, now.addDays(-FiveMinuteRetentionDays));
+}
+
+// 把早于 cutoff 的 fromResolution 数据按桶取平均，写成 toResolution 数据后删除原数据
+bool SensorStore::downsampleLevel(int fromResolution, int toResolution, const QString &bucketExpr, const QDateTime &cutoff)
+{
+    // 截止时间对齐到目标桶的边界，保证同一个桶只合并一次
+    QDateTime alignedCutoff = cutoff;
+    alignedCutoff.setTime(QTime(cutoff.time().hour(), toResolution >= 3600 ? 0 : cutoff.time().minute() / 5 * 5));
+    QString cutoffText = alignedCutoff.toString(TimestampFormat);
+
+    db.transaction();
+    QSqlQuery query(db);
+
+    query.prepare(QString(R"(
+        INSERT INTO sensor (room, source, temperature, timestamp, resolution)
+        SELECT room, source, AVG(temperature), %1 AS bucket, ?
+        FROM sensor
+        WHERE resolution = ? AND timestamp < ?
+        GROUP BY room, source, bucket
+    )").arg(bucketExpr));
+    query.addBindValue(toResolution);
+    query.addBindValue(fromResolution);
+    query.addBindValue(cutoffText);
+    if (!query.exec()) {
+        qCritical() << "温度数据降采样失败:" << query.lastError().text();
+        db.rollback();
+        return false;
+    }
+    int merged = query.numRowsAffected();
+
+    query.prepare("DELETE FROM sensor WHERE resolution = ? AND timestamp < ?");
+    query.addBindValue(fromResolution);
+    query.addBindValue(cutoffText);
+    if (!query.exec()) {
+        qCritical() << "删除已降采样的温度数据失败:" << query.lastError().text();
+        db.rollback();
+        return false;
+    }
+    int removed = query.numRowsAffected();
+
+    if (!db.commit()) {
+        qCritical() << "提交降采样事务失败:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+
+    if (removed > 0) {
+        qDebug() << "温度数据降采样:" << removed << "条" << fromResolution << "秒数据合并为" << merged << "条" << toResolution << "秒数据";
+    }
+    return true;
+}
+
+QVector<SensorReading> SensorStore::querySeries(const QString &room, const QDateTime &from, const QDateTime &to)
+{
+    QVector<SensorReading> series;
+    if (!db.isOpen()) {
+        return series;
+    }
+
+    // 查询前写入缓冲区，保证曲线包含最新读数
+    flush();
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(R"(
+        SELECT source, temperature, timestamp, resolution
+        FROM sensor
+        WHERE room = ? AND timestamp >= ? AND timestamp < ?
+        ORDER BY timestamp
+    )");
+    query.addBindValue(room);
+    query.addBindValue(from.toString(TimestampFormat));
+    query.addBindValue(to.toString(TimestampFormat));
+    if (!query.exec()) {
+        qCritical() << "查询温度曲线失败:" << query.lastError().text();
+        return series;
+    }
+
+    while (query.next()) {
+        SensorReading reading;
+        reading.room = room;
+        reading.source = query.value(0).toString();
+        reading.temperature = query.value(1).toDouble();
+        reading.timestamp = QDateTime::fromString(query.value(2).toString(), TimestampFormat);
+        reading.resolution = query.value(3).toInt();
+        series.append(reading);
+    }
+    return series;
+}
+
+QVector<SensorReading> SensorStore::queryDay(const QString &room, const QDate &date)
+{
+    QDateTime from(date, QTime(0, 0));
+    return querySeries(room, from, from.addDays(1));
+}
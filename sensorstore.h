@@ -0,0 +1,59 @@
+#ifndef SENSORSTORE_H
+#define SENSORSTORE_H
+
+#include <QDateTime>
+#include <QObject>
+#include <QSqlDatabase>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+// 一条温度读数
+struct SensorReading
+{
+    QString room;          // 房间，室外为 "outside"
+    QString source;        // 来源：weather / simulated / sensor
+    double temperature = 0.0;
+    QDateTime timestamp;
+    int resolution = 0;    // 0: 原始数据，300: 5分钟均值，3600: 小时均值
+};
+
+// 温度时间序列：写入 sensor 表，批量入库，并自动降采样
+// 原始数据保留1天，之后合并为5分钟均值；5分钟均值保留7天，之后合并为小时均值
+class SensorStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const QString OutsideRoom;
+    static const QString SimulatedSource;  // 由室外温度推算的室温，不是实测读数
+
+    explicit SensorStore(const QSqlDatabase &database, QObject *parent = nullptr);
+    ~SensorStore();
+
+    // 为 sensor 表补充 room/source/resolution 列和 (room, timestamp) 索引
+    bool ensureSchema();
+
+    // 追加一条读数，先进入缓冲区，缓冲区满或定时器到期时批量写入
+    void append(const QString &room, const QString &source, double temperature,
+                const QDateTime &timestamp = QDateTime::currentDateTime());
+
+    // 查询某个房间在时间范围内的温度曲线（走 room+timestamp 索引的一次范围读）
+    QVector<SensorReading> querySeries(const QString &room, const QDateTime &from, const QDateTime &to);
+    // 查询某个房间最近一天的温度曲线
+    QVector<SensorReading> queryDay(const QString &room, const QDate &date);
+
+public slots:
+    void flush();
+    void downsample();
+
+private:
+    bool downsampleLevel(int fromResolution, int toResolution, const QString &bucketExpr, const QDateTime &cutoff);
+
+    QSqlDatabase db;
+    QVector<SensorReading> buffer;
+    QTimer flushTimer;
+    QTimer downsampleTimer;
+};
+
+#endif // SENSORSTORE_H
@@ -0,0 +1,72 @@
+# 应用和基准测试共用的源文件（main.cpp 除外）
+INCLUDEPATH += $$PWD
+
+# CONFIG += count_allocations 时统计堆分配（见 allocationcounter.h），只用于基准测试
+count_allocations: DEFINES += SMARTHOME_COUNT_ALLOCATIONS
+
+SOURCES += \
+    $$PWD/acplanner.cpp \
+    $$PWD/allocationcounter.cpp \
+    $$PWD/anomalydetector.cpp \
+    $$PWD/controlserver.cpp \
+    $$PWD/devicecatalog.cpp \
+    $$PWD/energymeter.cpp \
+    $$PWD/historyexporter.cpp \
+    $$PWD/homecontroller.cpp \
+    $$PWD/homesnapshot.cpp \
+    $$PWD/mainwindow.cpp \
+    $$PWD/metricsregistry.cpp \
+    $$PWD/metricsserver.cpp \
+    $$PWD/networkworker.cpp \
+    $$PWD/retrypolicy.cpp \
+    $$PWD/ruleengine.cpp \
+    $$PWD/sceneanalytics.cpp \
+    $$PWD/scenescheduler.cpp \
+    $$PWD/scenesequencer.cpp \
+    $$PWD/sceneusagedialog.cpp \
+    $$PWD/schedulestore.cpp \
+    $$PWD/sensorstore.cpp \
+    $$PWD/storageworker.cpp \
+    $$PWD/thermalmodel.cpp \
+    $$PWD/timepickerdialog.cpp \
+    $$PWD/userdefinedscenedialog.cpp \
+    $$PWD/weathercache.cpp \
+    $$PWD/weatherpollpolicy.cpp \
+    $$PWD/weatherprovider.cpp
+
+HEADERS += \
+    $$PWD/acplanner.h \
+    $$PWD/allocationcounter.h \
+    $$PWD/anomalydetector.h \
+    $$PWD/controlserver.h \
+    $$PWD/devicecatalog.h \
+    $$PWD/devicetraits.h \
+    $$PWD/energymeter.h \
+    $$PWD/historyexporter.h \
+    $$PWD/homecontroller.h \
+    $$PWD/homesnapshot.h \
+    $$PWD/mainwindow.h \
+    $$PWD/metricsregistry.h \
+    $$PWD/metricsserver.h \
+    $$PWD/networkworker.h \
+    $$PWD/retrypolicy.h \
+    $$PWD/ruleengine.h \
+    $$PWD/sceneanalytics.h \
+    $$PWD/scenescheduler.h \
+    $$PWD/scenesequencer.h \
+    $$PWD/sceneusagedialog.h \
+    $$PWD/schedulestore.h \
+    $$PWD/sensorstore.h \
+    $$PWD/storageworker.h \
+    $$PWD/thermalmodel.h \
+    $$PWD/timepickerdialog.h \
+    $$PWD/userdefinedscenedialog.h \
+    $$PWD/weathercache.h \
+    $$PWD/weatherpollpolicy.h \
+    $$PWD/weatherprovider.h
+
+FORMS += \
+    $$PWD/mainwindow.ui
+
+RESOURCES += \
+    $$PWD/resources.qrc
@@ -0,0 +1,734 @@
+#include "storageworker.h"
+#include "devicecatalog.h"
+#include "devicetraits.h"
+#include "energymeter.h"
+#include "homesnapshot.h"
+#include "metricsregistry.h"
+#include "sceneanalytics.h"
+#include "schedulestore.h"
+#include "sensorstore.h"
+#include <QDebug>
+#include <QHash>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QStringList>
+#include <algorithm>
+#include <utility>
+
+const QString StorageWorker::DefaultConnectionName = QStringLiteral("smarthome_storage");
+
+static const QString TimestampFormat = QStringLiteral("yyyy-MM-dd hh:mm:ss");
+
+static MetricHistogram *sqlHistogram(const QString &statement)
+{
+    return &MetricsRegistry::instance().histogram("smarthome_sql_duration_seconds", "SQL statement latency",
+                                                  MetricsRegistry::label("statement", statement));
+}
+
+StorageWorker::StorageWorker(const QString &databasePath, const QString &connectionName, QObject *parent)
+    : QObject(parent)
+    , databasePath(databasePath)
+    , connectionName(connectionName)
+    , sensorStore(nullptr)
+    , energyMeter(nullptr)
+    , scheduleStore(nullptr)
+    , analytics(nullptr)
+    , statementsPrepared(false)
+    , historyInsertSeconds(sqlHistogram("device_history_insert"))
+    , statusUpdateSeconds(sqlHistogram("device_status_update"))
+    , sceneInsertSeconds(sqlHistogram("scene_history_insert"))
+    , batchSeconds(&MetricsRegistry::instance().histogram("smarthome_storage_batch_seconds",
+                                                          "Time to write one batch of queued records"))
+    , historyQueueDepth(&MetricsRegistry::instance().gauge("smarthome_history_queue_depth",
+                                                           "History rows waiting to be written"))
+{
+}
+
+// 在所属线程中析构（QThread::finished 连接到 deleteLater），先写完队列中剩余的记录
+StorageWorker::~StorageWorker()
+{
+    close();
+}
+
+QString StorageWorker::defaultDatabasePath()
+{
+    QString path = qEnvironmentVariable("SMARTHOME_DB_PATH");
+    if (path.isEmpty()) {
+        path = "C:/Users/Daisy/Desktop/QtCode/QtLab-FinalProject/finalprojectDB.db";
+    }
+    return path;
+}
+
+bool StorageWorker::open()
+{
+    if (db.isOpen()) {
+        return true;
+    }
+
+    db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setDatabaseName(databasePath);
+    if (!db.open()) {
+        qCritical() << "数据库打开失败:" << db.lastError().text();
+        return false;
+    }
+    qDebug() << "数据库打开成功:" << databasePath;
+
+    if (!HomeController::createSchema(db)) {
+        return false;
+    }
+
+    // 温度时间序列写入 sensor 表
+    sensorStore = new SensorStore(db);
+    sensorStore->ensureSchema();
+
+    // 能耗统计，由写入的设备开关和空调设置记录驱动
+    energyMeter = new EnergyMeter(db);
+    if (!energyMeter->ensureSchema()) {
+        delete energyMeter;
+        energyMeter = nullptr;
+    }
+
+    scheduleStore = new ScheduleStore(db);
+    if (!scheduleStore->ensureSchema()) {
+        delete scheduleStore;
+        scheduleStore = nullptr;
+    }
+
+    // 场景使用统计；scene_usage 表第一次创建时用已有历史回填
+    analytics = new SceneAnalytics(db);
+    if (!analytics->ensureSchema()) {
+        delete analytics;
+        analytics = nullptr;
+    }
+    return true;
+}
+
+void StorageWorker::close()
+{
+    drain();
+
+    // 各个存储对象析构时会写入缓冲的数据，必须在关闭连接之前
+    delete sensorStore;
+    sensorStore = nullptr;
+    delete energyMeter;
+    energyMeter = nullptr;
+    delete scheduleStore;
+    scheduleStore = nullptr;
+    delete analytics;
+    analytics = nullptr;
+
+    insertHistoryQuery = QSqlQuery();
+    updateStatusQuery = QSqlQuery();
+    insertSceneQuery = QSqlQuery();
+    lastSequenceQuery = QSqlQuery();
+    statementsPrepared = false;
+
+    if (db.isValid()) {
+        db.close();
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(connectionName);
+    }
+}
+
+bool StorageWorker::isOpen() const
+{
+    return db.isOpen();
+}
+
+QSqlDatabase StorageWorker::database() const
+{
+    return db;
+}
+
+SceneAnalytics *StorageWorker::sceneAnalytics() const
+{
+    return analytics;
+}
+
+EnergyMeter *StorageWorker::meter() const
+{
+    return energyMeter;
+}
+
+void StorageWorker::populateDefaultDevices()
+{
+    if (!db.isOpen()) {
+        qCritical() << "数据库未打开，无法插入默认设备。";
+        return;
+    }
+
+    QString currentTime = QDateTime::currentDateTime().toString(TimestampFormat);
+    // 设备列表来自设备目录
+    const QVector<DeviceInfo> &defaultDevices = DeviceCatalog::instance().devices();
+
+    // 事务包裹批量插入，语句只准备一次
+    db.transaction();
+    QSqlQuery query(db);
+    if (!query.prepare(R"(
+            INSERT OR IGNORE INTO devices (device_id, name, type, status, created_at)
+            VALUES (?, ?, ?, ?, ?)
+        )")) {
+        qWarning() << "准备SQL失败:" << query.lastError().text();
+        db.rollback();
+        return;
+    }
+
+    int insertedCount = 0;
+    for (const DeviceInfo &device : defaultDevices) {
+        query.bindValue(0, device.id);
+        query.bindValue(1, device.name);
+        query.bindValue(2, device.type);
+        query.bindValue(3, device.defaultStatus);
+        query.bindValue(4, currentTime);
+
+        if (query.exec()) {
+            if (query.numRowsAffected() > 0) {
+                insertedCount++;
+                qDebug() << "成功插入设备:" << device.id;
+            }
+        } else {
+            qWarning() << "插入设备失败:" << device.id
+                       << "原因:" << query.lastError().text();
+        }
+    }
+
+    if (db.commit()) {
+        qDebug() << "默认设备检查完成。本次新插入" << insertedCount << "个设备。";
+    } else {
+        qCritical() << "提交设备插入事务失败:" << db.lastError().text();
+        db.rollback();
+    }
+}
+
+void StorageWorker::populateDefaultScenes()
+{
+    if (!db.isOpen()) {
+        qCritical() << "数据库未打开，无法插入默认场景。";
+        return;
+    }
+
+    QString currentTime = QDateTime::currentDateTime().toString(TimestampFormat);
+    // 默认场景列表（scene_id + 场景名称）
+    const QList<QPair<QString, QString>> defaultScenes = {
+        {"comingHomeMode", "回家模式"},
+        {"leavingHomeMode", "离家模式"},
+        {"SleepMode", "睡眠模式"},
+        {"WakeUpMode", "起床模式"}
+    };
+
+    db.transaction();
+    QSqlQuery query(db);
+    if (!query.prepare("INSERT OR IGNORE INTO scenes (scene_id, name, created_at) VALUES (?, ?, ?)")) {
+        qWarning() << "准备场景SQL失败:" << query.lastError().text();
+        db.rollback();
+        return;
+    }
+
+    int insertedCount = 0;
+    for (const auto &scene : defaultScenes) {
+        query.bindValue(0, scene.first);
+        query.bindValue(1, scene.second);
+        query.bindValue(2, currentTime);
+
+        if (query.exec()) {
+            if (query.numRowsAffected() > 0) {
+                insertedCount++;
+                qDebug() << "成功插入场景:" << scene.first;
+            }
+        } else {
+            qWarning() << "插入场景失败:" << scene.first << "原因:" << query.lastError().text();
+        }
+    }
+
+    if (db.commit()) {
+        qDebug() << "默认场景检查完成。本次新插入" << insertedCount << "个场景。";
+    } else {
+        qCritical() << "提交场景插入事务失败:" << db.lastError().text();
+        db.rollback();
+    }
+}
+
+QVector<DeviceState> StorageWorker::loadDevices()
+{
+    return HomeController::readDevices(db);
+}
+
+// 每个设备最近一条开关记录（温度等其他操作不算）；状态值取自设备类型表
+static QString latestStateSql()
+{
+    QStringList values;
+    for (const DeviceTypeTraits &traits : DeviceTraitsTable) {
+        for (const char *value : { traits.onValue, traits.offValue }) {
+            QString quoted = QString("'%1'").arg(QLatin1String(value));
+            if (!values.contains(quoted)) {
+                values << quoted;
+            }
+        }
+    }
+    return "SELECT device_id, action_value FROM device_history WHERE seq IN ("
+           "SELECT MAX(seq) FROM device_history WHERE seq > 0 AND action_value IN (" + values.join(", ") + ") "
+           "GROUP BY device_id)";
+}
+
+// device_history 是开关状态的权威记录，devices.status 只是由它派生的缓存。
+// 以快照为起点按序号回放之后的开关记录（走 seq 的唯一索引），用时只与快照之后的记录数有关；
+// 快照在每批记录提交后1秒内更新，回放的记录通常只有几条，与历史总量无关。
+// 没有快照（或快照不知道序号）时每个设备取最近一条开关记录，没有记录的设备保持 devices.status。
+// 写入状态和写入历史之间崩溃时两者会不一致，以历史为准改正 devices.status；
+// 读取历史失败时退回 devices.status，不做改正。能耗统计按恢复结果重新开始计量
+DeviceRecovery StorageWorker::recoverDevices(const HomeSnapshot *snapshot)
+{
+    DeviceRecovery recovery;
+    recovery.devices = loadDevices();
+    recovery.sequence = lastHistorySequence();
+    if (recovery.devices.isEmpty()) {
+        return recovery;
+    }
+
+    QHash<QString, int> indexes;
+    indexes.reserve(recovery.devices.size());
+    QVector<bool> stored(recovery.devices.size());
+    for (int i = 0; i < recovery.devices.size(); ++i) {
+        indexes.insert(recovery.devices.at(i).deviceId, i);
+        stored[i] = recovery.devices.at(i).on;
+    }
+
+    // 界面上已经显示的状态：快照中的状态，快照之后新加入目录的设备在界面上是关闭的
+    QVector<bool> fromSnapshot(recovery.devices.size(), false);
+    if (snapshot) {
+        for (const DeviceState &saved : snapshot->devices) {
+            auto it = indexes.constFind(saved.deviceId);
+            if (it == indexes.constEnd()) {
+                continue;  // 设备目录中已经没有这个设备
+            }
+            DeviceState &device = recovery.devices[it.value()];
+            device.on = saved.on;
+            device.mode = saved.mode;
+            device.temperature = saved.temperature;
+            fromSnapshot[it.value()] = saved.on;
+        }
+    }
+
+    const bool fromTail = snapshot && snapshot->historySequence >= 0;
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (fromTail) {
+        query.prepare("SELECT device_id, action_value FROM device_history WHERE seq > ? ORDER BY seq");
+        query.addBindValue(snapshot->historySequence);
+    } else {
+        query.prepare(latestStateSql());
+    }
+    const bool replayed = query.exec();
+    if (!replayed) {
+        qCritical() << "读取设备历史失败，按 devices.status 恢复设备状态:" << query.lastError().text();
+        for (int i = 0; i < recovery.devices.size(); ++i) {
+            recovery.devices[i].on = stored.at(i);
+        }
+    }
+    while (replayed && query.next()) {
+        ++recovery.replayedRows;
+        QString value = query.value(1).toString();
+        bool isOn = HomeController::isOnValue(value);
+        if (!isOn && !HomeController::isOffValue(value)) {
+            continue;
+        }
+        auto it = indexes.constFind(query.value(0).toString());
+        if (it != indexes.constEnd()) {
+            recovery.devices[it.value()].on = isOn;
+        }
+    }
+
+    // 没有快照时界面按恢复结果重绘全部设备，否则只重绘与快照不同的设备
+    for (int i = 0; i < recovery.devices.size(); ++i) {
+        if (!snapshot || recovery.devices.at(i).on != fromSnapshot.at(i)) {
+            recovery.replayedIds << recovery.devices.at(i).deviceId;
+        }
+    }
+
+    if (replayed && prepareStatements()) {
+        db.transaction();
+        for (int i = 0; i < recovery.devices.size(); ++i) {
+            const DeviceState &device = recovery.devices.at(i);
+            DeviceKind kind;
+            if (device.on == stored.at(i) || !deviceKindFromType(device.type, &kind)) {
+                continue;
+            }
+            const DeviceTypeTraits &traits = deviceTraits(kind);
+            updateStatusQuery.bindValue(0, QString::fromLatin1(device.on ? traits.onValue : traits.offValue));
+            updateStatusQuery.bindValue(1, device.deviceId);
+            if (!updateStatusQuery.exec()) {
+                qCritical() << "改正设备状态失败:" << device.deviceId << updateStatusQuery.lastError().text();
+                continue;
+            }
+            ++recovery.repairedRows;
+        }
+        if (!db.commit()) {
+            qCritical() << "提交设备状态改正失败:" << db.lastError().text();
+            db.rollback();
+        }
+    }
+    // 能耗统计与界面、控制核心使用同一份恢复结果（打开数据库时按 devices.status 计量）
+    if (energyMeter) {
+        energyMeter->setDevices(recovery.devices);
+    }
+
+    qDebug() << "设备状态已恢复：快照序号" << (fromTail ? snapshot->historySequence : -1) << "读取" << recovery.replayedRows
+             << "条记录，改正" << recovery.repairedRows << "个设备状态";
+    return recovery;
+}
+
+// 已写入的 device_history 最大序号，没有记录时为0
+qint64 StorageWorker::lastHistorySequence()
+{
+    if (!db.isOpen() || !prepareStatements()) {
+        return 0;
+    }
+    if (!lastSequenceQuery.exec() || !lastSequenceQuery.next()) {
+        qCritical() << "读取设备历史序号失败:" << lastSequenceQuery.lastError().text();
+        return 0;
+    }
+    qint64 sequence = lastSequenceQuery.value(0).toLongLong();
+    lastSequenceQuery.finish();
+    return sequence;
+}
+
+// 更新设备的名称、类型和状态，空字符串表示该字段不变
+void StorageWorker::updateDevice(const QString &deviceId, const QString &name, const QString &type,
+                                 const QString &status)
+{
+    if (!db.isOpen()) {
+        qWarning() << "数据库未打开，无法更新设备状态。";
+        return;
+    }
+
+    QStringList updateFields;
+    QVariantList values;
+    if (!name.isEmpty()) {
+        updateFields << "name = ?";
+        values << name;
+    }
+    if (!type.isEmpty()) {
+        updateFields << "type = ?";
+        values << type;
+    }
+    if (!status.isEmpty()) {
+        updateFields << "status = ?";
+        values << status;
+    }
+    if (updateFields.isEmpty()) {
+        qDebug() << "无需要更新的设备字段，跳过更新";
+        return;
+    }
+
+    QSqlQuery query(db);
+    query.prepare(QString("UPDATE devices SET %1 WHERE device_id = ?").arg(updateFields.join(", ")));
+    for (const QVariant &value : qAsConst(values)) {
+        query.addBindValue(value);
+    }
+    query.addBindValue(deviceId);
+
+    if (!query.exec()) {
+        qCritical() << "更新设备状态失败 for device" << deviceId << "Error:" << query.lastError().text();
+    } else if (query.numRowsAffected() > 0) {
+        qDebug() << "成功更新设备:" << deviceId << name << type << status;
+    } else {
+        qDebug() << "设备状态未变化（或设备不存在）:" << deviceId;
+    }
+}
+
+QVector<ScheduleJob> StorageWorker::loadSchedules()
+{
+    return scheduleStore ? scheduleStore->loadAll() : QVector<ScheduleJob>();
+}
+
+void StorageWorker::saveSchedule(const ScheduleJob &job)
+{
+    if (scheduleStore) {
+        scheduleStore->save(job);
+    }
+}
+
+void StorageWorker::removeSchedule(quint64 jobId)
+{
+    if (scheduleStore) {
+        scheduleStore->remove(jobId);
+    }
+}
+
+void StorageWorker::appendReading(const QString &room, const QString &source, double temperature,
+                                  const QDateTime &at)
+{
+    if (sensorStore) {
+        sensorStore->append(room, source, temperature, at);
+    }
+}
+
+// 热模型（需要时重新拟合）、各房间最近的室温，以及离家时预测的到家时间
+PlanningInputs StorageWorker::loadPlanningInputs(const QDateTime &now, bool fitModels, bool predictArrival)
+{
+    PlanningInputs inputs;
+    inputs.at = now;
+    if (!sensorStore) {
+        return inputs;
+    }
+
+    // 用最近7天的室温曲线和空调开关记录拟合各房间的热模型；
+    // 模拟的室温只是室外温度加3度，不反映房间的散热和空调能力，只用实测读数，没有实测读数的房间保留默认参数
+    if (fitModels) {
+        QDateTime from = now.addDays(-7);
+        QVector<SensorReading> outside = sensorStore->querySeries(SensorStore::OutsideRoom, from, now);
+        for (int room = 0; room < AcPlanner::RoomCount; ++room) {
+            QVector<SensorReading> indoor = sensorStore->querySeries(AcPlanner::roomName(AcPlanner::Room(room)), from, now);
+            indoor.erase(std::remove_if(indoor.begin(), indoor.end(), [](const SensorReading &reading) {
+                return reading.source == SensorStore::SimulatedSource;
+            }), indoor.end());
+            if (indoor.isEmpty()) {
+                continue;
+            }
+            QVector<QPair<QDateTime, QDateTime>> acOn =
+                loadAcOnIntervals(AcPlanner::acDeviceId(AcPlanner::Room(room)), from, now);
+            inputs.models[room].fit(ThermalModel::buildSamples(indoor, outside, acOn));
+        }
+        inputs.modelsFitted = true;
+    }
+
+    for (int room = 0; room < AcPlanner::RoomCount; ++room) {
+        QVector<SensorReading> recent = sensorStore->querySeries(AcPlanner::roomName(AcPlanner::Room(room)),
+                                                                 now.addSecs(-2 * 3600), now);
+        if (!recent.isEmpty()) {
+            inputs.indoor[room] = recent.last().temperature;
+        }
+    }
+
+    if (predictArrival) {
+        inputs.predictedArrival = predictArrivalTime(now);
+    }
+    return inputs;
+}
+
+// 可以在任意线程调用：追加到队列，队列原本为空时通知存储线程
+void StorageWorker::enqueue(const StorageRecord &record)
+{
+    bool wasEmpty;
+    {
+        QMutexLocker locker(&queueMutex);
+        wasEmpty = pending.isEmpty();
+        pending.append(record);
+        historyQueueDepth->set(pending.size());
+    }
+    if (wasEmpty) {
+        QMetaObject::invokeMethod(this, &StorageWorker::drain, Qt::QueuedConnection);
+    }
+}
+
+int StorageWorker::pendingRecords() const
+{
+    QMutexLocker locker(&queueMutex);
+    return pending.size() + writing.size();
+}
+
+void StorageWorker::drain()
+{
+    {
+        QMutexLocker locker(&queueMutex);
+        if (pending.isEmpty()) {
+            return;
+        }
+        writing.swap(pending);
+        historyQueueDepth->set(0);
+    }
+
+    if (!db.isOpen() || !prepareStatements()) {
+        qWarning() << "数据库未打开，丢弃" << writing.size() << "条记录";
+    } else {
+        // 积压的记录放在一个事务中提交，积压越多每条记录的开销越小
+        MetricTimer timer(*batchSeconds);
+        bool deviceActions = false;
+        db.transaction();
+        for (const StorageRecord &record : qAsConst(writing)) {
+            write(record);
+            deviceActions = deviceActions || record.kind == StorageRecord::DeviceAction;
+        }
+        if (!db.commit()) {
+            qCritical() << "提交历史记录事务失败:" << db.lastError().text();
+            db.rollback();
+            if (analytics) {
+                analytics->rollback();
+            }
+        } else {
+            if (analytics) {
+                analytics->commit();
+            }
+            if (deviceActions) {
+                emit historyCommitted(lastHistorySequence());
+            }
+        }
+    }
+
+    // 保留容量，下一批交换回来时不再分配
+    QMutexLocker locker(&queueMutex);
+    writing.resize(0);
+}
+
+bool StorageWorker::prepareStatements()
+{
+    if (statementsPrepared) {
+        return true;
+    }
+
+    insertHistoryQuery = QSqlQuery(db);
+    updateStatusQuery = QSqlQuery(db);
+    insertSceneQuery = QSqlQuery(db);
+    lastSequenceQuery = QSqlQuery(db);
+    lastSequenceQuery.setForwardOnly(true);
+    if (!insertHistoryQuery.prepare(HomeController::InsertHistorySql)
+        || !updateStatusQuery.prepare(HomeController::UpdateStatusSql)
+        || !insertSceneQuery.prepare(HomeController::InsertSceneSql)
+        || !lastSequenceQuery.prepare("SELECT IFNULL(MAX(seq), 0) FROM device_history")) {
+        qCritical() << "准备存储线程SQL失败:" << insertHistoryQuery.lastError().text()
+                    << updateStatusQuery.lastError().text() << insertSceneQuery.lastError().text()
+                    << lastSequenceQuery.lastError().text();
+        return false;
+    }
+    statementsPrepared = true;
+    return true;
+}
+
+bool StorageWorker::write(const StorageRecord &record)
+{
+    QSqlQuery *query = nullptr;
+    MetricHistogram *seconds = nullptr;
+
+    switch (record.kind) {
+    case StorageRecord::DeviceAction: {
+        bool isOn = HomeController::isOnValue(record.value);
+        if (energyMeter && (isOn || HomeController::isOffValue(record.value))) {
+            energyMeter->recordPower(record.id, isOn, record.at);
+        }
+        // 时间戳与 CURRENT_TIMESTAMP 一样使用 UTC
+        insertHistoryQuery.bindValue(0, record.id);
+        insertHistoryQuery.bindValue(1, record.type);
+        insertHistoryQuery.bindValue(2, record.value);
+        insertHistoryQuery.bindValue(3, record.at.toUTC().toString(TimestampFormat));
+        query = &insertHistoryQuery;
+        seconds = historyInsertSeconds;
+        break;
+    }
+    case StorageRecord::StatusUpdate:
+        updateStatusQuery.bindValue(0, record.value);
+        updateStatusQuery.bindValue(1, record.id);
+        query = &updateStatusQuery;
+        seconds = statusUpdateSeconds;
+        break;
+    case StorageRecord::SceneRun:
+        insertSceneQuery.bindValue(0, record.id);
+        insertSceneQuery.bindValue(1, record.at.toString(TimestampFormat));
+        query = &insertSceneQuery;
+        seconds = sceneInsertSeconds;
+        break;
+    case StorageRecord::AcSetting:
+        if (energyMeter) {
+            energyMeter->setAcSetting(record.id, record.type, record.number, record.at);
+        }
+        return true;
+    }
+
+    bool ok;
+    {
+        MetricTimer timer(*seconds);
+        ok = query->exec();
+    }
+    if (!ok) {
+        qCritical() << "写入记录失败:" << record.id << record.type << record.value
+                    << "Error:" << query->lastError().text();
+        return false;
+    }
+    qCDebug(lcControl) << "成功写入记录:" << record.id << "-" << record.type << ":" << record.value;
+
+    // 场景统计只计已写入的记录，本批提交后才进入内存（见 drain）
+    if (analytics && record.kind == StorageRecord::DeviceAction) {
+        analytics->recordDeviceAction(record.type, record.at);
+    } else if (analytics && record.kind == StorageRecord::SceneRun) {
+        analytics->recordSceneRun(record.id, record.at);
+    }
+    return true;
+}
+
+// 从 device_history 读出空调开启的时间段（device_history 的时间戳是 UTC）
+QVector<QPair<QDateTime, QDateTime>> StorageWorker::loadAcOnIntervals(const QString &deviceId, const QDateTime &from,
+                                                                       const QDateTime &now)
+{
+    QVector<QPair<QDateTime, QDateTime>> intervals;
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT action_value, timestamp FROM device_history "
+                  "WHERE device_id = ? AND timestamp >= ? ORDER BY timestamp");
+    query.addBindValue(deviceId);
+    query.addBindValue(from.toUTC().toString(TimestampFormat));
+    if (!query.exec()) {
+        qCritical() << "读取空调开关记录失败:" << deviceId << query.lastError().text();
+        return intervals;
+    }
+
+    QDateTime onSince;
+    while (query.next()) {
+        QDateTime time = QDateTime::fromString(query.value(1).toString(), TimestampFormat);
+        time.setTimeSpec(Qt::UTC);
+        time = time.toLocalTime();
+
+        QString value = query.value(0).toString();
+        if (value == QLatin1String("on") && !onSince.isValid()) {
+            onSince = time;
+        } else if (value == QLatin1String("off") && onSince.isValid()) {
+            intervals.append(qMakePair(onSince, time));
+            onSince = QDateTime();
+        }
+    }
+    if (onSince.isValid()) {
+        intervals.append(qMakePair(onSince, now));
+    }
+    return intervals;
+}
+
+// 根据最近4周回家场景的记录预测下一次到家时间：同类日期（工作日/周末）的中位数时刻
+QDateTime StorageWorker::predictArrivalTime(const QDateTime &now)
+{
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT timestamp FROM scene_history WHERE scene_id = ? AND timestamp >= ?");
+    query.addBindValue(QString("comingHomeMode"));
+    query.addBindValue(now.addDays(-28).toString(TimestampFormat));
+    if (!query.exec()) {
+        qCritical() << "读取回家场景记录失败:" << query.lastError().text();
+        return QDateTime();
+    }
+
+    QVector<int> weekdaySecs;
+    QVector<int> weekendSecs;
+    while (query.next()) {
+        QDateTime time = QDateTime::fromString(query.value(0).toString(), TimestampFormat);
+        if (!time.isValid()) {
+            continue;
+        }
+        QVector<int> &bucket = time.date().dayOfWeek() >= 6 ? weekendSecs : weekdaySecs;
+        bucket.append(time.time().msecsSinceStartOfDay() / 1000);
+    }
+
+    // 记录少于3次时不做预测
+    auto medianArrival = [](QVector<int> secs, const QDate &date) {
+        if (secs.size() < 3) {
+            return QDateTime();
+        }
+        std::sort(secs.begin(), secs.end());
+        return QDateTime(date, QTime(0, 0).addSecs(secs.at(secs.size() / 2)));
+    };
+
+    for (int day = 0; day <= 1; ++day) {
+        QDate date = now.date().addDays(day);
+        QDateTime arrival = medianArrival(date.dayOfWeek() >= 6 ? weekendSecs : weekdaySecs, date);
+        if (arrival.isValid() && arrival > now) {
+            return arrival;
+        }
+    }
+    return QDateTime();
+}
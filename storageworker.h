@@ -0,0 +1,155 @@
+#ifndef STORAGEWORKER_H
+#define STORAGEWORKER_H
+
+#include "acplanner.h"
+#include "homecontroller.h"
+#include "scenescheduler.h"
+#include "thermalmodel.h"
+#include <QDateTime>
+#include <QMutex>
+#include <QObject>
+#include <QPair>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QtNumeric>
+
+class EnergyMeter;
+struct HomeSnapshot;
+class MetricGauge;
+class MetricHistogram;
+class SceneAnalytics;
+class ScheduleStore;
+class SensorStore;
+
+// 交给存储线程写入的一条记录
+struct StorageRecord
+{
+    enum Kind {
+        DeviceAction,   // device_history，开关类的值同时计入能耗统计，手动操作计入场景统计
+        StatusUpdate,   // devices.status
+        SceneRun,       // scene_history 和场景统计
+        AcSetting       // 空调模式和设定温度，只计入能耗统计
+    };
+
+    Kind kind = DeviceAction;
+    QString id;         // 设备ID或场景ID
+    QString type;       // 操作类型；AcSetting 为空调模式
+    QString value;      // 操作值或设备状态
+    int number = 0;     // AcSetting 的设定温度
+    QDateTime at;
+};
+
+// 预调温用到的历史数据，在存储线程中一次读出后交给界面线程
+struct PlanningInputs
+{
+    QDateTime at;
+    bool modelsFitted = false;
+    ThermalModel models[AcPlanner::RoomCount];
+    double indoor[AcPlanner::RoomCount] = { qQNaN(), qQNaN() };  // 最近2小时没有室温读数时为 NaN
+    QDateTime predictedArrival;
+};
+
+// 启动时恢复出的设备状态，在存储线程中得到后交给控制线程和界面线程
+struct DeviceRecovery
+{
+    QVector<DeviceState> devices;
+    QStringList replayedIds;   // 界面需要重绘的设备：没有快照时为全部设备，否则为回放后与快照不同的设备
+    qint64 sequence = 0;       // 恢复到的 device_history 序号
+    int replayedRows = 0;
+    int repairedRows = 0;      // 与恢复结果不一致、被改正的 devices.status 行数
+};
+
+// 存储线程：持有程序唯一的 SQLite 连接，建表、写入初始数据、写历史记录和所有查询都在这里执行。
+// 其他线程通过 enqueue 提交写入（只在队列由空变为非空时唤醒一次存储线程），
+// 或用 QMetaObject::invokeMethod 把查询交给存储线程，结果再投递回调用方的线程
+//
+// 不调用 moveToThread 时所有函数都可以在当前线程中直接使用（基准测试和命令行工具）
+class StorageWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const QString DefaultConnectionName;
+
+    explicit StorageWorker(const QString &databasePath, const QString &connectionName = DefaultConnectionName,
+                           QObject *parent = nullptr);
+    ~StorageWorker();
+
+    // 环境变量 SMARTHOME_DB_PATH 可以指定数据库文件，基准测试和工具使用独立的数据库
+    static QString defaultDatabasePath();
+
+    // 以下函数都在存储线程中调用
+    bool open();
+    void close();
+    bool isOpen() const;
+    QSqlDatabase database() const;
+    // 在 open 中创建、close 中删除；查询函数可以在其他线程中调用（数据库打开之后、关闭之前）
+    SceneAnalytics *sceneAnalytics() const;
+    // 在 open 中创建、close 中删除；只在存储线程中使用
+    EnergyMeter *meter() const;
+
+    void populateDefaultDevices();  // 向 devices 表插入设备
+    void populateDefaultScenes();
+    QVector<DeviceState> loadDevices();
+    // 快照加上快照之后的 device_history 得到设备状态，没有快照时取每个设备最近的开关记录，并改正 devices.status；
+    // 读取历史失败时使用 devices.status
+    DeviceRecovery recoverDevices(const HomeSnapshot *snapshot);
+    qint64 lastHistorySequence();
+    void updateDevice(const QString &deviceId, const QString &name, const QString &type, const QString &status);
+
+    QVector<ScheduleJob> loadSchedules();
+    void saveSchedule(const ScheduleJob &job);
+    void removeSchedule(quint64 jobId);
+
+    void appendReading(const QString &room, const QString &source, double temperature, const QDateTime &at);
+    PlanningInputs loadPlanningInputs(const QDateTime &now, bool fitModels, bool predictArrival);
+
+    // 可以在任意线程调用
+    void enqueue(const StorageRecord &record);
+    int pendingRecords() const;
+
+public slots:
+    // 把队列中的记录放在一个事务中写入
+    void drain();
+
+signals:
+    // 包含设备记录的一批提交之后发出，sequence 为已提交的最大序号
+    void historyCommitted(qint64 sequence);
+
+private:
+    bool prepareStatements();
+    bool write(const StorageRecord &record);
+    QVector<QPair<QDateTime, QDateTime>> loadAcOnIntervals(const QString &deviceId, const QDateTime &from,
+                                                            const QDateTime &now);
+    QDateTime predictArrivalTime(const QDateTime &now);
+
+    QString databasePath;
+    QString connectionName;
+    QSqlDatabase db;
+    SensorStore *sensorStore;      // 温度时间序列
+    EnergyMeter *energyMeter;      // 能耗统计，按写入的设备记录累计
+    ScheduleStore *scheduleStore;  // 定时任务持久化
+    SceneAnalytics *analytics;     // 场景使用统计，按写入的场景和设备记录更新
+
+    bool statementsPrepared;
+    QSqlQuery insertHistoryQuery;
+    QSqlQuery updateStatusQuery;
+    QSqlQuery insertSceneQuery;
+    QSqlQuery lastSequenceQuery;
+
+    // 写入队列：生产者只在互斥锁内追加，存储线程整批交换出来再写
+    mutable QMutex queueMutex;
+    QVector<StorageRecord> pending;
+    QVector<StorageRecord> writing;
+
+    MetricHistogram *historyInsertSeconds;
+    MetricHistogram *statusUpdateSeconds;
+    MetricHistogram *sceneInsertSeconds;
+    MetricHistogram *batchSeconds;
+    MetricGauge *historyQueueDepth;
+};
+
+#endif // STORAGEWORKER_H
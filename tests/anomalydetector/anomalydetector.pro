@@ -0,0 +1,7 @@
+# 异常检测的告警条件
+TARGET = anomalydetectortest
+
+include(../test.pri)
+
+SOURCES += \
+    anomalydetectortest.cpp
@@ -0,0 +1,182 @@
+#include "testsupport.h"
+#include "anomalydetector.h"
+#include <QSignalSpy>
+
+// 异常检测：各类检测器的告警条件
+class AnomalyDetectorTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void anomalyDetection();
+    void repeatedCommandsAreNotEvents();
+    void sceneMatchExpires();
+
+private:
+    CoreFixture core;
+};
+
+void AnomalyDetectorTest::initTestCase()
+{
+    QVERIFY(core.open());
+}
+
+void AnomalyDetectorTest::anomalyDetection()
+{
+    RuleEngine engine;
+    AnomalyDetector detector;
+    detector.setRuleEngine(&engine);
+    // 门锁时段取当前小时起的两个小时，测试在整点前后运行也落在时段内
+    const int hour = QTime::currentTime().hour();
+    const QByteArray json = QString(R"({
+        "latencyBudgetMs": 1000,
+        "detectors": [
+            {"id": "lights", "deviceType": "light", "on": true, "afterScene": "leavingHomeMode", "minutes": 0.002},
+            {"id": "heating", "deviceType": "air_conditioner", "on": true, "mode": "制热",
+             "if": {"input": "sensor.outside", "op": ">=", "value": 30}},
+            {"id": "lock", "device": "Lock", "on": false, "hours": {"from": %1, "to": %2}},
+            {"id": "storm", "deviceType": "curtain", "rate": {"count": 50, "seconds": 60}}
+        ]
+    })").arg(hour).arg((hour + 2) % 24).toUtf8();
+    QString error;
+    QVERIFY2(detector.loadDetectors(json, &error), qPrintable(error));
+    QCOMPARE(detector.detectorCount(), 4);
+
+    auto device = [](const QString &id, const QString &type, bool on) {
+        DeviceState state;
+        state.deviceId = id;
+        state.type = type;
+        state.on = on;
+        return state;
+    };
+    detector.setDevices({ device("LivingroomLight", "light", false), device("KitchenLight", "light", false),
+                          device("LivingroomAc", "air_conditioner", false), device("LivingroomCurtain", "curtain", false),
+                          device("Lock", "lock", true) });
+
+    QSignalSpy spy(&detector, &AnomalyDetector::anomalyDetected);
+    auto alerts = [&spy](const QString &detectorId) {
+        int count = 0;
+        for (const QList<QVariant> &args : qAsConst(spy)) {
+            if (args.at(0).value<AnomalyAlert>().detectorId == detectorId) {
+                ++count;
+            }
+        }
+        return count;
+    };
+
+    // 夜间没有上锁：每次开锁告警一次
+    detector.onDeviceEvent("Lock", false, QDateTime::currentDateTime());
+    detector.onDeviceEvent("Lock", false, QDateTime::currentDateTime());
+    QCOMPARE(alerts("lock"), 1);
+    detector.onDeviceEvent("Lock", true, QDateTime::currentDateTime());
+    detector.onDeviceEvent("Lock", false, QDateTime::currentDateTime());
+    QCOMPARE(alerts("lock"), 2);
+    const AnomalyAlert lockAlert = spy.last().at(0).value<AnomalyAlert>();
+    QCOMPARE(lockAlert.deviceId, QString("Lock"));
+    QVERIFY(lockAlert.latencyMs <= detector.latencyBudgetMs());
+
+    // 制热中室外温度升到30度以上
+    detector.onAcSetting("LivingroomAc", "制热", QDateTime::currentDateTime());
+    detector.onDeviceEvent("LivingroomAc", true, QDateTime::currentDateTime());
+    QCOMPARE(alerts("heating"), 0);
+    engine.setInput("sensor.outside", 31);
+    detector.onInputChanged(engine.inputIndex("sensor.outside"), QDateTime::currentDateTime());
+    QCOMPARE(alerts("heating"), 1);
+    detector.onAcSetting("LivingroomAc", "制冷", QDateTime::currentDateTime());
+    detector.onAcSetting("LivingroomAc", "制热", QDateTime::currentDateTime());
+    QCOMPARE(alerts("heating"), 2);
+
+    // 离家后灯仍开着：持续时间内回家不告警，再次离家后两盏灯各告警一次
+    detector.onDeviceEvent("LivingroomLight", true, QDateTime::currentDateTime());
+    detector.onSceneEvent("leavingHomeMode", QDateTime::currentDateTime());
+    detector.onSceneEvent("comingHomeMode", QDateTime::currentDateTime());
+    QTest::qWait(300);
+    QCOMPARE(alerts("lights"), 0);
+    detector.onDeviceEvent("KitchenLight", true, QDateTime::currentDateTime());
+    detector.onSceneEvent("leavingHomeMode", QDateTime::currentDateTime());
+    QTRY_COMPARE(alerts("lights"), 2);
+    QTest::qWait(300);
+    QCOMPARE(alerts("lights"), 2);
+
+    // 一分钟内第50次操作告警，之后一个窗口内不再重复
+    const QDateTime start = QDateTime::currentDateTime();
+    bool open = false;
+    for (int i = 0; i < 49; ++i) {
+        detector.onDeviceEvent("LivingroomCurtain", open = !open, start.addMSecs(i * 100));
+    }
+    QCOMPARE(alerts("storm"), 0);
+    for (int i = 49; i < 80; ++i) {
+        detector.onDeviceEvent("LivingroomCurtain", open = !open, start.addMSecs(i * 100));
+    }
+    QCOMPARE(alerts("storm"), 1);
+}
+
+// 控制核心只把改变了状态的开关命令交给检测器：重复的同一状态命令不计入操作频率
+void AnomalyDetectorTest::repeatedCommandsAreNotEvents()
+{
+    AnomalyDetector detector;
+    detector.setRuleEngine(core.ruleEngine);
+    QString error;
+    QVERIFY2(detector.loadDetectors(R"({
+        "detectors": [
+            {"id": "storm", "device": "LivingroomLight", "rate": {"count": 50, "seconds": 60}}
+        ]
+    })", &error), qPrintable(error));
+    core.controller->setAnomalyDetector(&detector);
+    QSignalSpy spy(&detector, &AnomalyDetector::anomalyDetected);
+
+    // 一分钟内100次开灯命令，只有第一次改变状态（默认设备关闭）
+    QVERIFY(!core.controller->device("LivingroomLight").on);
+    const QDateTime start = QDateTime::currentDateTime();
+    for (int i = 0; i < 100; ++i) {
+        QVERIFY(core.controller->recordDeviceAction("LivingroomLight", "turn_on", "on", start.addMSecs(i * 100)));
+    }
+    QCOMPARE(spy.count(), 0);
+
+    // 真正的开关切换仍然计入
+    bool on = true;
+    for (int i = 100; i < 160; ++i) {
+        on = !on;
+        QVERIFY(core.controller->recordDeviceAction("LivingroomLight", on ? "turn_on" : "turn_off", on ? "on" : "off",
+                                                    start.addMSecs(i * 100)));
+    }
+    QCOMPARE(spy.count(), 1);
+    core.controller->setAnomalyDetector(nullptr);
+}
+
+// 场景只约束其后一段时间内的状态：很久以后手动开灯不算离家后遗留的灯
+void AnomalyDetectorTest::sceneMatchExpires()
+{
+    AnomalyDetector detector;
+    QString error;
+    QVERIFY2(detector.loadDetectors(R"({
+        "detectors": [
+            {"id": "lights", "deviceType": "light", "on": true, "afterScene": "leavingHomeMode",
+             "sceneMinutes": 1, "minutes": 0.002}
+        ]
+    })", &error), qPrintable(error));
+    DeviceState light;
+    light.deviceId = "LivingroomLight";
+    light.type = "light";
+    light.on = false;
+    detector.setDevices({ light });
+    QSignalSpy spy(&detector, &AnomalyDetector::anomalyDetected);
+
+    const QDateTime now = QDateTime::currentDateTime();
+    detector.onSceneEvent("leavingHomeMode", now.addSecs(-2 * 3600));
+    detector.onDeviceEvent("LivingroomLight", true, now);
+    QTest::qWait(300);
+    QCOMPARE(spy.count(), 0);
+
+    // 窗口内开着的灯照常告警
+    detector.onDeviceEvent("LivingroomLight", false, QDateTime::currentDateTime());
+    detector.onSceneEvent("leavingHomeMode", QDateTime::currentDateTime());
+    detector.onDeviceEvent("LivingroomLight", true, QDateTime::currentDateTime());
+    QTRY_COMPARE(spy.count(), 1);
+}
+
+SMARTHOME_TEST_MAIN(AnomalyDetectorTest)
+
+#include "anomalydetectortest.moc"
@@ -0,0 +1,7 @@
+# 本机控制接口的请求、回复和状态订阅
+TARGET = controlservertest
+
+include(../test.pri)
+
+SOURCES += \
+    controlservertest.cpp
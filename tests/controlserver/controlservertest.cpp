@@ -0,0 +1,117 @@
+#include "testsupport.h"
+#include "mainwindowtestaccess.h"
+#include <QCborArray>
+
+// 本机控制接口：流水线和批量请求、错误回复、订阅后的快照和状态增量
+class ControlServerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void controlApi();
+
+private:
+    QTemporaryDir tempDir;
+    MainWindow *window = nullptr;
+    QString controlName;
+};
+
+void ControlServerTest::initTestCase()
+{
+    QVERIFY(tempDir.isValid());
+    // 控制接口使用测试专用的名称，与正在运行的主程序互不影响
+    controlName = QString("QtSmartHome-test-%1").arg(QCoreApplication::applicationPid());
+    prepareWindowEnvironment(tempDir.filePath("test.db"), controlName);
+    window = new MainWindow;
+    QTRY_VERIFY(MainWindowTestAccess::isDatabaseReady(*window));
+}
+
+void ControlServerTest::cleanupTestCase()
+{
+    delete window;
+    window = nullptr;
+}
+
+void ControlServerTest::controlApi()
+{
+    QVERIFY(MainWindowTestAccess::controlServer(*window));
+    ControlClient client(controlName);
+    QVERIFY(client.waitForConnected());
+
+    // 不等回复连续发送：一帧多设备命令、查询、一帧两个请求（都会失败）、订阅
+    const QStringList lights = { "LivingroomLight", "KitchenLight", "BedroomLight" };
+    QCborArray commands;
+    QCborArray ids;
+    for (const QString &deviceId : lights) {
+        commands.append(ControlClient::command(deviceId, "power", "on"));
+        ids.append(deviceId);
+    }
+    QCborMap set = ControlClient::request(1, "set");
+    set.insert(QStringLiteral("commands"), commands);
+    QCborMap get = ControlClient::request(2, "get");
+    get.insert(QStringLiteral("devices"), ids);
+    QCborMap unknownDevice = ControlClient::command("NoSuchDevice", "power", "on");
+    unknownDevice.insert(QStringLiteral("id"), 3);
+    unknownDevice.insert(QStringLiteral("op"), QStringLiteral("set"));
+    QCborMap unknownScene = ControlClient::request(4, "scene");
+    unknownScene.insert(QStringLiteral("scene"), QStringLiteral("NoSuchScene"));
+
+    client.send(set);
+    client.send(get);
+    client.send(QCborArray({ unknownDevice, unknownScene }));
+    client.send(ControlClient::request(5, "subscribe"));
+    // 订阅的回复之后是完整快照
+    QTRY_COMPARE(client.frames.size(), 5);
+
+    QCOMPARE(ControlClient::field(client.frames.at(0), "id").toInteger(), qint64(1));
+    QVERIFY(ControlClient::field(client.frames.at(0), "ok").toBool());
+    // 查询排在命令之后，读到的是执行后的状态
+    const QCborArray states = ControlClient::field(client.frames.at(1), "devices").toArray();
+    QCOMPARE(int(states.size()), lights.size());
+    for (const QCborValue &state : states) {
+        QVERIFY(lights.contains(ControlClient::field(state, "device").toString()));
+        QVERIFY(ControlClient::field(state, "on").toBool());
+    }
+    const QCborArray failed = client.frames.at(2).toArray();
+    QCOMPARE(int(failed.size()), 2);
+    QCOMPARE(ControlClient::field(failed.at(0), "id").toInteger(), qint64(3));
+    QVERIFY(!ControlClient::field(failed.at(0), "ok").toBool());
+    QVERIFY(!ControlClient::field(failed.at(1), "ok").toBool());
+    QVERIFY(ControlClient::field(client.frames.at(3), "ok").toBool());
+    QCOMPARE(ControlClient::field(client.frames.at(4), "event").toString(), QString("snapshot"));
+    QStringList snapshotIds;
+    for (const QCborValue &device : ControlClient::field(client.frames.at(4), "devices").toArray()) {
+        snapshotIds.append(ControlClient::field(device, "device").toString());
+        if (lights.contains(snapshotIds.last())) {
+            QVERIFY(ControlClient::field(device, "on").toBool());
+        }
+    }
+    const int kitchen = snapshotIds.indexOf("KitchenLight");
+    QVERIFY(kitchen >= 0);
+
+    // 订阅后，命令的回复之外还会收到按设备序号的状态增量；界面与按钮操作一样更新
+    QCborMap off = ControlClient::command("KitchenLight", "power", "off");
+    off.insert(QStringLiteral("id"), 6);
+    off.insert(QStringLiteral("op"), QStringLiteral("set"));
+    client.send(off);
+    auto received = [&client, kitchen]() {
+        bool reply = false;
+        bool delta = false;
+        for (const QCborValue &frame : qAsConst(client.frames)) {
+            reply = reply || ControlClient::field(frame, "id").toInteger() == 6;
+            for (const QCborValue &entry : ControlClient::field(frame, "deltas").toArray()) {
+                delta = delta || (entry.toArray().at(1).toInteger() == kitchen && !entry.toArray().at(2).toBool());
+            }
+        }
+        return reply && delta;
+    };
+    QTRY_VERIFY(received());
+    QVERIFY(!MainWindowTestAccess::isDeviceOn(*window, "KitchenLight"));
+}
+
+SMARTHOME_TEST_MAIN(ControlServerTest)
+
+#include "controlservertest.moc"
@@ -0,0 +1,7 @@
+# 界面线程的天气结果、场景统计、规则命令和状态快照
+TARGET = mainwindowtest
+
+include(../test.pri)
+
+SOURCES += \
+    mainwindowtest.cpp
@@ -0,0 +1,192 @@
+#include "testsupport.h"
+#include "mainwindowtestaccess.h"
+#include "sceneanalytics.h"
+#include <QComboBox>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+
+// 界面线程：天气结果、场景和手动操作的统计、规则命令和状态快照
+class MainWindowTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void notModifiedKeepsPollInterval();
+    void snapshotRoundTrip();
+    void sceneLockIsNotOverride();
+    void ruleLockAction();
+    void unconfiguredCustomScene();
+
+private:
+    void click(const QString &buttonName);
+
+    QTemporaryDir tempDir;
+    MainWindow *window = nullptr;
+};
+
+void MainWindowTest::initTestCase()
+{
+    QVERIFY(tempDir.isValid());
+    prepareWindowEnvironment(tempDir.filePath("test.db"));
+    window = new MainWindow;
+    // 存储线程打开数据库后才恢复定时任务和空调设置
+    QTRY_VERIFY(MainWindowTestAccess::isDatabaseReady(*window));
+}
+
+void MainWindowTest::cleanupTestCase()
+{
+    delete window;
+    window = nullptr;
+}
+
+// 与用户点击按钮相同
+void MainWindowTest::click(const QString &buttonName)
+{
+    QPushButton *button = window->findChild<QPushButton*>(buttonName);
+    QVERIFY2(button, qPrintable(buttonName));
+    button->click();
+}
+
+// 304 只刷新缓存的获取时间，不作为新的观测：温度正在快速变化时保持短轮询间隔
+void MainWindowTest::notModifiedKeepsPollInterval()
+{
+    QFile fixture(QString(FIXTURE_DIR) + "/weather_now.json");
+    QVERIFY(fixture.open(QIODevice::ReadOnly));
+    QJsonObject jsonObj = QJsonDocument::fromJson(fixture.readAll()).object();
+    const int temperature = jsonObj["now"].toObject()["temp"].toString().toInt();
+    MainWindowTestAccess::weatherCache(*window).store(jsonObj, "\"fixture\"", QByteArray());
+
+    // 最近一次观测就是缓存中的温度，之前每小时变化2到3度
+    const QDateTime now = QDateTime::currentDateTime();
+    WeatherPollPolicy &policy = MainWindowTestAccess::weatherPollPolicy(*window);
+    policy.setThresholds({});
+    policy.recordObservation(temperature - 7, now.addSecs(-3 * 3600));
+    policy.recordObservation(temperature - 5, now.addSecs(-2 * 3600));
+    policy.recordObservation(temperature - 3, now.addSecs(-3600));
+    policy.recordObservation(temperature, now.addSecs(-600));
+    QCOMPARE(policy.nextIntervalMs(), int(WeatherPollPolicy::FastIntervalMs));
+
+    WeatherFetchResult result;
+    result.status = WeatherFetchResult::NotModified;
+    MainWindowTestAccess::deliverWeather(*window, result);
+    QCOMPARE(MainWindowTestAccess::outsideTemperature(*window), temperature);
+    QCOMPARE(policy.nextIntervalMs(), int(WeatherPollPolicy::FastIntervalMs));
+    QCOMPARE(MainWindowTestAccess::weatherPollIntervalMs(*window), int(WeatherPollPolicy::FastIntervalMs));
+}
+
+// 状态快照：写入并读回完整状态；损坏的快照被拒绝，不会恢复出错误的状态
+void MainWindowTest::snapshotRoundTrip()
+{
+    RuleAction kitchenOn;
+    kitchenOn.ruleId = "test";
+    kitchenOn.deviceId = "KitchenLight";
+    kitchenOn.command = "power";
+    kitchenOn.value = "on";
+    QVERIFY(MainWindowTestAccess::executeDeviceAction(*window, kitchenOn));
+    QComboBox *bedroomMode = window->findChild<QComboBox*>("BedroomAcModecomboBox");
+    QVERIFY(bedroomMode);
+    bedroomMode->setCurrentText("睡眠");
+    const QMap<QString, int> sceneDevices = { {"客厅灯", 2}, {"客厅窗帘", 2} };
+    MainWindowTestAccess::setCustomScene1(*window, "观影", sceneDevices);
+
+    HomeSnapshot saved = MainWindowTestAccess::captureSnapshot(*window);
+    MainWindowTestAccess::setCustomScene1(*window, QString(), {});
+    const QString path = tempDir.filePath("roundtrip.snapshot");
+    QString errorMessage;
+    QVERIFY2(HomeSnapshot::writeFile(path, saved.serialize(), &errorMessage), qPrintable(errorMessage));
+
+    HomeSnapshot restored;
+    QVERIFY2(HomeSnapshot::readFile(path, &restored, &errorMessage), qPrintable(errorMessage));
+    QCOMPARE(restored.savedAt, saved.savedAt);
+    QCOMPARE(restored.historySequence, saved.historySequence);
+    QCOMPARE(restored.devices.size(), saved.devices.size());
+    for (int i = 0; i < saved.devices.size(); ++i) {
+        QCOMPARE(restored.devices.at(i).deviceId, saved.devices.at(i).deviceId);
+        QCOMPARE(restored.devices.at(i).on, saved.devices.at(i).on);
+        QCOMPARE(restored.devices.at(i).mode, saved.devices.at(i).mode);
+        QCOMPARE(restored.devices.at(i).temperature, saved.devices.at(i).temperature);
+    }
+    auto kitchen = std::find_if(restored.devices.cbegin(), restored.devices.cend(), [](const DeviceState &device) {
+        return device.deviceId == "KitchenLight";
+    });
+    QVERIFY(kitchen != restored.devices.cend() && kitchen->on);
+    auto bedroomAc = std::find_if(restored.devices.cbegin(), restored.devices.cend(), [](const DeviceState &device) {
+        return device.deviceId == "BedroomAc";
+    });
+    QVERIFY(bedroomAc != restored.devices.cend());
+    QCOMPARE(bedroomAc->mode, QString("睡眠"));
+    QCOMPARE(restored.customScenes.size(), 2);
+    QCOMPARE(restored.customScenes.at(0).name, QString("观影"));
+    QCOMPARE(restored.customScenes.at(0).devices, sceneDevices);
+    QCOMPARE(restored.schedules.size(), saved.schedules.size());
+
+    QByteArray corrupted = saved.serialize();
+    corrupted[corrupted.size() - 1] = char(corrupted.at(corrupted.size() - 1) ^ 0x5a);
+    QVERIFY(!HomeSnapshot().deserialize(corrupted));
+}
+
+// 睡眠模式自己锁门，不算对场景的手动操作：门锁记录排在场景记录之前，
+// 连续运行两次时第二次的锁门落在第一次的覆盖窗口内
+void MainWindowTest::sceneLockIsNotOverride()
+{
+    SceneAnalytics *analytics = MainWindowTestAccess::storage(*window)->sceneAnalytics();
+    QVERIFY(analytics);
+    const SceneUsage before = analytics->usage("SleepMode");
+
+    click("SleepModeButton");
+    click("SleepModeButton");
+    QTRY_COMPARE(analytics->usage("SleepMode").runs, before.runs + 2);
+    QCOMPARE(analytics->usage("SleepMode").overridden, before.overridden);
+
+    // 门锁按钮仍然是手动操作
+    click("LockButton");
+    QTRY_COMPARE(analytics->usage("SleepMode").overridden, before.overridden + 1);
+}
+
+// 规则的门锁动作按值上锁或开锁，无法识别的值不改变门锁
+void MainWindowTest::ruleLockAction()
+{
+    auto lockAction = [](const QString &value) {
+        RuleAction action;
+        action.ruleId = "test";
+        action.deviceId = "Lock";
+        action.command = "lock";
+        action.value = value;
+        return action;
+    };
+    auto locked = [this]() {
+        return MainWindowTestAccess::isDeviceOn(*window, "Lock");
+    };
+
+    QVERIFY(MainWindowTestAccess::executeDeviceAction(*window, lockAction("locked")));
+    QVERIFY(locked());
+    QVERIFY(MainWindowTestAccess::executeDeviceAction(*window, lockAction("unlocked")));
+    QVERIFY(!locked());
+    QVERIFY(MainWindowTestAccess::executeDeviceAction(*window, lockAction("true")));
+    QVERIFY(locked());
+    QVERIFY(MainWindowTestAccess::executeDeviceAction(*window, lockAction("false")));
+    QVERIFY(!locked());
+    QVERIFY(!MainWindowTestAccess::executeDeviceAction(*window, lockAction("unlock")));
+    QVERIFY(!locked());
+}
+
+// 按场景ID执行（定时任务、控制接口）时，尚未配置的自定义场景与未知场景一样返回失败
+void MainWindowTest::unconfiguredCustomScene()
+{
+    MainWindowTestAccess::setCustomScene1(*window, QString(), {});
+    QVERIFY(!MainWindowTestAccess::runSceneById(*window, "UserDefinedMode1"));
+    QVERIFY(!MainWindowTestAccess::runSceneById(*window, "noSuchMode"));
+
+    MainWindowTestAccess::setCustomScene1(*window, "观影", {});
+    QVERIFY(MainWindowTestAccess::runSceneById(*window, "UserDefinedMode1"));
+    MainWindowTestAccess::setCustomScene1(*window, QString(), {});
+}
+
+SMARTHOME_TEST_MAIN(MainWindowTest)
+
+#include "mainwindowtest.moc"
@@ -0,0 +1,117 @@
+#include "mainwindowtestaccess.h"
+
+bool MainWindowTestAccess::isDatabaseReady(const MainWindow &window)
+{
+    return window.databaseReady;
+}
+
+StorageWorker *MainWindowTestAccess::storage(const MainWindow &window)
+{
+    return window.storage;
+}
+
+HomeController *MainWindowTestAccess::controller(const MainWindow &window)
+{
+    return window.homeController;
+}
+
+RuleEngine *MainWindowTestAccess::ruleEngine(const MainWindow &window)
+{
+    return window.ruleEngine;
+}
+
+SceneScheduler *MainWindowTestAccess::scheduler(const MainWindow &window)
+{
+    return window.sceneScheduler;
+}
+
+ControlServer *MainWindowTestAccess::controlServer(const MainWindow &window)
+{
+    return window.controlServer;
+}
+
+// 设备ID不在界面上时返回 false
+bool MainWindowTestAccess::isDeviceOn(const MainWindow &window, const QString &deviceId)
+{
+    const MainWindow::CustomSceneTarget *target = window.deviceTarget(deviceId);
+    return target && window.isTargetOn(*target);
+}
+
+bool MainWindowTestAccess::executeDeviceAction(MainWindow &window, const RuleAction &action)
+{
+    return window.executeDeviceAction(action);
+}
+
+bool MainWindowTestAccess::setPowerByButton(MainWindow &window, QPushButton *button, bool on)
+{
+    const MainWindow::CustomSceneTarget *target = window.deviceTarget(button);
+    if (!target) {
+        return false;
+    }
+    window.setTargetPower(*target, on, on ? PowerCommand::TurnOn : PowerCommand::TurnOff);
+    return true;
+}
+
+int MainWindowTestAccess::rebuildDeviceTargets(MainWindow &window)
+{
+    window.buildCustomSceneTargets();
+    return window.deviceTargets.size();
+}
+
+void MainWindowTestAccess::executeCustomScene(MainWindow &window, const QMap<QString, int> &deviceStates)
+{
+    window.executeCustomScene(deviceStates);
+}
+
+// 名称为空时清除自定义场景1
+void MainWindowTestAccess::setCustomScene1(MainWindow &window, const QString &name, const QMap<QString, int> &deviceStates)
+{
+    window.customScene1Name = name;
+    window.customScene1Devices = deviceStates;
+}
+
+bool MainWindowTestAccess::runSceneById(MainWindow &window, const QString &sceneId)
+{
+    return window.runSceneById(sceneId);
+}
+
+HomeSnapshot MainWindowTestAccess::captureSnapshot(const MainWindow &window)
+{
+    return window.captureSnapshot();
+}
+
+QVector<quint64> MainWindowTestAccess::snapshotJobIds(const MainWindow &window)
+{
+    return window.snapshotJobIds;
+}
+
+bool MainWindowTestAccess::parseWeatherData(MainWindow &window, const QJsonObject &jsonObj)
+{
+    return window.parseWeatherData(jsonObj);
+}
+
+// 与网络线程交回的结果相同
+void MainWindowTestAccess::deliverWeather(MainWindow &window, const WeatherFetchResult &result)
+{
+    window.onWeatherFetched(result);
+}
+
+WeatherCache &MainWindowTestAccess::weatherCache(MainWindow &window)
+{
+    return window.weatherCache;
+}
+
+WeatherPollPolicy &MainWindowTestAccess::weatherPollPolicy(MainWindow &window)
+{
+    return window.weatherPollPolicy;
+}
+
+int MainWindowTestAccess::outsideTemperature(const MainWindow &window)
+{
+    return window.outsideTemperature;
+}
+
+int MainWindowTestAccess::weatherPollIntervalMs(const MainWindow &window)
+{
+    return window.weatherUpdateTimer->interval();
+}
@@ -0,0 +1,44 @@
+#ifndef MAINWINDOWTESTACCESS_H
+#define MAINWINDOWTESTACCESS_H
+
+#include "mainwindow.h"
+
+// 测试和基准测试访问界面内部状态的唯一入口：只开放驱动界面和检查结果所需的几个函数，
+// 其余成员仍是 MainWindow 的私有实现
+class MainWindowTestAccess
+{
+public:
+    // 存储线程已打开数据库并读出设备和定时任务
+    static bool isDatabaseReady(const MainWindow &window);
+    // 各线程的对象：除连接信号外只能在所在的线程中调用（QMetaObject::invokeMethod）
+    static StorageWorker *storage(const MainWindow &window);
+    static HomeController *controller(const MainWindow &window);
+    static RuleEngine *ruleEngine(const MainWindow &window);
+    static SceneScheduler *scheduler(const MainWindow &window);
+    static ControlServer *controlServer(const MainWindow &window);
+
+    // 设备按设备ID查找；按钮操作直接点击界面上的按钮（findChild），与用户操作走同一条路径
+    static bool isDeviceOn(const MainWindow &window, const QString &deviceId);
+    static bool executeDeviceAction(MainWindow &window, const RuleAction &action);
+    // 与规则命令和场景相同的开关路径（turn_on/turn_off），按钮不是设备按钮时返回 false
+    static bool setPowerByButton(MainWindow &window, QPushButton *button, bool on);
+    // 按设备目录重新生成执行表（测试补充了界面控件之后），返回有控件的设备数
+    static int rebuildDeviceTargets(MainWindow &window);
+
+    // 场景和状态快照
+    static void executeCustomScene(MainWindow &window, const QMap<QString, int> &deviceStates);
+    static void setCustomScene1(MainWindow &window, const QString &name, const QMap<QString, int> &deviceStates);
+    static bool runSceneById(MainWindow &window, const QString &sceneId);
+    static HomeSnapshot captureSnapshot(const MainWindow &window);
+    static QVector<quint64> snapshotJobIds(const MainWindow &window);
+
+    // 天气
+    static bool parseWeatherData(MainWindow &window, const QJsonObject &jsonObj);
+    static void deliverWeather(MainWindow &window, const WeatherFetchResult &result);
+    static WeatherCache &weatherCache(MainWindow &window);
+    static WeatherPollPolicy &weatherPollPolicy(MainWindow &window);
+    static int outsideTemperature(const MainWindow &window);
+    static int weatherPollIntervalMs(const MainWindow &window);
+};
+
+#endif // MAINWINDOWTESTACCESS_H
@@ -0,0 +1,7 @@
+# 规则引擎的条件、边沿触发和动作值
+TARGET = ruleenginetest
+
+include(../test.pri)
+
+SOURCES += \
+    ruleenginetest.cpp
@@ -0,0 +1,164 @@
+#include "testsupport.h"
+#include "devicetraits.h"
+#include <QSignalSpy>
+#include <QtMath>
+
+// 规则引擎：比较运算符、多条件规则的边沿触发和开关动作的值
+class RuleEngineTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void conditionOps_data();
+    void conditionOps();
+    void invalidRules();
+    void ruleConditions();
+    void lockAction_data();
+    void lockAction();
+};
+
+void RuleEngineTest::conditionOps_data()
+{
+    QTest::addColumn<QString>("op");
+    QTest::addColumn<double>("value");
+    QTest::addColumn<bool>("expected");
+
+    // 条件的常量为 26
+    QTest::newRow("< below") << "<" << 25.0 << true;
+    QTest::newRow("< equal") << "<" << 26.0 << false;
+    QTest::newRow("<= equal") << "<=" << 26.0 << true;
+    QTest::newRow("<= above") << "<=" << 27.0 << false;
+    QTest::newRow("> above") << ">" << 27.0 << true;
+    QTest::newRow("> equal") << ">" << 26.0 << false;
+    QTest::newRow(">= equal") << ">=" << 26.0 << true;
+    QTest::newRow(">= below") << ">=" << 25.0 << false;
+    QTest::newRow("== equal") << "==" << 26.0 << true;
+    QTest::newRow("== other") << "==" << 25.0 << false;
+    QTest::newRow("!= other") << "!=" << 25.0 << true;
+    QTest::newRow("!= equal") << "!=" << 26.0 << false;
+    // 未设置的输入与任何值比较都不成立，包括 !=
+    const char *ops[] = { "<", "<=", ">", ">=", "==", "!=" };
+    for (const char *op : ops) {
+        QTest::newRow(qPrintable(QString("%1 unset").arg(op))) << op << qQNaN() << false;
+    }
+}
+
+void RuleEngineTest::conditionOps()
+{
+    QFETCH(QString, op);
+    QFETCH(double, value);
+    QFETCH(bool, expected);
+
+    RuleCondition condition;
+    QVERIFY(RuleEngine::parseOp(op, &condition.op));
+    condition.value = 26;
+    QCOMPARE(RuleEngine::evaluateCondition(condition, value), expected);
+}
+
+void RuleEngineTest::invalidRules()
+{
+    RuleEngine engine;
+    QString error;
+    QVERIFY(!engine.loadRules(R"([{"id": "bad", "when": [{"input": "sensor.outside", "op": "=>", "value": 1}],
+                                 "then": [{"device": "BedroomLight", "command": "power", "value": "on"}]}])", &error));
+    QVERIFY(error.contains("=>"));
+    QVERIFY(!engine.loadRules(R"([{"id": "no_action", "when": [{"input": "sensor.outside", "op": ">", "value": 1}]}])",
+                              &error));
+    QVERIFY(!engine.loadRules("{}", &error));
+    QCOMPARE(engine.ruleCount(), 0);
+}
+
+// 多个条件全部成立才触发；条件保持成立时不重复触发，不成立之后再次成立才再触发
+void RuleEngineTest::ruleConditions()
+{
+    RuleEngine engine;
+    QString error;
+    QVERIFY2(engine.loadRules(R"([{
+        "id": "warm_evening",
+        "when": [
+            {"input": "sensor.outside", "op": ">=", "value": 26},
+            {"input": "time.hour", "op": ">=", "value": 18}
+        ],
+        "then": [
+            {"device": "LivingroomAc", "command": "power", "value": "on"},
+            {"device": "LivingroomAc", "command": "temperature", "input": "sensor.outside", "offset": -2}
+        ]
+    }])", &error), qPrintable(error));
+    QCOMPARE(engine.ruleCount(), 1);
+    QSignalSpy spy(&engine, &RuleEngine::actionTriggered);
+
+    engine.setInput("sensor.outside", 30);
+    QCOMPARE(spy.count(), 0);
+    engine.setInput("time.hour", 17);
+    QCOMPARE(spy.count(), 0);
+    engine.setInput("time.hour", 18);
+    QCOMPARE(spy.count(), 2);
+    const RuleAction power = spy.at(0).at(0).value<RuleAction>();
+    QCOMPARE(power.ruleId, QString("warm_evening"));
+    QCOMPARE(power.command, QString("power"));
+    QCOMPARE(power.value, QString("on"));
+    QCOMPARE(spy.at(1).at(0).value<RuleAction>().value, QString("28"));
+
+    engine.setInput("time.hour", 19);
+    engine.setInput("sensor.outside", 31);
+    QCOMPARE(spy.count(), 2);
+    engine.setInput("sensor.outside", 20);
+    engine.setInput("sensor.outside", 27);
+    QCOMPARE(spy.count(), 4);
+    QCOMPARE(spy.at(3).at(0).value<RuleAction>().value, QString("25"));
+
+    // 试算不改变引擎状态
+    const QVector<RuleAction> planned = engine.dryRun("sensor.outside", { { "time.hour", 8 } });
+    QVERIFY(planned.isEmpty());
+    QCOMPARE(engine.inputValue("time.hour"), 19.0);
+}
+
+void RuleEngineTest::lockAction_data()
+{
+    QTest::addColumn<QString>("value");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<bool>("locked");
+
+    QTest::newRow("locked") << "locked" << true << true;
+    QTest::newRow("unlocked") << "unlocked" << true << false;
+    QTest::newRow("on") << "on" << true << true;
+    QTest::newRow("off") << "off" << true << false;
+    // JSON 中的布尔值和数字
+    QTest::newRow("true") << "true" << true << true;
+    QTest::newRow("false") << "false" << true << false;
+    QTest::newRow("1") << "1" << true << true;
+    QTest::newRow("0") << "0" << true << false;
+    QTest::newRow("unknown") << "unlock" << false << false;
+    QTest::newRow("empty") << "" << false << false;
+}
+
+// 门锁动作按值上锁或开锁：值经过规则引擎原样交给界面，由 parsePowerValue 解释
+void RuleEngineTest::lockAction()
+{
+    QFETCH(QString, value);
+    QFETCH(bool, valid);
+    QFETCH(bool, locked);
+
+    RuleEngine engine;
+    QString error;
+    const QByteArray json = QString(R"([{"id": "night_lock", "when": [{"input": "time.hour", "op": "==", "value": 23}],
+                                        "then": [{"device": "Lock", "command": "lock", "value": "%1"}]}])")
+                                .arg(value).toUtf8();
+    QVERIFY2(engine.loadRules(json, &error), qPrintable(error));
+    QSignalSpy spy(&engine, &RuleEngine::actionTriggered);
+    engine.setInput("time.hour", 23);
+    QCOMPARE(spy.count(), 1);
+    const RuleAction action = spy.at(0).at(0).value<RuleAction>();
+    QCOMPARE(action.command, QString::fromLatin1(deviceTraits(DeviceKind::Lock).powerCommand));
+    QCOMPARE(action.value, value);
+
+    bool on = !locked;
+    QCOMPARE(parsePowerValue(deviceTraits(DeviceKind::Lock), action.value, &on), valid);
+    if (valid) {
+        QCOMPARE(on, locked);
+    }
+}
+
+SMARTHOME_TEST_MAIN(RuleEngineTest)
+
+#include "ruleenginetest.moc"
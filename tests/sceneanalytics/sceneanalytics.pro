@@ -0,0 +1,7 @@
+# 场景使用统计的增量更新、覆盖判定和重新加载
+TARGET = sceneanalyticstest
+
+include(../test.pri)
+
+SOURCES += \
+    sceneanalyticstest.cpp
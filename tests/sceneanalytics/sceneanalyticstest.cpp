@@ -0,0 +1,135 @@
+#include "testsupport.h"
+#include "sceneanalytics.h"
+#include <QSqlQuery>
+#include <algorithm>
+
+// 场景使用统计：增量更新、覆盖判定和重新加载
+class SceneAnalyticsTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void sceneAnalytics();
+    void failedWriteIsNotCounted();
+    void rollbackDiscardsUncommitted();
+
+private:
+    CoreFixture core;
+};
+
+void SceneAnalyticsTest::initTestCase()
+{
+    QVERIFY(core.open());
+}
+
+// 场景统计逐条更新：手动操作在时间窗口内计入最近一次运行的场景，每次运行最多计一次；
+// 重新打开后从 scene_usage 读出相同的结果；列表按运行次数排序
+void SceneAnalyticsTest::sceneAnalytics()
+{
+    SceneAnalytics *analytics = core.storage->sceneAnalytics();
+    QVERIFY(analytics);
+    const SceneUsage before = analytics->usage("SleepMode");
+
+    auto record = [this](StorageRecord::Kind kind, const QString &id, const QString &type, const QDateTime &at) {
+        StorageRecord entry;
+        entry.kind = kind;
+        entry.id = id;
+        entry.type = type;
+        entry.value = QStringLiteral("on");
+        entry.at = at;
+        core.storage->enqueue(entry);
+    };
+    const QDateTime monday(QDate(2024, 1, 1), QTime(22, 30));  // 星期一
+    const int window = analytics->overrideMinutes() * 60;
+    record(StorageRecord::SceneRun, "SleepMode", QString(), monday);
+    record(StorageRecord::DeviceAction, "BedroomLight", "toggle", monday.addSecs(window / 2));
+    record(StorageRecord::DeviceAction, "KitchenLight", "toggle", monday.addSecs(window / 2 + 60));
+    record(StorageRecord::SceneRun, "SleepMode", QString(), monday.addDays(1));
+    record(StorageRecord::DeviceAction, "BedroomLight", "toggle", monday.addDays(1).addSecs(window + 60));
+    record(StorageRecord::SceneRun, "comingHomeMode", QString(), monday.addDays(1).addSecs(2 * window));
+    record(StorageRecord::DeviceAction, "LivingroomLight", "turn_on", monday.addDays(1).addSecs(2 * window + 60));
+    core.storage->drain();
+
+    const SceneUsage after = analytics->usage("SleepMode");
+    const int mondayHour = SceneAnalytics::hourOfWeek(monday);
+    QCOMPARE(mondayHour, 22);
+    QCOMPARE(after.runs, before.runs + 2);
+    QCOMPARE(after.overridden, before.overridden + 1);
+    QCOMPARE(after.runsByHour.at(mondayHour), before.runsByHour.at(mondayHour) + 1);
+    QCOMPARE(after.runsByHour.at(mondayHour + 24), before.runsByHour.at(mondayHour + 24) + 1);
+    QCOMPARE(after.overriddenByHour.at(mondayHour), before.overriddenByHour.at(mondayHour) + 1);
+    QCOMPARE(after.overriddenByHour.at(mondayHour + 24), before.overriddenByHour.at(mondayHour + 24));
+    QCOMPARE(after.name, QString("睡眠模式"));
+
+    SceneAnalytics reloaded(core.storage->database());
+    QVERIFY(reloaded.ensureSchema());
+    const SceneUsage stored = reloaded.usage("SleepMode");
+    QCOMPARE(stored.runs, after.runs);
+    QCOMPARE(stored.overridden, after.overridden);
+    QCOMPARE(stored.runsByHour, after.runsByHour);
+    QCOMPARE(stored.overriddenByHour, after.overriddenByHour);
+
+    const QVector<SceneUsage> usage = analytics->usage();
+    QVERIFY(usage.size() >= 2);
+    QVERIFY(std::is_sorted(usage.cbegin(), usage.cend(), [](const SceneUsage &a, const SceneUsage &b) {
+        return a.runs > b.runs;
+    }));
+}
+
+// 场景记录没有写入（scene_history 不可用）时不计入统计
+void SceneAnalyticsTest::failedWriteIsNotCounted()
+{
+    SceneAnalytics *analytics = core.storage->sceneAnalytics();
+    QVERIFY(analytics);
+    const SceneUsage before = analytics->usage("leavingHomeMode");
+
+    QSqlQuery query(core.storage->database());
+    QVERIFY(query.exec("ALTER TABLE scene_history RENAME TO scene_history_moved"));
+    StorageRecord run;
+    run.kind = StorageRecord::SceneRun;
+    run.id = QStringLiteral("leavingHomeMode");
+    run.at = QDateTime(QDate(2024, 1, 3), QTime(8, 0));
+    core.storage->enqueue(run);
+    core.storage->drain();
+    QVERIFY(query.exec("ALTER TABLE scene_history_moved RENAME TO scene_history"));
+
+    QCOMPARE(analytics->usage("leavingHomeMode").runs, before.runs);
+    SceneAnalytics reloaded(core.storage->database());
+    QVERIFY(reloaded.ensureSchema());
+    QCOMPARE(reloaded.usage("leavingHomeMode").runs, before.runs);
+}
+
+// 调用方的事务回滚：内存统计不变，回滚掉的运行也不再接收之后的手动操作
+void SceneAnalyticsTest::rollbackDiscardsUncommitted()
+{
+    QSqlDatabase db = core.storage->database();
+    SceneAnalytics analytics(db);
+    QVERIFY(analytics.ensureSchema());
+    const SceneUsage before = analytics.usage("WakeUpMode");
+    const QDateTime at(QDate(2024, 1, 4), QTime(20, 0));
+
+    QVERIFY(db.transaction());
+    analytics.recordSceneRun("WakeUpMode", at);
+    analytics.recordDeviceAction("toggle", at.addSecs(60));
+    QVERIFY(db.rollback());
+    analytics.rollback();
+    QCOMPARE(analytics.usage("WakeUpMode").runs, before.runs);
+    QCOMPARE(analytics.usage("WakeUpMode").overridden, before.overridden);
+
+    QVERIFY(db.transaction());
+    analytics.recordDeviceAction("toggle", at.addSecs(120));
+    QVERIFY(db.commit());
+    analytics.commit();
+    QCOMPARE(analytics.usage("WakeUpMode").overridden, before.overridden);
+
+    SceneAnalytics reloaded(db);
+    QVERIFY(reloaded.ensureSchema());
+    QCOMPARE(reloaded.usage("WakeUpMode").runs, before.runs);
+    QCOMPARE(reloaded.usage("WakeUpMode").overridden, before.overridden);
+}
+
+SMARTHOME_TEST_MAIN(SceneAnalyticsTest)
+
+#include "sceneanalyticstest.moc"
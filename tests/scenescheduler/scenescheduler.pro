@@ -0,0 +1,7 @@
+# 分层时间轮：级联、超出范围的任务、取消和错过任务的补执行
+TARGET = sceneschedulertest
+
+include(../test.pri)
+
+SOURCES += \
+    sceneschedulertest.cpp
@@ -0,0 +1,231 @@
+#include "testsupport.h"
+#include "scenescheduler.h"
+#include <QSignalSpy>
+#include <algorithm>
+
+// 场景调度器：用模拟时钟逐秒推进时间轮，检查每个任务在准确的秒触发
+class SceneSchedulerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cascadeBetweenLevels();
+    void beyondTopLevel();
+    void cancel();
+    void restoreMissedJobs();
+    void catchUpAfterSleep();
+
+private:
+    static const QDateTime Start;
+
+    // 每次最多推进100秒（不超过调度器判定时间跳变的2分钟），时间轮逐个 tick 处理并级联
+    static void advanceTo(SceneScheduler &scheduler, QDateTime &now, const QDateTime &target);
+    static QList<quint64> triggeredIds(const QSignalSpy &spy);
+};
+
+const QDateTime SceneSchedulerTest::Start(QDate(2024, 1, 1), QTime(0, 0, 30));
+
+void SceneSchedulerTest::advanceTo(SceneScheduler &scheduler, QDateTime &now, const QDateTime &target)
+{
+    while (now < target) {
+        now = qMin(now.addSecs(100), target);
+        scheduler.setSimulatedTime(now);
+    }
+}
+
+QList<quint64> SceneSchedulerTest::triggeredIds(const QSignalSpy &spy)
+{
+    QList<quint64> ids;
+    for (const QList<QVariant> &args : spy) {
+        ids.append(args.at(0).value<quint64>());
+    }
+    return ids;
+}
+
+// 第0到3层的任务都在到期的那一秒触发，不提前也不推迟
+void SceneSchedulerTest::cascadeBetweenLevels()
+{
+    SceneScheduler scheduler;
+    QDateTime now = Start;
+    scheduler.setSimulatedTime(now);
+    QSignalSpy spy(&scheduler, &SceneScheduler::jobTriggered);
+
+    // 64秒、4096秒、262144秒是第1、2、3层的起点
+    const qint64 delays[] = { 30, 64, 100, 4095, 5000, 262143, 300000 };
+    QVector<quint64> ids;
+    for (qint64 delay : delays) {
+        ids.append(scheduler.scheduleOnce(QString("level%1").arg(delay), Start.addSecs(delay)));
+    }
+    QCOMPARE(scheduler.jobCount(), int(ids.size()));
+
+    for (int i = 0; i < ids.size(); ++i) {
+        const QDateTime fireAt = Start.addSecs(delays[i]);
+        advanceTo(scheduler, now, fireAt.addSecs(-1));
+        QCOMPARE(spy.count(), i);
+        QVERIFY(scheduler.contains(ids.at(i)));
+        advanceTo(scheduler, now, fireAt);
+        QCOMPARE(spy.count(), i + 1);
+        QCOMPARE(spy.last().at(0).value<quint64>(), ids.at(i));
+        QCOMPARE(spy.last().at(1).toString(), QString("level%1").arg(delays[i]));
+        QVERIFY(!scheduler.contains(ids.at(i)));
+    }
+    QCOMPARE(scheduler.jobCount(), 0);
+}
+
+// 超出时间轮范围（2^24秒，约194天）的任务先放在最远的槽，级联时重新计算，仍在准确的秒触发
+void SceneSchedulerTest::beyondTopLevel()
+{
+    SceneScheduler scheduler;
+    QDateTime now = Start;
+    scheduler.setSimulatedTime(now);
+    QSignalSpy spy(&scheduler, &SceneScheduler::jobTriggered);
+
+    const qint64 horizon = qint64(1) << 24;
+    const QDateTime farAt = Start.addSecs(horizon + 1000);
+    const QDateTime nearAt = Start.addSecs(horizon - 1);
+    const quint64 far = scheduler.scheduleOnce("far", farAt);
+    const quint64 near = scheduler.scheduleOnce("near", nearAt);
+    QCOMPARE(scheduler.nextFireTime("far"), farAt);
+
+    advanceTo(scheduler, now, nearAt.addSecs(-1));
+    QCOMPARE(spy.count(), 0);
+    advanceTo(scheduler, now, nearAt);
+    QCOMPARE(triggeredIds(spy), QList<quint64>{ near });
+
+    advanceTo(scheduler, now, farAt.addSecs(-1));
+    QCOMPARE(spy.count(), 1);
+    QVERIFY(scheduler.contains(far));
+    advanceTo(scheduler, now, farAt);
+    QCOMPARE(triggeredIds(spy), (QList<quint64>{ near, far }));
+}
+
+// 取消同一个槽中链表头、中间的任务和别的层的任务；场景触发时取消同一秒到期的任务
+void SceneSchedulerTest::cancel()
+{
+    SceneScheduler scheduler;
+    QDateTime now = Start;
+    scheduler.setSimulatedTime(now);
+    QSignalSpy spy(&scheduler, &SceneScheduler::jobTriggered);
+
+    const QDateTime at = Start.addSecs(10);
+    const quint64 first = scheduler.scheduleOnce("first", at);
+    const quint64 middle = scheduler.scheduleOnce("middle", at);
+    const quint64 last = scheduler.scheduleOnce("last", at);
+    const quint64 later = scheduler.scheduleOnce("later", Start.addSecs(5000));
+    const quint64 recurring = scheduler.scheduleRecurring("daily", 0x7F, QTime(12, 0));
+
+    QVERIFY(scheduler.cancel(middle));
+    QVERIFY(!scheduler.cancel(middle));
+    QVERIFY(scheduler.cancel(last));  // 链表头
+    QVERIFY(scheduler.cancel(later));
+    QVERIFY(scheduler.cancel(recurring));
+    QVERIFY(!scheduler.cancel(9999));
+    QCOMPARE(scheduler.jobCount(), 1);
+    QVERIFY(!scheduler.nextFireTime("daily").isValid());
+
+    advanceTo(scheduler, now, Start.addSecs(6000));
+    QCOMPARE(triggeredIds(spy), QList<quint64>{ first });
+
+    // 同一秒到期的两个任务，先触发的一个取消另一个
+    spy.clear();
+    const QDateTime pairAt = now.addSecs(20);
+    const quint64 a = scheduler.scheduleOnce("a", pairAt);
+    const quint64 b = scheduler.scheduleOnce("b", pairAt);
+    connect(&scheduler, &SceneScheduler::jobTriggered, [&](quint64 jobId) {
+        scheduler.cancel(jobId == a ? b : a);
+    });
+    advanceTo(scheduler, now, pairAt.addSecs(5));
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(scheduler.jobCount(), 0);
+}
+
+// 启动时恢复的任务已过期：按各自的补执行策略触发一次或跳过
+void SceneSchedulerTest::restoreMissedJobs()
+{
+    SceneScheduler scheduler;
+    QDateTime now = Start;
+    scheduler.setSimulatedTime(now);
+    QSignalSpy triggered(&scheduler, &SceneScheduler::jobTriggered);
+    QSignalSpy skipped(&scheduler, &SceneScheduler::jobSkipped);
+
+    auto oneShot = [](quint64 id, qint64 missedSecs, ScheduleJob::CatchUpPolicy policy, int minutes) {
+        ScheduleJob job;
+        job.id = id;
+        job.sceneId = QString("job%1").arg(id);
+        job.fireAt = Start.addSecs(-missedSecs);
+        job.catchUpPolicy = policy;
+        job.catchUpMinutes = minutes;
+        return job;
+    };
+    ScheduleJob daily;
+    daily.id = 14;
+    daily.sceneId = "daily";
+    daily.kind = ScheduleJob::Recurring;
+    daily.weekdays = 0x7F;
+    daily.timeOfDay = QTime(8, 0);
+    daily.fireAt = QDateTime(Start.date().addDays(-1), daily.timeOfDay);
+    daily.catchUpPolicy = ScheduleJob::Skip;
+
+    scheduler.restore({ oneShot(10, 3600, ScheduleJob::RunOnce, 0),
+                        oneShot(11, 3600, ScheduleJob::Skip, 0),
+                        oneShot(12, 600, ScheduleJob::RunIfWithin, 30),
+                        oneShot(13, 7200, ScheduleJob::RunIfWithin, 30),
+                        daily,
+                        oneShot(15, -60, ScheduleJob::Skip, 0) });
+
+    QList<quint64> skippedIds;
+    for (const QList<QVariant> &args : qAsConst(skipped)) {
+        skippedIds.append(args.at(0).value<quint64>());
+    }
+    std::sort(skippedIds.begin(), skippedIds.end());
+    QCOMPARE(skippedIds, (QList<quint64>{ 11, 13, 14 }));
+    QVERIFY(!scheduler.contains(11));
+    QVERIFY(!scheduler.contains(13));
+    // 跳过的循环任务推迟到下一次
+    QCOMPARE(scheduler.job(14).fireAt, QDateTime(Start.date(), QTime(8, 0)));
+
+    advanceTo(scheduler, now, Start.addSecs(1));
+    QList<quint64> ids = triggeredIds(triggered);
+    std::sort(ids.begin(), ids.end());
+    QCOMPARE(ids, (QList<quint64>{ 10, 12 }));
+
+    // 未到期的任务照常触发；新任务的ID排在恢复的任务之后
+    advanceTo(scheduler, now, Start.addSecs(60));
+    QCOMPARE(triggeredIds(triggered).last(), quint64(15));
+    QVERIFY(scheduler.scheduleOnce("new", now.addSecs(10)) > 15);
+}
+
+// 休眠超过2分钟后醒来：时间轮按绝对时间重建，休眠期间错过的任务按策略补执行或跳过
+void SceneSchedulerTest::catchUpAfterSleep()
+{
+    SceneScheduler scheduler;
+    QDateTime now = Start;
+    scheduler.setSimulatedTime(now);
+    QSignalSpy triggered(&scheduler, &SceneScheduler::jobTriggered);
+    QSignalSpy skipped(&scheduler, &SceneScheduler::jobSkipped);
+
+    const quint64 runOnce = scheduler.scheduleOnce("runOnce", Start.addSecs(60));
+    const quint64 skip = scheduler.scheduleOnce("skip", Start.addSecs(90), ScheduleJob::Skip);
+    const QTime dailyTime = Start.addSecs(120).time();
+    const quint64 daily = scheduler.scheduleRecurring("daily", 0x7F, dailyTime);
+    const quint64 afterWake = scheduler.scheduleOnce("afterWake", Start.addSecs(4000));
+
+    now = Start.addSecs(3600);
+    scheduler.setSimulatedTime(now);
+    QList<quint64> ids = triggeredIds(triggered);
+    std::sort(ids.begin(), ids.end());
+    QCOMPARE(ids, (QList<quint64>{ runOnce, daily }));
+    QCOMPARE(skipped.count(), 1);
+    QCOMPARE(skipped.at(0).at(0).value<quint64>(), skip);
+    // 循环任务只补执行一次，下一次是明天的同一时刻
+    QCOMPARE(scheduler.job(daily).fireAt, QDateTime(Start.date().addDays(1), dailyTime));
+    QVERIFY(scheduler.contains(afterWake));
+
+    advanceTo(scheduler, now, Start.addSecs(4000));
+    QCOMPARE(triggeredIds(triggered).last(), afterWake);
+    QCOMPARE(triggered.count(), 3);
+}
+
+SMARTHOME_TEST_MAIN(SceneSchedulerTest)
+
+#include "sceneschedulertest.moc"
@@ -0,0 +1,7 @@
+# 定时任务的保存、更新、删除和重新读入
+TARGET = schedulestoretest
+
+include(../test.pri)
+
+SOURCES += \
+    schedulestoretest.cpp
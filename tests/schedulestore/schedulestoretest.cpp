@@ -0,0 +1,157 @@
+#include "testsupport.h"
+#include "schedulestore.h"
+#include <algorithm>
+
+// 定时任务持久化：schedules 表的写入、更新、删除和重新读入
+class ScheduleStoreTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void persistAndReload();
+    void updateAndRemove();
+    void restoreIntoScheduler();
+
+private:
+    bool reopen();
+    static QVector<ScheduleJob> sorted(QVector<ScheduleJob> jobs);
+    static void compareJobs(const ScheduleJob &actual, const ScheduleJob &expected);
+
+    QTemporaryDir tempDir;
+    QSqlDatabase db;
+    ScheduleStore *store = nullptr;
+    ScheduleJob oneShot;
+    ScheduleJob recurring;
+};
+
+void ScheduleStoreTest::initTestCase()
+{
+    QVERIFY(tempDir.isValid());
+    QVERIFY(reopen());
+
+    oneShot.id = 7;
+    oneShot.sceneId = "comingHomeMode";
+    oneShot.fireAt = QDateTime(QDate(2030, 5, 6), QTime(18, 30, 15));
+    oneShot.catchUpPolicy = ScheduleJob::Skip;
+
+    recurring.id = 8;
+    recurring.sceneId = "WakeUpMode";
+    recurring.kind = ScheduleJob::Recurring;
+    recurring.weekdays = 0x1F;
+    recurring.timeOfDay = QTime(6, 45);
+    recurring.fireAt = QDateTime(QDate(2030, 5, 7), recurring.timeOfDay);
+    recurring.catchUpPolicy = ScheduleJob::RunIfWithin;
+    recurring.catchUpMinutes = 30;
+    recurring.lastRun = QDateTime(QDate(2030, 5, 6), QTime(6, 45, 1));
+}
+
+void ScheduleStoreTest::cleanupTestCase()
+{
+    delete store;
+    store = nullptr;
+    db.close();
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase("schedulestore");
+}
+
+// 关闭并重新打开数据库文件，模拟程序重启
+bool ScheduleStoreTest::reopen()
+{
+    delete store;
+    store = nullptr;
+    if (db.isValid()) {
+        db.close();
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase("schedulestore");
+    }
+    db = QSqlDatabase::addDatabase("QSQLITE", "schedulestore");
+    db.setDatabaseName(tempDir.filePath("schedules.db"));
+    if (!db.open()) {
+        return false;
+    }
+    store = new ScheduleStore(db);
+    return store->ensureSchema();
+}
+
+QVector<ScheduleJob> ScheduleStoreTest::sorted(QVector<ScheduleJob> jobs)
+{
+    std::sort(jobs.begin(), jobs.end(), [](const ScheduleJob &a, const ScheduleJob &b) {
+        return a.id < b.id;
+    });
+    return jobs;
+}
+
+void ScheduleStoreTest::compareJobs(const ScheduleJob &actual, const ScheduleJob &expected)
+{
+    QCOMPARE(actual.id, expected.id);
+    QCOMPARE(actual.sceneId, expected.sceneId);
+    QCOMPARE(actual.kind, expected.kind);
+    QCOMPARE(actual.fireAt, expected.fireAt);
+    QCOMPARE(actual.weekdays, expected.weekdays);
+    QCOMPARE(actual.timeOfDay, expected.timeOfDay);
+    QCOMPARE(actual.catchUpPolicy, expected.catchUpPolicy);
+    QCOMPARE(actual.catchUpMinutes, expected.catchUpMinutes);
+    QCOMPARE(actual.lastRun, expected.lastRun);
+}
+
+// 单次和循环任务的每个字段在重新打开数据库后保持不变
+void ScheduleStoreTest::persistAndReload()
+{
+    QVERIFY(store->save(oneShot));
+    QVERIFY(store->save(recurring));
+    ScheduleJob unsaved;
+    unsaved.sceneId = "SleepMode";
+    unsaved.fireAt = oneShot.fireAt;
+    QVERIFY(!store->save(unsaved));  // 没有任务ID
+
+    QVERIFY(reopen());
+    const QVector<ScheduleJob> jobs = sorted(store->loadAll());
+    QCOMPARE(jobs.size(), 2);
+    compareJobs(jobs.at(0), oneShot);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+    compareJobs(jobs.at(1), recurring);
+}
+
+// 同一个任务ID再次保存时更新原来的行；删除后不再读出
+void ScheduleStoreTest::updateAndRemove()
+{
+    ScheduleJob next = recurring;
+    next.fireAt = recurring.fireAt.addDays(1);
+    next.lastRun = recurring.fireAt;
+    QVERIFY(store->save(next));
+    QVERIFY(store->remove(oneShot.id));
+    QVERIFY(store->remove(12345));  // 不存在的任务
+
+    QVERIFY(reopen());
+    const QVector<ScheduleJob> jobs = store->loadAll();
+    QCOMPARE(jobs.size(), 1);
+    compareJobs(jobs.at(0), next);
+
+    // 恢复测试数据
+    QVERIFY(store->save(oneShot));
+    QVERIFY(store->save(recurring));
+}
+
+// 读出的任务放回调度器后保留原来的任务ID，新任务的ID接在后面
+void ScheduleStoreTest::restoreIntoScheduler()
+{
+    SceneScheduler scheduler;
+    scheduler.setSimulatedTime(QDateTime(QDate(2030, 5, 1), QTime(12, 0)));
+    scheduler.restore(store->loadAll());
+    QCOMPARE(scheduler.jobCount(), 2);
+    compareJobs(scheduler.job(oneShot.id), oneShot);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+    compareJobs(scheduler.job(recurring.id), recurring);
+    QVERIFY(scheduler.scheduleOnce("SleepMode", QDateTime(QDate(2030, 5, 2), QTime(22, 0))) > recurring.id);
+}
+
+SMARTHOME_TEST_MAIN(ScheduleStoreTest)
+
+#include "schedulestoretest.moc"
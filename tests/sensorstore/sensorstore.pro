@@ -0,0 +1,7 @@
+# 温度时间序列的批量写入、范围查询和降采样
+TARGET = sensorstoretest
+
+include(../test.pri)
+
+SOURCES += \
+    sensorstoretest.cpp
@@ -0,0 +1,141 @@
+#include "testsupport.h"
+#include "sensorstore.h"
+#include <QSqlQuery>
+
+// 温度时间序列：缓冲写入、(room, timestamp) 范围查询和按保留期降采样
+class SensorStoreTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void bufferedInsert();
+    void rangeQuery();
+    void retention();
+
+private:
+    int storedRows(const QString &room);
+
+    QTemporaryDir tempDir;
+    QSqlDatabase db;
+    SensorStore *store = nullptr;
+};
+
+void SensorStoreTest::initTestCase()
+{
+    QVERIFY(tempDir.isValid());
+    db = QSqlDatabase::addDatabase("QSQLITE", "sensorstore");
+    db.setDatabaseName(tempDir.filePath("sensor.db"));
+    QVERIFY(db.open());
+    store = new SensorStore(db);
+    QVERIFY(store->ensureSchema());
+    // 已有的表再次检查时不重复添加列
+    QVERIFY(store->ensureSchema());
+}
+
+void SensorStoreTest::cleanupTestCase()
+{
+    delete store;
+    store = nullptr;
+    db.close();
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase("sensorstore");
+}
+
+// 已写入数据库的读数（不含缓冲区）
+int SensorStoreTest::storedRows(const QString &room)
+{
+    QSqlQuery query(db);
+    query.prepare("SELECT COUNT(*) FROM sensor WHERE room = ?");
+    query.addBindValue(room);
+    if (!query.exec() || !query.next()) {
+        return -1;
+    }
+    return query.value(0).toInt();
+}
+
+// 缓冲区满64条时一次写入，不满的部分由 flush 写入
+void SensorStoreTest::bufferedInsert()
+{
+    const QString room = QStringLiteral("Insert");
+    const QDateTime start = QDateTime::currentDateTime().addSecs(-3600);
+    for (int i = 0; i < 63; ++i) {
+        store->append(room, "sensor", 20.0 + i * 0.1, start.addSecs(i));
+    }
+    QCOMPARE(storedRows(room), 0);
+    store->append(room, "sensor", 30.0, start.addSecs(63));
+    QCOMPARE(storedRows(room), 64);
+    store->append(room, "sensor", 31.0, start.addSecs(64));
+    QCOMPARE(storedRows(room), 64);
+    store->flush();
+    QCOMPARE(storedRows(room), 65);
+}
+
+// 只返回指定房间 [from, to) 内的读数，按时间排序，包含还在缓冲区中的读数
+void SensorStoreTest::rangeQuery()
+{
+    const QString room = QStringLiteral("Range");
+    QDateTime start = QDateTime::currentDateTime().addSecs(-2 * 3600);
+    start.setTime(QTime(start.time().hour(), start.time().minute(), 0));
+    // 倒序写入，查询结果仍按时间排序
+    for (int i = 11; i >= 0; --i) {
+        store->append(room, "sensor", 20.0 + i, start.addSecs(i * 600));
+        store->append("RangeOther", "sensor", 0.0, start.addSecs(i * 600));
+    }
+
+    const QVector<SensorReading> series = store->querySeries(room, start.addSecs(1800), start.addSecs(5400));
+    QCOMPARE(series.size(), 6);
+    for (int i = 0; i < series.size(); ++i) {
+        const SensorReading &reading = series.at(i);
+        QCOMPARE(reading.room, room);
+        QCOMPARE(reading.source, QString("sensor"));
+        QCOMPARE(reading.timestamp, start.addSecs((i + 3) * 600));
+        QCOMPARE(reading.temperature, 23.0 + i);
+        QCOMPARE(reading.resolution, 0);
+    }
+    QVERIFY(store->querySeries(room, start.addSecs(7200), start.addSecs(7200)).isEmpty());
+    QVERIFY(store->querySeries("NoSuchRoom", start, start.addDays(1)).isEmpty());
+}
+
+// 原始数据保留1天后合并为5分钟均值，5分钟均值保留7天后合并为小时均值，最近的原始数据不变
+void SensorStoreTest::retention()
+{
+    const QString room = QStringLiteral("Retention");
+    const QDate today = QDate::currentDate();
+    const QDateTime recent = QDateTime::currentDateTime().addSecs(-3600);
+    const QDateTime threeDays(today.addDays(-3), QTime(10, 1));
+    const QDateTime tenDays(today.addDays(-10), QTime(10, 1));
+
+    // 三天前：同一个5分钟桶中的两条
+    store->append(room, "sensor", 20.0, threeDays);
+    store->append(room, "sensor", 22.0, threeDays.addSecs(120));
+    // 十天前：同一小时中两个5分钟桶
+    store->append(room, "sensor", 10.0, tenDays);
+    store->append(room, "sensor", 14.0, tenDays.addSecs(32 * 60));
+    store->append(room, "sensor", 25.0, recent);
+    store->downsample();
+
+    const QVector<SensorReading> series = store->querySeries(room, tenDays.addDays(-1), QDateTime::currentDateTime());
+    QCOMPARE(series.size(), 3);
+
+    QCOMPARE(series.at(0).resolution, 3600);
+    QCOMPARE(series.at(0).timestamp, QDateTime(tenDays.date(), QTime(10, 0)));
+    QCOMPARE(series.at(0).temperature, 12.0);
+
+    QCOMPARE(series.at(1).resolution, 300);
+    QCOMPARE(series.at(1).timestamp, QDateTime(threeDays.date(), QTime(10, 0)));
+    QCOMPARE(series.at(1).temperature, 21.0);
+
+    QCOMPARE(series.at(2).resolution, 0);
+    QCOMPARE(series.at(2).temperature, 25.0);
+
+    // 再次降采样不改变已合并的数据
+    store->downsample();
+    QCOMPARE(store->querySeries(room, tenDays.addDays(-1), QDateTime::currentDateTime()).size(), 3);
+}
+
+SMARTHOME_TEST_MAIN(SensorStoreTest)
+
+#include "sensorstoretest.moc"
@@ -0,0 +1,7 @@
+# 程序启动：存储线程恢复设备状态后，界面、控制核心和能耗统计的初始状态
+TARGET = startuptest
+
+include(../test.pri)
+
+SOURCES += \
+    startuptest.cpp
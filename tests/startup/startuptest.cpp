@@ -0,0 +1,207 @@
+#include "testsupport.h"
+#include "devicecatalog.h"
+#include "devicetraits.h"
+#include "energymeter.h"
+#include "mainwindowtestaccess.h"
+#include <QFile>
+#include <QHash>
+#include <QSet>
+
+// 程序启动：每个测试用自己的数据库新建一个界面，检查恢复出的设备状态
+class StartupTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void coldStartWithoutSnapshot();
+    void coldStartStateAgrees();
+    void scheduleReconciliation();
+
+private:
+    static QHash<QString, bool> prepareDatabase(const QString &databasePath);
+
+    QTemporaryDir tempDir;
+};
+
+void StartupTest::initTestCase()
+{
+    QVERIFY(tempDir.isValid());
+}
+
+// 上次运行留下的数据库：每种开关设备的第一个设备开启，门锁打开；返回 devices.status 中的开关状态
+QHash<QString, bool> StartupTest::prepareDatabase(const QString &databasePath)
+{
+    QHash<QString, bool> states;
+    StorageWorker storage(databasePath, "startup");
+    if (!storage.open()) {
+        return states;
+    }
+    storage.populateDefaultDevices();
+    bool changed[DeviceKindCount] = {};
+    for (const DeviceState &device : storage.loadDevices()) {
+        DeviceKind kind;
+        if (!deviceKindFromType(device.type, &kind) || changed[int(kind)]) {
+            continue;
+        }
+        changed[int(kind)] = true;
+        const DeviceTypeTraits &traits = deviceTraits(kind);
+        const bool on = kind != DeviceKind::Lock;
+        storage.updateDevice(device.deviceId, QString(), QString(),
+                             QString::fromLatin1(on ? traits.onValue : traits.offValue));
+    }
+    for (const DeviceState &device : storage.loadDevices()) {
+        states.insert(device.deviceId, device.on);
+    }
+    return states;
+}
+
+// 没有状态快照的冷启动：界面按 devices.status 显示全部设备，而不是全部关闭
+void StartupTest::coldStartWithoutSnapshot()
+{
+    const QString databasePath = tempDir.filePath("coldstart.db");
+    QVERIFY(!QFile::exists(HomeSnapshot::pathForDatabase(databasePath)));
+    const QHash<QString, bool> stored = prepareDatabase(databasePath);
+    QVERIFY(!stored.isEmpty());
+    QVERIFY(stored.values().contains(true));
+
+    prepareWindowEnvironment(databasePath);
+    MainWindow window;
+    QTRY_VERIFY(MainWindowTestAccess::isDatabaseReady(window));
+
+    // 快照中是界面上所有设备的当前状态
+    const QVector<DeviceState> shown = MainWindowTestAccess::captureSnapshot(window).devices;
+    QVERIFY(!shown.isEmpty());
+    for (const DeviceState &device : shown) {
+        QVERIFY2(stored.contains(device.deviceId), qPrintable(device.deviceId));
+        QVERIFY2(device.on == stored.value(device.deviceId), qPrintable(device.deviceId));
+    }
+}
+
+// 冷启动之后界面、控制核心（含规则输入）和能耗统计的开关状态一致，都来自同一份恢复结果
+void StartupTest::coldStartStateAgrees()
+{
+    const QString databasePath = tempDir.filePath("agree.db");
+    const QHash<QString, bool> stored = prepareDatabase(databasePath);
+    QVERIFY(!stored.isEmpty());
+
+    prepareWindowEnvironment(databasePath);
+    MainWindow window;
+    QTRY_VERIFY(MainWindowTestAccess::isDatabaseReady(window));
+
+    // 控制线程在界面收到恢复结果之前已经收到设备列表
+    QHash<QString, bool> controllerStates;
+    QHash<QString, bool> ruleStates;
+    HomeController *controller = MainWindowTestAccess::controller(window);
+    RuleEngine *rules = MainWindowTestAccess::ruleEngine(window);
+    QMetaObject::invokeMethod(controller, [&]() {
+        for (const QString &deviceId : controller->deviceIds()) {
+            controllerStates.insert(deviceId, controller->device(deviceId).on);
+            ruleStates.insert(deviceId, rules->inputValue("device." + deviceId) == 1.0);
+        }
+    }, Qt::BlockingQueuedConnection);
+    QHash<QString, double> watts;
+    StorageWorker *storage = MainWindowTestAccess::storage(window);
+    QMetaObject::invokeMethod(storage, [&]() {
+        for (auto it = stored.cbegin(); it != stored.cend(); ++it) {
+            watts.insert(it.key(), storage->meter() ? storage->meter()->currentWatts(it.key()) : -1.0);
+        }
+    }, Qt::BlockingQueuedConnection);
+
+    QCOMPARE(controllerStates.size(), stored.size());
+    const QVector<DeviceState> shown = MainWindowTestAccess::captureSnapshot(window).devices;
+    for (const DeviceState &device : shown) {
+        const QString &deviceId = device.deviceId;
+        const bool on = device.on;
+        QVERIFY2(controllerStates.value(deviceId) == on, qPrintable(deviceId));
+        QVERIFY2(ruleStates.value(deviceId) == on, qPrintable(deviceId));
+
+        // 开关功率相同的设备（窗帘、门锁）只能检查已在计量
+        const DeviceInfo *info = DeviceCatalog::instance().find(deviceId);
+        DeviceKind kind;
+        QVERIFY2(info && deviceKindFromType(info->type, &kind), qPrintable(deviceId));
+        const DeviceTypeTraits &traits = deviceTraits(kind);
+        const double expected = on ? traits.onWatts : traits.standbyWatts;
+        if (kind == DeviceKind::AirConditioner && on) {
+            QVERIFY2(watts.value(deviceId) > traits.standbyWatts, qPrintable(deviceId));
+        } else {
+            QVERIFY2(qFuzzyCompare(watts.value(deviceId), expected), qPrintable(deviceId));
+        }
+    }
+}
+
+// 快照和数据库中的定时任务在启动后合并：快照中的任务以快照为准写回数据库，
+// 恢复时跳过的任务从数据库删除，只在数据库中的任务补充到调度器
+void StartupTest::scheduleReconciliation()
+{
+    const QString databasePath = tempDir.filePath("schedules.db");
+    // 数据库中的时间精确到秒
+    const QDateTime now = QDateTime::fromSecsSinceEpoch(QDateTime::currentSecsSinceEpoch());
+
+    ScheduleJob kept;          // 快照和数据库中都有，快照中的触发时间较新
+    kept.id = 1;
+    kept.sceneId = "comingHomeMode";
+    kept.fireAt = now.addDays(1);
+    ScheduleJob databaseOnly;  // 快照之后新增
+    databaseOnly.id = 2;
+    databaseOnly.sceneId = "SleepMode";
+    databaseOnly.fireAt = now.addDays(2);
+    ScheduleJob missed;        // 关机期间错过，恢复时跳过
+    missed.id = 3;
+    missed.sceneId = "WakeUpMode";
+    missed.fireAt = now.addSecs(-3600);
+    missed.catchUpPolicy = ScheduleJob::Skip;
+    ScheduleJob snapshotOnly;  // 快照之后数据库没有写入
+    snapshotOnly.id = 4;
+    snapshotOnly.sceneId = "leavingHomeMode";
+    snapshotOnly.fireAt = now.addDays(3);
+
+    HomeSnapshot snapshot;
+    snapshot.savedAt = now;
+    {
+        StorageWorker storage(databasePath, "startup");
+        QVERIFY(storage.open());
+        storage.populateDefaultDevices();
+        ScheduleJob stale = kept;
+        stale.fireAt = now.addDays(5);
+        storage.saveSchedule(stale);
+        storage.saveSchedule(databaseOnly);
+        storage.saveSchedule(missed);
+        QCOMPARE(storage.loadSchedules().size(), 3);
+        snapshot.devices = storage.loadDevices();
+    }
+    snapshot.schedules = { kept, missed, snapshotOnly };
+    QVERIFY(HomeSnapshot::writeFile(HomeSnapshot::pathForDatabase(databasePath), snapshot.serialize()));
+
+    prepareWindowEnvironment(databasePath);
+    MainWindow window;
+    QCOMPARE(MainWindowTestAccess::snapshotJobIds(window).size(), 3);
+    QTRY_VERIFY(MainWindowTestAccess::isDatabaseReady(window));
+
+    SceneScheduler *scheduler = MainWindowTestAccess::scheduler(window);
+    QVERIFY(scheduler->contains(kept.id));
+    QCOMPARE(scheduler->job(kept.id).fireAt, kept.fireAt);
+    QVERIFY(scheduler->contains(databaseOnly.id));
+    QVERIFY(scheduler->contains(snapshotOnly.id));
+    QVERIFY(!scheduler->contains(missed.id));
+
+    // 写回在存储线程排队执行，阻塞调用排在它们之后
+    QVector<ScheduleJob> rows;
+    StorageWorker *storage = MainWindowTestAccess::storage(window);
+    QMetaObject::invokeMethod(storage, [&]() {
+        rows = storage->loadSchedules();
+    }, Qt::BlockingQueuedConnection);
+    QHash<quint64, QDateTime> stored;
+    for (const ScheduleJob &job : qAsConst(rows)) {
+        stored.insert(job.id, job.fireAt);
+    }
+    const QSet<quint64> expectedIds = { kept.id, databaseOnly.id, snapshotOnly.id };
+    QCOMPARE(QSet<quint64>(stored.keyBegin(), stored.keyEnd()), expectedIds);
+    QCOMPARE(stored.value(kept.id), kept.fireAt);
+    QCOMPARE(stored.value(snapshotOnly.id), snapshotOnly.fireAt);
+}
+
+SMARTHOME_TEST_MAIN(StartupTest)
+
+#include "startuptest.moc"
@@ -0,0 +1,7 @@
+# 存储线程的设备状态恢复和热模型拟合
+TARGET = storageworkertest
+
+include(../test.pri)
+
+SOURCES += \
+    storageworkertest.cpp
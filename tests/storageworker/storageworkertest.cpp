@@ -0,0 +1,165 @@
+#include "testsupport.h"
+#include "homesnapshot.h"
+#include <QSqlQuery>
+#include <QtMath>
+#include <algorithm>
+
+// 存储线程：设备状态的恢复和热模型的拟合输入
+class StorageWorkerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void recoverFromHistoryTail();
+    void recoverWithoutSnapshot();
+    void thermalFitUsesMeasuredReadings();
+    void replayFailureKeepsDeviceStatus();
+
+private:
+    CoreFixture core;
+};
+
+void StorageWorkerTest::initTestCase()
+{
+    QVERIFY(core.open());
+}
+
+// 快照加历史回放：只回放快照序号之后的记录；写入状态后、写入历史前崩溃留下的 devices.status 被改正
+void StorageWorkerTest::recoverFromHistoryTail()
+{
+    const int tailRows = 1001;
+
+    HomeSnapshot snapshot;
+    snapshot.devices = core.storage->loadDevices();
+    for (DeviceState &device : snapshot.devices) {
+        device.on = false;
+    }
+    // 快照之前的记录不参与回放
+    for (int i = 0; i < 100; ++i) {
+        QVERIFY(core.controller->recordDeviceAction("BedroomLight", "toggle", i % 2 ? "off" : "on"));
+    }
+    snapshot.historySequence = core.storage->lastHistorySequence();
+    QVERIFY(snapshot.historySequence > 0);
+
+    for (int i = 0; i < tailRows; ++i) {
+        QVERIFY(core.controller->recordDeviceAction("LivingroomLight", "toggle", i % 2 ? "off" : "on"));
+    }
+    QCOMPARE(core.storage->lastHistorySequence(), snapshot.historySequence + tailRows);
+    // 状态已写入，历史还没写入时崩溃
+    QVERIFY(core.controller->updateStatus("KitchenLight", "on"));
+
+    const DeviceRecovery recovery = core.storage->recoverDevices(&snapshot);
+    QCOMPARE(recovery.replayedRows, tailRows);
+    QCOMPARE(recovery.sequence, snapshot.historySequence + tailRows);
+    QCOMPARE(recovery.replayedIds, QStringList{ "LivingroomLight" });
+
+    auto isOn = [&recovery](const QString &deviceId) {
+        auto it = std::find_if(recovery.devices.cbegin(), recovery.devices.cend(), [&deviceId](const DeviceState &device) {
+            return device.deviceId == deviceId;
+        });
+        return it != recovery.devices.cend() && it->on;
+    };
+    QVERIFY(isOn("LivingroomLight"));
+    QVERIFY(!isOn("BedroomLight"));
+    QVERIFY(!isOn("KitchenLight"));
+
+    QSqlQuery query(core.storage->database());
+    QVERIFY(query.exec("SELECT device_id, status FROM devices WHERE device_id IN ('LivingroomLight', 'KitchenLight')"));
+    while (query.next()) {
+        QCOMPARE(query.value(1).toString(), QString(query.value(0).toString() == "LivingroomLight" ? "on" : "off"));
+    }
+}
+
+// 没有快照：每个设备取最近一条开关记录，与之不符的 devices.status 被改正；没有记录的设备保持 devices.status，
+// 全部设备交给界面重绘
+void StorageWorkerTest::recoverWithoutSnapshot()
+{
+    QVERIFY(core.controller->recordDeviceAction("LivingroomLight", "toggle", "on"));
+    QVERIFY(core.controller->recordDeviceAction("LivingroomLight", "set_temperature", "24"));
+    QVERIFY(core.controller->recordDeviceAction("BedroomLight", "toggle", "off"));
+    // 历史写入后 devices.status 没有跟上；书房灯没有开关记录
+    QVERIFY(core.controller->updateStatus("LivingroomLight", "off"));
+    QVERIFY(core.controller->updateStatus("BedroomLight", "off"));
+    QVERIFY(core.controller->updateStatus("StudyroomLight", "on"));
+    const QVector<DeviceState> stored = core.storage->loadDevices();
+    QVERIFY(!stored.isEmpty());
+
+    const DeviceRecovery recovery = core.storage->recoverDevices(nullptr);
+    QVERIFY(recovery.replayedRows >= 2);
+    QCOMPARE(recovery.repairedRows, 1);
+    QCOMPARE(recovery.sequence, core.storage->lastHistorySequence());
+    QCOMPARE(recovery.devices.size(), stored.size());
+    QCOMPARE(recovery.replayedIds.size(), stored.size());
+    for (int i = 0; i < stored.size(); ++i) {
+        const QString &deviceId = stored.at(i).deviceId;
+        QCOMPARE(recovery.devices.at(i).deviceId, deviceId);
+        QCOMPARE(recovery.devices.at(i).on, deviceId == "LivingroomLight" ? true : stored.at(i).on);
+        QVERIFY(recovery.replayedIds.contains(deviceId));
+    }
+    QCOMPARE(core.storage->recoverDevices(nullptr).repairedRows, 0);
+
+    QSqlQuery query(core.storage->database());
+    QVERIFY(query.exec("SELECT status FROM devices WHERE device_id = 'LivingroomLight'"));
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toString(), QString("on"));
+}
+
+// 热模型只用实测室温拟合：只有模拟读数的客厅保留默认参数，卧室的实测降温曲线拟合出时间常数
+void StorageWorkerTest::thermalFitUsesMeasuredReadings()
+{
+    // 3天前没有空调开关记录，样本都是空调关闭
+    const QDateTime now = QDateTime::currentDateTime();
+    const QDateTime start = now.addDays(-3);
+    const double outside = 10.0;
+    const double tauHours = 6.0;
+    for (int i = 0; i <= 10; ++i) {
+        const QDateTime at = start.addSecs(i * 1800);
+        const double hours = i * 0.5;
+        core.storage->appendReading(SensorStore::OutsideRoom, "weather", outside, at);
+        core.storage->appendReading("Livingroom", SensorStore::SimulatedSource, outside + 3 + (i % 2), at);
+        core.storage->appendReading("Bedroom", "sensor", outside + 15.0 * qExp(-hours / tauHours), at);
+    }
+
+    const PlanningInputs inputs = core.storage->loadPlanningInputs(now, true, false);
+    QVERIFY(inputs.modelsFitted);
+    const ThermalModel &livingroom = inputs.models[AcPlanner::Livingroom];
+    QVERIFY(!livingroom.isFitted());
+    QCOMPARE(livingroom.timeConstantHours(), ThermalModel::DefaultTimeConstantHours);
+    const ThermalModel &bedroom = inputs.models[AcPlanner::Bedroom];
+    QVERIFY(bedroom.isFitted());
+    QVERIFY2(qAbs(bedroom.timeConstantHours() - tauHours) < 1.0, qPrintable(QString::number(bedroom.timeConstantHours())));
+}
+
+// 读取历史失败：按 devices.status 恢复，与快照不同的设备交给界面重绘，不改正 devices.status
+void StorageWorkerTest::replayFailureKeepsDeviceStatus()
+{
+    QVERIFY(core.controller->updateStatus("BedroomLight", "on"));
+    QVERIFY(core.controller->updateStatus("KitchenLight", "off"));
+    HomeSnapshot snapshot;
+    snapshot.devices = core.storage->loadDevices();
+    for (DeviceState &device : snapshot.devices) {
+        device.on = (device.deviceId == "KitchenLight");
+    }
+    snapshot.historySequence = core.storage->lastHistorySequence();
+
+    QSqlQuery query(core.storage->database());
+    QVERIFY(query.exec("ALTER TABLE device_history RENAME TO device_history_moved"));
+    const DeviceRecovery recovery = core.storage->recoverDevices(&snapshot);
+    QVERIFY(query.exec("ALTER TABLE device_history_moved RENAME TO device_history"));
+
+    QCOMPARE(recovery.replayedRows, 0);
+    QCOMPARE(recovery.repairedRows, 0);
+    const QVector<DeviceState> stored = core.storage->loadDevices();
+    QCOMPARE(recovery.devices.size(), stored.size());
+    for (int i = 0; i < stored.size(); ++i) {
+        QCOMPARE(recovery.devices.at(i).on, stored.at(i).on);
+    }
+    QVERIFY(recovery.replayedIds.contains("BedroomLight"));
+    QVERIFY(recovery.replayedIds.contains("KitchenLight"));
+}
+
+SMARTHOME_TEST_MAIN(StorageWorkerTest)
+
+#include "storageworkertest.moc"
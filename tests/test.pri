@@ -0,0 +1,20 @@
+# 各组件功能测试的公共配置：与主程序编译同一份源文件，另加测试入口和公共夹具（testsupport）
+QT       += core gui widgets sql network testlib
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+# 天气数据使用模拟服务器的夹具
+DEFINES += FIXTURE_DIR=\\\"$$PWD/../tools/mockweatherserver/fixtures\\\"
+
+include($$PWD/../smarthome.pri)
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/mainwindowtestaccess.cpp \
+    $$PWD/testsupport.cpp
+
+HEADERS += \
+    $$PWD/mainwindowtestaccess.h \
+    $$PWD/testsupport.h
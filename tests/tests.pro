@@ -0,0 +1,15 @@
+# 每个组件一个 QtTest 程序，检查功能是否正确；耗时和分配见 benchmarks/，公共配置见 test.pri
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    anomalydetector \
+    controlserver \
+    mainwindow \
+    ruleengine \
+    sceneanalytics \
+    scenescheduler \
+    schedulestore \
+    sensorstore \
+    startup \
+    storageworker \
+    weatherpollpolicy
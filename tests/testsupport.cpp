@@ -0,0 +1,128 @@
+#include "testsupport.h"
+#include "controlserver.h"
+#include <QLoggingCategory>
+#include <QStandardPaths>
+
+CoreFixture::~CoreFixture()
+{
+    close();
+}
+
+bool CoreFixture::open()
+{
+    if (!dir.isValid()) {
+        return false;
+    }
+    storage = new StorageWorker(databasePath(), "test");
+    if (!storage->open()) {
+        return false;
+    }
+    storage->populateDefaultDevices();
+    storage->populateDefaultScenes();
+    ruleEngine = new RuleEngine;
+    ruleEngine->loadDefaultRules();
+    controller = new HomeController;
+    controller->setDatabase(storage->database());
+    if (!controller->loadDevices()) {
+        return false;
+    }
+    controller->setRuleEngine(ruleEngine);
+    return true;
+}
+
+void CoreFixture::close()
+{
+    delete controller;
+    controller = nullptr;
+    delete ruleEngine;
+    ruleEngine = nullptr;
+    delete storage;
+    storage = nullptr;
+}
+
+QString CoreFixture::filePath(const QString &fileName) const
+{
+    return dir.filePath(fileName);
+}
+
+QString CoreFixture::databasePath() const
+{
+    return dir.filePath("core.db");
+}
+
+void prepareWindowEnvironment(const QString &databasePath, const QString &controlSocket)
+{
+    qputenv("SMARTHOME_DB_PATH", databasePath.toLocal8Bit());
+    // 天气请求发到本机未监听的端口，立即失败，不影响计时
+    qputenv("SMARTHOME_WEATHER_URL", "http://127.0.0.1:9");
+    // 不启动指标服务，避免与正在运行的主程序争用端口
+    qputenv("SMARTHOME_METRICS_PORT", "0");
+    qputenv("SMARTHOME_CONTROL_SOCKET", controlSocket.toLocal8Bit());
+}
+
+ControlClient::ControlClient(const QString &name)
+{
+    connect(&socket, &QLocalSocket::readyRead, this, &ControlClient::read);
+    socket.connectToServer(name);
+}
+
+void ControlClient::send(const QCborValue &payload)
+{
+    socket.write(ControlServer::frame(payload));
+}
+
+void ControlClient::setPaused(bool pause)
+{
+    paused = pause;
+    socket.setReadBufferSize(pause ? 1 : 0);
+    if (!pause) {
+        read();
+    }
+}
+
+QCborMap ControlClient::request(qint64 id, const QString &op)
+{
+    QCborMap request;
+    request.insert(QStringLiteral("id"), id);
+    request.insert(QStringLiteral("op"), op);
+    return request;
+}
+
+QCborMap ControlClient::command(const QString &deviceId, const QString &command, const QString &value)
+{
+    QCborMap map;
+    map.insert(QStringLiteral("device"), deviceId);
+    map.insert(QStringLiteral("command"), command);
+    map.insert(QStringLiteral("value"), value);
+    return map;
+}
+
+QCborValue ControlClient::field(const QCborValue &frame, const char *key)
+{
+    return frame.toMap().value(QString::fromLatin1(key));
+}
+
+void ControlClient::read()
+{
+    if (paused) {
+        return;
+    }
+    buffer.append(socket.readAll());
+    int offset = 0;
+    QByteArray payload;
+    while (ControlServer::takeFrame(buffer, &offset, &payload)) {
+        frames.append(QCborValue::fromCbor(payload));
+    }
+    payload.clear();
+    buffer.remove(0, offset);
+}
+
+void prepareTestEnvironment(const char *testName)
+{
+    QApplication::setOrganizationName("QtLab");
+    // 每个测试程序一个目录，可以同时运行
+    QApplication::setApplicationName("QtSmartHome-" + QString::fromLatin1(testName));
+    QStandardPaths::setTestModeEnabled(true);
+    // 控制函数的调试输出会混进测试日志，影响计时和分配统计
+    QLoggingCategory::setFilterRules("default.debug=false\nsmarthome.*.debug=false");
+}
@@ -0,0 +1,80 @@
+#ifndef TESTSUPPORT_H
+#define TESTSUPPORT_H
+
+#include "homecontroller.h"
+#include "ruleengine.h"
+#include "storageworker.h"
+#include <QApplication>
+#include <QCborMap>
+#include <QCborValue>
+#include <QLocalSocket>
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+
+// 功能测试（tests/<组件>/）和基准测试（benchmarks/<组件>/）共用的部分：
+// 每个组件一个测试程序，由 tests.pro 和 benchmarks.pro 统一构建，make check 依次运行
+
+// 控制核心和存储直接在测试线程中使用，只测函数本身；界面程序中它们运行在各自的线程。
+// 数据库和测试的其它文件放在夹具自己的临时目录，测试对象析构时关闭
+struct CoreFixture
+{
+    ~CoreFixture();
+
+    // 新建数据库，写入默认设备和场景，控制核心加载设备和默认规则
+    bool open();
+    void close();
+    QString filePath(const QString &fileName) const;
+    QString databasePath() const;
+
+    StorageWorker *storage = nullptr;
+    RuleEngine *ruleEngine = nullptr;
+    HomeController *controller = nullptr;
+
+private:
+    QTemporaryDir dir;
+};
+
+// 界面程序的环境变量：数据库放在测试目录，天气请求立即失败，不启动指标服务；
+// controlSocket 为空时不启动本机控制接口
+void prepareWindowEnvironment(const QString &databasePath, const QString &controlSocket = QString());
+
+// 本机控制接口的测试客户端：收到的回复和事件按帧保存
+class ControlClient : public QObject
+{
+public:
+    explicit ControlClient(const QString &name);
+
+    bool waitForConnected() { return socket.waitForConnected(5000); }
+    void send(const QCborValue &payload);
+
+    // 模拟慢的订阅者：暂停期间不读取，读缓冲很小，数据积压在服务端
+    void setPaused(bool pause);
+
+    static QCborMap request(qint64 id, const QString &op);
+    static QCborMap command(const QString &deviceId, const QString &command, const QString &value);
+    static QCborValue field(const QCborValue &frame, const char *key);
+
+    QVector<QCborValue> frames;
+
+private:
+    void read();
+
+    QLocalSocket socket;
+    QByteArray buffer;
+    bool paused = false;
+};
+
+// 应用名称、测试模式和日志过滤：缓存、规则等文件放到每个测试程序自己的目录，不碰正式数据
+void prepareTestEnvironment(const char *testName);
+
+#define SMARTHOME_TEST_MAIN(TestClass) \
+int main(int argc, char *argv[]) \
+{ \
+    QApplication app(argc, argv); \
+    prepareTestEnvironment(#TestClass); \
+    TestClass test; \
+    return QTest::qExec(&test, argc, argv); \
+}
+
+#endif // TESTSUPPORT_H
@@ -0,0 +1,7 @@
+# 自适应天气轮询间隔：温度变化、空调阈值、无人在家和304重新验证
+TARGET = weatherpollpolicytest
+
+include(../test.pri)
+
+SOURCES += \
+    weatherpollpolicytest.cpp
@@ -0,0 +1,82 @@
+#include "testsupport.h"
+#include "weatherpollpolicy.h"
+
+// 天气轮询策略：由最近几次观测计算下一次轮询的间隔
+class WeatherPollPolicyTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void intervals_data();
+    void intervals();
+    void awayOverridesChanges();
+    void revalidatedReadingIsNotObservation();
+};
+
+void WeatherPollPolicyTest::intervals_data()
+{
+    QTest::addColumn<QVector<int>>("temperatures");  // 每小时一次观测
+    QTest::addColumn<QVector<double>>("thresholds");
+    QTest::addColumn<int>("expected");
+
+    const QVector<double> noThresholds;
+    QTest::newRow("no observations") << QVector<int>() << noThresholds << int(WeatherPollPolicy::NormalIntervalMs);
+    QTest::newRow("one observation") << QVector<int>{20} << noThresholds << int(WeatherPollPolicy::NormalIntervalMs);
+    QTest::newRow("fast change") << QVector<int>{20, 23} << noThresholds << int(WeatherPollPolicy::FastIntervalMs);
+    QTest::newRow("moderate change") << QVector<int>{20, 21} << noThresholds << int(WeatherPollPolicy::NormalIntervalMs);
+    QTest::newRow("stable") << QVector<int>{20, 20, 20} << noThresholds << int(WeatherPollPolicy::SlowIntervalMs);
+    // 最近两次没有变化，但几个小时内总体在变
+    QTest::newRow("stable only recently") << QVector<int>{16, 18, 20, 20} << noThresholds
+                                          << int(WeatherPollPolicy::NormalIntervalMs);
+    QTest::newRow("near threshold") << QVector<int>{27, 27, 27} << QVector<double>{28} << int(WeatherPollPolicy::FastIntervalMs);
+    QTest::newRow("far from threshold") << QVector<int>{20, 20, 20} << QVector<double>{28} << int(WeatherPollPolicy::SlowIntervalMs);
+}
+
+void WeatherPollPolicyTest::intervals()
+{
+    QFETCH(QVector<int>, temperatures);
+    QFETCH(QVector<double>, thresholds);
+    QFETCH(int, expected);
+
+    WeatherPollPolicy policy;
+    policy.setThresholds(thresholds);
+    const QDateTime start = QDateTime::currentDateTime().addSecs(-3600 * temperatures.size());
+    for (int i = 0; i < temperatures.size(); ++i) {
+        policy.recordObservation(temperatures.at(i), start.addSecs(3600 * i));
+    }
+    QCOMPARE(policy.nextIntervalMs(), expected);
+}
+
+void WeatherPollPolicyTest::awayOverridesChanges()
+{
+    WeatherPollPolicy policy;
+    const QDateTime now = QDateTime::currentDateTime();
+    policy.recordObservation(20, now.addSecs(-3600));
+    policy.recordObservation(25, now);
+    policy.setAway(true);
+    QVERIFY(policy.isAway());
+    QCOMPARE(policy.nextIntervalMs(), int(WeatherPollPolicy::AwayIntervalMs));
+    policy.setAway(false);
+    QCOMPARE(policy.nextIntervalMs(), int(WeatherPollPolicy::FastIntervalMs));
+}
+
+// 304 只说明缓存仍然有效，温度还是上一次观测的值；
+// 把它当作新的观测会让温度变化率变成0，正在快速变化时也放慢轮询
+void WeatherPollPolicyTest::revalidatedReadingIsNotObservation()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    WeatherPollPolicy policy;
+    policy.recordObservation(14, now.addSecs(-3 * 3600));
+    policy.recordObservation(16, now.addSecs(-2 * 3600));
+    policy.recordObservation(18, now.addSecs(-3600));
+    policy.recordObservation(21, now.addSecs(-600));
+    QCOMPARE(policy.nextIntervalMs(), int(WeatherPollPolicy::FastIntervalMs));
+
+    WeatherPollPolicy recordedRevalidation = policy;
+    recordedRevalidation.recordObservation(21, now);
+    QVERIFY(recordedRevalidation.nextIntervalMs() > WeatherPollPolicy::FastIntervalMs);
+}
+
+SMARTHOME_TEST_MAIN(WeatherPollPolicyTest)
+
+#include "weatherpollpolicytest.moc"
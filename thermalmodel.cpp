@@ -0,0 +1,146 @@
+#include "thermalmodel.h"
+#include <QDebug>
+#include <QtMath>
+
+static const qint64 MaxSampleGapSecs = 2 * 3600;
+static const double MinTimeConstantHours = 1.0;
+static const double MaxTimeConstantHours = 48.0;
+static const double MinAcRatePerHour = 0.5;
+static const double MaxAcRatePerHour = 20.0;
+static const double ComfortToleranceDegrees = 0.5;  // 与目标温度相差0.5度以内视为已达到
+
+ThermalModel::ThermalModel()
+    : timeConstant(DefaultTimeConstantHours)
+    , acRate(DefaultAcRatePerHour)
+    , fitted(false)
+{
+}
+
+QVector<ThermalSample> ThermalModel::buildSamples(const QVector<SensorReading> &indoor,
+                                                  const QVector<SensorReading> &outside,
+                                                  const QVector<QPair<QDateTime, QDateTime>> &acOnIntervals)
+{
+    QVector<ThermalSample> samples;
+    if (indoor.size() < 2 || outside.isEmpty()) {
+        return samples;
+    }
+    samples.reserve(indoor.size() - 1);
+
+    // 三个序列都按时间升序，用游标一次扫描
+    int outsideIndex = 0;
+    int intervalIndex = 0;
+    for (int i = 1; i < indoor.size(); ++i) {
+        const SensorReading &previous = indoor.at(i - 1);
+        const SensorReading &current = indoor.at(i);
+        qint64 gapSecs = previous.timestamp.secsTo(current.timestamp);
+        if (gapSecs <= 0 || gapSecs > MaxSampleGapSecs) {
+            continue;
+        }
+        QDateTime middle = previous.timestamp.addSecs(gapSecs / 2);
+
+        // 取中点之前最近的一次室外读数
+        while (outsideIndex + 1 < outside.size() && outside.at(outsideIndex + 1).timestamp <= middle) {
+            outsideIndex++;
+        }
+        while (intervalIndex < acOnIntervals.size() && acOnIntervals.at(intervalIndex).second < middle) {
+            intervalIndex++;
+        }
+
+        ThermalSample sample;
+        sample.indoor = (previous.temperature + current.temperature) / 2.0;
+        sample.outside = outside.at(outsideIndex).temperature;
+        sample.ratePerHour = (current.temperature - previous.temperature) * 3600.0 / gapSecs;
+        sample.acOn = intervalIndex < acOnIntervals.size() && acOnIntervals.at(intervalIndex).first <= middle;
+        samples.append(sample);
+    }
+    return samples;
+}
+
+bool ThermalModel::fit(const QVector<ThermalSample> &samples)
+{
+    // 空调关闭的样本：ratePerHour = (outside - indoor) / tau，过原点的最小二乘求 1/tau
+    double sumXY = 0.0;
+    double sumXX = 0.0;
+    int offCount = 0;
+    for (const ThermalSample &sample : samples) {
+        if (sample.acOn) {
+            continue;
+        }
+        double x = sample.outside - sample.indoor;
+        sumXY += x * sample.ratePerHour;
+        sumXX += x * x;
+        offCount++;
+    }
+
+    bool fittedTimeConstant = false;
+    if (offCount >= MinSamples && sumXX > 0.0 && sumXY > 0.0) {
+        timeConstant = qBound(MinTimeConstantHours, sumXX / sumXY, MaxTimeConstantHours);
+        fittedTimeConstant = true;
+    }
+
+    // 空调开启的样本：扣除自然散热部分后剩下的就是空调的能力
+    double sumResidual = 0.0;
+    int onCount = 0;
+    for (const ThermalSample &sample : samples) {
+        if (!sample.acOn) {
+            continue;
+        }
+        double passive = (sample.outside - sample.indoor) / timeConstant;
+        sumResidual += qAbs(sample.ratePerHour - passive);
+        onCount++;
+    }
+
+    bool fittedAcRate = false;
+    if (onCount >= MinSamples) {
+        acRate = qBound(MinAcRatePerHour, sumResidual / onCount, MaxAcRatePerHour);
+        fittedAcRate = true;
+    }
+
+    fitted = fittedTimeConstant || fittedAcRate;
+    qDebug() << "热模型拟合: tau =" << timeConstant << "小时, 空调能力 =" << acRate << "度/小时"
+             << "(关闭样本" << offCount << "个, 开启样本" << onCount << "个)";
+    return fitted;
+}
+
+double ThermalModel::timeConstantHours() const
+{
+    return timeConstant;
+}
+
+double ThermalModel::acRatePerHour() const
+{
+    return acRate;
+}
+
+bool ThermalModel::isFitted() const
+{
+    return fitted;
+}
+
+double ThermalModel::predict(double indoor, double outside, bool acOn, bool heating, double hours) const
+{
+    // 一阶系统以指数方式趋近平衡温度
+    double equilibrium = outside;
+    if (acOn) {
+        equilibrium += (heating ? 1.0 : -1.0) * acRate * timeConstant;
+    }
+    return equilibrium + (indoor - equilibrium) * qExp(-hours / timeConstant);
+}
+
+int ThermalModel::leadMinutes(double indoor, double outside, double target) const
+{
+    if (qAbs(target - indoor) < ComfortToleranceDegrees) {
+        return 0;
+    }
+
+    bool heating = target > indoor;
+    double equilibrium = outside + (heating ? 1.0 : -1.0) * acRate * timeConstant;
+
+    // 空调一直开着也达不到目标温度，尽量提前
+    if ((heating && equilibrium <= target) || (!heating && equilibrium >= target)) {
+        return MaxLeadMinutes;
+    }
+
+    double hours = -timeConstant * qLn((target - equilibrium) / (indoor - equilibrium));
+    return qBound(0, qCeil(hours * 60.0), MaxLeadMinutes);
+}
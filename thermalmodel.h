@@ -0,0 +1,57 @@
+#ifndef THERMALMODEL_H
+#define THERMALMODEL_H
+
+#include "sensorstore.h"
+#include <QDateTime>
+#include <QPair>
+#include <QVector>
+
+// 一段时间内的室温变化样本
+struct ThermalSample
+{
+    double indoor = 0.0;       // 区间中点的室内温度
+    double outside = 0.0;      // 同一时刻的室外温度
+    double ratePerHour = 0.0;  // 室内温度每小时的变化
+    bool acOn = false;         // 区间内空调是否开启
+};
+
+// 房间的一阶热模型：
+//   空调关闭时 dT/dt = (T室外 - T) / tau
+//   空调开启时再加上空调的制冷/制热能力 ±rate（度/小时）
+// 用 sensor 表的室温曲线和 device_history 中空调的开关时间拟合 tau 和 rate，
+// 再据此计算提前多久开空调才能在起床或到家时刚好达到目标温度
+class ThermalModel
+{
+public:
+    static constexpr double DefaultTimeConstantHours = 6.0;  // 样本不足时的默认值
+    static constexpr double DefaultAcRatePerHour = 4.0;
+    static constexpr int MinSamples = 6;
+    static constexpr int MaxLeadMinutes = 180;  // 最多提前3小时开空调
+
+    ThermalModel();
+
+    // 把室内/室外温度曲线和空调开启区间整理成样本，间隔超过2小时的相邻读数不使用
+    static QVector<ThermalSample> buildSamples(const QVector<SensorReading> &indoor,
+                                               const QVector<SensorReading> &outside,
+                                               const QVector<QPair<QDateTime, QDateTime>> &acOnIntervals);
+
+    // 最小二乘拟合，样本不足的参数保留默认值；返回是否至少拟合出一个参数
+    bool fit(const QVector<ThermalSample> &samples);
+
+    double timeConstantHours() const;
+    double acRatePerHour() const;
+    bool isFitted() const;
+
+    // 预测 hours 小时后的室温
+    double predict(double indoor, double outside, bool acOn, bool heating, double hours) const;
+
+    // 从 indoor 开空调到达到 target 需要的分钟数；已经达到时返回0，达不到时返回 MaxLeadMinutes
+    int leadMinutes(double indoor, double outside, double target) const;
+
+private:
+    double timeConstant;
+    double acRate;
+    bool fitted;
+};
+
+#endif // THERMALMODEL_H
@@ -27,6 +27,19 @@ TimePickerDialog::TimePickerDialog(QWidget *parent)
     timeLayout->addWidget(minuteSpinBox);
     mainLayout->addLayout(timeLayout);
 
+    // 重复设置，不勾选则只响一次
+    QLabel *repeatLabel = new QLabel("重复（不选则只响一次）:", this);
+    mainLayout->addWidget(repeatLabel);
+
+    QHBoxLayout *weekdayLayout = new QHBoxLayout();
+    const QStringList weekdayNames = {"一", "二", "三", "四", "五", "六", "日"};
+    for (const QString &name : weekdayNames) {
+        QCheckBox *checkBox = new QCheckBox(name, this);
+        weekdayCheckBoxes.append(checkBox);
+        weekdayLayout->addWidget(checkBox);
+    }
+    mainLayout->addLayout(weekdayLayout);
+
     QHBoxLayout *buttonLayout = new QHBoxLayout();
 
     QPushButton *confirmButton = new QPushButton("确认", this);
@@ -50,3 +63,14 @@ void TimePickerDialog::setSelectedTime(const QTime &time)
     hourSpinBox->setValue(time.hour());
     minuteSpinBox->setValue(time.minute());
 }
+
+quint8 TimePickerDialog::selectedWeekdays() const
+{
+    quint8 weekdays = 0;
+    for (int i = 0; i < weekdayCheckBoxes.size(); ++i) {
+        if (weekdayCheckBoxes.at(i)->isChecked()) {
+            weekdays |= quint8(1 << i);
+        }
+    }
+    return weekdays;
+}
@@ -8,6 +8,8 @@
 #include <QPushButton>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
+#include <QCheckBox>
+#include <QList>
 
 class TimePickerDialog : public QDialog
 {
@@ -17,11 +19,14 @@ public:
     explicit TimePickerDialog(QWidget *parent = nullptr);
     QTime selectedTime() const;
     void setSelectedTime(const QTime &time);
+    // 重复的星期：bit0=周一 ... bit6=周日，0表示只响一次
+    quint8 selectedWeekdays() const;
 
 private:
     QSpinBox *hourSpinBox;
     QSpinBox *minuteSpinBox;
     QLabel *timeLabel;
+    QList<QCheckBox*> weekdayCheckBoxes;
 };
 
 #endif // TIMEPICKERDIALOG_H
@@ -0,0 +1,274 @@
+#include "historyreplayer.h"
+#include "energymeter.h"
+#include "homecontroller.h"
+#include "ruleengine.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <algorithm>
+
+static const char *SourceConnection = "replay_source";
+static const char *TargetConnection = "replay_target";
+static const char *TimestampFormat = "yyyy-MM-dd hh:mm:ss";
+static const int ProgressInterval = 100000;  // 每回放多少条事件打印一次进度
+
+HistoryReplayer::HistoryReplayer(const ReplayOptions &options)
+    : options(options)
+{
+}
+
+HistoryReplayer::~HistoryReplayer()
+{
+    source.close();
+    target.close();
+    source = QSqlDatabase();
+    target = QSqlDatabase();
+    QSqlDatabase::removeDatabase(SourceConnection);
+    QSqlDatabase::removeDatabase(TargetConnection);
+}
+
+bool HistoryReplayer::run(QTextStream &out)
+{
+    if (QFile::exists(options.targetPath)) {
+        qCritical() << "目标数据库已存在，回放只写入新文件:" << options.targetPath;
+        return false;
+    }
+    if (!openDatabases()) {
+        return false;
+    }
+
+    HomeController controller;
+    controller.setDatabase(target);
+    if (!controller.ensureSchema() || !copyDevicesAndScenes() || !controller.loadDevices()) {
+        return false;
+    }
+
+    RuleEngine ruleEngine;
+    if (!ruleEngine.loadDefaultRules()) {
+        return false;
+    }
+    // 回放时没有界面执行规则动作，只统计触发次数
+    qint64 ruleActions = 0;
+    QObject::connect(&ruleEngine, &RuleEngine::actionTriggered, [&ruleActions](const RuleAction &) {
+        ++ruleActions;
+    });
+    controller.setRuleEngine(&ruleEngine);
+
+    // 两张历史表各自按时间顺序读取，回放时归并
+    QSqlQuery deviceQuery(source);
+    deviceQuery.setForwardOnly(true);
+    QSqlQuery sceneQuery(source);
+    sceneQuery.setForwardOnly(true);
+    QString limitClause = options.limit > 0 ? QString(" LIMIT %1").arg(options.limit) : QString();
+    if (!deviceQuery.exec("SELECT device_id, action_type, action_value, timestamp FROM device_history "
+                          "ORDER BY timestamp, id" + limitClause)
+        || !sceneQuery.exec("SELECT scene_id, timestamp FROM scene_history ORDER BY timestamp, id" + limitClause)) {
+        qCritical() << "读取源数据库历史失败:" << deviceQuery.lastError().text() << sceneQuery.lastError().text();
+        return false;
+    }
+
+    // device_history 是 UTC，scene_history 是本地时间
+    auto deviceTime = [&deviceQuery]() {
+        QDateTime time = QDateTime::fromString(deviceQuery.value(3).toString(), TimestampFormat);
+        time.setTimeSpec(Qt::UTC);
+        return time.toLocalTime();
+    };
+    auto sceneTime = [&sceneQuery]() {
+        return QDateTime::fromString(sceneQuery.value(1).toString(), TimestampFormat);
+    };
+
+    bool hasDevice = deviceQuery.next();
+    bool hasScene = sceneQuery.next();
+    if (!hasDevice && !hasScene) {
+        out << "源数据库中没有历史记录\n";
+        return true;
+    }
+    QDateTime firstTime = !hasScene ? deviceTime()
+                        : !hasDevice ? sceneTime()
+                                     : qMin(deviceTime(), sceneTime());
+
+    // 能耗统计以事件时间为时钟，从第一条事件开始计量
+    EnergyMeter energyMeter(target);
+    energyMeter.setSimulatedTime(firstTime);
+    if (!energyMeter.ensureSchema()) {
+        return false;
+    }
+    controller.setEnergyMeter(&energyMeter);
+
+    qint64 sizeBefore = QFileInfo(options.targetPath).size();
+    QVector<qint64> latenciesNs;
+    qint64 deviceEvents = 0;
+    qint64 sceneEvents = 0;
+    QDateTime lastTime = firstTime;
+
+    QElapsedTimer wallClock;
+    wallClock.start();
+    QElapsedTimer eventTimer;
+    while ((hasDevice || hasScene) && (options.limit <= 0 || latenciesNs.size() < options.limit)) {
+        bool takeDevice = hasDevice && (!hasScene || deviceTime() <= sceneTime());
+        QDateTime at = takeDevice ? deviceTime() : sceneTime();
+        if (!at.isValid()) {
+            at = lastTime;
+        }
+        lastTime = at;
+
+        // 按倍速等待到该事件在回放时间轴上的位置
+        if (options.speed > 0.0) {
+            qint64 dueMs = qint64(firstTime.msecsTo(at) / options.speed);
+            qint64 waitMs = dueMs - wallClock.elapsed();
+            if (waitMs > 0) {
+                QThread::usleep(quint64(waitMs) * 1000);
+            }
+        }
+
+        energyMeter.setSimulatedTime(at);
+        eventTimer.start();
+        if (takeDevice) {
+            controller.recordDeviceAction(deviceQuery.value(0).toString(), deviceQuery.value(1).toString(),
+                                          deviceQuery.value(2).toString(), at);
+            ++deviceEvents;
+            hasDevice = deviceQuery.next();
+        } else {
+            controller.recordSceneRun(sceneQuery.value(0).toString(), at);
+            ++sceneEvents;
+            hasScene = sceneQuery.next();
+        }
+        latenciesNs.append(eventTimer.nsecsElapsed());
+
+        if (latenciesNs.size() % ProgressInterval == 0) {
+            out << "已回放 " << latenciesNs.size() << " 条，当前事件时间 " << at.toString(TimestampFormat) << "\n";
+            out.flush();
+        }
+    }
+    energyMeter.flush();
+    qint64 elapsedMs = qMax<qint64>(1, wallClock.elapsed());
+    qint64 sizeAfter = QFileInfo(options.targetPath).size();
+
+    std::sort(latenciesNs.begin(), latenciesNs.end());
+    qint64 events = latenciesNs.size();
+    out << "回放事件 " << events << " 条（设备 " << deviceEvents << "，场景 " << sceneEvents
+        << "），规则触发动作 " << ruleActions << " 次\n";
+    out << "时间范围 " << firstTime.toString(TimestampFormat) << " ~ " << lastTime.toString(TimestampFormat) << "\n";
+    out << "耗时 " << QString::number(elapsedMs / 1000.0, 'f', 2) << " 秒，吞吐 "
+        << QString::number(events * 1000.0 / elapsedMs, 'f', 0) << " 条/秒\n";
+    out << "单条处理延迟(微秒) p50=" << QString::number(percentile(latenciesNs, 0.50) / 1000.0, 'f', 1)
+        << " p90=" << QString::number(percentile(latenciesNs, 0.90) / 1000.0, 'f', 1)
+        << " p99=" << QString::number(percentile(latenciesNs, 0.99) / 1000.0, 'f', 1)
+        << " p99.9=" << QString::number(percentile(latenciesNs, 0.999) / 1000.0, 'f', 1)
+        << " max=" << QString::number(latenciesNs.last() / 1000.0, 'f', 1) << "\n";
+    out << "目标数据库 " << sizeBefore << " -> " << sizeAfter << " 字节，每千条事件增长 "
+        << QString::number(double(sizeAfter - sizeBefore) / events, 'f', 3) << " KB\n";
+    out << "行数 device_history=" << countRows("device_history")
+        << " scene_history=" << countRows("scene_history")
+        << " energy_hourly=" << countRows("energy_hourly") << "\n";
+    reportQueries(out);
+    return true;
+}
+
+bool HistoryReplayer::openDatabases()
+{
+    source = QSqlDatabase::addDatabase("QSQLITE", SourceConnection);
+    source.setDatabaseName(options.sourcePath);
+    source.setConnectOptions("QSQLITE_OPEN_READONLY");
+    if (!source.open()) {
+        qCritical() << "无法打开源数据库:" << options.sourcePath << source.lastError().text();
+        return false;
+    }
+
+    target = QSqlDatabase::addDatabase("QSQLITE", TargetConnection);
+    target.setDatabaseName(options.targetPath);
+    if (!target.open()) {
+        qCritical() << "无法创建目标数据库:" << options.targetPath << target.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool HistoryReplayer::copyDevicesAndScenes()
+{
+    QSqlQuery read(source);
+    read.setForwardOnly(true);
+    QSqlQuery write(target);
+
+    target.transaction();
+    if (!read.exec("SELECT device_id, name, type, created_at FROM devices")) {
+        qCritical() << "读取源设备失败:" << read.lastError().text();
+        target.rollback();
+        return false;
+    }
+    write.prepare("INSERT OR IGNORE INTO devices (device_id, name, type, status, created_at) VALUES (?, ?, ?, 'off', ?)");
+    while (read.next()) {
+        for (int i = 0; i < 4; ++i) {
+            write.bindValue(i, read.value(i));
+        }
+        if (!write.exec()) {
+            qCritical() << "复制设备失败:" << write.lastError().text();
+            target.rollback();
+            return false;
+        }
+    }
+
+    if (!read.exec("SELECT scene_id, name, created_at FROM scenes")) {
+        qCritical() << "读取源场景失败:" << read.lastError().text();
+        target.rollback();
+        return false;
+    }
+    write.prepare("INSERT OR IGNORE INTO scenes (scene_id, name, created_at) VALUES (?, ?, ?)");
+    while (read.next()) {
+        for (int i = 0; i < 3; ++i) {
+            write.bindValue(i, read.value(i));
+        }
+        if (!write.exec()) {
+            qCritical() << "复制场景失败:" << write.lastError().text();
+            target.rollback();
+            return false;
+        }
+    }
+    return target.commit();
+}
+
+// 界面上常用的几个查询在回放后的数据量下的耗时
+void HistoryReplayer::reportQueries(QTextStream &out)
+{
+    const QStringList queries = {
+        "SELECT COUNT(*) FROM device_history WHERE device_id = 'LivingroomLight'",
+        "SELECT * FROM device_history ORDER BY timestamp DESC LIMIT 100",
+        "SELECT scene_id, COUNT(*) FROM scene_history GROUP BY scene_id",
+        "SELECT room, SUM(kwh) FROM energy_hourly GROUP BY room"
+    };
+
+    QSqlQuery query(target);
+    query.setForwardOnly(true);
+    QElapsedTimer timer;
+    for (const QString &sql : queries) {
+        timer.start();
+        bool ok = query.exec(sql);
+        while (ok && query.next()) {
+        }
+        out << "查询 " << QString::number(timer.nsecsElapsed() / 1000000.0, 'f', 2) << " 毫秒: " << sql
+            << (ok ? "" : "（失败）") << "\n";
+    }
+}
+
+qint64 HistoryReplayer::countRows(const QString &table)
+{
+    QSqlQuery query(target);
+    if (!query.exec("SELECT COUNT(*) FROM " + table) || !query.next()) {
+        return -1;
+    }
+    return query.value(0).toLongLong();
+}
+
+double HistoryReplayer::percentile(const QVector<qint64> &sorted, double p)
+{
+    if (sorted.isEmpty()) {
+        return 0.0;
+    }
+    int index = qBound(0, int(p * sorted.size()), sorted.size() - 1);
+    return double(sorted.at(index));
+}
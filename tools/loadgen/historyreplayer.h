@@ -0,0 +1,40 @@
+#ifndef HISTORYREPLAYER_H
+#define HISTORYREPLAYER_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QTextStream>
+#include <QVector>
+
+struct ReplayOptions
+{
+    QString sourcePath;
+    QString targetPath;        // 必须是不存在的新文件
+    double speed = 0.0;        // 相对原始时间的倍速，0 表示不等待、尽快回放
+    qint64 limit = 0;          // 最多回放多少条事件，0 表示全部
+};
+
+// 历史回放：按时间顺序把源数据库的设备和场景历史交给控制核心（HomeController），
+// 规则引擎和能耗统计照常工作，写入新的目标数据库；统计吞吐、每条事件的处理延迟和数据库增长
+class HistoryReplayer
+{
+public:
+    explicit HistoryReplayer(const ReplayOptions &options);
+    ~HistoryReplayer();
+
+    bool run(QTextStream &out);
+
+private:
+    bool openDatabases();
+    bool copyDevicesAndScenes();
+    void reportQueries(QTextStream &out);
+    qint64 countRows(const QString &table);
+
+    static double percentile(const QVector<qint64> &sorted, double p);
+
+    ReplayOptions options;
+    QSqlDatabase source;
+    QSqlDatabase target;
+};
+
+#endif // HISTORYREPLAYER_H
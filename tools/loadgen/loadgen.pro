@@ -0,0 +1,53 @@
+QT       += core sql
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = loadgen
+
+# 控制核心与主程序共用，不依赖界面
+INCLUDEPATH += ../..
+
+SOURCES += \
+    main.cpp \
+    historyreplayer.cpp \
+    loadgenerator.cpp \
+    ../../acplanner.cpp \
+    ../../anomalydetector.cpp \
+    ../../devicecatalog.cpp \
+    ../../energymeter.cpp \
+    ../../historyexporter.cpp \
+    ../../homecontroller.cpp \
+    ../../homesnapshot.cpp \
+    ../../metricsregistry.cpp \
+    ../../ruleengine.cpp \
+    ../../sceneanalytics.cpp \
+    ../../scenescheduler.cpp \
+    ../../schedulestore.cpp \
+    ../../sensorstore.cpp \
+    ../../storageworker.cpp \
+    ../../thermalmodel.cpp
+
+HEADERS += \
+    historyreplayer.h \
+    loadgenerator.h \
+    ../../acplanner.h \
+    ../../anomalydetector.h \
+    ../../devicecatalog.h \
+    ../../devicetraits.h \
+    ../../energymeter.h \
+    ../../historyexporter.h \
+    ../../homecontroller.h \
+    ../../homesnapshot.h \
+    ../../metricsregistry.h \
+    ../../ruleengine.h \
+    ../../sceneanalytics.h \
+    ../../scenescheduler.h \
+    ../../schedulestore.h \
+    ../../sensorstore.h \
+    ../../storageworker.h \
+    ../../thermalmodel.h
+
+RESOURCES += \
+    ../../resources.qrc
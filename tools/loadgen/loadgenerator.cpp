@@ -0,0 +1,399 @@
+#include "loadgenerator.h"
+#include "devicecatalog.h"
+#include "devicetraits.h"
+#include "homecontroller.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <utility>
+
+static const char *ConnectionName = "loadgen";
+static const char *TimestampFormat = "yyyy-MM-dd hh:mm:ss";
+static const int BatchRows = 50000;          // 每个事务写入的行数
+static const int MinEventsPerDay = 30;       // 按事件数生成时用来估算天数
+
+static const struct { const char *id; const char *name; } Scenes[] = {
+    {"comingHomeMode", "回家模式"},
+    {"leavingHomeMode", "离家模式"},
+    {"SleepMode", "睡眠模式"},
+    {"WakeUpMode", "起床模式"}
+};
+
+// 晚上会被随手开关的灯
+static const char *EveningLights[] = {"StudyroomLight", "BalconyLight", "DiningroomLight", "BathroomLight"};
+
+LoadGenerator::LoadGenerator(const LoadGenOptions &options)
+    : options(options)
+    , random(options.seed)
+{
+}
+
+LoadGenerator::~LoadGenerator()
+{
+    if (db.isOpen()) {
+        db.close();
+    }
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(ConnectionName);
+}
+
+bool LoadGenerator::run(QTextStream &out)
+{
+    qint64 sizeBefore = QFileInfo(options.dbPath).size();
+    if (!openDatabase() || !seedDevicesAndScenes()) {
+        return false;
+    }
+
+    QDate today = QDate::currentDate();
+    int days = options.days;
+    if (options.targetEvents > 0) {
+        days = int(options.targetEvents / MinEventsPerDay) + 1;
+    }
+    QDate start = today.addDays(-days);
+    out << "生成 " << (options.targetEvents > 0 ? QString("%1 条事件").arg(options.targetEvents)
+                                                 : QString("%1 天").arg(days))
+        << "，起始日期 " << start.toString(Qt::ISODate) << "，随机种子 " << options.seed << "\n";
+    out.flush();
+
+    QElapsedTimer timer;
+    timer.start();
+    for (QDate date = start; date < today; date = date.addDays(1)) {
+        generateDay(date);
+        appendDay();
+        if (historyTimes.size() + sceneTimes.size() >= BatchRows && !flushBatch()) {
+            return false;
+        }
+        if (options.targetEvents > 0 && deviceRows + sceneRows + historyTimes.size() + sceneTimes.size()
+                                            >= options.targetEvents) {
+            break;
+        }
+    }
+    if (!flushBatch() || !writeFinalStatus()) {
+        return false;
+    }
+    qint64 elapsedMs = qMax<qint64>(1, timer.elapsed());
+
+    db.close();
+    qint64 sizeAfter = QFileInfo(options.dbPath).size();
+    qint64 rows = deviceRows + sceneRows;
+    out << "写入 device_history " << deviceRows << " 行，scene_history " << sceneRows << " 行\n";
+    out << "耗时 " << QString::number(elapsedMs / 1000.0, 'f', 2) << " 秒，"
+        << QString::number(rows * 1000.0 / elapsedMs, 'f', 0) << " 行/秒\n";
+    out << "数据库大小 " << sizeBefore << " -> " << sizeAfter << " 字节";
+    if (rows > 0) {
+        out << "，平均每行 " << QString::number(double(sizeAfter - sizeBefore) / rows, 'f', 1) << " 字节";
+    }
+    out << "\n";
+    return true;
+}
+
+bool LoadGenerator::openDatabase()
+{
+    db = QSqlDatabase::addDatabase("QSQLITE", ConnectionName);
+    db.setDatabaseName(options.dbPath);
+    if (!db.open()) {
+        qCritical() << "无法打开数据库:" << options.dbPath << db.lastError().text();
+        return false;
+    }
+    // 只对本连接生效：生成的数据可以重新生成，不需要每次提交都落盘
+    QSqlQuery query(db);
+    query.exec("PRAGMA synchronous = OFF");
+
+    HomeController controller;
+    controller.setDatabase(db);
+    return controller.ensureSchema();
+}
+
+bool LoadGenerator::seedDevicesAndScenes()
+{
+    QString now = QDateTime::currentDateTime().toString(TimestampFormat);
+    QVariantList ids, names, types, statuses, createdAt;
+    // 设备与主程序使用同一个设备目录
+    for (const DeviceInfo &device : DeviceCatalog::instance().devices()) {
+        ids << device.id;
+        names << device.name;
+        types << device.type;
+        statuses << device.defaultStatus;
+        createdAt << now;
+        deviceTypes.insert(device.id, device.type);
+        deviceOn.insert(device.id, false);
+    }
+
+    QSqlQuery query(db);
+    query.prepare("INSERT OR IGNORE INTO devices (device_id, name, type, status, created_at) VALUES (?, ?, ?, ?, ?)");
+    query.addBindValue(ids);
+    query.addBindValue(names);
+    query.addBindValue(types);
+    query.addBindValue(statuses);
+    query.addBindValue(createdAt);
+    if (!query.execBatch()) {
+        qCritical() << "写入设备失败:" << query.lastError().text();
+        return false;
+    }
+
+    QVariantList sceneIdList, sceneNames, sceneCreatedAt;
+    for (const auto &scene : Scenes) {
+        sceneIdList << scene.id;
+        sceneNames << QString::fromUtf8(scene.name);
+        sceneCreatedAt << now;
+    }
+    query.prepare("INSERT OR IGNORE INTO scenes (scene_id, name, created_at) VALUES (?, ?, ?)");
+    query.addBindValue(sceneIdList);
+    query.addBindValue(sceneNames);
+    query.addBindValue(sceneCreatedAt);
+    if (!query.execBatch()) {
+        qCritical() << "写入场景失败:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+void LoadGenerator::generateDay(const QDate &date)
+{
+    dayEvents.clear();
+    bool weekend = date.dayOfWeek() >= 6;
+    int month = date.month();
+    bool acSeason = (month >= 6 && month <= 9) || month == 12 || month <= 2;
+
+    // 起床：拉开卧室窗帘，关卧室空调；天还没亮时开一会儿卧室灯
+    QDateTime wake = jittered(date, weekend ? QTime(8, 30) : QTime(6, 50), 20);
+    addScene(wake, "WakeUpMode");
+    addAction(wake, "BedroomCurtain", "turn_on", On);
+    addAction(wake, "BedroomAc", "turn_off", Off);
+    if (wake.time().hour() < 7) {
+        addAction(wake, "BedroomLight", "turn_on", On);
+        addAction(wake.addSecs(60 * uniform(15, 35)), "BedroomLight", "toggle", Off);
+    }
+
+    // 洗漱和早餐
+    QDateTime bath = wake.addSecs(60 * uniform(3, 15));
+    addAction(bath, "BathroomLight", "toggle", On);
+    addAction(bath.addSecs(60 * uniform(8, 25)), "BathroomLight", "toggle", Off);
+    QDateTime breakfast = wake.addSecs(60 * uniform(20, 40));
+    addAction(breakfast, "KitchenLight", "toggle", On);
+    addAction(breakfast.addSecs(60 * uniform(5, 15)), "DiningroomLight", "toggle", On);
+    addAction(breakfast.addSecs(60 * uniform(30, 45)), "KitchenLight", "toggle", Off);
+    addAction(breakfast.addSecs(60 * uniform(30, 50)), "DiningroomLight", "toggle", Off);
+
+    // 出门和回家：工作日都出门，周末六成概率
+    bool goesOut = !weekend || chance(0.6);
+    if (goesOut) {
+        QDateTime leave = weekend ? jittered(date, QTime(14, 0), 90) : wake.addSecs(60 * uniform(60, 95));
+        addScene(leave, "leavingHomeMode");
+        for (const DeviceInfo &device : DeviceCatalog::instance().devices()) {
+            const QString &type = device.type;
+            if (type == "light" || type == "air_conditioner") {
+                addAction(leave, device.id, "turn_off", Off);
+            } else if (type == "curtain") {
+                addAction(leave, device.id, "turn_on", On);
+            }
+        }
+        addAction(leave, "Lock", "lock", On);
+
+        QDateTime arrive = weekend ? leave.addSecs(60 * uniform(120, 300)) : jittered(date, QTime(18, 30), 40);
+        addScene(arrive, "comingHomeMode");
+        addAction(arrive, "Lock", "unlock", Off);
+        addAction(arrive, "LivingroomLight", "turn_on", On);
+        addAction(arrive, "LivingroomCurtain", "turn_off", Off);
+        addAction(arrive, "BedroomCurtain", "turn_off", Off);
+        if (acSeason) {
+            addAction(arrive, "LivingroomAc", "turn_on", On);
+        }
+    } else {
+        // 在家的白天：客厅灯和空调随手开关
+        addAction(jittered(date, QTime(13, 0), 60), "LivingroomLight", "toggle", On);
+        addAction(jittered(date, QTime(17, 0), 60), "LivingroomLight", "toggle", Off);
+        if (acSeason) {
+            addAction(jittered(date, QTime(12, 0), 60), "LivingroomAc", "toggle", On);
+        }
+    }
+
+    // 晚饭和晚上的随手开关
+    QDateTime dinner = jittered(date, QTime(19, 0), 30);
+    addAction(dinner, "KitchenLight", "toggle", On);
+    addAction(dinner.addSecs(60 * uniform(30, 60)), "KitchenLight", "toggle", Off);
+    for (const char *light : EveningLights) {
+        int count = uniform(0, 2);
+        for (int i = 0; i < count; ++i) {
+            QDateTime on = jittered(date, QTime(20, 30), 60);
+            addAction(on, light, "toggle", On);
+            addAction(on.addSecs(60 * uniform(5, 60)), light, "toggle", Off);
+        }
+    }
+
+    // 突发：同一盏灯被连续快速开关（小孩玩开关、自动化脚本抖动）
+    if (chance(options.burstRate)) {
+        const QVector<DeviceInfo> lights = DeviceCatalog::instance().devicesOfType("light");
+        const QString light = lights.at(uniform(0, lights.size() - 1)).id;
+        QDateTime t = jittered(date, QTime(20, 0), 90);
+        int toggles = uniform(6, 40);
+        for (int i = 0; i < toggles; ++i) {
+            t = t.addMSecs(uniform(300, 5000));
+            addAction(t, light, "toggle", Toggle);
+        }
+    }
+
+    // 睡觉：关掉其他房间，卧室灯亮一会儿，空调季开卧室空调
+    QDateTime sleep = jittered(date, weekend ? QTime(23, 40) : QTime(23, 0), 30);
+    addScene(sleep, "SleepMode");
+    for (const DeviceInfo &device : DeviceCatalog::instance().devices()) {
+        if (device.type == "light" && device.id != "BedroomLight") {
+            addAction(sleep, device.id, "turn_off", Off);
+        }
+    }
+    addAction(sleep, "LivingroomAc", "turn_off", Off);
+    addAction(sleep, "LivingroomCurtain", "turn_off", Off);
+    addAction(sleep, "BedroomCurtain", "turn_off", Off);
+    addAction(sleep, "BedroomLight", "turn_on", On);
+    addAction(sleep.addSecs(60 * uniform(10, 40)), "BedroomLight", "toggle", Off);
+    if (acSeason) {
+        addAction(sleep, "BedroomAc", "turn_on", On);
+    }
+}
+
+// 按时间排序后逐条应用：状态没有变化的操作丢弃，Toggle 取当时状态的反
+void LoadGenerator::appendDay()
+{
+    std::stable_sort(dayEvents.begin(), dayEvents.end(), [](const Event &a, const Event &b) {
+        return a.time < b.time;
+    });
+
+    for (const Event &event : qAsConst(dayEvents)) {
+        if (!event.sceneId.isEmpty()) {
+            sceneIds << event.sceneId;
+            sceneTimes << event.time.toString(TimestampFormat);
+            continue;
+        }
+
+        bool &on = deviceOn[event.deviceId];
+        bool newOn = (event.target == Toggle) ? !on : (event.target == On);
+        if (newOn == on) {
+            continue;
+        }
+        on = newOn;
+
+        historyDevices << event.deviceId;
+        historyTypes << event.actionType;
+        historyValues << valueFor(deviceTypes.value(event.deviceId), newOn);
+        // device_history 与主程序一样使用 UTC
+        historyTimes << event.time.toUTC().toString(TimestampFormat);
+    }
+}
+
+bool LoadGenerator::flushBatch()
+{
+    if (historyTimes.isEmpty() && sceneTimes.isEmpty()) {
+        return true;
+    }
+
+    db.transaction();
+    QSqlQuery query(db);
+    if (!historyTimes.isEmpty()) {
+        // 与主程序使用同一条语句，序号接在已有记录之后
+        query.prepare(HomeController::InsertHistorySql);
+        query.addBindValue(historyDevices);
+        query.addBindValue(historyTypes);
+        query.addBindValue(historyValues);
+        query.addBindValue(historyTimes);
+        if (!query.execBatch()) {
+            qCritical() << "写入设备历史失败:" << query.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+    if (!sceneTimes.isEmpty()) {
+        query.prepare("INSERT INTO scene_history (scene_id, timestamp) VALUES (?, ?)");
+        query.addBindValue(sceneIds);
+        query.addBindValue(sceneTimes);
+        if (!query.execBatch()) {
+            qCritical() << "写入场景历史失败:" << query.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+    if (!db.commit()) {
+        qCritical() << "提交事务失败:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+
+    deviceRows += historyTimes.size();
+    sceneRows += sceneTimes.size();
+    historyDevices.clear();
+    historyTypes.clear();
+    historyValues.clear();
+    historyTimes.clear();
+    sceneIds.clear();
+    sceneTimes.clear();
+    return true;
+}
+
+// devices.status 与最后一条历史保持一致
+bool LoadGenerator::writeFinalStatus()
+{
+    QVariantList statuses, ids;
+    for (auto it = deviceOn.constBegin(); it != deviceOn.constEnd(); ++it) {
+        statuses << valueFor(deviceTypes.value(it.key()), it.value());
+        ids << it.key();
+    }
+    QSqlQuery query(db);
+    query.prepare("UPDATE devices SET status = ? WHERE device_id = ?");
+    query.addBindValue(statuses);
+    query.addBindValue(ids);
+    if (!query.execBatch()) {
+        qCritical() << "更新设备状态失败:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+void LoadGenerator::addScene(const QDateTime &time, const QString &sceneId)
+{
+    Event event;
+    event.time = time;
+    event.sceneId = sceneId;
+    dayEvents.append(event);
+}
+
+void LoadGenerator::addAction(const QDateTime &time, const QString &deviceId, const QString &actionType, Target target)
+{
+    Event event;
+    event.time = time;
+    event.deviceId = deviceId;
+    event.actionType = actionType;
+    event.target = target;
+    dayEvents.append(event);
+}
+
+// 以 mean 为中心、标准差 sdMinutes 的正态分布时间，截断在 ±3 个标准差内
+QDateTime LoadGenerator::jittered(const QDate &date, const QTime &mean, int sdMinutes)
+{
+    std::normal_distribution<double> distribution(0.0, sdMinutes * 60.0);
+    double offset = qBound(-3.0 * sdMinutes * 60.0, distribution(random), 3.0 * sdMinutes * 60.0);
+    return QDateTime(date, mean).addSecs(qint64(std::lround(offset)));
+}
+
+int LoadGenerator::uniform(int low, int high)
+{
+    return random.bounded(low, high + 1);
+}
+
+bool LoadGenerator::chance(double probability)
+{
+    return random.generateDouble() < probability;
+}
+
+// 状态值取自设备类型表，与主程序写入的值相同；未知类型按开关值写入
+QString LoadGenerator::valueFor(const QString &type, bool on)
+{
+    DeviceKind kind = DeviceKind::Light;
+    deviceKindFromType(type, &kind);
+    const DeviceTypeTraits &traits = deviceTraits(kind);
+    return QString::fromLatin1(on ? traits.onValue : traits.offValue);
+}
@@ -0,0 +1,75 @@
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QRandomGenerator>
+#include <QSqlDatabase>
+#include <QString>
+#include <QTextStream>
+#include <QVariantList>
+#include <QVector>
+
+struct LoadGenOptions
+{
+    QString dbPath;
+    int days = 365;            // 生成多少天的历史（截止到昨天）
+    qint64 targetEvents = 0;   // 大于0时按事件数生成，忽略 days
+    quint32 seed = 1;
+    double burstRate = 0.05;   // 每天出现一次连续快速开关的概率
+};
+
+// 合成负载：按作息生成起床、离家、回家、睡眠场景及其设备操作，
+// 加上随机的手动开关和突发的连续开关，批量写入 device_history / scene_history
+class LoadGenerator
+{
+public:
+    explicit LoadGenerator(const LoadGenOptions &options);
+    ~LoadGenerator();
+
+    bool run(QTextStream &out);
+
+private:
+    // 设备操作的目标状态；Toggle 在排序后按当时的状态取反
+    enum Target { Off = 0, On = 1, Toggle = 2 };
+
+    struct Event {
+        QDateTime time;
+        QString sceneId;      // 非空表示场景事件
+        QString deviceId;
+        QString actionType;
+        Target target = Off;
+    };
+
+    bool openDatabase();
+    bool seedDevicesAndScenes();
+    void generateDay(const QDate &date);
+    void appendDay();
+    bool flushBatch();
+    bool writeFinalStatus();
+
+    void addScene(const QDateTime &time, const QString &sceneId);
+    void addAction(const QDateTime &time, const QString &deviceId, const QString &actionType, Target target);
+    QDateTime jittered(const QDate &date, const QTime &mean, int sdMinutes);
+    int uniform(int low, int high);
+    bool chance(double probability);
+
+    static QString valueFor(const QString &type, bool on);
+
+    LoadGenOptions options;
+    QRandomGenerator random;
+    QSqlDatabase db;
+
+    QHash<QString, QString> deviceTypes;   // 设备ID -> 类型
+    QHash<QString, bool> deviceOn;         // 设备ID -> 生成过程中的当前状态
+    QVector<Event> dayEvents;
+
+    // 等待批量写入的列
+    QVariantList historyDevices, historyTypes, historyValues, historyTimes;
+    QVariantList sceneIds, sceneTimes;
+
+    qint64 deviceRows = 0;
+    qint64 sceneRows = 0;
+};
+
+#endif // LOADGENERATOR_H
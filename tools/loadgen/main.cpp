@@ -0,0 +1,137 @@
+#include "historyexporter.h"
+#include "historyreplayer.h"
+#include "loadgenerator.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QLoggingCategory>
+#include <QTextStream>
+#include <QThread>
+
+// 用法示例：
+//   loadgen generate --db load.db --days 3650 --seed 7 --burst-rate 0.1
+//   loadgen generate --db load.db --events 5000000
+//   loadgen replay --db load.db --out replay.db --speed 0
+//   loadgen replay --db load.db --out replay.db --speed 3600 --limit 100000
+//   loadgen export --db finalprojectDB.db --out history.csv
+//   loadgen export --db load.db --out history.shc --format columnar --table device_history \
+//                  --from 2024-01-01T00:00:00 --to 2024-02-01T00:00:00 --ids LivingroomLight,BedroomLight
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    // 与主程序相同，回放时读取用户自定义的规则文件
+    QCoreApplication::setOrganizationName("QtLab");
+    QCoreApplication::setApplicationName("QtSmartHome");
+    // 控制核心每条事件都会打印调试信息，压测时关闭
+    QLoggingCategory::setFilterRules("default.debug=false");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("智能家居合成负载生成、历史回放和历史导出工具");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "generate：生成合成历史；replay：回放已有历史；export：导出历史");
+
+    QCommandLineOption dbOption("db", "数据库文件（generate 写入，replay 和 export 读取）", "file");
+    QCommandLineOption daysOption("days", "生成多少天的历史", "days", "365");
+    QCommandLineOption eventsOption("events", "按事件总数生成，优先于 --days", "count", "0");
+    QCommandLineOption seedOption("seed", "随机种子", "seed", "1");
+    QCommandLineOption burstRateOption("burst-rate", "每天出现连续快速开关的概率(0~1)", "rate", "0.05");
+    QCommandLineOption outOption("out", "回放写入的新数据库文件，或导出文件", "file");
+    QCommandLineOption speedOption("speed", "回放倍速，0 表示尽快回放", "factor", "0");
+    QCommandLineOption limitOption("limit", "最多回放多少条事件，0 表示全部", "count", "0");
+    QCommandLineOption tableOption("table", "导出的表：device_history 或 scene_history", "table", "device_history");
+    QCommandLineOption formatOption("format", "导出格式：csv 或 columnar", "format", "csv");
+    QCommandLineOption fromOption("from", "只导出此时间（本地时间，ISO 格式）之后的记录", "time");
+    QCommandLineOption toOption("to", "只导出此时间之前的记录", "time");
+    QCommandLineOption idsOption("ids", "只导出这些设备或场景，逗号分隔", "ids");
+    parser.addOptions({dbOption, daysOption, eventsOption, seedOption, burstRateOption,
+                       outOption, speedOption, limitOption, tableOption, formatOption,
+                       fromOption, toOption, idsOption});
+    parser.process(a);
+
+    QTextStream out(stdout);
+    const QStringList args = parser.positionalArguments();
+    QString command = args.value(0);
+    if (!parser.isSet(dbOption)) {
+        qCritical() << "缺少 --db 参数";
+        parser.showHelp(1);
+    }
+
+    if (command == "generate") {
+        LoadGenOptions options;
+        options.dbPath = parser.value(dbOption);
+        options.days = qMax(1, parser.value(daysOption).toInt());
+        options.targetEvents = parser.value(eventsOption).toLongLong();
+        options.seed = parser.value(seedOption).toUInt();
+        options.burstRate = qBound(0.0, parser.value(burstRateOption).toDouble(), 1.0);
+
+        LoadGenerator generator(options);
+        return generator.run(out) ? 0 : 1;
+    }
+
+    if (command == "replay") {
+        if (!parser.isSet(outOption)) {
+            qCritical() << "回放需要 --out 参数";
+            parser.showHelp(1);
+        }
+        ReplayOptions options;
+        options.sourcePath = parser.value(dbOption);
+        options.targetPath = parser.value(outOption);
+        options.speed = qMax(0.0, parser.value(speedOption).toDouble());
+        options.limit = parser.value(limitOption).toLongLong();
+
+        HistoryReplayer replayer(options);
+        return replayer.run(out) ? 0 : 1;
+    }
+
+    if (command == "export") {
+        HistoryExportOptions options;
+        options.dbPath = parser.value(dbOption);
+        options.outputPath = parser.value(outOption);
+        if (options.outputPath.isEmpty()
+            || !HistoryExporter::parseTable(parser.value(tableOption), &options.table)
+            || !HistoryExporter::parseFormat(parser.value(formatOption), &options.format)) {
+            qCritical() << "导出需要 --out，--table 和 --format 的取值见帮助";
+            parser.showHelp(1);
+        }
+        if (parser.isSet(fromOption)) {
+            options.from = QDateTime::fromString(parser.value(fromOption), Qt::ISODate);
+        }
+        if (parser.isSet(toOption)) {
+            options.to = QDateTime::fromString(parser.value(toOption), Qt::ISODate);
+        }
+        if ((parser.isSet(fromOption) && !options.from.isValid()) || (parser.isSet(toOption) && !options.to.isValid())) {
+            qCritical() << "--from 和 --to 需要 ISO 格式的时间，例如 2024-01-01T00:00:00";
+            return 1;
+        }
+        if (parser.isSet(idsOption)) {
+            options.ids = parser.value(idsOption).split(',', Qt::SkipEmptyParts);
+        }
+
+        // 导出在工作线程中进行，主线程只打印进度
+        QThread thread;
+        HistoryExporter *exporter = new HistoryExporter(options);
+        exporter->moveToThread(&thread);
+        QObject::connect(&thread, &QThread::started, exporter, &HistoryExporter::run);
+        QObject::connect(&thread, &QThread::finished, exporter, &QObject::deleteLater);
+        QObject::connect(exporter, &HistoryExporter::progress, &a, [&out](qint64 rows, int percent) {
+            out << "已导出 " << rows << " 行 (" << percent << "%)\n";
+            out.flush();
+        });
+        int exitCode = 1;
+        QObject::connect(exporter, &HistoryExporter::finished, &a,
+                         [&](bool ok, qint64 rows, const QString &errorMessage) {
+            out << (ok ? QString("导出完成，共 %1 行\n").arg(rows) : "导出失败: " + errorMessage + "\n");
+            exitCode = ok ? 0 : 1;
+            thread.quit();
+        });
+        QObject::connect(&thread, &QThread::finished, &a, &QCoreApplication::quit);
+        thread.start();
+        a.exec();
+        thread.wait();
+        return exitCode;
+    }
+
+    qCritical() << "未知命令:" << command;
+    parser.showHelp(1);
+}
@@ -0,0 +1,49 @@
+#include "mockweatherserver.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+
+// 用法示例：
+//   mockweatherserver --port 8088 --latency 200 --jitter 100 --error-rate 0.2 --error-mode http --error-status 503
+// 然后以 SMARTHOME_WEATHER_URL=http://127.0.0.1:8088 启动主程序
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("mockweatherserver");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("本地和风天气模拟服务器");
+    parser.addHelpOption();
+
+    QCommandLineOption portOption("port", "监听端口", "port", "8088");
+    QCommandLineOption fixturesOption("fixtures", "夹具目录", "dir", QString(SOURCE_DIR) + "/fixtures");
+    QCommandLineOption latencyOption("latency", "固定延迟(毫秒)", "ms", "0");
+    QCommandLineOption jitterOption("jitter", "随机附加延迟上限(毫秒)", "ms", "0");
+    QCommandLineOption errorRateOption("error-rate", "故障概率(0~1)", "rate", "0");
+    QCommandLineOption errorModeOption("error-mode", "故障类型: http | drop | api", "mode", "http");
+    QCommandLineOption errorStatusOption("error-status", "HTTP错误码或API错误码", "code", "500");
+    parser.addOptions({portOption, fixturesOption, latencyOption, jitterOption,
+                       errorRateOption, errorModeOption, errorStatusOption});
+    parser.process(a);
+
+    MockWeatherServer server;
+    server.setFixturesDir(parser.value(fixturesOption));
+    server.setLatency(parser.value(latencyOption).toInt(), parser.value(jitterOption).toInt());
+    server.setErrorRate(parser.value(errorRateOption).toDouble());
+
+    QString mode = parser.value(errorModeOption);
+    int errorStatus = parser.value(errorStatusOption).toInt();
+    if (mode == "drop") {
+        server.setErrorMode(MockWeatherServer::DropConnection, errorStatus);
+    } else if (mode == "api") {
+        server.setErrorMode(MockWeatherServer::ApiError, errorStatus);
+    } else {
+        server.setErrorMode(MockWeatherServer::HttpError, errorStatus);
+    }
+
+    if (!server.listen(quint16(parser.value(portOption).toUInt()))) {
+        return 1;
+    }
+    return a.exec();
+}
@@ -0,0 +1,201 @@
+#include "mockweatherserver.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
+#include <QPointer>
+#include <QRandomGenerator>
+#include <QTcpSocket>
+#include <QTimer>
+
+MockWeatherServer::MockWeatherServer(QObject *parent)
+    : QObject(parent)
+    , latency(0)
+    , latencyJitter(0)
+    , errorRate(0.0)
+    , errorMode(HttpError)
+    , errorHttpStatus(500)
+    , served(0)
+    , failed(0)
+{
+    connect(&server, &QTcpServer::newConnection, this, &MockWeatherServer::onNewConnection);
+}
+
+void MockWeatherServer::setFixturesDir(const QString &dir)
+{
+    fixturesDir = dir;
+    fixtureCache.clear();
+}
+
+void MockWeatherServer::setLatency(int latencyMs, int jitterMs)
+{
+    latency = qMax(0, latencyMs);
+    latencyJitter = qMax(0, jitterMs);
+}
+
+void MockWeatherServer::setErrorRate(double rate)
+{
+    errorRate = qBound(0.0, rate, 1.0);
+}
+
+void MockWeatherServer::setErrorMode(ErrorMode mode, int httpStatus)
+{
+    errorMode = mode;
+    errorHttpStatus = httpStatus;
+}
+
+bool MockWeatherServer::listen(quint16 port)
+{
+    // 只监听本机地址
+    if (!server.listen(QHostAddress::LocalHost, port)) {
+        qCritical() << "模拟服务器监听失败:" << server.errorString();
+        return false;
+    }
+    qDebug() << "模拟天气服务器已启动: http://127.0.0.1:" << server.serverPort();
+    return true;
+}
+
+quint16 MockWeatherServer::port() const
+{
+    return server.serverPort();
+}
+
+qint64 MockWeatherServer::servedCount() const
+{
+    return served;
+}
+
+qint64 MockWeatherServer::failedCount() const
+{
+    return failed;
+}
+
+void MockWeatherServer::onNewConnection()
+{
+    while (QTcpSocket *socket = server.nextPendingConnection()) {
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            handleRequest(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            pendingRequests.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void MockWeatherServer::handleRequest(QTcpSocket *socket)
+{
+    QByteArray &buffer = pendingRequests[socket];
+    buffer.append(socket->readAll());
+
+    // 请求头未读完，等待更多数据
+    int headerEnd = buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        return;
+    }
+
+    QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+    pendingRequests.remove(socket);
+
+    // 请求行：GET /v7/weather/now?location=xxx HTTP/1.1
+    QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+    QByteArray target = requestLine.value(1);
+    QByteArray path = target.left(target.indexOf('?') < 0 ? target.size() : target.indexOf('?'));
+
+    QByteArray ifNoneMatch;
+    for (int i = 1; i < lines.size(); ++i) {
+        QByteArray line = lines.at(i).trimmed();
+        if (line.toLower().startsWith("if-none-match:")) {
+            ifNoneMatch = line.mid(int(qstrlen("if-none-match:"))).trimmed();
+        }
+    }
+
+    int delay = latency;
+    if (latencyJitter > 0) {
+        delay += QRandomGenerator::global()->bounded(latencyJitter + 1);
+    }
+
+    // 连接可能在延迟期间被客户端关闭
+    QPointer<QTcpSocket> guard(socket);
+    QTimer::singleShot(delay, this, [this, guard, path, ifNoneMatch]() {
+        if (guard) {
+            respond(guard, path, ifNoneMatch);
+        }
+    });
+}
+
+void MockWeatherServer::respond(QTcpSocket *socket, const QByteArray &path, const QByteArray &ifNoneMatch)
+{
+    // 按配置的概率注入故障
+    if (errorRate > 0.0 && QRandomGenerator::global()->generateDouble() < errorRate) {
+        failed++;
+        switch (errorMode) {
+        case DropConnection:
+            qDebug() << "注入故障：断开连接" << path;
+            socket->abort();
+            return;
+        case ApiError:
+            qDebug() << "注入故障：API错误码" << errorHttpStatus << path;
+            writeResponse(socket, 200, "OK", QString("{\"code\":\"%1\"}").arg(errorHttpStatus).toUtf8());
+            return;
+        case HttpError:
+            qDebug() << "注入故障：HTTP" << errorHttpStatus << path;
+            writeResponse(socket, errorHttpStatus, "Injected Error", QByteArray());
+            return;
+        }
+    }
+
+    QByteArray body = loadFixture(path);
+    if (body.isEmpty()) {
+        failed++;
+        writeResponse(socket, 404, "Not Found", "{\"code\":\"404\"}");
+        return;
+    }
+
+    served++;
+    QByteArray etag = '"' + QCryptographicHash::hash(body, QCryptographicHash::Md5).toHex() + '"';
+    if (!ifNoneMatch.isEmpty() && ifNoneMatch == etag) {
+        writeResponse(socket, 304, "Not Modified", QByteArray(), etag);
+        return;
+    }
+    writeResponse(socket, 200, "OK", body, etag);
+}
+
+void MockWeatherServer::writeResponse(QTcpSocket *socket, int status, const QByteArray &reason,
+                                      const QByteArray &body, const QByteArray &etag)
+{
+    QByteArray response = "HTTP/1.1 " + QByteArray::number(status) + ' ' + reason + "\r\n";
+    response += "Content-Type: application/json; charset=utf-8\r\n";
+    response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    if (!etag.isEmpty()) {
+        response += "ETag: " + etag + "\r\n";
+    }
+    response += "Connection: close\r\n\r\n";
+    response += body;
+
+    socket->write(response);
+    socket->disconnectFromHost();
+}
+
+// 路径 /v7/weather/now 对应夹具文件 weather_now.json
+QByteArray MockWeatherServer::loadFixture(const QByteArray &path)
+{
+    auto it = fixtureCache.constFind(path);
+    if (it != fixtureCache.constEnd()) {
+        return it.value();
+    }
+
+    QByteArray name = path;
+    if (name.startsWith("/v7/")) {
+        name = name.mid(4);
+    }
+    name.replace('/', '_');
+
+    QFile file(fixturesDir + '/' + QString::fromUtf8(name) + ".json");
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "找不到夹具文件:" << file.fileName();
+        return QByteArray();
+    }
+    QByteArray body = file.readAll();
+    fixtureCache.insert(path, body);
+    return body;
+}
@@ -0,0 +1,62 @@
+#ifndef MOCKWEATHERSERVER_H
+#define MOCKWEATHERSERVER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QTcpServer>
+
+class QTcpSocket;
+
+// 本地天气模拟服务器：按请求路径返回录制好的和风天气响应，
+// 可配置延迟和故障，用于离线测试和压测天气请求的处理流程
+class MockWeatherServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 故障类型：HTTP错误码、直接断开连接、返回API错误码（HTTP 200 但 code != "200"）
+    enum ErrorMode {
+        HttpError,
+        DropConnection,
+        ApiError
+    };
+
+    explicit MockWeatherServer(QObject *parent = nullptr);
+
+    void setFixturesDir(const QString &dir);
+    void setLatency(int latencyMs, int jitterMs);
+    void setErrorRate(double rate);
+    void setErrorMode(ErrorMode mode, int httpStatus = 500);
+
+    bool listen(quint16 port);
+    quint16 port() const;
+
+    qint64 servedCount() const;
+    qint64 failedCount() const;
+
+private slots:
+    void onNewConnection();
+
+private:
+    void handleRequest(QTcpSocket *socket);
+    void respond(QTcpSocket *socket, const QByteArray &path, const QByteArray &ifNoneMatch);
+    void writeResponse(QTcpSocket *socket, int status, const QByteArray &reason,
+                       const QByteArray &body, const QByteArray &etag = QByteArray());
+    QByteArray loadFixture(const QByteArray &path);
+
+    QTcpServer server;
+    QString fixturesDir;
+    QHash<QByteArray, QByteArray> fixtureCache;  // 路径 -> 响应体
+    QHash<QTcpSocket*, QByteArray> pendingRequests;  // 尚未读完请求头的连接
+    int latency;
+    int latencyJitter;
+    double errorRate;
+    ErrorMode errorMode;
+    int errorHttpStatus;
+    qint64 served;
+    qint64 failed;
+};
+
+#endif // MOCKWEATHERSERVER_H
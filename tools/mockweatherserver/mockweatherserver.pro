@@ -0,0 +1,17 @@
+QT       += core network
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = mockweatherserver
+
+# 默认夹具目录为源码目录下的 fixtures
+DEFINES += SOURCE_DIR=\\\"$$PWD\\\"
+
+SOURCES += \
+    main.cpp \
+    mockweatherserver.cpp
+
+HEADERS += \
+    mockweatherserver.h
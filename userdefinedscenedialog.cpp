@@ -1,4 +1,5 @@
 #include "userdefinedscenedialog.h"
+#include "devicecatalog.h"
 #include <QDebug>
 
 UserDefinedSceneDialog::UserDefinedSceneDialog(QWidget *parent)
@@ -37,37 +38,20 @@ void UserDefinedSceneDialog::initUI()
     devicesLayout = new QVBoxLayout();
     mainLayout->addLayout(devicesLayout);
 
-    // 添加灯光设备
-    QLabel *lightLabel = new QLabel("灯光设备:", this);
-    lightLabel->setStyleSheet("font-weight: bold;");
-    devicesLayout->addWidget(lightLabel);
-    addDeviceComboBox("客厅灯", "LivingroomLight");
-    addDeviceComboBox("厨房灯", "KitchenLight");
-    addDeviceComboBox("卧室灯", "BedroomLight");
-    addDeviceComboBox("浴室灯", "BathroomLight");
-    addDeviceComboBox("书房灯", "StudyroomLight");
-    addDeviceComboBox("阳台灯", "BalconyLight");
-    addDeviceComboBox("餐厅灯", "DiningroomLight");
-
-    // 添加窗帘设备
-    QLabel *curtainLabel = new QLabel("窗帘设备:", this);
-    curtainLabel->setStyleSheet("font-weight: bold;");
-    devicesLayout->addWidget(curtainLabel);
-    addDeviceComboBox("客厅窗帘", "LivingroomCurtain");
-    addDeviceComboBox("卧室窗帘", "BedroomCurtain");
-
-    // 添加空调设备
-    QLabel *acLabel = new QLabel("空调设备:", this);
-    acLabel->setStyleSheet("font-weight: bold;");
-    devicesLayout->addWidget(acLabel);
-    addDeviceComboBox("客厅空调", "LivingroomAc");
-    addDeviceComboBox("卧室空调", "BedroomAc");
-
-    // 添加门锁设备
-    QLabel *lockLabel = new QLabel("门锁设备:", this);
-    lockLabel->setStyleSheet("font-weight: bold;");
-    devicesLayout->addWidget(lockLabel);
-    addDeviceComboBox("门锁", "Lock");
+    // 按设备目录中的类型分组添加设备
+    const DeviceCatalog &catalog = DeviceCatalog::instance();
+    for (const DeviceTypeInfo &type : catalog.types()) {
+        const QVector<DeviceInfo> devices = catalog.devicesOfType(type.id);
+        if (devices.isEmpty()) {
+            continue;
+        }
+        QLabel *typeLabel = new QLabel(type.label + ":", this);
+        typeLabel->setStyleSheet("font-weight: bold;");
+        devicesLayout->addWidget(typeLabel);
+        for (const DeviceInfo &device : devices) {
+            addDeviceComboBox(device.name, device.id);
+        }
+    }
 
     // 按钮区域
     QHBoxLayout *buttonLayout = new QHBoxLayout();
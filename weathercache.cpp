@@ -0,0 +1,144 @@
+#include "weathercache.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QSaveFile>
+
+WeatherCache::WeatherCache()
+{
+}
+
+void WeatherCache::setFilePath(const QString &filePath)
+{
+    cacheFilePath = filePath;
+}
+
+QString WeatherCache::filePath() const
+{
+    return cacheFilePath;
+}
+
+bool WeatherCache::load()
+{
+    QFile file(cacheFilePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "天气缓存不存在:" << cacheFilePath;
+        return false;
+    }
+
+    QJsonParseError jsonError;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &jsonError);
+    if (jsonError.error != QJsonParseError::NoError || !doc.isObject()) {
+        qWarning() << "天气缓存损坏，忽略:" << jsonError.errorString();
+        return false;
+    }
+
+    QJsonObject root = doc.object();
+    QDateTime fetchedAt = QDateTime::fromString(root["fetched_at"].toString(), Qt::ISODate);
+    QJsonObject observation = root["observation"].toObject();
+    if (!fetchedAt.isValid() || observation.isEmpty()) {
+        qWarning() << "天气缓存缺少必要字段，忽略";
+        return false;
+    }
+
+    cachedObservation = observation;
+    cachedFetchedAt = fetchedAt;
+    cachedEtag = root["etag"].toString().toUtf8();
+    cachedLastModified = root["last_modified"].toString().toUtf8();
+    qDebug() << "读取天气缓存成功，获取时间:" << cachedFetchedAt.toString("yyyy-MM-dd hh:mm:ss");
+    return true;
+}
+
+bool WeatherCache::save() const
+{
+    if (cacheFilePath.isEmpty() || cachedObservation.isEmpty()) {
+        return false;
+    }
+
+    QDir().mkpath(QFileInfo(cacheFilePath).absolutePath());
+
+    QJsonObject root;
+    root["fetched_at"] = cachedFetchedAt.toString(Qt::ISODate);
+    root["etag"] = QString::fromUtf8(cachedEtag);
+    root["last_modified"] = QString::fromUtf8(cachedLastModified);
+    root["observation"] = cachedObservation;
+
+    // 使用QSaveFile，写入过程中崩溃也不会留下半个文件
+    QSaveFile file(cacheFilePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "无法写入天气缓存:" << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        qWarning() << "提交天气缓存失败:" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool WeatherCache::hasObservation() const
+{
+    return !cachedObservation.isEmpty();
+}
+
+QJsonObject WeatherCache::observation() const
+{
+    return cachedObservation;
+}
+
+QDateTime WeatherCache::fetchedAt() const
+{
+    return cachedFetchedAt;
+}
+
+QByteArray WeatherCache::etag() const
+{
+    return cachedEtag;
+}
+
+QByteArray WeatherCache::lastModified() const
+{
+    return cachedLastModified;
+}
+
+void WeatherCache::store(const QJsonObject &observation, const QByteArray &etag, const QByteArray &lastModified)
+{
+    cachedObservation = observation;
+    cachedFetchedAt = QDateTime::currentDateTime();
+    cachedEtag = etag;
+    cachedLastModified = lastModified;
+}
+
+void WeatherCache::markRevalidated()
+{
+    cachedFetchedAt = QDateTime::currentDateTime();
+}
+
+WeatherCache::Freshness WeatherCache::freshness(const QDateTime &now) const
+{
+    if (!hasObservation() || !cachedFetchedAt.isValid()) {
+        return Expired;
+    }
+
+    qint64 age = cachedFetchedAt.secsTo(now);
+    if (age < 0) {
+        // 系统时间被调回，无法判断缓存年龄，按过期处理
+        return Expired;
+    }
+    if (age <= FreshSeconds) {
+        return Fresh;
+    }
+    if (age <= ExpiredSeconds) {
+        return Stale;
+    }
+    return Expired;
+}
+
+bool WeatherCache::isUsableForSmartControl(const QDateTime &now) const
+{
+    return freshness(now) != Expired;
+}
@@ -0,0 +1,57 @@
+#ifndef WEATHERCACHE_H
+#define WEATHERCACHE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QString>
+
+// 天气缓存：保存最近一次成功获取的实况天气及其获取时间，
+// 启动时先用缓存绘制状态栏，网络请求只负责刷新
+class WeatherCache
+{
+public:
+    // 缓存新鲜度：Fresh 正常使用；Stale 仍可显示和参与智能控制；Expired 只显示，不参与智能控制
+    enum Freshness {
+        Fresh,
+        Stale,
+        Expired
+    };
+
+    static constexpr qint64 FreshSeconds = 60 * 60;        // 1小时内视为新鲜
+    static constexpr qint64 ExpiredSeconds = 3 * 60 * 60;  // 超过3小时视为过期
+
+    WeatherCache();
+
+    void setFilePath(const QString &filePath);
+    QString filePath() const;
+
+    // 从磁盘读取缓存，文件不存在或损坏时返回false
+    bool load();
+    // 将缓存写回磁盘
+    bool save() const;
+
+    bool hasObservation() const;
+    QJsonObject observation() const;  // 完整的API响应（含now字段）
+    QDateTime fetchedAt() const;
+    QByteArray etag() const;
+    QByteArray lastModified() const;
+
+    // 记录一次成功的响应（200）
+    void store(const QJsonObject &observation, const QByteArray &etag, const QByteArray &lastModified);
+    // 服务器返回304，缓存内容仍然有效，只刷新获取时间
+    void markRevalidated();
+
+    Freshness freshness(const QDateTime &now = QDateTime::currentDateTime()) const;
+    // 智能空调是否可以使用缓存中的温度
+    bool isUsableForSmartControl(const QDateTime &now = QDateTime::currentDateTime()) const;
+
+private:
+    QString cacheFilePath;
+    QJsonObject cachedObservation;
+    QDateTime cachedFetchedAt;
+    QByteArray cachedEtag;
+    QByteArray cachedLastModified;
+};
+
+#endif // WEATHERCACHE_H
@@ -0,0 +1,89 @@
+#include "weatherpollpolicy.h"
+#include <QtMath>
+
+static const int MaxObservations = 4;
+static const int ThresholdMargin = 1;  // 距阈值1度以内视为接近
+static const double FastRatePerHour = 2.0;    // 每小时变化2度以上视为快速变化
+static const double StableRatePerHour = 0.5;  // 每小时变化不到0.5度视为稳定
+
+WeatherPollPolicy::WeatherPollPolicy()
+    : away(false)
+{
+}
+
+void WeatherPollPolicy::recordObservation(int temperature, const QDateTime &time)
+{
+    observations.append({time, temperature});
+    if (observations.size() > MaxObservations) {
+        observations.removeFirst();
+    }
+}
+
+void WeatherPollPolicy::setThresholds(const QVector<double> &values)
+{
+    thresholds = values;
+}
+
+void WeatherPollPolicy::setAway(bool awayMode)
+{
+    away = awayMode;
+}
+
+bool WeatherPollPolicy::isAway() const
+{
+    return away;
+}
+
+int WeatherPollPolicy::nextIntervalMs() const
+{
+    // 无人在家时空调不会自动开启，降低轮询频率
+    if (away) {
+        return AwayIntervalMs;
+    }
+
+    if (observations.size() < 2) {
+        return NormalIntervalMs;
+    }
+
+    double rate = recentRatePerHour();
+    if (rate >= FastRatePerHour || nearThreshold()) {
+        return FastIntervalMs;
+    }
+
+    // 最近几次观测温度都很稳定
+    if (observations.size() >= 3 && rate < StableRatePerHour) {
+        const Observation &oldest = observations.first();
+        const Observation &latest = observations.last();
+        double hours = oldest.time.secsTo(latest.time) / 3600.0;
+        if (hours > 0 && qAbs(latest.temperature - oldest.temperature) / hours < StableRatePerHour) {
+            return SlowIntervalMs;
+        }
+    }
+
+    return NormalIntervalMs;
+}
+
+double WeatherPollPolicy::recentRatePerHour() const
+{
+    const Observation &previous = observations.at(observations.size() - 2);
+    const Observation &latest = observations.last();
+    // 观测间隔过短时按10分钟计算，避免放大误差
+    double hours = qMax<qint64>(previous.time.secsTo(latest.time), 600) / 3600.0;
+    return qAbs(latest.temperature - previous.temperature) / hours;
+}
+
+bool WeatherPollPolicy::nearThreshold() const
+{
+    int latest = observations.last().temperature;
+    int previous = observations.at(observations.size() - 2).temperature;
+    for (double threshold : thresholds) {
+        if (qAbs(latest - threshold) <= ThresholdMargin) {
+            return true;
+        }
+        // 最近两次观测之间越过了阈值
+        if ((previous < threshold) != (latest < threshold)) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,42 @@
+#ifndef WEATHERPOLLPOLICY_H
+#define WEATHERPOLLPOLICY_H
+
+#include <QDateTime>
+#include <QVector>
+
+// 自适应天气轮询间隔：
+// 温度变化快或接近智能空调规则中的温度阈值时缩短间隔，温度稳定或无人在家时延长间隔
+class WeatherPollPolicy
+{
+public:
+    static constexpr int FastIntervalMs = 10 * 60 * 1000;      // 10分钟
+    static constexpr int NormalIntervalMs = 30 * 60 * 1000;    // 30分钟
+    static constexpr int SlowIntervalMs = 60 * 60 * 1000;      // 1小时
+    static constexpr int AwayIntervalMs = 2 * 60 * 60 * 1000;  // 2小时
+
+    WeatherPollPolicy();
+
+    void recordObservation(int temperature, const QDateTime &time = QDateTime::currentDateTime());
+    void setAway(bool awayMode);
+    // 智能空调规则中与室外温度比较的阈值，由规则引擎提供
+    void setThresholds(const QVector<double> &values);
+    bool isAway() const;
+
+    // 根据最近的观测计算下一次轮询的间隔
+    int nextIntervalMs() const;
+
+private:
+    struct Observation {
+        QDateTime time;
+        int temperature;
+    };
+
+    double recentRatePerHour() const;  // 最近两次观测之间每小时的温度变化
+    bool nearThreshold() const;        // 是否接近或刚越过空调阈值
+
+    QVector<Observation> observations;  // 最近几次观测，最新的在最后
+    QVector<double> thresholds;
+    bool away;
+};
+
+#endif // WEATHERPOLLPOLICY_H
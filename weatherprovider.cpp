@@ -0,0 +1,87 @@
+#include "weatherprovider.h"
+#include <QDebug>
+#include <QSettings>
+#include <QUrlQuery>
+
+// 默认配置，可在 QSettings 的 weather 分组中覆盖
+static const char *DefaultQWeatherUrl = "https://n66apx77xf.re.qweatherapi.com";
+static const char *DefaultQWeatherLocation = "101281601";
+static const char *DefaultQWeatherApiKey = "228b0b2673454eacb238fdefe86d9409";
+
+// 单次请求的传输超时，避免失败的请求长时间占用
+static const int WeatherRequestTimeoutMs = 10000;
+
+WeatherProvider::~WeatherProvider()
+{
+}
+
+QWeatherProvider::QWeatherProvider(const QString &baseUrl, const QString &location, const QString &apiKey)
+    : providerBaseUrl(baseUrl)
+    , providerLocation(location)
+    , providerApiKey(apiKey)
+{
+    // 去掉末尾的斜杠，拼接路径时统一添加
+    while (providerBaseUrl.endsWith('/')) {
+        providerBaseUrl.chop(1);
+    }
+}
+
+QWeatherProvider *QWeatherProvider::fromSettings()
+{
+    QSettings settings;
+    settings.beginGroup("weather");
+    QString baseUrl = settings.value("url", DefaultQWeatherUrl).toString();
+    QString location = settings.value("location", DefaultQWeatherLocation).toString();
+    QString apiKey = settings.value("api_key", DefaultQWeatherApiKey).toString();
+    settings.endGroup();
+
+    QString overrideUrl = qEnvironmentVariable("SMARTHOME_WEATHER_URL");
+    if (!overrideUrl.isEmpty()) {
+        qDebug() << "使用环境变量指定的天气服务地址:" << overrideUrl;
+        baseUrl = overrideUrl;
+    }
+
+    return new QWeatherProvider(baseUrl, location, apiKey);
+}
+
+QString QWeatherProvider::name() const
+{
+    return "QWeather";
+}
+
+QNetworkRequest QWeatherProvider::currentWeatherRequest() const
+{
+    return buildRequest("/v7/weather/now");
+}
+
+QNetworkRequest QWeatherProvider::hourlyForecastRequest() const
+{
+    return buildRequest("/v7/weather/24h");
+}
+
+QString QWeatherProvider::baseUrl() const
+{
+    return providerBaseUrl;
+}
+
+QString QWeatherProvider::location() const
+{
+    return providerLocation;
+}
+
+QNetworkRequest QWeatherProvider::buildRequest(const QString &path) const
+{
+    QUrl url(providerBaseUrl + path);
+    QUrlQuery query;
+    query.addQueryItem("location", providerLocation);
+    url.setQuery(query);
+
+    // 创建请求并添加API密钥到请求头
+    QNetworkRequest request(url);
+    request.setHeader(QNetworkRequest::UserAgentHeader, "QtSmartHomeApp/1.0");
+    request.setRawHeader("X-QW-Api-Key", providerApiKey.toUtf8());
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    request.setTransferTimeout(WeatherRequestTimeoutMs);
+#endif
+    return request;
+}
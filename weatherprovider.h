@@ -0,0 +1,45 @@
+#ifndef WEATHERPROVIDER_H
+#define WEATHERPROVIDER_H
+
+#include <QNetworkRequest>
+#include <QString>
+#include <QUrl>
+
+// 天气数据源接口：负责构造请求，响应的解析仍由 MainWindow::parseWeatherData 完成
+class WeatherProvider
+{
+public:
+    virtual ~WeatherProvider();
+
+    virtual QString name() const = 0;
+    // 实况天气请求
+    virtual QNetworkRequest currentWeatherRequest() const = 0;
+    // 未来24小时逐小时预报请求（一次请求返回全部小时）
+    virtual QNetworkRequest hourlyForecastRequest() const = 0;
+};
+
+// 和风天气（QWeather）数据源
+class QWeatherProvider : public WeatherProvider
+{
+public:
+    QWeatherProvider(const QString &baseUrl, const QString &location, const QString &apiKey);
+
+    // 从 QSettings 读取配置，环境变量 SMARTHOME_WEATHER_URL 可覆盖服务地址（例如指向本地模拟服务器）
+    static QWeatherProvider *fromSettings();
+
+    QString name() const override;
+    QNetworkRequest currentWeatherRequest() const override;
+    QNetworkRequest hourlyForecastRequest() const override;
+
+    QString baseUrl() const;
+    QString location() const;
+
+private:
+    QNetworkRequest buildRequest(const QString &path) const;
+
+    QString providerBaseUrl;
+    QString providerLocation;
+    QString providerApiKey;
+};
+
+#endif // WEATHERPROVIDER_H